@@ -72,6 +72,7 @@
  */
 #define ICAP_ERROR_INIT 6 
 #define ICAP_ERROR_NOMEM 12
+#define ICAP_ERROR_ACCESS 13
 #define ICAP_ERROR_BUSY 16
 #define ICAP_ERROR_INVALID 22
 #define ICAP_ERROR_BROKEN_CON 32
@@ -108,6 +109,8 @@
 #define ICAP_FORMAT_FLOAT_BE 15
 #define ICAP_FORMAT_FLOAT64_LE 16
 #define ICAP_FORMAT_FLOAT64_BE 17
+#define ICAP_FORMAT_S24_3LE 18 /**< Packed in 3 bytes */
+#define ICAP_FORMAT_S24_3BE 19 /**< Packed in 3 bytes */
 /**@}*/
 
 /**
@@ -132,6 +135,8 @@
 #define ICAP_FMTBIT_FLOAT_BE (1<<ICAP_FORMAT_FLOAT_BE)
 #define ICAP_FMTBIT_FLOAT64_LE (1<<ICAP_FORMAT_FLOAT64_LE)
 #define ICAP_FMTBIT_FLOAT64_BE (1<<ICAP_FORMAT_FLOAT64_BE)
+#define ICAP_FMTBIT_S24_3LE (1<<ICAP_FORMAT_S24_3LE)
+#define ICAP_FMTBIT_S24_3BE (1<<ICAP_FORMAT_S24_3BE)
 /**@}*/
 
 /**
@@ -191,6 +196,32 @@
 #define ICAP_BUF_NAME_LEN (64)
 #define ICAP_BUF_MAX_FRAGS_OFFSETS_NUM (64)
 
+/** @brief Request the earliest fragment boundary the device can switch at */
+#define ICAP_FRAG_NEXT ((uint64_t)-1)
+
+/** @brief Max number of subdevices started together by icap_start_group() */
+#define ICAP_SCHED_GROUP_MAX (16)
+
+/** @brief Max number of channels with a meter in icap_ctrl_meters */
+#define ICAP_CTRL_CHANNELS_MAX (16)
+
+/** @brief Max number of playback channels in icap_monitor_route.channel_map */
+#define ICAP_MONITOR_CHANNELS_MAX (16)
+
+/** @brief Playback channel without a monitored record channel */
+#define ICAP_MONITOR_CHANNEL_NONE (0xffffffff)
+
+/** @brief Max number of processing blocks in a subdevice chain, see icap_set_dsp_chain() */
+#define ICAP_DSP_BLOCKS_MAX (8)
+
+/** @brief Processing block types, used in icap_dsp_chain.blocks */
+enum icap_dsp_type {
+	ICAP_DSP_NONE = 0, /**< Empty slot, passes the samples unchanged */
+	ICAP_DSP_GAIN = 1, /**< Gain with linear ramp, icap_dsp_gain */
+	ICAP_DSP_BIQUAD = 2, /**< Second order IIR filter, icap_dsp_biquad */
+	ICAP_DSP_LIMITER = 3, /**< Peak limiter, icap_dsp_limiter */
+};
+
 /** @brief ICAP subdevice type */
 enum icap_dev_type {
 	ICAP_DEV_PLAYBACK = 0, /**< Playback subdevice */
@@ -205,32 +236,33 @@ enum icap_buf_type {
 
 	/** Audio fragments are scattered, needs new #icap_buf_offsets after fragments are consumed */
 	ICAP_BUF_SCATTERED = 1,
-};
 
-/** @brief ICAP instance, initialized by icap_device_init() or
- * icap_application_init() except of some members in #icap_transport */
-struct icap_instance {
-	/** @brief Platform specific transport internals, some fields of this stuct
-	 * must be initialized before icap_device_init() or icap_application_init() */
-	struct icap_transport transport;
-
-	/** @brief Optional ICAP instance name */
-	char *name;
+	/** Non-interleaved, each channel has its own plane of fragments laid out like
+	 * #ICAP_BUF_CIRCURAL, planes are icap_buf_descriptor.channel_stride apart */
+	ICAP_BUF_PLANAR = 2,
+};
 
-	/** @brief ICAP instance type, one of the #icap_instance_type */
-	uint32_t type;
+/**
+ * @defgroup buf_type_bit Buffer type bit field
+ * @{
+ */
+#define ICAP_BUFBIT_CIRCURAL (1<<ICAP_BUF_CIRCURAL)
+#define ICAP_BUFBIT_SCATTERED (1<<ICAP_BUF_SCATTERED)
+#define ICAP_BUFBIT_PLANAR (1<<ICAP_BUF_PLANAR)
+/**@}*/
 
-	/** @brief Private pointer for caller use */
-	void *priv;
+/** @brief Time base of a scheduled action, defines icap_sched.time_base */
+enum icap_time_base {
+	/** Act as soon as possible, the time field is ignored */
+	ICAP_TIME_NOW = 0,
 
-	/** @brief Pointer to callbacks #icap_device_callbacks or icap_application_callbacks */
-	void *callbacks;
+	/** Time field is a frame count of the subdevice audio clock */
+	ICAP_TIME_FRAMES = 1,
 
-	/** @brief Internal counter for messages */
-	uint32_t seq_num;
+	/** Time field is a device timestamp in nanoseconds */
+	ICAP_TIME_TIMESTAMP = 2,
 };
 
-
 /**
  * @defgroup msg_structs Message structs send and received by application and device sides.
  * @{
@@ -247,16 +279,20 @@ struct icap_buf_descriptor {
 	/** @brief Pointer to shared memory with the audio data */
 	uint64_t buf;
 
-	/** @brief Size of the shared memory */
+	/** @brief Size of the shared memory, size of one channel plane for
+	 * #ICAP_BUF_PLANAR, the whole buffer then spans
+	 * (channels - 1) * channel_stride + buf_size bytes */
 	uint32_t buf_size;
 
 	/** @brief Buffer type, one of the #icap_buf_type */
 	uint32_t type;
 
-	/** @brief Gaps between audio fragments in the shared memory */
+	/** @brief Gaps between audio fragments in the shared memory,
+	 * gaps between fragments of one channel for #ICAP_BUF_PLANAR */
 	uint32_t gap_size;
 
-	/** @brief Audio fragments size in the shared memory */
+	/** @brief Audio fragments size in the shared memory,
+	 * size of a fragment of one channel for #ICAP_BUF_PLANAR */
 	uint32_t frag_size;
 
 	/** @brief Number of channels */
@@ -270,6 +306,10 @@ struct icap_buf_descriptor {
 
 	/** @brief Set this flag if ICAP device must report that it consumed audio fragment from this buffer */
 	uint32_t report_frags;
+
+	/** @brief Distance in bytes between the first fragments of consecutive channels,
+	 * at least buf_size, used only with #ICAP_BUF_PLANAR */
+	uint32_t channel_stride;
 }ICAP_PACKED_END;
 
 /** @brief Struct send by icap_frag_ready() device function */
@@ -282,6 +322,19 @@ struct icap_buf_frags {
 	uint32_t frags;
 }ICAP_PACKED_END;
 
+/** @brief Struct send by icap_frag_ready_ts() device function,
+ * #icap_buf_frags extended with the time the fragments were consumed at */
+ICAP_PACKED_BEGIN
+struct icap_buf_frags_ts {
+	/** @brief Buffer id and number of consumed fragments, must be the first member */
+	struct icap_buf_frags frags;
+
+	/** @brief Device timestamp in nanoseconds when the last fragment was consumed */
+	uint64_t timestamp;
+
+	/** @brief Buffer frame position at the #timestamp, counted from subdevice start */
+	uint64_t position;
+}ICAP_PACKED_END;
 
 /** @brief Struct send by icap_frags() application function, used with #ICAP_BUF_SCATTERED buffer type */
 ICAP_PACKED_BEGIN
@@ -319,6 +372,9 @@ struct icap_subdevice_features {
 
 	/** @brief Supported sample rates, bitfield @ref sample_rate */
 	uint32_t rates;
+
+	/** @brief Supported buffer types, bitfield @ref buf_type_bit */
+	uint32_t buf_types;
 }ICAP_PACKED_END;
 
 /** @brief Subdevice params to be initialized with, send by icap_subdevice_init() */
@@ -336,6 +392,225 @@ struct icap_subdevice_params {
 	uint32_t rate;
 }ICAP_PACKED_END;
 
+/** @brief Scheduled action on a subdevice, send by icap_start_at(),
+ * icap_stop_at(), icap_pause_at() and icap_resume_at() */
+ICAP_PACKED_BEGIN
+struct icap_sched {
+	/** @brief Subdevice id the action applies to */
+	uint32_t subdev_id;
+
+	/** @brief Time base of the #time field, one of the #icap_time_base */
+	uint32_t time_base;
+
+	/** @brief Frame count or device timestamp at which the action takes effect */
+	uint64_t time;
+}ICAP_PACKED_END;
+
+/** @brief New fragment geometry of a running buffer, send by icap_set_buf_geometry() */
+ICAP_PACKED_BEGIN
+struct icap_buf_geometry {
+	/** @brief Buffer which fragment geometry changes */
+	uint32_t buf_id;
+
+	/** @brief New audio fragments size */
+	uint32_t frag_size;
+
+	/** @brief New gaps between audio fragments */
+	uint32_t gap_size;
+
+	/** @brief Fragment index, counted from the subdevice start, from which the new
+	 * geometry applies or #ICAP_FRAG_NEXT. The device responds with the confirmed
+	 * index which is never earlier than requested. */
+	uint64_t frag;
+}ICAP_PACKED_END;
+
+/** @brief Replacement of a running buffer, send by icap_switch_buf() */
+ICAP_PACKED_BEGIN
+struct icap_buf_switch {
+	/** @brief Running buffer to be replaced */
+	uint32_t buf_id;
+
+	/** @brief Fragment index, counted from the subdevice start, from which the new
+	 * buffer is used or #ICAP_FRAG_NEXT. The device confirms the index which is
+	 * never earlier than requested. */
+	uint64_t frag;
+
+	/** @brief Descriptor of the new buffer, must have the same direction and subdevice */
+	struct icap_buf_descriptor buf;
+}ICAP_PACKED_END;
+
+/** @brief Response to icap_switch_buf() */
+ICAP_PACKED_BEGIN
+struct icap_buf_switch_point {
+	/** @brief Buffer id assigned to the new buffer by device side */
+	uint32_t buf_id;
+
+	/** @brief Confirmed fragment index the new buffer is used from */
+	uint64_t frag;
+}ICAP_PACKED_END;
+
+/** @brief Group of subdevices started together, send by icap_start_group() */
+ICAP_PACKED_BEGIN
+struct icap_sched_group {
+	/** @brief Time base of the #time field, one of the #icap_time_base.
+	 * For #ICAP_TIME_FRAMES the frame count refers to the first subdevice in the group. */
+	uint32_t time_base;
+
+	/** @brief Frame count or device timestamp at which the subdevices start */
+	uint64_t time;
+
+	/** @brief Number of valid entries in the #subdev_ids */
+	uint32_t num;
+
+	/** @brief Subdevices to be started phase-aligned */
+	uint32_t subdev_ids[ICAP_SCHED_GROUP_MAX];
+}ICAP_PACKED_END;
+
+/** @brief Direct monitoring route from record to playback subdevice, send by icap_set_monitor() */
+ICAP_PACKED_BEGIN
+struct icap_monitor_route {
+	/** @brief Record subdevice the samples are taken from */
+	uint32_t src_subdev_id;
+
+	/** @brief Playback subdevice the samples are mixed into */
+	uint32_t dst_subdev_id;
+
+	/** @brief Non zero enables the route, 0 removes it */
+	uint32_t enable;
+
+	/** @brief Gain of the monitored samples, unsigned Q16.16 */
+	uint32_t gain;
+
+	/** @brief Number of valid entries in the #channel_map */
+	uint32_t channels;
+
+	/** @brief Record channel mixed into each playback channel or #ICAP_MONITOR_CHANNEL_NONE */
+	uint32_t channel_map[ICAP_MONITOR_CHANNELS_MAX];
+}ICAP_PACKED_END;
+
+/** @brief Shared control block of a subdevice, send by icap_set_ctrl_block() */
+ICAP_PACKED_BEGIN
+struct icap_ctrl_desc {
+	/** @brief Subdevice the control block belongs to */
+	int32_t subdev_id;
+
+	/** @brief Pointer to shared memory with struct icap_ctrl_block, 0 detaches the block */
+	uint64_t addr;
+
+	/** @brief Size of the shared memory, at least sizeof(struct icap_ctrl_block) */
+	uint32_t size;
+}ICAP_PACKED_END;
+
+/** @brief Parameters written by application side to the control block */
+ICAP_PACKED_BEGIN
+struct icap_ctrl_params {
+	/** @brief Gain, unsigned Q16.16 */
+	uint32_t gain;
+
+	/** @brief Non zero mutes all channels */
+	uint32_t mute;
+
+	/** @brief Bit per channel, channels with the bit cleared are muted */
+	uint32_t channel_mask;
+
+	/** @brief Reserved for future use */
+	uint32_t reserved;
+}ICAP_PACKED_END;
+
+/** @brief Meters written back by device side to the control block */
+ICAP_PACKED_BEGIN
+struct icap_ctrl_meters {
+	/** @brief Frames processed by the subdevice when the meters were written */
+	uint64_t frames;
+
+	/** @brief Peak level of each channel in the last fragment, unsigned Q1.31 of the full scale */
+	uint32_t peak[ICAP_CTRL_CHANNELS_MAX];
+}ICAP_PACKED_END;
+
+/** @brief Control block in shared memory, see icap_ctrl.h. Each half has a single
+ * writer and is protected by its own sequence counter, odd while being written. */
+ICAP_PACKED_BEGIN
+struct icap_ctrl_block {
+	/** @brief Sequence counter of the #params */
+	uint32_t params_seq;
+
+	/** @brief Parameters written by application side */
+	struct icap_ctrl_params params;
+
+	/** @brief Sequence counter of the #meters */
+	uint32_t meters_seq;
+
+	/** @brief Meters written by device side */
+	struct icap_ctrl_meters meters;
+}ICAP_PACKED_END;
+
+/** @brief Processing chain of a subdevice, send by icap_set_dsp_chain() */
+ICAP_PACKED_BEGIN
+struct icap_dsp_chain {
+	/** @brief Subdevice the chain runs on */
+	uint32_t subdev_id;
+
+	/** @brief Number of valid entries in the #blocks, 0 removes the chain */
+	uint32_t num;
+
+	/** @brief Block types in processing order, one of the #icap_dsp_type */
+	uint32_t blocks[ICAP_DSP_BLOCKS_MAX];
+}ICAP_PACKED_END;
+
+/** @brief Parameters of #ICAP_DSP_GAIN */
+ICAP_PACKED_BEGIN
+struct icap_dsp_gain {
+	/** @brief Target gain, unsigned Q16.16 */
+	uint32_t gain;
+
+	/** @brief Frames to ramp from the current gain to the target, 0 to jump */
+	uint32_t ramp_frames;
+}ICAP_PACKED_END;
+
+/** @brief Parameters of #ICAP_DSP_BIQUAD, coefficients normalized to a0 = 1.0
+ * in signed Q2.30, the same filter runs on every channel */
+ICAP_PACKED_BEGIN
+struct icap_dsp_biquad {
+	int32_t b0;
+	int32_t b1;
+	int32_t b2;
+	int32_t a1;
+	int32_t a2;
+}ICAP_PACKED_END;
+
+/** @brief Parameters of #ICAP_DSP_LIMITER */
+ICAP_PACKED_BEGIN
+struct icap_dsp_limiter {
+	/** @brief Peak level the output is limited to, unsigned Q1.31 of the full scale */
+	uint32_t threshold;
+
+	/** @brief Envelope attack time in frames, 0 limits instantly */
+	uint32_t attack_frames;
+
+	/** @brief Envelope release time in frames */
+	uint32_t release_frames;
+}ICAP_PACKED_END;
+
+/** @brief Parameters of one block in the processing chain, send by icap_set_dsp_params() */
+ICAP_PACKED_BEGIN
+struct icap_dsp_params {
+	/** @brief Subdevice the chain runs on */
+	uint32_t subdev_id;
+
+	/** @brief Index of the block in icap_dsp_chain.blocks */
+	uint32_t block;
+
+	/** @brief Type of the block, must match the chain, one of the #icap_dsp_type */
+	uint32_t type;
+
+	/** @brief Parameters, valid field depends on #type */
+	union {
+		struct icap_dsp_gain gain;
+		struct icap_dsp_biquad biquad;
+		struct icap_dsp_limiter limiter;
+	} u;
+}ICAP_PACKED_END;
+
 /**@}*/
 
 /** @brief Used to verify remote address, only rpmsg supported currently */
@@ -344,6 +619,308 @@ union icap_remote_addr {
 	void *tcpip_addr;
 };
 
+/** @brief Cross-core clock estimator state, updated by timestamped fragment
+ * reports, see icap_get_clock_sync() */
+struct icap_clock_est {
+	/** @brief Number of timestamped reports the estimator was fed with */
+	uint32_t samples;
+
+	/** @brief Buffer which sent the last timestamped report */
+	uint32_t buf_id;
+
+	/** @brief Frame position from the last timestamped report */
+	uint64_t position;
+
+	/** @brief Device timestamp from the last timestamped report */
+	uint64_t dev_base;
+
+	/** @brief Filtered local time corresponding to the #dev_base */
+	uint64_t local_base;
+
+	/** @brief Rate deviation of the local clock against device clock, Q32 format */
+	int64_t rate_dev;
+};
+
+/** @brief Number of commands with separate round trip time statistics */
+#define ICAP_RTT_SLOTS (32)
+
+/** @brief Round trip time statistics of a command */
+struct icap_rtt {
+	/** @brief Smoothed round trip time in microseconds */
+	uint32_t srtt_us;
+
+	/** @brief Round trip time variation in microseconds */
+	uint32_t rttvar_us;
+
+	/** @brief Number of measurements since the last timeout */
+	uint32_t samples;
+};
+
+/** @brief Peer liveness and message timeouts state, see icap_set_heartbeat()
+ * and icap_set_msg_timeout() */
+struct icap_link {
+	/** @brief Heartbeat period in microseconds, 0 if heartbeat disabled */
+	uint32_t heartbeat_us;
+
+	/** @brief Set if the peer sent any message recently */
+	uint32_t peer_alive;
+
+	/** @brief Local time the last message was received from the peer */
+	uint64_t last_rx;
+
+	/** @brief Local time the last heartbeat was sent */
+	uint64_t last_heartbeat;
+
+	/** @brief Lower bound of the adaptive message timeout */
+	uint32_t timeout_min_us;
+
+	/** @brief Session id of this instance, send in every message header */
+	uint32_t session;
+
+	/** @brief Session id received with the last heartbeat from the peer */
+	uint32_t peer_session;
+
+	/** @brief Set once the peer echoed the #session in a heartbeat response */
+	uint32_t peer_synced;
+
+	/** @brief Number of threads waiting for a response */
+	uint32_t sync_depth;
+
+	/** @brief Upper bound of the adaptive message timeout */
+	uint32_t timeout_max_us;
+
+	/** @brief Multiplier applied to the measured RTT, 0 disables adaptive timeouts */
+	uint32_t timeout_mult;
+
+	/** @brief Round trip time statistics per command */
+	struct icap_rtt rtt[ICAP_RTT_SLOTS];
+};
+
+/** @brief Max response payload kept in the response cache */
+#define ICAP_RESP_CACHE_PAYLOAD (ICAP_BUF_NAME_LEN)
+
+/** @brief Response remembered to answer a retransmitted message without executing it again */
+struct icap_resp_cache_entry {
+	/** @brief Set if the entry holds a response */
+	uint32_t valid;
+
+	/** @brief Session id of the message sender */
+	uint32_t session;
+
+	/** @brief Device session index of the message sender */
+	uint32_t peer;
+
+	/** @brief Sequence number of the message */
+	uint32_t seq_num;
+
+	/** @brief Command of the message */
+	uint32_t cmd;
+
+	/** @brief Response type, ACK or NAK */
+	uint32_t type;
+
+	/** @brief Response payload length */
+	uint32_t payload_len;
+
+	/** @brief Response payload */
+	uint8_t payload[ICAP_RESP_CACHE_PAYLOAD];
+};
+
+/** @brief Cache of the last responses sent, see #ICAP_RESP_CACHE_SIZE */
+struct icap_resp_cache {
+	/** @brief Next entry to be replaced */
+	uint32_t next;
+
+	/** @brief Session id of the message being parsed */
+	uint32_t rx_session;
+
+	/** @brief Cached responses */
+	struct icap_resp_cache_entry entries[ICAP_RESP_CACHE_SIZE];
+};
+
+/** @brief Subdevice run state recorded in the session journal */
+enum icap_run_state {
+	ICAP_RUN_STOPPED = 0, /**< Subdevice initialized but not started. */
+	ICAP_RUN_RUNNING = 1, /**< Subdevice started. */
+	ICAP_RUN_PAUSED = 2, /**< Subdevice started and paused. */
+};
+
+/** @brief Subdevice entry of the session journal */
+struct icap_journal_subdev {
+	/** @brief Set if the subdevice was initialized by icap_subdevice_init() */
+	uint32_t used;
+
+	/** @brief Subdevice run state, one of the #icap_run_state */
+	uint32_t run_state;
+
+	/** @brief Params the subdevice was initialized with */
+	struct icap_subdevice_params params;
+
+	/** @brief Chain set by icap_set_dsp_chain(), icap_dsp_chain.num = 0 if none */
+	struct icap_dsp_chain dsp_chain;
+
+	/** @brief Bit set for each block of the chain with #dsp_params */
+	uint32_t dsp_params_set;
+
+	/** @brief Last params set by icap_set_dsp_params() for each block of the chain */
+	struct icap_dsp_params dsp_params[ICAP_DSP_BLOCKS_MAX];
+
+	/** @brief Control block set by icap_set_ctrl_block(), icap_ctrl_desc.addr = 0 if none */
+	struct icap_ctrl_desc ctrl;
+};
+
+/** @brief Buffer entry of the session journal */
+struct icap_journal_buf {
+	/** @brief Set if the buffer is attached */
+	uint32_t used;
+
+	/** @brief Buffer direction, one of the #icap_dev_type */
+	uint32_t dir;
+
+	/** @brief Buffer id returned to the application by icap_add_src() or icap_add_dst() */
+	uint32_t app_id;
+
+	/** @brief Buffer id assigned by the device in the current device session */
+	uint32_t dev_id;
+
+	/** @brief Buffer descriptor the buffer was attached with */
+	struct icap_buf_descriptor buf;
+};
+
+/** @brief Session state established by the application, replayed by icap_session_resume() */
+struct icap_journal {
+	/** @brief Set when the device lost the session state */
+	uint32_t resume_pending;
+
+	/** @brief Subdevices indexed by subdevice id */
+	struct icap_journal_subdev subdevs[ICAP_JOURNAL_SUBDEVS];
+
+	/** @brief Attached buffers */
+	struct icap_journal_buf bufs[ICAP_JOURNAL_BUFS];
+
+	/** @brief Monitor routes set by icap_set_monitor(), icap_monitor_route.enable = 0 if unused */
+	struct icap_monitor_route monitors[ICAP_JOURNAL_MONITORS];
+};
+
+/** @brief Subdevice access for all sessions, see icap_device_subdevice_access() */
+#define ICAP_SESSION_SHARED ((uint32_t)-1)
+
+/** @brief Subdevice claimed by the first session using it until deinitialized,
+ * see icap_device_subdevice_access() */
+#define ICAP_SESSION_ANY ((uint32_t)-2)
+
+/** @brief Subdevice not claimed by any session */
+#define ICAP_SESSION_NONE ((uint32_t)-3)
+
+/** @brief Application endpoint served by a multi-session device */
+struct icap_session {
+	/** @brief Set if the session is in use */
+	uint32_t used;
+
+	/** @brief Remote address of the application endpoint */
+	union icap_remote_addr addr;
+
+	/** @brief Counter for messages send to the session */
+	uint32_t seq_num;
+
+	/** @brief Session id received with the last heartbeat from the endpoint */
+	uint32_t peer_session;
+
+	/** @brief Local time the last message was received from the endpoint */
+	uint64_t last_rx;
+};
+
+/** @brief Buffer owned by a session */
+struct icap_session_buf {
+	/** @brief Set if the entry is in use */
+	uint32_t used;
+
+	/** @brief Buffer id assigned by the device */
+	uint32_t buf_id;
+
+	/** @brief Subdevice of the buffer */
+	uint32_t subdev_id;
+
+	/** @brief Session index which attached the buffer */
+	uint32_t session;
+};
+
+/** @brief Multi-session device state, see icap_device_enable_sessions() */
+struct icap_sessions {
+	/** @brief Set if the device serves multiple application endpoints */
+	uint32_t enabled;
+
+	/** @brief Session index of the message being parsed */
+	uint32_t current;
+
+	/** @brief Application endpoints */
+	struct icap_session sessions[ICAP_SESSIONS_MAX];
+
+	/** @brief Subdevice access policy: session index, #ICAP_SESSION_SHARED or #ICAP_SESSION_ANY */
+	uint32_t subdev_access[ICAP_SESSION_SUBDEVS];
+
+	/** @brief Session index which claimed a #ICAP_SESSION_ANY subdevice or #ICAP_SESSION_NONE */
+	uint32_t subdev_owner[ICAP_SESSION_SUBDEVS];
+
+	/** @brief Buffers attached by the sessions */
+	struct icap_session_buf bufs[ICAP_SESSION_BUFS];
+};
+
+struct icap_proxy;
+struct icap_cache;
+struct icap_arena;
+struct icap_xlat;
+
+/** @brief ICAP instance, initialized by icap_device_init() or
+ * icap_application_init() except of some members in #icap_transport */
+struct icap_instance {
+	/** @brief Platform specific transport internals, some fields of this stuct
+	 * must be initialized before icap_device_init() or icap_application_init() */
+	struct icap_transport transport;
+
+	/** @brief Optional ICAP instance name */
+	char *name;
+
+	/** @brief ICAP instance type, one of the #icap_instance_type */
+	uint32_t type;
+
+	/** @brief Private pointer for caller use */
+	void *priv;
+
+	/** @brief Pointer to callbacks #icap_device_callbacks or icap_application_callbacks */
+	void *callbacks;
+
+	/** @brief Internal counter for messages */
+	uint32_t seq_num;
+
+	/** @brief Internal device clock estimator, application side only */
+	struct icap_clock_est clock;
+
+	/** @brief Internal peer liveness and message timeouts state */
+	struct icap_link link;
+
+	/** @brief Internal session journal, application side only */
+	struct icap_journal journal;
+
+	/** @brief Internal cache of responses for duplicate suppression */
+	struct icap_resp_cache resp_cache;
+
+	/** @brief Internal multi-session state, device side only */
+	struct icap_sessions sessions;
+
+	/** @brief Proxy forwarding the messages, see icap_proxy_init() */
+	struct icap_proxy *proxy;
+
+	/** @brief Cache maintenance of non-coherent buffers, see icap_set_cache() */
+	struct icap_cache *cache;
+
+	/** @brief Shared memory allocator tied to the buffer ids, see icap_set_arena() */
+	struct icap_arena *arena;
+
+	/** @brief Translation of received buffer addresses, see icap_set_xlat() */
+	struct icap_xlat *xlat;
+};
+
 /**
  * @defgroup msg_handlers Handling of the ICAP messages.
  * @{
@@ -381,4 +958,55 @@ int32_t icap_loop(struct icap_instance *icap);
 
 /**@}*/
 
+/**
+ * @defgroup link_functions Peer liveness and message timeouts.
+ * @{
+ */
+
+/**
+ * @brief Enable periodic heartbeat messages. The peer responds to them
+ * without any callback. If nothing is received from the peer for
+ * #ICAP_HEARTBEAT_MISS_MAX periods the peer is considered dead,
+ * the link_state() callback is executed and synchronous functions fail
+ * immediately with -#ICAP_ERROR_BROKEN_CON until the peer responds again.
+ * On application side the heartbeat also detects a restarted device and replays
+ * the session journal, see icap_session_resume(). On device side in the
+ * multi-session mode each application endpoint is checked separately and
+ * removed once it stops responding, see icap_device_callbacks.session_lost.
+ * 
+ * @param icap Pointer to ICAP instance.
+ * @param period_us Heartbeat period in microseconds, 0 disables the heartbeat.
+ * @return int32_t Returns 0 on success, negative error code on failure.
+ */
+int32_t icap_set_heartbeat(struct icap_instance *icap, uint32_t period_us);
+
+/**
+ * @brief Sends a heartbeat if due and checks peer liveness. Must be called
+ * periodically when the heartbeat is enabled, icap_loop() calls it
+ * on bare metal platform, Linux kernel platform calls it from a workqueue.
+ * 
+ * @param icap Pointer to ICAP instance.
+ * @return int32_t Returns 0 on success, negative error code on failure.
+ */
+int32_t icap_heartbeat(struct icap_instance *icap);
+
+/**
+ * @brief Configure timeouts of synchronous functions. Each command timeout
+ * adapts to its measured round trip time: (srtt + 4 * rttvar) * rtt_mult,
+ * limited to the min_us and max_us range. Until a few round trips are measured,
+ * after a timeout or with rtt_mult 0, each attempt waits
+ * max_us / (#ICAP_MSG_RETRIES + 1). A lost message is retransmitted up to
+ * #ICAP_MSG_RETRIES times, every attempt with the same timeout without backoff.
+ * 
+ * @param icap Pointer to ICAP instance.
+ * @param min_us Lower bound of the timeout in microseconds.
+ * @param max_us Upper bound of the timeout in microseconds.
+ * @param rtt_mult Multiplier applied to the measured RTT, 0 disables the adaptation.
+ * @return int32_t Returns 0 on success, negative error code on failure.
+ */
+int32_t icap_set_msg_timeout(struct icap_instance *icap, uint32_t min_us,
+		uint32_t max_us, uint32_t rtt_mult);
+
+/**@}*/
+
 #endif /* _ICAP_H_ */
@@ -69,9 +69,41 @@
  * 
  */
 struct icap_application_callbacks {
+	/** @brief Executed on icap_frag_ready() and icap_frag_ready_ts(), timestamped
+	 * reports update the device clock estimation before the callback is executed. */
 	int32_t (*frag_ready)(struct icap_instance *icap, struct icap_buf_frags *frags);
 	int32_t (*xrun)(struct icap_instance *icap, struct icap_buf_frags *frags);
 	int32_t (*error)(struct icap_instance *icap, int32_t error_code);
+
+	/** @brief Executed when the device stops or starts responding,
+	 * requires heartbeat enabled by icap_set_heartbeat(). */
+	int32_t (*link_state)(struct icap_instance *icap, uint32_t peer_alive);
+};
+
+/** @brief Device clock relation estimated from timestamped fragment reports,
+ * returned by icap_get_clock_sync() */
+struct icap_clock_sync {
+	/** @brief Buffer which sent the last timestamped report */
+	uint32_t buf_id;
+
+	/** @brief Buffer frame position from the last timestamped report */
+	uint64_t position;
+
+	/** @brief Device timestamp of the #position */
+	uint64_t dev_timestamp;
+
+	/** @brief Estimated local time of the #position, in nanoseconds */
+	uint64_t local_timestamp;
+
+	/** @brief Offset of the local clock against the device clock, in nanoseconds */
+	int64_t offset;
+
+	/** @brief Device clock rate deviation from the local clock in parts per billion,
+	 * positive if the device clock runs faster */
+	int32_t drift_ppb;
+
+	/** @brief Local time elapsed since the #position was consumed, in nanoseconds */
+	uint64_t delay;
 };
 
 /**@}*/
@@ -223,6 +255,123 @@ int32_t icap_pause(struct icap_instance *icap, uint32_t subdev_id);
  */
 int32_t icap_resume(struct icap_instance *icap, uint32_t subdev_id);
 
+/**
+ * @brief Start audio on a subdevice at a given frame count or device timestamp.
+ * 
+ * @param icap Pointer to ICAP instance.
+ * @param sched Subdevice to be started and the time it should start at.
+ * @return int32_t Returns 0 on success, negative error code on failure.
+ */
+int32_t icap_start_at(struct icap_instance *icap, struct icap_sched *sched);
+
+/**
+ * @brief Stop audio on a subdevice at a given frame count or device timestamp.
+ * 
+ * @param icap Pointer to ICAP instance.
+ * @param sched Subdevice to be stopped and the time it should stop at.
+ * @return int32_t Returns 0 on success, negative error code on failure.
+ */
+int32_t icap_stop_at(struct icap_instance *icap, struct icap_sched *sched);
+
+/**
+ * @brief Pause audio on a subdevice at a given frame count or device timestamp.
+ * 
+ * @param icap Pointer to ICAP instance.
+ * @param sched Subdevice to be paused and the time it should pause at.
+ * @return int32_t Returns 0 on success, negative error code on failure.
+ */
+int32_t icap_pause_at(struct icap_instance *icap, struct icap_sched *sched);
+
+/**
+ * @brief Resume paused audio on a subdevice at a given frame count or device timestamp.
+ * 
+ * @param icap Pointer to ICAP instance.
+ * @param sched Subdevice to be resumed and the time it should resume at.
+ * @return int32_t Returns 0 on success, negative error code on failure.
+ */
+int32_t icap_resume_at(struct icap_instance *icap, struct icap_sched *sched);
+
+/**
+ * @brief Arm several subdevices with a single message, the subdevices start
+ * phase-aligned on the same frame.
+ * 
+ * @param icap Pointer to ICAP instance.
+ * @param group Subdevices to be started and the time they should start at.
+ * @return int32_t Returns 0 on success, negative error code on failure.
+ */
+int32_t icap_start_group(struct icap_instance *icap, struct icap_sched_group *group);
+
+/**
+ * @brief Change fragment size and gap size of a running buffer without
+ * stopping the subdevice. Both sides switch to the new geometry at the same
+ * fragment boundary confirmed by the device.
+ * 
+ * @param icap Pointer to ICAP instance.
+ * @param [in,out] geometry New geometry and requested switch fragment,
+ * on success icap_buf_geometry.frag is set to the switch fragment confirmed by the device.
+ * @return int32_t Returns 0 on success, negative error code on failure.
+ */
+int32_t icap_set_buf_geometry(struct icap_instance *icap, struct icap_buf_geometry *geometry);
+
+/**
+ * @brief Replace a running buffer with a new one at a fragment boundary,
+ * the device moves to the new buffer without an underrun. The old buffer is
+ * released by the device after the switch, icap_remove_src() or icap_remove_dst()
+ * isn't needed for it.
+ * 
+ * @param icap Pointer to ICAP instance.
+ * @param [in,out] buf_switch Buffer to be replaced, the new buffer descriptor and
+ * requested switch fragment, on success icap_buf_switch.frag is set to the switch
+ * fragment confirmed by the device.
+ * @return int32_t Returns buffer_id of the new buffer, negative error code on failure.
+ */
+int32_t icap_switch_buf(struct icap_instance *icap, struct icap_buf_switch *buf_switch);
+
+/**
+ * @brief Set the chain of processing blocks the device runs in place on each
+ * fragment of a subdevice. Blocks keep their parameters when the chain is set
+ * again with the same type on the same position, new blocks start with
+ * parameters passing the samples unchanged.
+ * 
+ * @param icap Pointer to ICAP instance.
+ * @param chain Subdevice and the block types in processing order.
+ * @return int32_t Returns 0 on success, negative error code on failure.
+ */
+int32_t icap_set_dsp_chain(struct icap_instance *icap, struct icap_dsp_chain *chain);
+
+/**
+ * @brief Set parameters of a processing block, can be called while the
+ * subdevice is running.
+ * 
+ * @param icap Pointer to ICAP instance.
+ * @param params Subdevice, block index and the new parameters.
+ * @return int32_t Returns 0 on success, negative error code on failure.
+ */
+int32_t icap_set_dsp_params(struct icap_instance *icap, struct icap_dsp_params *params);
+
+/**
+ * @brief Attach a control block in shared memory to a subdevice. Afterwards
+ * parameters are updated with icap_ctrl_write_params() and meters are read with
+ * icap_ctrl_read_meters() without sending any message, see icap_ctrl.h.
+ * 
+ * @param icap Pointer to ICAP instance.
+ * @param desc Subdevice and the shared memory, initialized by icap_ctrl_init().
+ * @return int32_t Returns 0 on success, negative error code on failure.
+ */
+int32_t icap_set_ctrl_block(struct icap_instance *icap, struct icap_ctrl_desc *desc);
+
+/**
+ * @brief Route channels of a record subdevice directly into the output of a
+ * playback subdevice on the device, for low latency monitoring. The record
+ * buffers keep reporting fragments to the application as usual. Setting a
+ * route for the same pair of subdevices replaces it.
+ * 
+ * @param icap Pointer to ICAP instance.
+ * @param route Subdevices, gain and channel map of the route.
+ * @return int32_t Returns 0 on success, negative error code on failure.
+ */
+int32_t icap_set_monitor(struct icap_instance *icap, struct icap_monitor_route *route);
+
 /**
  * @brief Send array of new audio fragments offsets. This is needed if buffer is
  * #ICAP_BUF_SCATTERED, application needs continuously send information where
@@ -230,10 +379,67 @@ int32_t icap_resume(struct icap_instance *icap, uint32_t subdev_id);
  * 
  * @param icap Pointer to ICAP instance.
  * @param offsets Struct with the array of offsets.
- * @return int32_t Returns 0 on success, negative error code on failure.
+ * @return int32_t Returns 0 on success, -#ICAP_ERROR_NOMEM if cache maintenance
+ * (see icap_set_cache()) has #ICAP_FRAG_QUEUE_SIZE fragments of the buffer
+ * queued already, the offsets aren't sent then, negative error code on failure.
  */
 int32_t icap_frags(struct icap_instance *icap, struct icap_buf_offsets *offsets);
 
+/**
+ * @brief Replay the session state established by this instance after the device
+ * restarted: subdevice params, control blocks, processing chains with their last
+ * block params, attached buffers, monitor routes and run states. Running
+ * subdevices are restarted together by a group start if the device supports it.
+ * The application keeps using the buffer ids it got before the restart,
+ * ICAP translates them to the ids assigned by the restarted device.
+ * 
+ * When the heartbeat is enabled the function is called automatically as soon as
+ * the heartbeat detects the device lost the session state. On Linux the driver
+ * can keep the instance over rpmsg device removal, set the new
+ * icap_transport.rpdev and call this function.
+ * Only #ICAP_JOURNAL_SUBDEVS subdevices, #ICAP_JOURNAL_BUFS buffers and
+ * #ICAP_JOURNAL_MONITORS monitor routes are restored, buffers above the limit
+ * keep the device id and icap_add_src() or icap_add_dst() fails with
+ * -#ICAP_ERROR_NOMEM if a restored buffer has that id already.
+ * 
+ * The state is replayed with the existing commands, one message per subdevice,
+ * control block, chain, block params, buffer and route, so any device can be
+ * resumed without a new protocol command.
+ * If the replay fails, e.g. the device is still booting, it is retried from the
+ * start on the next heartbeat.
+ * 
+ * Schedules aren't replayed. An acknowledged icap_start_at(), icap_stop_at(),
+ * icap_pause_at(), icap_resume_at() or icap_start_group() is journaled as the
+ * run state it leads to, and the replay applies that state immediately even if
+ * the device restarted before the scheduled time. Frame counts and timestamps
+ * start over with the restarted device, re-arm the schedule if it matters.
+ * 
+ * @param icap Pointer to ICAP instance.
+ * @return int32_t Returns 0 on success, negative error code on failure.
+ */
+int32_t icap_session_resume(struct icap_instance *icap);
+
+/**
+ * @brief Get the device clock relation estimated from timestamped fragment
+ * reports sent by icap_frag_ready_ts(). Doesn't send any message.
+ * 
+ * @param icap Pointer to ICAP instance.
+ * @param [out] sync Pointer for the current delay and drift estimation.
+ * @return int32_t Returns 0 on success, -#ICAP_ERROR_INIT if no timestamped
+ * report was received yet, negative error code on failure.
+ */
+int32_t icap_get_clock_sync(struct icap_instance *icap, struct icap_clock_sync *sync);
+
+/**
+ * @brief Convert a device timestamp to the local time using the estimated
+ * device clock relation. Doesn't send any message.
+ * 
+ * @param icap Pointer to ICAP instance.
+ * @param dev_timestamp Device timestamp in nanoseconds.
+ * @return uint64_t Returns local time in nanoseconds.
+ */
+uint64_t icap_dev_to_local_time(struct icap_instance *icap, uint64_t dev_timestamp);
+
 /**@}*/
 
 #endif /* _ICAP_APPLICATION_H_ */
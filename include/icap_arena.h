@@ -0,0 +1,261 @@
+/* SPDX-License-Identifier: (GPL-2.0-or-later OR Apache-2.0) */
+
+/*
+ *  Copyright 2021-2022 Analog Devices Inc.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+/*
+ * Copyright (C) 2021-2022 Analog Devices Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301,USA.
+ */
+
+/*
+ * Authors:
+ *   Piotr Wojtaszczyk <piotr.wojtaszczyk@timesys.com>
+ */
+
+#ifndef _ICAP_ARENA_H_
+#define _ICAP_ARENA_H_
+
+/**
+ * @file icap_arena.h
+ * @author Piotr Wojtaszczyk <piotr.wojtaszczyk@timesys.com>
+ * @brief Shared memory allocator for audio buffers, application side.
+ * 
+ * @copyright Copyright 2021-2022 Analog Devices Inc.
+ * 
+ */
+
+#include "icap.h"
+
+/**
+ * @defgroup arena_functions Shared memory arena
+ * 
+ * Carves audio buffers out of a shared memory region. Blocks are aligned to
+ * the cache line and kept in segregated free lists, one for each power of
+ * two size range, so allocation and release take constant time. Neighbouring
+ * free blocks are merged on release. The block table is kept in the
+ * #icap_arena, the region itself is accessed only for the guard patterns.
+ * 
+ * When attached with icap_set_arena() the blocks are tied to buffer ids:
+ * the block holding icap_buf_descriptor.buf is bound to the buffer by
+ * icap_add_src() and icap_add_dst() and released by icap_remove_src() and
+ * icap_remove_dst(). The device keeps reading a buffer replaced by
+ * icap_switch_buf() until the switch point, so the switch only unbinds the
+ * old block, the application frees it with icap_arena_free() after the
+ * switch point was reached. The arena isn't thread safe,
+ * the calls must be serialized with these functions. Doesn't use floating point.
+ * 
+ * @{
+ */
+
+/** @brief Number of segregated free lists */
+#define ICAP_ARENA_CLASSES (32)
+
+/** @brief icap_arena_block.buf_id of blocks not bound to a buffer */
+#define ICAP_ARENA_NO_BUF (0xffffffff)
+
+/** @brief Byte written to the guard areas */
+#define ICAP_ARENA_GUARD_PATTERN (0xa5)
+
+/** @brief Block of the region, allocated or free */
+struct icap_arena_block {
+	/** @brief Offset from the region start */
+	uint32_t offset;
+
+	/** @brief Size including the alignment padding and guard */
+	uint32_t size;
+
+	/** @brief Size requested by icap_arena_alloc(), 0 if the block is free */
+	uint32_t req_size;
+
+	/** @brief Buffer the block is bound to or #ICAP_ARENA_NO_BUF */
+	uint32_t buf_id;
+
+	/** @brief Neighbour blocks in address order, -1 at the region ends */
+	int32_t prev;
+	int32_t next;
+
+	/** @brief Free list links, -1 at the list ends */
+	int32_t free_prev;
+	int32_t free_next;
+};
+
+/** @brief Arena usage returned by icap_arena_get_stats() */
+struct icap_arena_stats {
+	/** @brief Region size */
+	uint32_t total;
+
+	/** @brief Bytes in allocated blocks */
+	uint32_t used;
+
+	/** @brief Bytes in free blocks */
+	uint32_t free;
+
+	/** @brief Largest free block, allocations above it fail */
+	uint32_t largest_free;
+
+	/** @brief Number of allocated blocks */
+	uint32_t used_blocks;
+
+	/** @brief Number of free blocks, many small ones mean fragmentation */
+	uint32_t free_blocks;
+};
+
+/** @brief Arena instance, initialized by icap_arena_init() */
+struct icap_arena {
+	/** @brief Region mapped for this core, used for the guard patterns */
+	uint8_t *vaddr;
+
+	/** @brief Region address written to icap_buf_descriptor.buf */
+	uint64_t addr;
+
+	/** @brief Region size */
+	uint32_t size;
+
+	/** @brief Alignment of the blocks, cache line size or larger */
+	uint32_t align;
+
+	/** @brief Guard bytes after each allocation, 0 disables the guards */
+	uint32_t guard;
+
+	/** @brief Bit per non empty free list */
+	uint32_t free_map;
+
+	/** @brief Free list heads, list n holds blocks of align * [2^n, 2^(n+1)) bytes */
+	int32_t free_lists[ICAP_ARENA_CLASSES];
+
+	/** @brief Unused entries of the #blocks, linked by icap_arena_block.next */
+	int32_t unused;
+
+	/** @brief The block table */
+	struct icap_arena_block blocks[ICAP_ARENA_BLOCKS];
+};
+
+/**
+ * @brief Initializes the arena with the whole region free.
+ * 
+ * @param arena Pointer to arena.
+ * @param vaddr Region mapped for this core, may be NULL without guards.
+ * @param addr Region address as written to icap_buf_descriptor.buf.
+ * @param size Region size.
+ * @param align Block alignment, power of two, at least the cache line size.
+ * @param guard Guard bytes after each allocation, 0 disables the guards.
+ * @return int32_t Returns 0 on success, negative error code on failure.
+ */
+int32_t icap_arena_init(struct icap_arena *arena, void *vaddr, uint64_t addr,
+		uint32_t size, uint32_t align, uint32_t guard);
+
+/**
+ * @brief Allocates a block.
+ * 
+ * @param arena Pointer to arena.
+ * @param size Requested size.
+ * @param [out] offset Offset of the block from the region start.
+ * @return int32_t Returns 0 on success, -#ICAP_ERROR_NOMEM if no free block is big enough.
+ */
+int32_t icap_arena_alloc(struct icap_arena *arena, uint32_t size, uint32_t *offset);
+
+/**
+ * @brief Releases a block.
+ * 
+ * @param arena Pointer to arena.
+ * @param offset Offset returned by icap_arena_alloc().
+ * @return int32_t Returns 0 on success, -#ICAP_ERROR_INVALID if there is no such block.
+ */
+int32_t icap_arena_free(struct icap_arena *arena, uint32_t offset);
+
+/**
+ * @brief Allocates memory for a buffer and sets icap_buf_descriptor.buf.
+ * The gap_size is extended so every fragment starts on a cache line, buf_size
+ * is updated to the new layout. For #ICAP_BUF_PLANAR buffers buf_size is the
+ * size of one plane, channels planes are allocated and the channel_stride is
+ * set to the cache line aligned plane size.
+ * 
+ * @param arena Pointer to arena.
+ * @param [in,out] buf Buffer with the requested buf_size, frag_size and gap_size.
+ * @return int32_t Returns 0 on success, negative error code on failure.
+ */
+int32_t icap_arena_alloc_buf(struct icap_arena *arena, struct icap_buf_descriptor *buf);
+
+/**
+ * @brief Binds the block holding addr to a buffer id.
+ * 
+ * @param arena Pointer to arena.
+ * @param addr Address within the block, e.g. icap_buf_descriptor.buf.
+ * @param buf_id Buffer id.
+ * @return int32_t Returns 0 on success, -#ICAP_ERROR_INVALID if no allocated block holds addr.
+ */
+int32_t icap_arena_bind(struct icap_arena *arena, uint64_t addr, uint32_t buf_id);
+
+/**
+ * @brief Releases the block bound to a buffer id.
+ * 
+ * @param arena Pointer to arena.
+ * @param buf_id Buffer id.
+ * @return int32_t Returns 0 on success, -#ICAP_ERROR_INVALID if no block is bound to buf_id.
+ */
+int32_t icap_arena_release(struct icap_arena *arena, uint32_t buf_id);
+
+/**
+ * @brief Unbinds the block bound to a buffer id without releasing it.
+ * 
+ * @param arena Pointer to arena.
+ * @param buf_id Buffer id.
+ * @return int32_t Returns 0 on success, -#ICAP_ERROR_INVALID if no block is bound to buf_id.
+ */
+int32_t icap_arena_unbind(struct icap_arena *arena, uint32_t buf_id);
+
+/**
+ * @brief Returns usage and fragmentation of the arena.
+ * 
+ * @param arena Pointer to arena.
+ * @param [out] stats Pointer for the statistics.
+ */
+void icap_arena_get_stats(struct icap_arena *arena, struct icap_arena_stats *stats);
+
+/**
+ * @brief Verifies the guard patterns of all allocated blocks.
+ * 
+ * @param arena Pointer to arena.
+ * @return int32_t Returns number of blocks with a damaged guard, 0 if all are intact.
+ */
+int32_t icap_arena_check(struct icap_arena *arena);
+
+/**
+ * @brief Ties the arena blocks to the buffer ids of an application instance.
+ * 
+ * @param icap Pointer to ICAP instance.
+ * @param arena Pointer to arena, NULL detaches it.
+ * @return int32_t Returns 0 on success, negative error code on failure.
+ */
+int32_t icap_set_arena(struct icap_instance *icap, struct icap_arena *arena);
+
+/**@}*/
+
+#endif /* _ICAP_ARENA_H_ */
@@ -83,6 +83,14 @@ struct icap_transport {
 	uint32_t remote_addr;
 	struct _icap_msg_fifo msg_fifo;
 	uint8_t last_response[RL_BUFFER_PAYLOAD_SIZE];
+	uint32_t time_last_tick;
+	uint32_t time_wraps;
+
+	/** @brief Optional value set before ICAP initialization which differs on each
+	 * boot, e.g. from a hardware RNG or a boot counter kept in retained memory.
+	 * Without it a deterministic boot may generate the same session id.
+	 */
+	uint32_t seed;
 };
 
 #endif /* _ICAP_BM_RPMSG_LITE_H_ */
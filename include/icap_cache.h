@@ -0,0 +1,153 @@
+/* SPDX-License-Identifier: (GPL-2.0-or-later OR Apache-2.0) */
+
+/*
+ *  Copyright 2021-2022 Analog Devices Inc.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+/*
+ * Copyright (C) 2021-2022 Analog Devices Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301,USA.
+ */
+
+/*
+ * Authors:
+ *   Piotr Wojtaszczyk <piotr.wojtaszczyk@timesys.com>
+ */
+
+#ifndef _ICAP_CACHE_H_
+#define _ICAP_CACHE_H_
+
+/**
+ * @file icap_cache.h
+ * @author Piotr Wojtaszczyk <piotr.wojtaszczyk@timesys.com>
+ * @brief Cache maintenance of shared buffers for both application and device side.
+ * 
+ * @copyright Copyright 2021-2022 Analog Devices Inc.
+ * 
+ */
+
+#include "icap_frag.h"
+
+/**
+ * @defgroup cache_functions Cache maintenance
+ * 
+ * Lets the buffers be mapped cached on cores which aren't cache coherent.
+ * ICAP tracks the fragments of the buffers attached after icap_set_cache()
+ * and calls the platform hooks with the exact fragment ranges, gaps excluded,
+ * when a fragment changes hands, followed by a memory barrier:
+ * 
+ * Device side:
+ * - icap_frag_ready() cleans the reported record fragments and invalidates
+ * the reported playback fragments, so data processed in place can't be
+ * written back over the next refill.
+ * - Received icap_frags() offsets are invalidated before icap_device_callbacks.frags().
+ * 
+ * Application side:
+ * - Reported record fragments are invalidated before
+ * icap_application_callbacks.frag_ready(), reported playback fragments are
+ * cleaned after it returns, the application must refill them in the callback.
+ * - icap_frags() cleans the playback and invalidates the record fragments
+ * before sending the offsets.
+ * 
+ * Buffers attached before icap_set_cache() and above #ICAP_CACHE_BUFS
+ * are not maintained. Fragments are counted from the buffer start, for a
+ * geometry change and a buffer switch the counting of icap_buf_geometry.frag
+ * and icap_buf_switch.frag is assumed to match the reported fragments. A
+ * replaced buffer is maintained until the switch point and needs its own
+ * entry meanwhile. icap_session_resume() restarts the counting of the
+ * replayed buffers, the offsets of scattered buffers must be sent again.
+ * 
+ * @{
+ */
+
+/** @brief Platform cache hooks, the addresses are icap_buf_descriptor.buf plus offset */
+struct icap_cache_ops {
+	/** @brief Write dirty cache lines of the range back to memory */
+	void (*clean)(struct icap_instance *icap, uint32_t buf_id, uint64_t addr, uint32_t size);
+
+	/** @brief Discard cache lines of the range without writing them back */
+	void (*invalidate)(struct icap_instance *icap, uint32_t buf_id, uint64_t addr, uint32_t size);
+};
+
+/** @brief Internal state of a maintained buffer */
+struct icap_cache_buf {
+	/** @brief Set if the entry is in use */
+	uint32_t used;
+
+	/** @brief Buffer id used on this side */
+	uint32_t buf_id;
+
+	/** @brief #ICAP_DEV_PLAYBACK for source and #ICAP_DEV_RECORD for destination buffers */
+	uint32_t dir;
+
+	/** @brief Number of channel planes, 1 if interleaved */
+	uint32_t planes;
+
+	/** @brief Set while a geometry change waits for #switch_frag */
+	uint32_t switch_pending;
+
+	/** @brief Fragment the new geometry applies from */
+	uint64_t switch_frag;
+
+	/** @brief Set when the buffer was replaced by icap_switch_buf(), the entry is
+	 * released when the cursor reaches #retire_frag */
+	uint32_t retire_pending;
+
+	/** @brief Switch point of the replaced buffer */
+	uint64_t retire_frag;
+
+	/** @brief Descriptor of the buffer, with the new geometry while #switch_pending */
+	struct icap_buf_descriptor buf;
+
+	/** @brief Next fragment to change hands */
+	struct icap_frag_cursor cur;
+};
+
+/** @brief Cache maintenance state, attached by icap_set_cache() */
+struct icap_cache {
+	/** @brief Platform hooks */
+	const struct icap_cache_ops *ops;
+
+	/** @brief Maintained buffers */
+	struct icap_cache_buf bufs[ICAP_CACHE_BUFS];
+};
+
+/**
+ * @brief Enables cache maintenance of the buffers attached afterwards.
+ * 
+ * @param icap Pointer to ICAP instance.
+ * @param cache Storage for the state, NULL disables the maintenance.
+ * @param ops Platform hooks, both must be set.
+ * @return int32_t Returns 0 on success, negative error code on failure.
+ */
+int32_t icap_set_cache(struct icap_instance *icap, struct icap_cache *cache,
+		const struct icap_cache_ops *ops);
+
+/**@}*/
+
+#endif /* _ICAP_CACHE_H_ */
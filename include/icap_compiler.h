@@ -59,5 +59,13 @@
 #define ICAP_PACKED_END __attribute__((packed))
 #endif
 
+/* Full memory barrier between cores sharing memory, may be overridden by the platform */
+#ifndef ICAP_MEMORY_BARRIER
+#if defined(__CCESVERSION__) && defined(__ADSPSHARC__)
+#define ICAP_MEMORY_BARRIER() asm volatile("sync;" ::: "memory")
+#else
+#define ICAP_MEMORY_BARRIER() __sync_synchronize()
+#endif
+#endif
 
 #endif /* _ICAP_COMPILER_H_ */
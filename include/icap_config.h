@@ -48,14 +48,76 @@
  * 
  */
 
-/** @brief ICAP message timeout */
+/** @brief ICAP message timeout, upper bound of the adaptive message timeout */
 #define ICAP_MSG_TIMEOUT_US (600*1000)
 
+/** @brief Lower bound of the adaptive message timeout */
+#define ICAP_MSG_TIMEOUT_MIN_US (1000)
+
+/** @brief Adaptive message timeout multiplier applied to the measured RTT */
+#define ICAP_MSG_TIMEOUT_RTT_MULT (4)
+
+/** @brief Number of retransmissions of a message before it times out */
+#define ICAP_MSG_RETRIES (2)
+
+/** @brief Number of responses remembered to answer retransmitted messages */
+#define ICAP_RESP_CACHE_SIZE (4)
+
+/** @brief Heartbeat periods without any message from the peer before it's considered dead */
+#define ICAP_HEARTBEAT_MISS_MAX (3)
+
+/*
+ * Bind the callbacks at compile time. ICAP_STATIC_CALLBACKS_HEADER must define
+ * ICAP_STATIC_APPLICATION_CALLBACKS and/or ICAP_STATIC_DEVICE_CALLBACKS as
+ * initializers of icap_application_callbacks and icap_device_callbacks,
+ * e.g. {.start = my_start, .stop = my_stop}. The callbacks passed to
+ * icap_application_init() and icap_device_init() are not executed.
+ */
+//#define ICAP_STATIC_CALLBACKS
+//#define ICAP_STATIC_CALLBACKS_HEADER "my_icap_callbacks.h"
+
 /* Choose one of the transport layers */
 //#define ICAP_LINUX_KERNEL_RPMSG /* For use in linux kernel */
 #define ICAP_BM_RPMSG_LITE /* For use in bare metal applications */
 //#define ICAP_LINUX_RPMSG_CHARDEV /* For use in linux user space application */
 
+/* For static allocation of the session journal, see icap_session_resume() */
+#define ICAP_JOURNAL_SUBDEVS 8
+#define ICAP_JOURNAL_BUFS 16
+#define ICAP_JOURNAL_MONITORS 4
+
+/* For static allocation of the device sessions, see icap_device_enable_sessions() */
+#define ICAP_SESSIONS_MAX 4
+#define ICAP_SESSION_SUBDEVS 16
+#define ICAP_SESSION_BUFS 32
+
+/* Max messages forwarded by icap_proxy in each direction waiting for a response */
+#define ICAP_PROXY_PENDING 8
+
+/* Max source buffers mixed by icap_mixer */
+#define ICAP_MIXER_INPUTS 8
+
+/* Max interleaved channels processed by icap_dsp */
+#define ICAP_DSP_CHANNELS_MAX 8
+
+/* Scattered fragment offsets queued by icap_frag cursor, power of two */
+#define ICAP_FRAG_QUEUE_SIZE 128
+
+/* Max descriptors in a ring built by icap_dma */
+#define ICAP_DMA_DESCS_MAX 64
+
+/* Max buffers with cache maintenance, see icap_set_cache() */
+#define ICAP_CACHE_BUFS 8
+
+/* Max blocks, allocated and free, tracked by icap_arena */
+#define ICAP_ARENA_BLOCKS 64
+
+/* Max address translation regions of an instance, see icap_set_xlat() */
+#define ICAP_XLAT_REGIONS 8
+
+/* Max fragments of a scattered buffer recycled by icap_pool */
+#define ICAP_POOL_FRAGS 256
+
 #if defined(ICAP_BM_RPMSG_LITE)
 /* For static allocation of message queues */
 #define ICAP_MSG_QUEUE_SIZE 10
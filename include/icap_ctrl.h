@@ -0,0 +1,119 @@
+/* SPDX-License-Identifier: (GPL-2.0-or-later OR Apache-2.0) */
+
+/*
+ *  Copyright 2021-2022 Analog Devices Inc.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+/*
+ * Copyright (C) 2021-2022 Analog Devices Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301,USA.
+ */
+
+/*
+ * Authors:
+ *   Piotr Wojtaszczyk <piotr.wojtaszczyk@timesys.com>
+ */
+
+#ifndef _ICAP_CTRL_H_
+#define _ICAP_CTRL_H_
+
+/**
+ * @file icap_ctrl.h
+ * @author Piotr Wojtaszczyk <piotr.wojtaszczyk@timesys.com>
+ * @brief Shared memory control block helpers for both application and device side.
+ * 
+ * @copyright Copyright 2021-2022 Analog Devices Inc.
+ * 
+ */
+
+#include "icap.h"
+
+/**
+ * @defgroup ctrl_functions Shared control block
+ * 
+ * Streams parameters and meters through struct icap_ctrl_block in shared memory
+ * attached by icap_set_ctrl_block(), without any message. Application side
+ * writes icap_ctrl_block.params, device side reads them once per fragment and
+ * writes icap_ctrl_block.meters back. Each half has a single writer and is
+ * protected by a sequence lock, readers never block the writer and retry
+ * when they race with it. The block must be in memory coherent between the
+ * cores, or kept coherent by the platform. Doesn't use floating point.
+ * 
+ * @{
+ */
+
+/** @brief Reads retried before giving up when racing with the writer */
+#define ICAP_CTRL_READ_RETRIES (4)
+
+/**
+ * @brief Initializes the control block: unity gain, unmuted, all channels enabled.
+ * 
+ * @param block Pointer to control block.
+ */
+void icap_ctrl_init(struct icap_ctrl_block *block);
+
+/**
+ * @brief Publishes new parameters, used by application side.
+ * 
+ * @param block Pointer to control block.
+ * @param params New parameters.
+ */
+void icap_ctrl_write_params(struct icap_ctrl_block *block, const struct icap_ctrl_params *params);
+
+/**
+ * @brief Reads consistent parameters, used by device side once per fragment.
+ * 
+ * @param block Pointer to control block.
+ * @param [out] params Parameters read, untouched on failure.
+ * @return int32_t Returns 0 on success, -#ICAP_ERROR_BUSY if the writer was
+ * active during all #ICAP_CTRL_READ_RETRIES attempts, the previous parameters
+ * should be used for the fragment then.
+ */
+int32_t icap_ctrl_read_params(struct icap_ctrl_block *block, struct icap_ctrl_params *params);
+
+/**
+ * @brief Publishes new meters, used by device side.
+ * 
+ * @param block Pointer to control block.
+ * @param meters New meters.
+ */
+void icap_ctrl_write_meters(struct icap_ctrl_block *block, const struct icap_ctrl_meters *meters);
+
+/**
+ * @brief Reads consistent meters, used by application side.
+ * 
+ * @param block Pointer to control block.
+ * @param [out] meters Meters read, untouched on failure.
+ * @return int32_t Returns 0 on success, -#ICAP_ERROR_BUSY if the writer was
+ * active during all #ICAP_CTRL_READ_RETRIES attempts.
+ */
+int32_t icap_ctrl_read_meters(struct icap_ctrl_block *block, struct icap_ctrl_meters *meters);
+
+/**@}*/
+
+#endif /* _ICAP_CTRL_H_ */
@@ -89,6 +89,49 @@ struct icap_device_callbacks {
 	int32_t (*resume)(struct icap_instance *icap, uint32_t subdev_id);
 	int32_t (*frags)(struct icap_instance *icap, struct icap_buf_offsets *offsets);
 
+	/** @brief Optional - Device callbacks for the scheduled actions. The action must take
+	 * effect exactly at icap_sched.time. If not implemented the #ICAP_TIME_NOW
+	 * requests fall back to #start, #stop, #pause and #resume, other requests
+	 * are rejected with -#ICAP_ERROR_NOT_SUP. */
+	int32_t (*start_at)(struct icap_instance *icap, struct icap_sched *sched);
+	int32_t (*stop_at)(struct icap_instance *icap, struct icap_sched *sched);
+	int32_t (*pause_at)(struct icap_instance *icap, struct icap_sched *sched);
+	int32_t (*resume_at)(struct icap_instance *icap, struct icap_sched *sched);
+
+	/** @brief Optional - Device callback for icap_start_group(), all subdevices in the group
+	 * must be armed together and start on the same frame. If not implemented
+	 * the request is rejected with -#ICAP_ERROR_NOT_SUP. */
+	int32_t (*start_group)(struct icap_instance *icap, struct icap_sched_group *group);
+
+	/** @brief Optional - Device callback for icap_set_buf_geometry(). The callback
+	 * must set icap_buf_geometry.frag to the fragment it will switch at, not earlier
+	 * than requested. If not implemented the request is rejected with -#ICAP_ERROR_NOT_SUP. */
+	int32_t (*buf_geometry)(struct icap_instance *icap, struct icap_buf_geometry *geometry);
+
+	/** @brief Optional - Device callback for icap_switch_buf(), attaches the new buffer
+	 * and moves the DMA to it at the confirmed fragment, then releases the old buffer.
+	 * The callback should return buffer_id of the new buffer and set icap_buf_switch.frag
+	 * to the fragment it will switch at. If not implemented the request is
+	 * rejected with -#ICAP_ERROR_NOT_SUP. */
+	int32_t (*switch_buf)(struct icap_instance *icap, struct icap_buf_switch *buf_switch);
+
+	/** @brief Optional - Device callbacks for icap_set_dsp_chain() and icap_set_dsp_params().
+	 * The device runs the chain in place on each fragment of the subdevice, e.g. with
+	 * icap_dsp_process() from icap_dsp.h. If not implemented the requests are
+	 * rejected with -#ICAP_ERROR_NOT_SUP. */
+	int32_t (*dsp_chain)(struct icap_instance *icap, struct icap_dsp_chain *chain);
+	int32_t (*dsp_params)(struct icap_instance *icap, struct icap_dsp_params *params);
+
+	/** @brief Optional - Device callback for icap_set_ctrl_block(), maps the shared
+	 * control block, the device reads the parameters with icap_ctrl_read_params()
+	 * once per fragment. If not implemented the request is rejected with -#ICAP_ERROR_NOT_SUP. */
+	int32_t (*ctrl_block)(struct icap_instance *icap, struct icap_ctrl_desc *desc);
+
+	/** @brief Optional - Device callback for icap_set_monitor(), mixes the record samples
+	 * into the playback output as soon as they are captured, e.g. with icap_mixer_monitor().
+	 * If not implemented the request is rejected with -#ICAP_ERROR_NOT_SUP. */
+	int32_t (*monitor)(struct icap_instance *icap, struct icap_monitor_route *route);
+
 	/** @brief Callback executed when a response to icap_frag_ready() is received. */
 	int32_t (*frag_ready_response)(struct icap_instance *icap, int32_t buf_id);
 
@@ -97,6 +140,17 @@ struct icap_device_callbacks {
 
 	/** @brief Callback executed when a response to icap_error() is received. */
 	int32_t (*error_response)(struct icap_instance *icap, int32_t error);
+
+	/** @brief Executed when the application stops or starts responding,
+	 * requires heartbeat enabled by icap_set_heartbeat(). */
+	int32_t (*link_state)(struct icap_instance *icap, uint32_t peer_alive);
+
+	/** @brief Optional - Executed in the multi-session mode when an application
+	 * endpoint stopped responding to the heartbeat, see icap_set_heartbeat().
+	 * The subdevices and buffers of the session are still listed, the device
+	 * should stop them and release their resources. Afterwards the session
+	 * is removed as by icap_device_remove_session(). */
+	int32_t (*session_lost)(struct icap_instance *icap, uint32_t session);
 };
 
 /**@}*/
@@ -128,6 +182,74 @@ int32_t icap_device_deinit(struct icap_instance *icap);
 
 /**@}*/
 
+/**
+ * @defgroup dev_sessions Device sessions
+ * 
+ * By default the device serves only the first application endpoint which
+ * sends a message to it. In the multi-session mode each application endpoint
+ * gets its own session with separate sequence numbers and response routing.
+ * Subdevices are partitioned between the sessions or shared by them, messages
+ * to a subdevice or a buffer of another session are rejected with
+ * -#ICAP_ERROR_ACCESS. icap_frag_ready() and icap_xrun() are send to the
+ * session which attached the buffer, icap_error() is send to all sessions.
+ * With the heartbeat enabled on the device, sessions which stop responding are
+ * removed automatically, see icap_device_callbacks.session_lost.
+ * 
+ * @{
+ */
+
+/**
+ * @brief Enables the multi-session mode, must be called after icap_device_init()
+ * and before any message is received. All subdevices are #ICAP_SESSION_ANY.
+ * 
+ * @param icap Pointer to ICAP instance.
+ * @return int32_t Returns 0 on success, negative error code on failure.
+ */
+int32_t icap_device_enable_sessions(struct icap_instance *icap);
+
+/**
+ * @brief Registers an application endpoint. Unknown endpoints are registered
+ * automatically with the first message, up to #ICAP_SESSIONS_MAX sessions.
+ * 
+ * @param icap Pointer to ICAP instance.
+ * @param addr Remote address of the application endpoint.
+ * @return int32_t Returns session index on success, negative error code on failure.
+ */
+int32_t icap_device_add_session(struct icap_instance *icap, union icap_remote_addr *addr);
+
+/**
+ * @brief Removes an application endpoint and releases its subdevices and buffers.
+ * 
+ * @param icap Pointer to ICAP instance.
+ * @param addr Remote address of the application endpoint.
+ * @return int32_t Returns 0 on success, negative error code on failure.
+ */
+int32_t icap_device_remove_session(struct icap_instance *icap, union icap_remote_addr *addr);
+
+/**
+ * @brief Sets the subdevice access policy.
+ * 
+ * @param icap Pointer to ICAP instance.
+ * @param subdev_id Subdevice id, subdevices above #ICAP_SESSION_SUBDEVS are shared.
+ * @param access Session index which gets exclusive access, #ICAP_SESSION_SHARED
+ * for access by all sessions or #ICAP_SESSION_ANY for exclusive access of the
+ * first session using the subdevice until it's deinitialized.
+ * @return int32_t Returns 0 on success, negative error code on failure.
+ */
+int32_t icap_device_subdevice_access(struct icap_instance *icap, uint32_t subdev_id,
+		uint32_t access);
+
+/**
+ * @brief Returns session index of the message being processed, can be used in
+ * the device callbacks.
+ * 
+ * @param icap Pointer to ICAP instance.
+ * @return int32_t Returns session index on success, negative error code on failure.
+ */
+int32_t icap_device_get_session(struct icap_instance *icap);
+
+/**@}*/
+
 /**
  * @defgroup dev_functions Device side functions
  * 
@@ -155,6 +277,18 @@ int32_t icap_device_deinit(struct icap_instance *icap);
  */
 int32_t icap_frag_ready(struct icap_instance *icap, struct icap_buf_frags *frags);
 
+/**
+ * @brief Same as icap_frag_ready() but also reports the device timestamp and
+ * the buffer frame position at which the fragments were consumed. The application
+ * side uses the reports to estimate the device clock, see icap_get_clock_sync().
+ * 
+ * @param icap Pointer to ICAP instance.
+ * @param frags Pointer to struct containing buffer id, number of fragments consumed,
+ * device timestamp and frame position.
+ * @return int32_t Returns 0 on success, negative error code on failure.
+ */
+int32_t icap_frag_ready_ts(struct icap_instance *icap, struct icap_buf_frags_ts *frags);
+
 /**
  * @brief Device can call this function if xrun event is detected.
  * 
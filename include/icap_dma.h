@@ -0,0 +1,176 @@
+/* SPDX-License-Identifier: (GPL-2.0-or-later OR Apache-2.0) */
+
+/*
+ *  Copyright 2021-2022 Analog Devices Inc.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+/*
+ * Copyright (C) 2021-2022 Analog Devices Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301,USA.
+ */
+
+/*
+ * Authors:
+ *   Piotr Wojtaszczyk <piotr.wojtaszczyk@timesys.com>
+ */
+
+#ifndef _ICAP_DMA_H_
+#define _ICAP_DMA_H_
+
+/**
+ * @file icap_dma.h
+ * @author Piotr Wojtaszczyk <piotr.wojtaszczyk@timesys.com>
+ * @brief Hardware neutral DMA descriptor chain builder for device side.
+ * 
+ * @copyright Copyright 2021-2022 Analog Devices Inc.
+ * 
+ */
+
+#include "icap_frag.h"
+
+/**
+ * @defgroup dma_functions DMA descriptor chain
+ * 
+ * Turns icap_buf_descriptor into a ring of {address, length, next} records,
+ * one for each fragment or, for #ICAP_BUF_PLANAR, for each channel plane
+ * of a fragment. The port converts the records into its DMA descriptor
+ * format in icap_dma_chain.write_desc. Circular and planar rings are built
+ * once by icap_dma_init(). Scattered rings are filled by icap_dma_push_offsets()
+ * as the offsets arrive, and the DMA interrupt only calls icap_dma_complete().
+ * Doesn't use floating point.
+ * 
+ * @{
+ */
+
+#if (ICAP_DMA_DESCS_MAX & (ICAP_DMA_DESCS_MAX - 1))
+#error "ICAP_DMA_DESCS_MAX must be a power of two"
+#endif
+
+/** @brief Set on the last filled record of a scattered ring, the DMA must stop there */
+#define ICAP_DMA_FLAG_STOP (1 << 0)
+
+/** @brief Hardware neutral DMA descriptor */
+struct icap_dma_desc {
+	/** @brief DMA address of the data */
+	uint64_t addr;
+
+	/** @brief Length of the data in bytes */
+	uint32_t len;
+
+	/** @brief Index of the next record in the ring */
+	uint32_t next;
+
+	/** @brief Record flags, @ref ICAP_DMA_FLAG_STOP */
+	uint32_t flags;
+};
+
+/** @brief Descriptor ring, initialized by icap_dma_init() */
+struct icap_dma_chain {
+	/** @brief DMA address of the buffer start */
+	uint64_t base;
+
+	/** @brief Records per fragment, number of channel planes or 1 */
+	uint32_t planes;
+
+	/** @brief Number of records in the ring */
+	uint32_t num;
+
+	/** @brief Records completed by the DMA, free running, updated from the DMA interrupt */
+	volatile uint32_t head;
+
+	/** @brief Records filled, free running, used only for scattered rings */
+	uint32_t tail;
+
+	/** @brief Port callback converting a record to the port DMA descriptor format,
+	 * called for each new or changed record. May be NULL if the port uses #descs directly. */
+	void (*write_desc)(struct icap_dma_chain *chain, uint32_t index, const struct icap_dma_desc *desc);
+
+	/** @brief Port private data */
+	void *priv;
+
+	/** @brief Fragment layout of the buffer */
+	struct icap_frag_cursor cur;
+
+	/** @brief The ring */
+	struct icap_dma_desc descs[ICAP_DMA_DESCS_MAX];
+};
+
+/**
+ * @brief Initializes the ring for a buffer. Records of circular and planar
+ * buffers are written immediately, scattered rings start empty.
+ * 
+ * @param chain Pointer to ring.
+ * @param buf Buffer received by icap_device_callbacks.add_src() or add_dst().
+ * @param base DMA address the buffer is at.
+ * @param write_desc Port callback, may be NULL.
+ * @param priv Port private data.
+ * @return int32_t Returns 0 on success, -#ICAP_ERROR_NOMEM if the buffer
+ * needs more than #ICAP_DMA_DESCS_MAX records, negative error code on failure.
+ */
+int32_t icap_dma_init(struct icap_dma_chain *chain, const struct icap_buf_descriptor *buf,
+		uint64_t base, void (*write_desc)(struct icap_dma_chain *chain, uint32_t index,
+		const struct icap_dma_desc *desc), void *priv);
+
+/**
+ * @brief Appends records for new #ICAP_BUF_SCATTERED fragments, moves the
+ * stop flag to the last of them.
+ * The DMA may halt at the previous stop record just before the flag is
+ * cleared, with the interrupt calling icap_dma_complete() still pending. After
+ * this function the port must check its DMA status and, if the DMA is idle and
+ * icap_dma_pending() isn't 0 once the completed records are accounted, restart
+ * it at record #icap_dma_chain.head & (#ICAP_DMA_DESCS_MAX - 1).
+ * 
+ * @param chain Pointer to ring.
+ * @param offsets Offsets received by icap_device_callbacks.frags().
+ * @return int32_t Returns 1 if the ring was empty, the DMA is stopped and must
+ * be restarted at the first new record, 0 on success otherwise,
+ * -#ICAP_ERROR_NOMEM if the ring has no room for all offsets, nothing is
+ * appended then, negative error code on failure.
+ */
+int32_t icap_dma_push_offsets(struct icap_dma_chain *chain, const struct icap_buf_offsets *offsets);
+
+/**
+ * @brief Releases records completed by the DMA, called from the DMA interrupt.
+ * 
+ * @param chain Pointer to ring.
+ * @param descs Number of completed records.
+ */
+void icap_dma_complete(struct icap_dma_chain *chain, uint32_t descs);
+
+/**
+ * @brief Returns number of filled records not completed by the DMA yet.
+ * 
+ * @param chain Pointer to ring.
+ * @return uint32_t Returns number of pending records, #icap_dma_chain.num
+ * for circular and planar rings.
+ */
+uint32_t icap_dma_pending(const struct icap_dma_chain *chain);
+
+/**@}*/
+
+#endif /* _ICAP_DMA_H_ */
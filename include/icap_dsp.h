@@ -0,0 +1,168 @@
+/* SPDX-License-Identifier: (GPL-2.0-or-later OR Apache-2.0) */
+
+/*
+ *  Copyright 2021-2022 Analog Devices Inc.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+/*
+ * Copyright (C) 2021-2022 Analog Devices Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301,USA.
+ */
+
+/*
+ * Authors:
+ *   Piotr Wojtaszczyk <piotr.wojtaszczyk@timesys.com>
+ */
+
+#ifndef _ICAP_DSP_H_
+#define _ICAP_DSP_H_
+
+/**
+ * @file icap_dsp.h
+ * @author Piotr Wojtaszczyk <piotr.wojtaszczyk@timesys.com>
+ * @brief Processing chain runtime for device side.
+ * 
+ * @copyright Copyright 2021-2022 Analog Devices Inc.
+ * 
+ */
+
+#include "icap.h"
+
+/**
+ * @defgroup dsp_functions Device processing chain
+ * 
+ * Runs the blocks set by icap_set_dsp_chain() and icap_set_dsp_params() in
+ * place on the fragments of a subdevice. The device keeps one instance per
+ * subdevice, passes the received chain and parameters from
+ * icap_device_callbacks.dsp_chain() and icap_device_callbacks.dsp_params()
+ * and calls icap_dsp_process() on each fragment. Samples are processed in
+ * floating point, the gain kernel is vectorized with SSE2 or NEON when the
+ * compiler targets it. Not intended for the linux kernel.
+ * 
+ * @{
+ */
+
+/** @brief State of one processing block */
+struct icap_dsp_block {
+	/** @brief One of the #icap_dsp_type */
+	uint32_t type;
+
+	/** @brief Parameters and state, valid field depends on #type */
+	union {
+		struct {
+			float gain;
+			float target;
+			float step;
+			uint32_t ramp_left;
+		} gain;
+		struct {
+			float b0;
+			float b1;
+			float b2;
+			float a1;
+			float a2;
+			float z1[ICAP_DSP_CHANNELS_MAX];
+			float z2[ICAP_DSP_CHANNELS_MAX];
+		} biquad;
+		struct {
+			float threshold;
+			float attack;
+			float release;
+			float env;
+		} limiter;
+	} u;
+};
+
+/** @brief Processing chain instance, initialized by icap_dsp_init() */
+struct icap_dsp {
+	/** @brief Sample format of the fragments */
+	uint32_t format;
+
+	/** @brief Number of interleaved channels */
+	uint32_t channels;
+
+	/** @brief Number of blocks in the chain */
+	uint32_t num;
+
+	/** @brief Blocks in processing order */
+	struct icap_dsp_block blocks[ICAP_DSP_BLOCKS_MAX];
+};
+
+/**
+ * @brief Initializes an empty processing chain.
+ * 
+ * @param dsp Pointer to chain instance.
+ * @param format #ICAP_FORMAT_S16_LE, #ICAP_FORMAT_S32_LE or #ICAP_FORMAT_FLOAT_LE
+ * (or the BE variant on a big endian host).
+ * @param channels Number of interleaved channels, up to #ICAP_DSP_CHANNELS_MAX.
+ * @return int32_t Returns 0 on success, negative error code on failure.
+ */
+int32_t icap_dsp_init(struct icap_dsp *dsp, uint32_t format, uint32_t channels);
+
+/**
+ * @brief Sets the block types of the chain. Blocks which keep their type on the
+ * same position keep their parameters and state, other blocks pass the samples
+ * unchanged until their parameters are set.
+ * 
+ * @param dsp Pointer to chain instance.
+ * @param chain Chain received by icap_device_callbacks.dsp_chain().
+ * @return int32_t Returns 0 on success, negative error code on failure.
+ */
+int32_t icap_dsp_set_chain(struct icap_dsp *dsp, const struct icap_dsp_chain *chain);
+
+/**
+ * @brief Sets parameters of a block. Filter and envelope state is kept so
+ * the parameters can change while the subdevice is running.
+ * 
+ * @param dsp Pointer to chain instance.
+ * @param params Parameters received by icap_device_callbacks.dsp_params().
+ * @return int32_t Returns 0 on success, negative error code on failure.
+ */
+int32_t icap_dsp_set_params(struct icap_dsp *dsp, const struct icap_dsp_params *params);
+
+/**
+ * @brief Clears filter and envelope state and finishes gain ramps,
+ * e.g. when the subdevice starts.
+ * 
+ * @param dsp Pointer to chain instance.
+ */
+void icap_dsp_reset(struct icap_dsp *dsp);
+
+/**
+ * @brief Runs the chain in place on a fragment. Integer samples saturate.
+ * 
+ * @param dsp Pointer to chain instance.
+ * @param data Interleaved fragment.
+ * @param frames Number of frames in the fragment.
+ * @return int32_t Returns 0 on success, negative error code on failure.
+ */
+int32_t icap_dsp_process(struct icap_dsp *dsp, void *data, uint32_t frames);
+
+/**@}*/
+
+#endif /* _ICAP_DSP_H_ */
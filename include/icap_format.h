@@ -0,0 +1,141 @@
+/* SPDX-License-Identifier: (GPL-2.0-or-later OR Apache-2.0) */
+
+/*
+ *  Copyright 2021-2022 Analog Devices Inc.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+/*
+ * Copyright (C) 2021-2022 Analog Devices Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301,USA.
+ */
+
+/*
+ * Authors:
+ *   Piotr Wojtaszczyk <piotr.wojtaszczyk@timesys.com>
+ */
+
+#ifndef _ICAP_FORMAT_H_
+#define _ICAP_FORMAT_H_
+
+/**
+ * @file icap_format.h
+ * @author Piotr Wojtaszczyk <piotr.wojtaszczyk@timesys.com>
+ * @brief Sample format conversion helpers for both application and device side.
+ * 
+ * @copyright Copyright 2021-2022 Analog Devices Inc.
+ * 
+ */
+
+#include "icap.h"
+
+/**
+ * @defgroup format_functions Sample format conversion
+ * 
+ * Converts audio samples between any of the @ref sample_format and between
+ * interleaved and planar (#ICAP_BUF_PLANAR) layout. The kernels
+ * are vectorized with SSE2/SSSE3/AVX2 or NEON when the compiler targets them,
+ * otherwise plain C loops are used. Uses floating point, not intended for the
+ * linux kernel.
+ * 
+ * Integer samples are scaled to the full range of the destination, narrowing
+ * truncates the least significant bits. Floating point samples are in range
+ * [-1.0, 1.0), out of range values are clipped when converted to integer.
+ * Floating point to integer conversion rounds to the nearest integer with ties
+ * to even and converts NaN to 0, the vectorized and plain C kernels give the
+ * same result.
+ * Samples must be aligned to their size.
+ * 
+ * @{
+ */
+
+/**
+ * @brief Returns size of a sample in bytes.
+ * 
+ * @param format One of the @ref sample_format.
+ * @return uint32_t Returns sample size, 0 for invalid format.
+ */
+uint32_t icap_format_size(uint32_t format);
+
+/**
+ * @brief Chooses the format to use with a subdevice.
+ * 
+ * @param formats Supported formats, bitfield @ref sample_format_bit,
+ * e.g. icap_subdevice_features.formats.
+ * @param format Preferred format, one of the @ref sample_format.
+ * @return int32_t Returns the preferred format if supported, otherwise the
+ * supported format with the best resolution of the same kind (integer or
+ * floating point) preferring the byte order of the preferred format, negative
+ * error code if no format is supported.
+ */
+int32_t icap_format_select(uint32_t formats, uint32_t format);
+
+/**
+ * @brief Converts samples between formats.
+ * 
+ * @param dst Destination buffer.
+ * @param dst_format Destination format, one of the @ref sample_format.
+ * @param src Source buffer, can be the same as dst for in place conversion.
+ * Other overlapping buffers are not supported.
+ * @param src_format Source format, one of the @ref sample_format.
+ * @param samples Number of samples to convert.
+ * @return int32_t Returns 0 on success, negative error code on failure.
+ */
+int32_t icap_format_convert(void *dst, uint32_t dst_format, const void *src,
+		uint32_t src_format, uint32_t samples);
+
+/**
+ * @brief Interleaves planar samples, e.g. from a #ICAP_BUF_PLANAR fragment.
+ * 
+ * @param dst Destination buffer for frames * channels interleaved samples.
+ * @param src First sample of the first channel plane.
+ * @param channel_stride Distance in bytes between the first samples of consecutive channels.
+ * @param channels Number of channels.
+ * @param frames Number of samples in each channel.
+ * @param format Sample format of both buffers, one of the @ref sample_format.
+ * @return int32_t Returns 0 on success, negative error code on failure.
+ */
+int32_t icap_format_interleave(void *dst, const void *src, uint32_t channel_stride,
+		uint32_t channels, uint32_t frames, uint32_t format);
+
+/**
+ * @brief Deinterleaves samples into channel planes, e.g. to a #ICAP_BUF_PLANAR fragment.
+ * 
+ * @param dst First sample of the first channel plane.
+ * @param channel_stride Distance in bytes between the first samples of consecutive channels.
+ * @param src Source buffer with frames * channels interleaved samples.
+ * @param channels Number of channels.
+ * @param frames Number of samples in each channel.
+ * @param format Sample format of both buffers, one of the @ref sample_format.
+ * @return int32_t Returns 0 on success, negative error code on failure.
+ */
+int32_t icap_format_deinterleave(void *dst, uint32_t channel_stride, const void *src,
+		uint32_t channels, uint32_t frames, uint32_t format);
+
+/**@}*/
+
+#endif /* _ICAP_FORMAT_H_ */
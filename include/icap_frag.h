@@ -0,0 +1,181 @@
+/* SPDX-License-Identifier: (GPL-2.0-or-later OR Apache-2.0) */
+
+/*
+ *  Copyright 2021-2022 Analog Devices Inc.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+/*
+ * Copyright (C) 2021-2022 Analog Devices Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301,USA.
+ */
+
+/*
+ * Authors:
+ *   Piotr Wojtaszczyk <piotr.wojtaszczyk@timesys.com>
+ */
+
+#ifndef _ICAP_FRAG_H_
+#define _ICAP_FRAG_H_
+
+/**
+ * @file icap_frag.h
+ * @author Piotr Wojtaszczyk <piotr.wojtaszczyk@timesys.com>
+ * @brief Fragment cursor for both application and device side.
+ * 
+ * @copyright Copyright 2021-2022 Analog Devices Inc.
+ * 
+ */
+
+#include "icap.h"
+
+/**
+ * @defgroup frag_functions Fragment cursor
+ * 
+ * Walks the fragments of a buffer described by icap_buf_descriptor, so both
+ * sides compute the fragment positions the same way. The layout is
+ * precomputed by icap_frag_init(), icap_frag_advance() doesn't divide and
+ * uses masks and shifts when the number of fragments and the fragment
+ * stride are powers of two. For #ICAP_BUF_SCATTERED buffers the offsets
+ * received with icap_frags() are queued in the cursor. Positions are offsets
+ * from the start of the buffer, each side adds the address it has the buffer
+ * mapped at. Doesn't use floating point.
+ * 
+ * @{
+ */
+
+#if (ICAP_FRAG_QUEUE_SIZE & (ICAP_FRAG_QUEUE_SIZE - 1))
+#error "ICAP_FRAG_QUEUE_SIZE must be a power of two"
+#endif
+
+/** @brief Fragment cursor, initialized by icap_frag_init() */
+struct icap_frag_cursor {
+	/** @brief Buffer type, one of the #icap_buf_type */
+	uint32_t type;
+
+	/** @brief Audio fragment size, per channel for #ICAP_BUF_PLANAR */
+	uint32_t frag_size;
+
+	/** @brief Distance between starts of consecutive fragments */
+	uint32_t stride;
+
+	/** @brief Distance between channel planes, 0 if interleaved */
+	uint32_t channel_stride;
+
+	/** @brief Number of fragments in the buffer, 0 for #ICAP_BUF_SCATTERED */
+	uint32_t frags;
+
+	/** @brief #frags - 1 if #frags and #stride are powers of two, 0 otherwise */
+	uint32_t mask;
+
+	/** @brief log2 of the #stride when #mask is used */
+	uint32_t shift;
+
+	/** @brief Index of the current fragment in the buffer */
+	uint32_t index;
+
+	/** @brief Offset of the current fragment */
+	uint32_t offset;
+
+	/** @brief Fragments advanced since initialization */
+	uint64_t pos;
+
+	/** @brief Queue of #ICAP_BUF_SCATTERED fragment offsets, the head is the current fragment */
+	uint32_t queue[ICAP_FRAG_QUEUE_SIZE];
+
+	/** @brief Queue read index, free running */
+	uint32_t head;
+
+	/** @brief Queue write index, free running */
+	uint32_t tail;
+};
+
+/**
+ * @brief Initializes the cursor at the first fragment of the buffer.
+ * 
+ * @param cur Pointer to cursor.
+ * @param buf Descriptor of the buffer.
+ * @return int32_t Returns 0 on success, negative error code on failure.
+ */
+int32_t icap_frag_init(struct icap_frag_cursor *cur, const struct icap_buf_descriptor *buf);
+
+/**
+ * @brief Queues offsets of new fragments of #ICAP_BUF_SCATTERED buffer,
+ * received by icap_device_callbacks.frags() or sent with icap_frags().
+ * 
+ * @param cur Pointer to cursor.
+ * @param offsets Offset table.
+ * @return int32_t Returns 0 on success, -#ICAP_ERROR_NOMEM if the offsets
+ * don't fit the queue, nothing is queued then.
+ */
+int32_t icap_frag_push_offsets(struct icap_frag_cursor *cur, const struct icap_buf_offsets *offsets);
+
+/**
+ * @brief Returns number of fragments the cursor can move to, unlimited for
+ * buffers other than #ICAP_BUF_SCATTERED.
+ * 
+ * @param cur Pointer to cursor.
+ * @return uint32_t Returns number of queued fragments including the current one,
+ * 0xffffffff if not scattered.
+ */
+uint32_t icap_frag_available(const struct icap_frag_cursor *cur);
+
+/**
+ * @brief Returns offset of the current fragment. For #ICAP_BUF_SCATTERED
+ * buffers valid only if icap_frag_available() isn't 0.
+ * 
+ * @param cur Pointer to cursor.
+ * @param channel Channel plane for #ICAP_BUF_PLANAR, 0 otherwise.
+ * @return uint32_t Returns offset from the start of the buffer.
+ */
+uint32_t icap_frag_offset(const struct icap_frag_cursor *cur, uint32_t channel);
+
+/**
+ * @brief Moves the cursor forward, wrapping at the end of the buffer.
+ * 
+ * @param cur Pointer to cursor.
+ * @param frags Number of fragments to move by, e.g. icap_buf_frags.frags.
+ * @return int32_t Returns 0 on success, -#ICAP_ERROR_NO_BUFS if a
+ * #ICAP_BUF_SCATTERED buffer has less than frags offsets queued, the cursor
+ * doesn't move then.
+ */
+int32_t icap_frag_advance(struct icap_frag_cursor *cur, uint32_t frags);
+
+/**
+ * @brief Moves the cursor to a fragment counted from the buffer start, e.g. to
+ * icap_buf_geometry.frag after reinitializing with the new geometry. Not
+ * supported for #ICAP_BUF_SCATTERED. Divides, not intended for the audio path.
+ * 
+ * @param cur Pointer to cursor.
+ * @param frag Fragment index counted from the buffer start.
+ * @return int32_t Returns 0 on success, negative error code on failure.
+ */
+int32_t icap_frag_seek(struct icap_frag_cursor *cur, uint64_t frag);
+
+/**@}*/
+
+#endif /* _ICAP_FRAG_H_ */
@@ -40,6 +40,7 @@
 #include <linux/string.h>
 #include <linux/rpmsg.h>
 #include <linux/skbuff.h>
+#include <linux/workqueue.h>
 
 /**
  * @brief ICAP `icap_transport` for Linux kernel ICAP implementation.
@@ -56,6 +57,9 @@ struct icap_transport {
 	struct wait_queue_head response_event;
 	struct mutex response_lock;
 	struct mutex platform_lock;
+	spinlock_t irq_spinlock;
+	unsigned long irq_flags;
+	struct delayed_work heartbeat_work;
 };
 
 #endif /* _ICAP_LINUX_KERNEL_RPMSG_H_ */
@@ -0,0 +1,185 @@
+/* SPDX-License-Identifier: (GPL-2.0-or-later OR Apache-2.0) */
+
+/*
+ *  Copyright 2021-2022 Analog Devices Inc.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+/*
+ * Copyright (C) 2021-2022 Analog Devices Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301,USA.
+ */
+
+/*
+ * Authors:
+ *   Piotr Wojtaszczyk <piotr.wojtaszczyk@timesys.com>
+ */
+
+#ifndef _ICAP_MIXER_H_
+#define _ICAP_MIXER_H_
+
+/**
+ * @file icap_mixer.h
+ * @author Piotr Wojtaszczyk <piotr.wojtaszczyk@timesys.com>
+ * @brief Mixer of source buffers for device side.
+ * 
+ * @copyright Copyright 2021-2022 Analog Devices Inc.
+ * 
+ */
+
+#include "icap.h"
+
+/**
+ * @defgroup mixer_functions Device mixer
+ * 
+ * Sums fragments of the source buffers attached to a playback subdevice into
+ * one output fragment, with a gain for each buffer. The device registers the
+ * buffers in icap_device_callbacks.add_src() and pauses them in
+ * icap_device_callbacks.pause(). Integer samples are mixed in fixed point and
+ * saturated, the kernels are vectorized with SSE2 or NEON when the compiler
+ * targets them.
+ * 
+ * @{
+ */
+
+/** @brief Gain 1.0, gains are unsigned Q16.16 fixed point values */
+#define ICAP_MIXER_GAIN_UNITY (1 << 16)
+
+/** @brief Max gain 4.0 */
+#define ICAP_MIXER_GAIN_MAX (4 << 16)
+
+/** @brief Mixer input, one for each source buffer */
+struct icap_mixer_input {
+	/** @brief Set if the input is in use */
+	uint32_t used;
+
+	/** @brief Source buffer id */
+	uint32_t buf_id;
+
+	/** @brief Set while the input is paused */
+	uint32_t paused;
+
+	/** @brief Gain of the input, Q16.16 */
+	uint32_t gain;
+};
+
+/** @brief Mixer instance, initialized by icap_mixer_init() */
+struct icap_mixer {
+	/** @brief Sample format of the inputs and the output */
+	uint32_t format;
+
+	/** @brief Number of interleaved channels */
+	uint32_t channels;
+
+	/** @brief Inputs, indexed by the value returned from icap_mixer_add_input() */
+	struct icap_mixer_input inputs[ICAP_MIXER_INPUTS];
+};
+
+/**
+ * @brief Initializes the mixer.
+ * 
+ * @param mixer Pointer to mixer instance.
+ * @param format #ICAP_FORMAT_S16_LE, #ICAP_FORMAT_S32_LE or #ICAP_FORMAT_FLOAT_LE
+ * (or the BE variant on a big endian host).
+ * @param channels Number of interleaved channels.
+ * @return int32_t Returns 0 on success, negative error code on failure.
+ */
+int32_t icap_mixer_init(struct icap_mixer *mixer, uint32_t format, uint32_t channels);
+
+/**
+ * @brief Adds a source buffer to the mixer.
+ * 
+ * @param mixer Pointer to mixer instance.
+ * @param buf_id Source buffer id.
+ * @param gain Gain of the buffer, Q16.16 up to #ICAP_MIXER_GAIN_MAX.
+ * @return int32_t Returns input index on success, negative error code on failure.
+ */
+int32_t icap_mixer_add_input(struct icap_mixer *mixer, uint32_t buf_id, uint32_t gain);
+
+/**
+ * @brief Removes a source buffer from the mixer.
+ * 
+ * @param mixer Pointer to mixer instance.
+ * @param buf_id Source buffer id.
+ * @return int32_t Returns 0 on success, negative error code on failure.
+ */
+int32_t icap_mixer_remove_input(struct icap_mixer *mixer, uint32_t buf_id);
+
+/**
+ * @brief Changes gain of a source buffer.
+ * 
+ * @param mixer Pointer to mixer instance.
+ * @param buf_id Source buffer id.
+ * @param gain Gain of the buffer, Q16.16 up to #ICAP_MIXER_GAIN_MAX, 0 mutes the buffer.
+ * @return int32_t Returns 0 on success, negative error code on failure.
+ */
+int32_t icap_mixer_set_gain(struct icap_mixer *mixer, uint32_t buf_id, uint32_t gain);
+
+/**
+ * @brief Pauses or resumes a source buffer, paused buffers are skipped.
+ * 
+ * @param mixer Pointer to mixer instance.
+ * @param buf_id Source buffer id.
+ * @param paused Non zero to pause.
+ * @return int32_t Returns 0 on success, negative error code on failure.
+ */
+int32_t icap_mixer_pause_input(struct icap_mixer *mixer, uint32_t buf_id, uint32_t paused);
+
+/**
+ * @brief Mixes the source fragments into the output fragment. Unused, paused
+ * and muted inputs and inputs without a fragment are skipped, the output is
+ * silence if nothing is mixed. Integer output saturates, float output isn't clipped.
+ * 
+ * @param mixer Pointer to mixer instance.
+ * @param out Output fragment.
+ * @param src Fragment of each input indexed by the input index, NULL if the
+ * buffer has no data ready.
+ * @param frames Number of frames to mix.
+ * @return int32_t Returns number of mixed inputs, negative error code on failure.
+ */
+int32_t icap_mixer_mix(struct icap_mixer *mixer, void *out,
+		const void *const src[ICAP_MIXER_INPUTS], uint32_t frames);
+
+/**
+ * @brief Mixes captured record samples into the output fragment for direct
+ * monitoring set by icap_set_monitor(), after icap_mixer_mix(). The record
+ * samples must be in the mixer format. Integer output saturates.
+ * 
+ * @param mixer Pointer to mixer instance of the playback subdevice.
+ * @param out Output fragment.
+ * @param in Record samples.
+ * @param in_channels Number of interleaved record channels.
+ * @param route Route received by icap_device_callbacks.monitor().
+ * @param frames Number of frames to mix.
+ * @return int32_t Returns 0 on success, negative error code on failure.
+ */
+int32_t icap_mixer_monitor(struct icap_mixer *mixer, void *out, const void *in,
+		uint32_t in_channels, const struct icap_monitor_route *route, uint32_t frames);
+
+/**@}*/
+
+#endif /* _ICAP_MIXER_H_ */
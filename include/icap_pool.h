@@ -0,0 +1,182 @@
+/* SPDX-License-Identifier: (GPL-2.0-or-later OR Apache-2.0) */
+
+/*
+ *  Copyright 2021-2022 Analog Devices Inc.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+/*
+ * Copyright (C) 2021-2022 Analog Devices Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301,USA.
+ */
+
+/*
+ * Authors:
+ *   Piotr Wojtaszczyk <piotr.wojtaszczyk@timesys.com>
+ */
+
+#ifndef _ICAP_POOL_H_
+#define _ICAP_POOL_H_
+
+/**
+ * @file icap_pool.h
+ * @author Piotr Wojtaszczyk <piotr.wojtaszczyk@timesys.com>
+ * @brief Fragment recycling for scattered buffers, application side.
+ * 
+ * @copyright Copyright 2021-2022 Analog Devices Inc.
+ * 
+ */
+
+#include "icap.h"
+
+/**
+ * @defgroup pool_functions Scattered fragment pool
+ * 
+ * Keeps the fragments of an #ICAP_BUF_SCATTERED buffer circulating. The
+ * device consumes the offsets in the order they were sent, so the pool keeps
+ * the fragment offsets in a fixed ring and only counts the submitted and the
+ * consumed fragments.
+ * 
+ * icap_pool_frag_ready() is called from icap_application_callbacks.frag_ready()
+ * and recycles the consumed fragments, it sends no message. icap_pool_refill()
+ * is called from the application thread: once no more than the low watermark
+ * fragments are left with the device it sends free fragments with
+ * icap_frags(), #ICAP_BUF_MAX_FRAGS_OFFSETS_NUM per message, until
+ * icap_pool.max_in_flight fragments are with the device. The device never
+ * starves as long as the watermark covers the refill latency, and there is
+ * one message per many fragments instead of one per fragment.
+ * 
+ * The two functions may run concurrently without a lock, each one writes
+ * only its own counter. Doesn't use floating point.
+ * 
+ * @{
+ */
+
+/** @brief Pool of one buffer, initialized by icap_pool_init() */
+struct icap_pool {
+	/** @brief Application instance the buffer was added to */
+	struct icap_instance *icap;
+
+	/** @brief Buffer id returned by icap_add_src() or icap_add_dst() */
+	uint32_t buf_id;
+
+	/** @brief Number of fragments in #offsets */
+	uint32_t num;
+
+	/** @brief icap_pool_refill() sends fragments once no more than this many are with the device */
+	uint32_t low_watermark;
+
+	/** @brief Most fragments with the device at once, the depth of the device queue.
+	 * #ICAP_FRAG_QUEUE_SIZE by default, lower it to #ICAP_DMA_DESCS_MAX for a device
+	 * feeding the offsets to icap_dma_push_offsets(). Set after icap_pool_init(). */
+	uint32_t max_in_flight;
+
+	/** @brief Next fragment to send, written only by icap_pool_refill() */
+	uint32_t submit_idx;
+
+	/** @brief Fragments sent, free running, written only by icap_pool_refill() */
+	volatile uint32_t submitted;
+
+	/** @brief Next fragment to be consumed, written only by icap_pool_frag_ready() */
+	uint32_t consume_idx;
+
+	/** @brief Fragments consumed, free running, written only by icap_pool_frag_ready() */
+	volatile uint32_t consumed;
+
+	/** @brief Optional - Fills a playback fragment before it is sent, a negative
+	 * return stops the refill at this fragment. Set after icap_pool_init(). */
+	int32_t (*fill)(struct icap_pool *pool, uint32_t offset);
+
+	/** @brief Optional - Called for each consumed fragment before it is recycled,
+	 * e.g. to read the recorded data. Set after icap_pool_init(). */
+	void (*consume)(struct icap_pool *pool, uint32_t offset);
+
+	/** @brief Private data for the user */
+	void *priv;
+
+	/** @brief Fragment offsets from the buffer start, in the order they circulate */
+	uint32_t offsets[ICAP_POOL_FRAGS];
+};
+
+/**
+ * @brief Initializes the pool with the fragments of the buffer laid out
+ * one after another, frag_size plus gap_size apart. All fragments start free.
+ * 
+ * @param pool Pointer to pool.
+ * @param icap Application instance.
+ * @param buf_id Buffer id returned by icap_add_src() or icap_add_dst().
+ * @param buf Buffer descriptor, must be #ICAP_BUF_SCATTERED.
+ * @param low_watermark Fragments left with the device that trigger the refill.
+ * @return int32_t Returns 0 on success, -#ICAP_ERROR_NOMEM if the buffer has
+ * more than #ICAP_POOL_FRAGS fragments, negative error code on failure.
+ */
+int32_t icap_pool_init(struct icap_pool *pool, struct icap_instance *icap, uint32_t buf_id,
+		const struct icap_buf_descriptor *buf, uint32_t low_watermark);
+
+/**
+ * @brief Replaces the fragment layout, for fragments placed freely in the
+ * buffer. Allowed only before the first icap_pool_refill().
+ * 
+ * @param pool Pointer to pool.
+ * @param offsets Fragment offsets from the buffer start.
+ * @param num Number of offsets, up to #ICAP_POOL_FRAGS.
+ * @return int32_t Returns 0 on success, negative error code on failure.
+ */
+int32_t icap_pool_set_offsets(struct icap_pool *pool, const uint32_t *offsets, uint32_t num);
+
+/**
+ * @brief Recycles the fragments reported by the device, calls icap_pool.consume
+ * for each of them. Sends no message, safe in icap_application_callbacks.frag_ready().
+ * 
+ * @param pool Pointer to pool.
+ * @param frags Report received by icap_application_callbacks.frag_ready().
+ * @return int32_t Returns 1 if icap_pool_refill() should run, 0 if not,
+ * -#ICAP_ERROR_INVALID if more fragments were reported than sent.
+ */
+int32_t icap_pool_frag_ready(struct icap_pool *pool, const struct icap_buf_frags *frags);
+
+/**
+ * @brief Sends the free fragments to the device if no more than
+ * icap_pool.low_watermark are left there, up to icap_pool.max_in_flight
+ * fragments with the device. Calls icap_pool.fill for each of them.
+ * 
+ * @param pool Pointer to pool.
+ * @return int32_t Returns number of fragments sent, negative error code on failure.
+ */
+int32_t icap_pool_refill(struct icap_pool *pool);
+
+/**
+ * @brief Returns number of fragments sent and not yet reported back.
+ * 
+ * @param pool Pointer to pool.
+ * @return uint32_t Fragments with the device.
+ */
+uint32_t icap_pool_in_flight(struct icap_pool *pool);
+
+/**@}*/
+
+#endif /* _ICAP_POOL_H_ */
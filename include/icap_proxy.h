@@ -0,0 +1,146 @@
+/* SPDX-License-Identifier: (GPL-2.0-or-later OR Apache-2.0) */
+
+/*
+ *  Copyright 2021-2022 Analog Devices Inc.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+/*
+ * Copyright (C) 2021-2022 Analog Devices Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301,USA.
+ */
+
+/*
+ * Authors:
+ *   Piotr Wojtaszczyk <piotr.wojtaszczyk@timesys.com>
+ */
+
+#ifndef _ICAP_PROXY_H_
+#define _ICAP_PROXY_H_
+
+/**
+ * @file icap_proxy.h
+ * @author Piotr Wojtaszczyk <piotr.wojtaszczyk@timesys.com>
+ * @brief ICAP forwarding between an upstream device and a downstream application instance.
+ * 
+ * @copyright Copyright 2021-2022 Analog Devices Inc.
+ * 
+ */
+
+#include "icap.h"
+
+/**
+ * @defgroup proxy Proxy
+ * 
+ * Cascades ICAP instances without nested waits (ARM <-> SHARC0 <-> SHARC1).
+ * Messages received by the upstream device instance are forwarded to the
+ * downstream device through the downstream application instance, and its
+ * responses are send back upstream with the original sequence number. Buffer
+ * notifications from the downstream device are forwarded upstream in the same
+ * way. Nothing blocks, the forwarded messages are tracked in
+ * icap_proxy.requests and icap_proxy.events.
+ * 
+ * Buffer ids are assigned by the downstream device and passed unchanged,
+ * buffer and control block addresses are mapped with the table of the upstream
+ * instance (see icap_set_xlat()), buffers can be rewritten further by the
+ * icap_proxy.translate_buf callback.
+ * Heartbeat is handled by each instance independently.
+ * 
+ * @{
+ */
+
+/** @brief Forwarded message waiting for a response */
+struct icap_proxy_pending {
+	/** @brief Set if the entry is in use */
+	uint32_t used;
+
+	/** @brief Command of the forwarded message */
+	uint32_t cmd;
+
+	/** @brief Sequence number of the forwarded message */
+	uint32_t fwd_seq_num;
+
+	/** @brief Sequence number of the original message, used for the response */
+	uint32_t seq_num;
+
+	/** @brief Session id of the original message sender */
+	uint32_t session;
+
+	/** @brief Time the message was forwarded, see icap_platform_time_ns() */
+	uint64_t time;
+};
+
+/** @brief Proxy instance, initialized by icap_proxy_init() */
+struct icap_proxy {
+	/** @brief Device instance serving the upstream application */
+	struct icap_instance *upstream;
+
+	/** @brief Application instance connected to the downstream device */
+	struct icap_instance *downstream;
+
+	/** @brief Optional - Rewrites the buffer descriptor of icap_add_src(),
+	 * icap_add_dst() and icap_switch_buf() before forwarding, for example
+	 * the buffer address to the downstream address space. */
+	int32_t (*translate_buf)(struct icap_proxy *proxy, struct icap_buf_descriptor *buf);
+
+	/** @brief Private data for the user */
+	void *priv;
+
+	/** @brief Messages forwarded downstream */
+	struct icap_proxy_pending requests[ICAP_PROXY_PENDING];
+
+	/** @brief Notifications forwarded upstream */
+	struct icap_proxy_pending events[ICAP_PROXY_PENDING];
+};
+
+/**
+ * @brief Attaches the proxy to already initialized instances. After that the
+ * messages received by the instances are forwarded instead of executing the
+ * callbacks. Responses which don't belong to a forwarded message complete the
+ * synchronous calls made directly on the downstream instance, such as
+ * icap_session_resume() started by its heartbeat. The upstream instance can't
+ * use the multi-session mode.
+ * 
+ * @param proxy Pointer to proxy instance.
+ * @param upstream Device instance initialized by icap_device_init().
+ * @param downstream Application instance initialized by icap_application_init().
+ * @return int32_t Returns 0 on success, negative error code on failure.
+ */
+int32_t icap_proxy_init(struct icap_proxy *proxy, struct icap_instance *upstream,
+		struct icap_instance *downstream);
+
+/**
+ * @brief Detaches the proxy from the instances.
+ * 
+ * @param proxy Pointer to proxy instance.
+ * @return int32_t Returns 0 on success, negative error code on failure.
+ */
+int32_t icap_proxy_deinit(struct icap_proxy *proxy);
+
+/**@}*/
+
+#endif /* _ICAP_PROXY_H_ */
@@ -0,0 +1,174 @@
+/* SPDX-License-Identifier: (GPL-2.0-or-later OR Apache-2.0) */
+
+/*
+ *  Copyright 2021-2022 Analog Devices Inc.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+/*
+ * Copyright (C) 2021-2022 Analog Devices Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301,USA.
+ */
+
+/*
+ * Authors:
+ *   Piotr Wojtaszczyk <piotr.wojtaszczyk@timesys.com>
+ */
+
+#ifndef _ICAP_RESAMPLE_H_
+#define _ICAP_RESAMPLE_H_
+
+/**
+ * @file icap_resample.h
+ * @author Piotr Wojtaszczyk <piotr.wojtaszczyk@timesys.com>
+ * @brief Polyphase sample rate converter for both application and device side.
+ * 
+ * @copyright Copyright 2021-2022 Analog Devices Inc.
+ * 
+ */
+
+#include "icap.h"
+
+/**
+ * @defgroup resample_functions Sample rate conversion
+ * 
+ * Converts interleaved float samples between two rates with a rational ratio
+ * up/down, e.g. 160/147 for 44100 -> 48000 Hz. The Kaiser windowed sinc filter
+ * bank is computed by icap_resample_init() into memory provided by the caller,
+ * nothing is allocated. The filter inner loops are vectorized with SSE/AVX
+ * or NEON when the compiler targets them. Uses floating point, not intended
+ * for the linux kernel.
+ * 
+ * @{
+ */
+
+/** @brief Max number of filter phases, the reduced up factor of the rate ratio */
+#define ICAP_RESAMPLE_PHASES_MAX (1024)
+
+/** @brief Resampler quality, trades the filter length for the stop band attenuation */
+enum icap_resample_quality {
+	/** 8 taps per phase, for voice or monitoring */
+	ICAP_RESAMPLE_LOW = 0,
+	/** 16 taps per phase */
+	ICAP_RESAMPLE_MEDIUM = 1,
+	/** 32 taps per phase */
+	ICAP_RESAMPLE_HIGH = 2,
+};
+
+/** @brief Resampler instance, initialized by icap_resample_init() */
+struct icap_resampler {
+	/** @brief Number of interleaved channels */
+	uint32_t channels;
+
+	/** @brief Interpolation factor, also the number of filter phases */
+	uint32_t up;
+
+	/** @brief Decimation factor */
+	uint32_t down;
+
+	/** @brief Filter taps per phase */
+	uint32_t taps;
+
+	/** @brief Filter phase of the next output sample */
+	uint32_t phase;
+
+	/** @brief Input frames to consume before the next output sample */
+	uint32_t skip;
+
+	/** @brief Position of the oldest sample in the history */
+	uint32_t pos;
+
+	/** @brief Filter bank, taps coefficients for each phase */
+	float *coefs;
+
+	/** @brief Input history, 2 * taps samples for each channel */
+	float *history;
+};
+
+/**
+ * @brief Returns memory size needed by icap_resample_init().
+ * 
+ * @param in_rate Input sample rate in Hz.
+ * @param out_rate Output sample rate in Hz.
+ * @param channels Number of channels.
+ * @param quality One of the #icap_resample_quality.
+ * @return uint32_t Returns size in bytes, 0 if the conversion isn't supported.
+ */
+uint32_t icap_resample_mem_size(uint32_t in_rate, uint32_t out_rate,
+		uint32_t channels, uint32_t quality);
+
+/**
+ * @brief Initializes the resampler and computes its filter bank.
+ * 
+ * @param rs Pointer to resampler instance.
+ * @param in_rate Input sample rate in Hz.
+ * @param out_rate Output sample rate in Hz.
+ * @param channels Number of channels.
+ * @param quality One of the #icap_resample_quality.
+ * @param mem Memory for the filter bank and history, aligned to float.
+ * @param mem_size Size of the memory, see icap_resample_mem_size().
+ * @return int32_t Returns 0 on success, negative error code on failure.
+ */
+int32_t icap_resample_init(struct icap_resampler *rs, uint32_t in_rate, uint32_t out_rate,
+		uint32_t channels, uint32_t quality, void *mem, uint32_t mem_size);
+
+/**
+ * @brief Clears the history, e.g. after a stream restart.
+ * 
+ * @param rs Pointer to resampler instance.
+ */
+void icap_resample_reset(struct icap_resampler *rs);
+
+/**
+ * @brief Converts interleaved samples, stops when either the input is consumed
+ * or the output is full.
+ * 
+ * @param rs Pointer to resampler instance.
+ * @param in Input frames.
+ * @param in_frames Number of input frames.
+ * @param [out] in_used Number of input frames consumed.
+ * @param out Output buffer, can't overlap the input.
+ * @param out_frames Size of the output buffer in frames.
+ * @return int32_t Returns number of output frames, negative error code on failure.
+ */
+int32_t icap_resample_process(struct icap_resampler *rs, const float *in, uint32_t in_frames,
+		uint32_t *in_used, float *out, uint32_t out_frames);
+
+/**
+ * @brief Chooses the subdevice rate which is the cheapest to convert to.
+ * 
+ * @param rates Supported rates, bitfield @ref sample_rate, e.g. icap_subdevice_features.rates.
+ * @param rate Native sample rate in Hz.
+ * @return int32_t Returns rate itself if supported, otherwise the supported rate
+ * not lower than rate with the fewest filter phases, the highest lower rate only
+ * if there is no higher one, negative error code if there is none.
+ */
+int32_t icap_resample_select_rate(uint32_t rates, uint32_t rate);
+
+/**@}*/
+
+#endif /* _ICAP_RESAMPLE_H_ */
@@ -0,0 +1,208 @@
+/* SPDX-License-Identifier: (GPL-2.0-or-later OR Apache-2.0) */
+
+/*
+ *  Copyright 2021-2022 Analog Devices Inc.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+/*
+ * Copyright (C) 2021-2022 Analog Devices Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301,USA.
+ */
+
+/*
+ * Authors:
+ *   Piotr Wojtaszczyk <piotr.wojtaszczyk@timesys.com>
+ */
+
+#ifndef _ICAP_STREAM_H_
+#define _ICAP_STREAM_H_
+
+/**
+ * @file icap_stream.h
+ * @author Piotr Wojtaszczyk <piotr.wojtaszczyk@timesys.com>
+ * @brief Zero-copy read and write access to an attached buffer, application side.
+ * 
+ * @copyright Copyright 2021-2022 Analog Devices Inc.
+ * 
+ */
+
+#include "icap_frag.h"
+
+/**
+ * @defgroup stream_functions Stream
+ * 
+ * Ring bookkeeping over an #ICAP_BUF_CIRCURAL or #ICAP_BUF_PLANAR buffer
+ * attached by icap_add_src() or icap_add_dst(). The client renders straight
+ * into the shared memory: icap_stream_begin_write() returns a pointer to the
+ * next free fragments, icap_stream_commit() hands them over. On the record
+ * side icap_stream_begin_read() and icap_stream_release() do the same for
+ * recorded fragments. Space and data are counted in fragments and driven by
+ * the reports passed to icap_stream_frag_ready() from
+ * icap_application_callbacks.frag_ready().
+ * 
+ * A playback stream starts with all fragments free, so the client can fill
+ * the buffer before starting the subdevice. The client functions and
+ * icap_stream_frag_ready() may run concurrently without a lock, each one
+ * writes only its own counter. No cache maintenance is done, the buffer
+ * must be mapped coherent. Doesn't use floating point.
+ * 
+ * @{
+ */
+
+/** @brief Stream of one buffer, initialized by icap_stream_init() */
+struct icap_stream {
+	/** @brief #ICAP_DEV_PLAYBACK for source and #ICAP_DEV_RECORD for destination buffers */
+	uint32_t dir;
+
+	/** @brief Buffer mapped for the client */
+	uint8_t *vaddr;
+
+	/** @brief icap_stream_wait() returns once this many fragments are available */
+	uint32_t avail_min;
+
+	/** @brief Fragments reported by the device, free running, written only by icap_stream_frag_ready() */
+	volatile uint32_t reported;
+
+	/** @brief Fragments committed or released by the client, free running */
+	volatile uint32_t appl;
+
+	/** @brief Fragments returned by the last begin call */
+	uint32_t pending;
+
+	/** @brief Set if fragments are contiguous, the begin calls can return more than one */
+	uint32_t contiguous;
+
+	/** @brief Optional - Blocks until wake is called or the timeout expires, returns 0
+	 * when woken and -#ICAP_ERROR_TIMEOUT on timeout. A wake before the wait must not
+	 * be lost, e.g. a semaphore. Set after icap_stream_init(). */
+	int32_t (*wait)(struct icap_stream *stream, uint32_t timeout_us);
+
+	/** @brief Optional - Wakes up wait, called from icap_stream_frag_ready().
+	 * Set after icap_stream_init(). */
+	void (*wake)(struct icap_stream *stream);
+
+	/** @brief Private data for the user */
+	void *priv;
+
+	/** @brief Position of the client in the buffer */
+	struct icap_frag_cursor cur;
+};
+
+/**
+ * @brief Initializes the stream over an attached buffer.
+ * 
+ * @param stream Pointer to stream.
+ * @param buf Buffer descriptor passed to icap_add_src() or icap_add_dst().
+ * @param dir #ICAP_DEV_PLAYBACK for source and #ICAP_DEV_RECORD for destination buffers.
+ * @param vaddr Buffer mapped for the client.
+ * @param avail_min Threshold for icap_stream_wait(), at least 1.
+ * @return int32_t Returns 0 on success, -#ICAP_ERROR_INVALID for #ICAP_BUF_SCATTERED
+ * buffers, negative error code on failure.
+ */
+int32_t icap_stream_init(struct icap_stream *stream, const struct icap_buf_descriptor *buf,
+		uint32_t dir, void *vaddr, uint32_t avail_min);
+
+/**
+ * @brief Accounts fragments reported by the device and wakes up icap_stream_wait()
+ * once icap_stream.avail_min fragments are available. Sends no message, safe in
+ * icap_application_callbacks.frag_ready().
+ * 
+ * @param stream Pointer to stream.
+ * @param frags Report received by icap_application_callbacks.frag_ready().
+ */
+void icap_stream_frag_ready(struct icap_stream *stream, const struct icap_buf_frags *frags);
+
+/**
+ * @brief Returns number of fragments the client can write for playback or read for record.
+ * 
+ * @param stream Pointer to stream.
+ * @return int32_t Returns available fragments, -#ICAP_ERROR_NO_BUFS on playback
+ * underrun or record overrun, see icap_stream_recover().
+ */
+int32_t icap_stream_avail(struct icap_stream *stream);
+
+/**
+ * @brief Waits until icap_stream.avail_min fragments are available.
+ * 
+ * @param stream Pointer to stream.
+ * @param timeout_us Timeout for each wakeup, 0 doesn't block.
+ * @return int32_t Returns available fragments, -#ICAP_ERROR_BUSY if not enough are
+ * available and timeout_us is 0, -#ICAP_ERROR_NOT_SUP if blocking without
+ * icap_stream.wait, negative error code on failure.
+ */
+int32_t icap_stream_wait(struct icap_stream *stream, uint32_t timeout_us);
+
+/**
+ * @brief Returns the next free playback fragments.
+ * 
+ * @param stream Pointer to stream.
+ * @param [out] ptr Start of the fragments, plane of the first channel for
+ * #ICAP_BUF_PLANAR, the other planes follow icap_buf_descriptor.channel_stride apart.
+ * @return int32_t Returns number of contiguous fragments at ptr, 0 if none
+ * is free, negative error code on failure.
+ */
+int32_t icap_stream_begin_write(struct icap_stream *stream, void **ptr);
+
+/**
+ * @brief Hands over written fragments to the device.
+ * 
+ * @param stream Pointer to stream.
+ * @param frags Number of fragments, up to the value returned by icap_stream_begin_write().
+ * @return int32_t Returns 0 on success, negative error code on failure.
+ */
+int32_t icap_stream_commit(struct icap_stream *stream, uint32_t frags);
+
+/**
+ * @brief Returns the next recorded fragments.
+ * 
+ * @param stream Pointer to stream.
+ * @param [out] ptr Start of the fragments, see icap_stream_begin_write().
+ * @return int32_t Returns number of contiguous fragments at ptr, 0 if none
+ * is recorded, negative error code on failure.
+ */
+int32_t icap_stream_begin_read(struct icap_stream *stream, void **ptr);
+
+/**
+ * @brief Returns read fragments to the device.
+ * 
+ * @param stream Pointer to stream.
+ * @param frags Number of fragments, up to the value returned by icap_stream_begin_read().
+ * @return int32_t Returns 0 on success, negative error code on failure.
+ */
+int32_t icap_stream_release(struct icap_stream *stream, uint32_t frags);
+
+/**
+ * @brief Continues after an underrun or overrun at the fragment the device reported last.
+ * 
+ * @param stream Pointer to stream.
+ */
+void icap_stream_recover(struct icap_stream *stream);
+
+/**@}*/
+
+#endif /* _ICAP_STREAM_H_ */
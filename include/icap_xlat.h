@@ -0,0 +1,144 @@
+/* SPDX-License-Identifier: (GPL-2.0-or-later OR Apache-2.0) */
+
+/*
+ *  Copyright 2021-2022 Analog Devices Inc.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+/*
+ * Copyright (C) 2021-2022 Analog Devices Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301,USA.
+ */
+
+/*
+ * Authors:
+ *   Piotr Wojtaszczyk <piotr.wojtaszczyk@timesys.com>
+ */
+
+#ifndef _ICAP_XLAT_H_
+#define _ICAP_XLAT_H_
+
+/**
+ * @file icap_xlat.h
+ * @author Piotr Wojtaszczyk <piotr.wojtaszczyk@timesys.com>
+ * @brief Translation of buffer addresses between the address spaces of the cores.
+ * 
+ * @copyright Copyright 2021-2022 Analog Devices Inc.
+ * 
+ */
+
+#include "icap.h"
+
+/**
+ * @defgroup xlat_functions Address translation
+ * 
+ * Each core sees the shared memory at its own addresses: kernel DMA address,
+ * user space mapping, SHARC L2 or DDR alias. The application writes
+ * icap_buf_descriptor.buf in its own address space, the receiving side maps
+ * it with a table of regions attached by icap_set_xlat().
+ * 
+ * The device instance translates the descriptors of icap_add_src(),
+ * icap_add_dst() and icap_switch_buf() and the icap_ctrl_desc.addr of
+ * icap_set_ctrl_block() before calling the device callbacks, and the cache
+ * hooks get the translated addresses. A proxy translates with the table of its
+ * upstream instance before icap_proxy.translate_buf, so a chain of cores only
+ * needs a table per hop. The whole buffer or control block must lie in one
+ * region, scattered fragment offsets are relative to the buffer and need no
+ * translation, so there is no cost per fragment. Descriptors outside of all
+ * regions are rejected with -#ICAP_ERROR_INVALID.
+ * 
+ * The table isn't locked, regions must be added before the buffers arrive.
+ * 
+ * @{
+ */
+
+/** @brief Contiguous range mapped in both address spaces */
+struct icap_xlat_region {
+	/** @brief Start address as seen by the peer */
+	uint64_t peer_addr;
+
+	/** @brief Start address as seen by this core */
+	uint64_t local_addr;
+
+	/** @brief Region size */
+	uint64_t size;
+};
+
+/** @brief Translation table, initialized by icap_xlat_init() */
+struct icap_xlat {
+	/** @brief Number of valid regions */
+	uint32_t num;
+
+	/** @brief Region of the last successful lookup, tried first */
+	uint32_t last;
+
+	/** @brief The regions */
+	struct icap_xlat_region regions[ICAP_XLAT_REGIONS];
+};
+
+/**
+ * @brief Initializes an empty table.
+ * 
+ * @param xlat Pointer to table.
+ */
+void icap_xlat_init(struct icap_xlat *xlat);
+
+/**
+ * @brief Adds a region to the table.
+ * 
+ * @param xlat Pointer to table.
+ * @param peer_addr Region start as seen by the peer.
+ * @param local_addr Region start as seen by this core.
+ * @param size Region size.
+ * @return int32_t Returns 0 on success, -#ICAP_ERROR_NOMEM if the table is full,
+ * -#ICAP_ERROR_INVALID if the region overlaps another one in the peer address space.
+ */
+int32_t icap_xlat_add(struct icap_xlat *xlat, uint64_t peer_addr, uint64_t local_addr, uint64_t size);
+
+/**
+ * @brief Translates a peer address range to the local address space.
+ * 
+ * @param xlat Pointer to table.
+ * @param addr Range start as seen by the peer.
+ * @param size Range size, the whole range must lie in one region.
+ * @param [out] local Range start as seen by this core.
+ * @return int32_t Returns 0 on success, -#ICAP_ERROR_INVALID if no region holds the range.
+ */
+int32_t icap_xlat_addr(struct icap_xlat *xlat, uint64_t addr, uint64_t size, uint64_t *local);
+
+/**
+ * @brief Attaches a translation table to an instance.
+ * 
+ * @param icap Pointer to ICAP instance.
+ * @param xlat Pointer to table, NULL disables the translation.
+ * @return int32_t Returns 0 on success, negative error code on failure.
+ */
+int32_t icap_set_xlat(struct icap_instance *icap, struct icap_xlat *xlat);
+
+/**@}*/
+
+#endif /* _ICAP_XLAT_H_ */
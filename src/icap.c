@@ -49,6 +49,10 @@
 
 #include "../include/icap_application.h"
 #include "../include/icap_device.h"
+#include "../include/icap_proxy.h"
+#include "../include/icap_cache.h"
+#include "../include/icap_arena.h"
+#include "../include/icap_xlat.h"
 #include "platform/icap_transport.h"
 
 /**
@@ -63,9 +67,127 @@ enum icap_instance_type {
 	ICAP_DEVICE_INSTANCE = 1, /**< ICAP device instance. */
 };
 
+#ifdef ICAP_STATIC_CALLBACKS
+#include ICAP_STATIC_CALLBACKS_HEADER
+
+#ifndef ICAP_STATIC_APPLICATION_CALLBACKS
+#define ICAP_STATIC_APPLICATION_CALLBACKS {0}
+#endif
+#ifndef ICAP_STATIC_DEVICE_CALLBACKS
+#define ICAP_STATIC_DEVICE_CALLBACKS {0}
+#endif
+
+/* Constant tables let the compiler drop missing callbacks and call the rest directly */
+static const struct icap_application_callbacks icap_static_application_cb = ICAP_STATIC_APPLICATION_CALLBACKS;
+static const struct icap_device_callbacks icap_static_device_cb = ICAP_STATIC_DEVICE_CALLBACKS;
+
+#define ICAP_APPLICATION_CB(icap) (&icap_static_application_cb)
+#define ICAP_DEVICE_CB(icap) (&icap_static_device_cb)
+#else
+#define ICAP_APPLICATION_CB(icap) ((const struct icap_application_callbacks *)(icap)->callbacks)
+#define ICAP_DEVICE_CB(icap) ((const struct icap_device_callbacks *)(icap)->callbacks)
+#endif
+
+/* Receiving side and min payload length of a message */
+struct icap_msg_info {
+	uint16_t rx;
+	uint16_t payload_len;
+};
+
+#define ICAP_RX_APPLICATION (1 << ICAP_APPLICATION_INSTANCE)
+#define ICAP_RX_DEVICE (1 << ICAP_DEVICE_INSTANCE)
+
+/*
+ * Indexed by cmd, checked before the message is dispatched. The dispatch
+ * itself stays a switch: compilers turn the dense cmd ranges into a jump
+ * table, and the cases call the callbacks directly, so with
+ * ICAP_STATIC_CALLBACKS they can be inlined. A table of handler pointers
+ * would add back an indirect call per message. See tests/bench_parse.c.
+ */
+static const struct icap_msg_info icap_msg_info[ICAP_MSG_HEARTBEAT + 1] = {
+	[ICAP_MSG_GET_DEV_NUM] = {ICAP_RX_DEVICE, 0},
+	[ICAP_MSG_GET_DEV_FEATURES] = {ICAP_RX_DEVICE, sizeof(uint32_t)},
+	[ICAP_MSG_DEV_INIT] = {ICAP_RX_DEVICE, sizeof(struct icap_subdevice_params)},
+	[ICAP_MSG_DEV_DEINIT] = {ICAP_RX_DEVICE, sizeof(uint32_t)},
+	[ICAP_MSG_ADD_SRC] = {ICAP_RX_DEVICE, sizeof(struct icap_buf_descriptor)},
+	[ICAP_MSG_ADD_DST] = {ICAP_RX_DEVICE, sizeof(struct icap_buf_descriptor)},
+	[ICAP_MSG_REMOVE_SRC] = {ICAP_RX_DEVICE, sizeof(uint32_t)},
+	[ICAP_MSG_REMOVE_DST] = {ICAP_RX_DEVICE, sizeof(uint32_t)},
+	[ICAP_MSG_START] = {ICAP_RX_DEVICE, sizeof(uint32_t)},
+	[ICAP_MSG_STOP] = {ICAP_RX_DEVICE, sizeof(uint32_t)},
+	[ICAP_MSG_PAUSE] = {ICAP_RX_DEVICE, sizeof(uint32_t)},
+	[ICAP_MSG_RESUME] = {ICAP_RX_DEVICE, sizeof(uint32_t)},
+	[ICAP_MSG_BUF_OFFSETS] = {ICAP_RX_DEVICE, sizeof(struct icap_buf_offsets)},
+	[ICAP_MSG_FRAG_READY] = {ICAP_RX_APPLICATION, sizeof(struct icap_buf_frags)},
+	[ICAP_MSG_XRUN] = {ICAP_RX_APPLICATION, sizeof(struct icap_buf_frags)},
+	[ICAP_MSG_START_AT] = {ICAP_RX_DEVICE, sizeof(struct icap_sched)},
+	[ICAP_MSG_STOP_AT] = {ICAP_RX_DEVICE, sizeof(struct icap_sched)},
+	[ICAP_MSG_PAUSE_AT] = {ICAP_RX_DEVICE, sizeof(struct icap_sched)},
+	[ICAP_MSG_RESUME_AT] = {ICAP_RX_DEVICE, sizeof(struct icap_sched)},
+	[ICAP_MSG_START_GROUP] = {ICAP_RX_DEVICE, sizeof(struct icap_sched_group)},
+	[ICAP_MSG_BUF_GEOMETRY] = {ICAP_RX_DEVICE, sizeof(struct icap_buf_geometry)},
+	[ICAP_MSG_BUF_SWITCH] = {ICAP_RX_DEVICE, sizeof(struct icap_buf_switch)},
+	[ICAP_MSG_DSP_CHAIN] = {ICAP_RX_DEVICE, sizeof(struct icap_dsp_chain)},
+	[ICAP_MSG_DSP_PARAMS] = {ICAP_RX_DEVICE, sizeof(struct icap_dsp_params)},
+	[ICAP_MSG_CTRL_BLOCK] = {ICAP_RX_DEVICE, sizeof(struct icap_ctrl_desc)},
+	[ICAP_MSG_MONITOR] = {ICAP_RX_DEVICE, sizeof(struct icap_monitor_route)},
+	[ICAP_MSG_ERROR] = {ICAP_RX_APPLICATION, sizeof(int32_t)},
+	[ICAP_MSG_HEARTBEAT] = {ICAP_RX_APPLICATION | ICAP_RX_DEVICE, 0},
+};
+
+/* Clock estimator loop gains, as power of two shifts */
+#define ICAP_CLOCK_PHASE_SHIFT (5)
+#define ICAP_CLOCK_RATE_SHIFT (11)
+
+/* Restart the clock estimator when reports are more than ~1s apart */
+#define ICAP_CLOCK_MAX_GAP_SHIFT (30)
+
+/* Max rate deviation tracked by the clock estimator, ~1000ppm in Q32 */
+#define ICAP_CLOCK_RATE_DEV_MAX ((int64_t)1 << 22)
+
+/* Round trips measured before the adaptive timeout is used */
+#define ICAP_RTT_MIN_SAMPLES (4)
+
+static
+void icap_link_init(struct icap_instance *icap)
+{
+	struct icap_link *link = &icap->link;
+
+	memset(link, 0, sizeof(struct icap_link));
+	link->peer_alive = 1;
+	link->timeout_min_us = ICAP_MSG_TIMEOUT_MIN_US;
+	link->timeout_max_us = ICAP_MSG_TIMEOUT_US;
+	link->timeout_mult = ICAP_MSG_TIMEOUT_RTT_MULT;
+}
+
+/*
+ * Peers detect lost state by the echoed session, a restarted instance must
+ * not reuse its id. Needs the transport initialized for the time and entropy.
+ */
+static
+void icap_link_new_session(struct icap_instance *icap)
+{
+	uint64_t now = icap_platform_time_ns(icap);
+	uint32_t seed;
+
+	seed = icap_platform_entropy(icap) ^ (uint32_t)now ^ (uint32_t)(now >> 32);
+
+	/* Spread the bits, seeds of consecutive boots often differ in a few */
+	seed ^= seed >> 16;
+	seed *= 0x85ebca6b;
+	seed ^= seed >> 13;
+	seed *= 0xc2b2ae35;
+	seed ^= seed >> 16;
+
+	/* Never 0, the peer session isn't known before the first heartbeat */
+	icap->link.session = seed | 1;
+}
+
 int32_t icap_application_init(struct icap_instance *icap, char* name,
 		struct icap_application_callbacks *cb, void *priv)
 {
+	int32_t ret;
+
 	if ( (icap == NULL) || (cb == NULL)) {
 		return -ICAP_ERROR_INVALID;
 	}
@@ -77,7 +199,21 @@ int32_t icap_application_init(struct icap_instance *icap, char* name,
 	icap->priv = priv;
 	icap->callbacks = cb;
 	icap->seq_num = 0;
-	return icap_init_transport(icap);
+	memset(&icap->clock, 0, sizeof(icap->clock));
+	icap_link_init(icap);
+	memset(&icap->journal, 0, sizeof(icap->journal));
+	memset(&icap->resp_cache, 0, sizeof(icap->resp_cache));
+	memset(&icap->sessions, 0, sizeof(icap->sessions));
+	icap->proxy = NULL;
+	icap->cache = NULL;
+	icap->arena = NULL;
+	icap->xlat = NULL;
+	ret = icap_init_transport(icap);
+	if (ret) {
+		return ret;
+	}
+	icap_link_new_session(icap);
+	return 0;
 }
 
 int32_t icap_application_deinit(struct icap_instance *icap)
@@ -92,6 +228,8 @@ int32_t icap_application_deinit(struct icap_instance *icap)
 int32_t icap_device_init(struct icap_instance *icap, char* name,
 		struct icap_device_callbacks *cb, void *priv)
 {
+	int32_t ret;
+
 	if ( (icap == NULL) || (cb == NULL) ) {
 		return -ICAP_ERROR_INVALID;
 	}
@@ -100,7 +238,21 @@ int32_t icap_device_init(struct icap_instance *icap, char* name,
 	icap->priv = priv;
 	icap->callbacks = cb;
 	icap->seq_num = 0;
-	return icap_init_transport(icap);
+	memset(&icap->clock, 0, sizeof(icap->clock));
+	icap_link_init(icap);
+	memset(&icap->journal, 0, sizeof(icap->journal));
+	memset(&icap->resp_cache, 0, sizeof(icap->resp_cache));
+	memset(&icap->sessions, 0, sizeof(icap->sessions));
+	icap->proxy = NULL;
+	icap->cache = NULL;
+	icap->arena = NULL;
+	icap->xlat = NULL;
+	ret = icap_init_transport(icap);
+	if (ret) {
+		return ret;
+	}
+	icap_link_new_session(icap);
+	return 0;
 }
 
 int32_t icap_device_deinit(struct icap_instance *icap)
@@ -112,14 +264,205 @@ int32_t icap_device_deinit(struct icap_instance *icap)
 	return icap_deinit_transport(icap);
 }
 
+static
+struct icap_rtt *icap_get_rtt(struct icap_instance *icap, enum icap_msg_cmd cmd)
+{
+	uint32_t slot;
+
+	/* Control commands first, then stream commands, others share the last slot */
+	if ((cmd >= ICAP_MSG_GET_DEV_NUM) && (cmd <= ICAP_MSG_DEV_DEINIT)) {
+		slot = cmd - ICAP_MSG_GET_DEV_NUM;
+	} else if ((cmd >= ICAP_MSG_ADD_SRC) && (cmd < ICAP_MSG_ADD_SRC + ICAP_RTT_SLOTS - 5)) {
+		slot = cmd - ICAP_MSG_ADD_SRC + 4;
+	} else {
+		slot = ICAP_RTT_SLOTS - 1;
+	}
+	return &icap->link.rtt[slot];
+}
+
+static
+uint32_t icap_get_timeout(struct icap_instance *icap, enum icap_msg_cmd cmd)
+{
+	struct icap_link *link = &icap->link;
+	struct icap_rtt *rtt = icap_get_rtt(icap, cmd);
+	uint64_t timeout;
+
+	icap_platform_irq_lock(icap);
+	if ((link->timeout_mult == 0) || (rtt->samples < ICAP_RTT_MIN_SAMPLES)) {
+		/* Retransmissions share the max timeout */
+		timeout = link->timeout_max_us / (ICAP_MSG_RETRIES + 1);
+	} else {
+		timeout = ((uint64_t)rtt->srtt_us + 4 * (uint64_t)rtt->rttvar_us) * link->timeout_mult;
+	}
+	if (timeout > link->timeout_max_us) {
+		timeout = link->timeout_max_us;
+	}
+	if (timeout < link->timeout_min_us) {
+		timeout = link->timeout_min_us;
+	}
+	icap_platform_irq_unlock(icap);
+	return (uint32_t)timeout;
+}
+
+static
+void icap_update_rtt(struct icap_instance *icap, enum icap_msg_cmd cmd,
+		uint64_t start, int32_t result)
+{
+	struct icap_rtt *rtt = icap_get_rtt(icap, cmd);
+	uint64_t elapsed = icap_platform_time_ns(icap) - start;
+	int32_t sample_us;
+	int32_t err;
+
+	if (elapsed > 0xffffffff) {
+		elapsed = 0xffffffff;
+	}
+	sample_us = (uint32_t)elapsed / 1000;
+
+	icap_platform_irq_lock(icap);
+	if (result == -ICAP_ERROR_TIMEOUT) {
+		/* Fall back to the max timeout until new measurements are collected */
+		rtt->samples = 0;
+	} else if (rtt->samples == 0) {
+		rtt->srtt_us = sample_us;
+		rtt->rttvar_us = sample_us / 2;
+		rtt->samples = 1;
+	} else {
+		err = sample_us - (int32_t)rtt->srtt_us;
+		rtt->srtt_us = (int32_t)rtt->srtt_us + err / 8;
+		if (err < 0) {
+			err = -err;
+		}
+		rtt->rttvar_us = (int32_t)rtt->rttvar_us + (err - (int32_t)rtt->rttvar_us) / 4;
+		if (rtt->samples < ICAP_RTT_MIN_SAMPLES) {
+			rtt->samples++;
+		}
+	}
+	icap_platform_irq_unlock(icap);
+}
+
+static
+void icap_init_header(struct icap_instance *icap, struct icap_msg_header *header,
+		enum icap_msg_cmd cmd, enum icap_msg_type type, uint32_t seq_num, uint32_t size)
+{
+	header->protocol_version = ICAP_PROTOCOL_VERSION;
+	header->seq_num = seq_num;
+	header->cmd = cmd;
+	header->type = type;
+	header->session = icap->link.session;
+	header->flags = 0;
+	memset(&header->reserved, 0, sizeof(header->reserved));
+	header->payload_len = size;
+}
+
+/* Destination of responses, the session of the message being parsed */
+static
+union icap_remote_addr *icap_session_dst(struct icap_instance *icap)
+{
+	if (!icap->sessions.enabled) {
+		return NULL;
+	}
+	return &icap->sessions.sessions[icap->sessions.current].addr;
+}
+
+static
+int32_t icap_send_raw(struct icap_instance *icap, union icap_remote_addr *dst,
+		enum icap_msg_cmd cmd, enum icap_msg_type type, uint32_t seq_num,
+		uint32_t flags, void *data, uint32_t size)
+{
+	struct icap_msg msg;
+
+	/* Copy data to msg payload */
+	if (data) {
+		if (size > sizeof(msg.payload)) {
+			return -ICAP_ERROR_MSG_LEN;
+		}
+		memcpy(&msg.payload, data, size);
+	} else {
+		size = 0;
+	}
+
+	icap_init_header(icap, &msg.header, cmd, type, seq_num, size);
+	msg.header.flags = flags;
+
+	return icap_send_platform(icap, dst, &msg, sizeof(msg.header) + size);
+}
+
+static
+uint32_t icap_next_seq_num(struct icap_instance *icap, struct icap_session *session)
+{
+	uint32_t seq_num;
+
+	icap_platform_lock(icap);
+	if (session) {
+		session->seq_num++;
+		seq_num = session->seq_num;
+	} else {
+		icap->seq_num++;
+		seq_num = icap->seq_num;
+	}
+	icap_platform_unlock(icap);
+	return seq_num;
+}
+
+/* Send asynchronous message, to the default remote if session is NULL */
+static
+int32_t icap_send_async(struct icap_instance *icap, struct icap_session *session,
+		enum icap_msg_cmd cmd, void *data, uint32_t size)
+{
+	if (data && (size > sizeof(union icap_msg_payload))) {
+		return -ICAP_ERROR_MSG_LEN;
+	}
+
+	return icap_send_raw(icap, session ? &session->addr : NULL, cmd, ICAP_MSG,
+			icap_next_seq_num(icap, session), 0, data, size);
+}
+
+/* Send asynchronous message to all application endpoints */
+static
+int32_t icap_send_broadcast(struct icap_instance *icap, enum icap_msg_cmd cmd,
+		void *data, uint32_t size)
+{
+	struct icap_session *session;
+	int32_t ret = 0;
+	int32_t s32;
+	uint32_t i;
+
+	if (!icap->sessions.enabled) {
+		return icap_send_async(icap, NULL, cmd, data, size);
+	}
+
+	for (i = 0; i < ICAP_SESSIONS_MAX; i++) {
+		session = &icap->sessions.sessions[i];
+		if (!session->used) {
+			continue;
+		}
+		s32 = icap_send_async(icap, session, cmd, data, size);
+		if (s32 < 0) {
+			ret = s32;
+		}
+	}
+	return ret;
+}
+
 static
 int32_t icap_send_msg(struct icap_instance *icap, enum icap_msg_cmd cmd,
 		void *data, uint32_t size, uint32_t sync, struct icap_msg *response)
 {
 	struct icap_msg msg;
 	uint32_t seq_num;
+	uint32_t timeout_us;
+	uint32_t attempt;
+	uint64_t start;
 	int32_t ret;
 
+	if (!sync) {
+		return icap_send_async(icap, NULL, cmd, data, size);
+	}
+
+	if (!icap->link.peer_alive) {
+		return -ICAP_ERROR_BROKEN_CON;
+	}
+
 	/* Copy data to msg payload */
 	if (data) {
 		if (size > sizeof(msg.payload)) {
@@ -136,35 +479,102 @@ int32_t icap_send_msg(struct icap_instance *icap, enum icap_msg_cmd cmd,
 	seq_num = icap->seq_num;
 	icap_platform_unlock(icap);
 
-	/* Initialize msg header */
-	msg.header.protocol_version = ICAP_PROTOCOL_VERSION;
-	msg.header.seq_num = seq_num;
-	msg.header.cmd = cmd;
-	msg.header.type = ICAP_MSG;
-	memset(&msg.header.reserved, 0, sizeof(msg.header.reserved));
-	msg.header.payload_len = size;
+	icap_init_header(icap, &msg.header, cmd, ICAP_MSG, seq_num, size);
 
 	size += sizeof(msg.header);
 
-	if (sync) {
+	timeout_us = icap_get_timeout(icap, cmd);
+	start = icap_platform_time_ns(icap);
+
+	/*
+	 * Retransmit with the same seq_num, the receiver answers a duplicate from
+	 * its response cache and a late response to any attempt is accepted.
+	 */
+	for (attempt = 0; ; attempt++) {
 		ret = icap_prepare_wait(icap, &msg);
 		if (ret) {
 			return ret;
 		}
+
+		icap_send_platform(icap, NULL, &msg, size);
+
+		icap_platform_irq_lock(icap);
+		icap->link.sync_depth++;
+		icap_platform_irq_unlock(icap);
+
+		ret = icap_wait_for_response(icap, seq_num, response, timeout_us);
+
+		icap_platform_irq_lock(icap);
+		icap->link.sync_depth--;
+		icap_platform_irq_unlock(icap);
+
+		if ((ret != -ICAP_ERROR_TIMEOUT) || (attempt >= ICAP_MSG_RETRIES) ||
+				!icap->link.peer_alive) {
+			break;
+		}
+		msg.header.flags |= ICAP_MSG_FLAG_RETRANSMIT;
 	}
 
-	ret = icap_send_platform(icap, &msg, size);
+	/* Round trip of a retransmitted message is ambiguous, don't measure it */
+	if ((ret == -ICAP_ERROR_TIMEOUT) || ((attempt == 0) && (ret != -ICAP_ERROR_BROKEN_CON))) {
+		icap_update_rtt(icap, cmd, start, ret);
+	}
+	return ret;
+}
 
-	if (!sync) {
-		return ret;
+static
+struct icap_resp_cache_entry *icap_resp_cache_find(struct icap_instance *icap,
+		struct icap_msg_header *msg_header)
+{
+	struct icap_resp_cache_entry *entry;
+	uint32_t i;
+
+	for (i = 0; i < ICAP_RESP_CACHE_SIZE; i++) {
+		entry = &icap->resp_cache.entries[i];
+		if (entry->valid && (entry->seq_num == msg_header->seq_num) &&
+				(entry->cmd == msg_header->cmd) &&
+				(entry->session == msg_header->session) &&
+				(entry->peer == icap->sessions.current)) {
+			return entry;
+		}
+	}
+	return NULL;
+}
+
+static
+void icap_resp_cache_put(struct icap_instance *icap, struct icap_msg *response,
+		uint32_t rx_session)
+{
+	struct icap_resp_cache *cache = &icap->resp_cache;
+	struct icap_resp_cache_entry *entry;
+
+	if ((response->header.cmd == ICAP_MSG_HEARTBEAT) ||
+			(response->header.payload_len > ICAP_RESP_CACHE_PAYLOAD)) {
+		return;
 	}
 
-	return icap_wait_for_response(icap, seq_num, response);
+	icap_platform_irq_lock(icap);
+	entry = &cache->entries[cache->next];
+	cache->next++;
+	if (cache->next >= ICAP_RESP_CACHE_SIZE) {
+		cache->next = 0;
+	}
+	entry->valid = 1;
+	entry->session = rx_session;
+	entry->peer = icap->sessions.current;
+	entry->seq_num = response->header.seq_num;
+	entry->cmd = response->header.cmd;
+	entry->type = response->header.type;
+	entry->payload_len = response->header.payload_len;
+	memcpy(entry->payload, &response->payload, response->header.payload_len);
+	icap_platform_irq_unlock(icap);
 }
 
+/* Send response and cache it for duplicates of the message from rx_session */
 static
-int32_t icap_send_response(struct icap_instance *icap, enum icap_msg_cmd cmd,
-		enum icap_msg_type type, uint32_t seq_num, void *data, uint32_t size)
+int32_t icap_send_cached_response(struct icap_instance *icap, uint32_t rx_session,
+		enum icap_msg_cmd cmd, enum icap_msg_type type, uint32_t seq_num,
+		void *data, uint32_t size)
 {
 	struct icap_msg msg;
 
@@ -178,17 +588,46 @@ int32_t icap_send_response(struct icap_instance *icap, enum icap_msg_cmd cmd,
 		size = 0;
 	}
 
-	/* Initialize msg header */
-	msg.header.protocol_version = ICAP_PROTOCOL_VERSION;
-	msg.header.seq_num = seq_num;
-	msg.header.cmd = cmd;
-	msg.header.type = type;
-	memset(&msg.header.reserved, 0, sizeof(msg.header.reserved));
-	msg.header.payload_len = size;
+	icap_init_header(icap, &msg.header, cmd, type, seq_num, size);
+
+	icap_resp_cache_put(icap, &msg, rx_session);
 
 	size += sizeof(msg.header);
 
-	return icap_send_platform(icap, &msg, size);
+	return icap_send_platform(icap, icap_session_dst(icap), &msg, size);
+}
+
+static
+int32_t icap_send_response(struct icap_instance *icap, enum icap_msg_cmd cmd,
+		enum icap_msg_type type, uint32_t seq_num, void *data, uint32_t size)
+{
+	return icap_send_cached_response(icap, icap->resp_cache.rx_session, cmd, type,
+			seq_num, data, size);
+}
+
+/* Answer a retransmitted message from the response cache if it was already executed */
+static
+int32_t icap_resp_cache_replay(struct icap_instance *icap, struct icap_msg_header *msg_header)
+{
+	struct icap_resp_cache_entry *entry;
+	struct icap_msg response;
+	uint32_t found = 0;
+
+	icap_platform_irq_lock(icap);
+	entry = icap_resp_cache_find(icap, msg_header);
+	if (entry) {
+		icap_init_header(icap, &response.header, entry->cmd, entry->type,
+				entry->seq_num, entry->payload_len);
+		memcpy(&response.payload, entry->payload, entry->payload_len);
+		found = 1;
+	}
+	icap_platform_irq_unlock(icap);
+
+	if (!found) {
+		return -ICAP_ERROR_MSG_ID;
+	}
+	return icap_send_platform(icap, icap_session_dst(icap), &response,
+			sizeof(response.header) + response.header.payload_len);
 }
 
 static
@@ -205,153 +644,1762 @@ int32_t icap_send_nak(struct icap_instance *icap, enum icap_msg_cmd cmd,
 	return icap_send_response(icap, cmd, ICAP_NAK, seq_num, &error, sizeof(error));
 }
 
-int32_t icap_get_subdevices(struct icap_instance *icap)
+static
+void icap_journal_subdev_init(struct icap_instance *icap,
+		struct icap_subdevice_params *params)
 {
-	struct icap_msg response;
-	int32_t ret;
+	struct icap_journal_subdev *subdev;
 
-	ret = icap_send_msg(icap, ICAP_MSG_GET_DEV_NUM, NULL, 0, 1, &response);
-	if (ret) {
-		return ret;
-	}
-	if (response.header.payload_len != sizeof(uint32_t)){
-		return -ICAP_ERROR_MSG_LEN;
+	if (params->subdev_id >= ICAP_JOURNAL_SUBDEVS) {
+		return;
 	}
-	return response.payload.s32;
+	subdev = &icap->journal.subdevs[params->subdev_id];
+
+	icap_platform_irq_lock(icap);
+	subdev->used = 1;
+	subdev->run_state = ICAP_RUN_STOPPED;
+	memcpy(&subdev->params, params, sizeof(struct icap_subdevice_params));
+	icap_platform_irq_unlock(icap);
 }
 
-int32_t icap_get_subdevice_features(struct icap_instance *icap, uint32_t subdev_id,
-		struct icap_subdevice_features *features)
+static
+void icap_journal_subdev_deinit(struct icap_instance *icap, uint32_t subdev_id)
 {
-	struct icap_msg response;
-	int32_t ret;
-
-	if(features == NULL){
-		return -ICAP_ERROR_INVALID;
+	struct icap_monitor_route *route;
+	uint32_t i;
+
+	icap_platform_irq_lock(icap);
+	for (i = 0; i < ICAP_JOURNAL_MONITORS; i++) {
+		route = &icap->journal.monitors[i];
+		if ((route->src_subdev_id == subdev_id) || (route->dst_subdev_id == subdev_id)) {
+			route->enable = 0;
+		}
 	}
+	icap_platform_irq_unlock(icap);
 
-	ret = icap_send_msg(icap, ICAP_MSG_GET_DEV_FEATURES, &subdev_id, sizeof(subdev_id), 1, &response);
-	if (ret) {
-		return ret;
+	if (subdev_id >= ICAP_JOURNAL_SUBDEVS) {
+		return;
 	}
-	if (response.header.payload_len != sizeof(struct icap_subdevice_features)){
-		return -ICAP_ERROR_MSG_LEN;
+	icap_platform_irq_lock(icap);
+	icap->journal.subdevs[subdev_id].used = 0;
+	icap->journal.subdevs[subdev_id].dsp_chain.num = 0;
+	icap->journal.subdevs[subdev_id].dsp_params_set = 0;
+	icap->journal.subdevs[subdev_id].ctrl.addr = 0;
+	icap_platform_irq_unlock(icap);
+}
+
+static
+void icap_journal_run_state(struct icap_instance *icap, uint32_t subdev_id,
+		enum icap_run_state state)
+{
+	if (subdev_id >= ICAP_JOURNAL_SUBDEVS) {
+		return;
 	}
-	memcpy(features, &response.payload, sizeof(struct icap_subdevice_features));
-	return 0;
+	icap_platform_irq_lock(icap);
+	icap->journal.subdevs[subdev_id].run_state = state;
+	icap_platform_irq_unlock(icap);
 }
 
-int32_t icap_subdevice_init(struct icap_instance *icap,
-		struct icap_subdevice_params *params)
+static
+void icap_journal_dsp_chain(struct icap_instance *icap, struct icap_dsp_chain *chain)
 {
-	if(params == NULL){
-		return -ICAP_ERROR_INVALID;
+	struct icap_journal_subdev *subdev;
+	uint32_t i;
+
+	if (chain->subdev_id >= ICAP_JOURNAL_SUBDEVS) {
+		return;
+	}
+	subdev = &icap->journal.subdevs[chain->subdev_id];
+
+	icap_platform_irq_lock(icap);
+	/* Blocks keep their params only if the type on their position stays */
+	for (i = 0; i < ICAP_DSP_BLOCKS_MAX; i++) {
+		if ((i >= chain->num) || (i >= subdev->dsp_chain.num) ||
+				(chain->blocks[i] != subdev->dsp_chain.blocks[i])) {
+			subdev->dsp_params_set &= ~(1u << i);
+		}
 	}
-	return icap_send_msg(icap, ICAP_MSG_DEV_INIT, params, sizeof(struct icap_subdevice_params), 1, NULL);
+	memcpy(&subdev->dsp_chain, chain, sizeof(struct icap_dsp_chain));
+	icap_platform_irq_unlock(icap);
 }
 
-int32_t icap_subdevice_deinit(struct icap_instance *icap, uint32_t subdev_id)
+static
+void icap_journal_dsp_params(struct icap_instance *icap, struct icap_dsp_params *params)
 {
-	return icap_send_msg(icap, ICAP_MSG_DEV_DEINIT, &subdev_id, sizeof(subdev_id), 1, NULL);
+	struct icap_journal_subdev *subdev;
+
+	if (params->subdev_id >= ICAP_JOURNAL_SUBDEVS) {
+		return;
+	}
+	subdev = &icap->journal.subdevs[params->subdev_id];
+
+	icap_platform_irq_lock(icap);
+	subdev->dsp_params_set |= 1u << params->block;
+	memcpy(&subdev->dsp_params[params->block], params, sizeof(struct icap_dsp_params));
+	icap_platform_irq_unlock(icap);
 }
 
-int32_t icap_add_src(struct icap_instance *icap, struct icap_buf_descriptor *buf)
+static
+void icap_journal_monitor(struct icap_instance *icap, struct icap_monitor_route *route)
 {
-	struct icap_msg response;
-	int32_t ret;
+	struct icap_monitor_route *entry;
+	struct icap_monitor_route *free = NULL;
+	uint32_t i;
+
+	icap_platform_irq_lock(icap);
+	for (i = 0; i < ICAP_JOURNAL_MONITORS; i++) {
+		entry = &icap->journal.monitors[i];
+		if (!entry->enable) {
+			if (free == NULL) {
+				free = entry;
+			}
+		} else if ((entry->src_subdev_id == route->src_subdev_id) &&
+				(entry->dst_subdev_id == route->dst_subdev_id)) {
+			/* Replaced or removed */
+			entry->enable = 0;
+			free = entry;
+			break;
+		}
+	}
+	if (route->enable && free) {
+		memcpy(free, route, sizeof(struct icap_monitor_route));
+	}
+	icap_platform_irq_unlock(icap);
+}
 
-	if (buf == NULL) {
-		return -ICAP_ERROR_INVALID;
+static
+void icap_journal_ctrl_block(struct icap_instance *icap, struct icap_ctrl_desc *desc)
+{
+	if ((uint32_t)desc->subdev_id >= ICAP_JOURNAL_SUBDEVS) {
+		return;
 	}
+	icap_platform_irq_lock(icap);
+	memcpy(&icap->journal.subdevs[desc->subdev_id].ctrl, desc, sizeof(struct icap_ctrl_desc));
+	icap_platform_irq_unlock(icap);
+}
 
-	ret = icap_send_msg(icap, ICAP_MSG_ADD_SRC, buf, sizeof(struct icap_buf_descriptor), 1, &response);
-	if (ret) {
-		return ret;
+static
+struct icap_journal_buf *icap_journal_find_app_id(struct icap_instance *icap, uint32_t app_id)
+{
+	struct icap_journal_buf *jbuf;
+	uint32_t i;
+
+	for (i = 0; i < ICAP_JOURNAL_BUFS; i++) {
+		jbuf = &icap->journal.bufs[i];
+		if (jbuf->used && (jbuf->app_id == app_id)) {
+			return jbuf;
+		}
 	}
+	return NULL;
+}
 
-	if (response.header.payload_len != sizeof(uint32_t)){
-		return -ICAP_ERROR_MSG_LEN;
+static
+struct icap_journal_buf *icap_journal_find_dev_id(struct icap_instance *icap, uint32_t dev_id)
+{
+	struct icap_journal_buf *jbuf;
+	uint32_t i;
+
+	for (i = 0; i < ICAP_JOURNAL_BUFS; i++) {
+		jbuf = &icap->journal.bufs[i];
+		if (jbuf->used && (jbuf->dev_id == dev_id)) {
+			return jbuf;
+		}
 	}
-	return response.payload.s32;
+	return NULL;
 }
 
-int32_t icap_add_dst(struct icap_instance *icap, struct icap_buf_descriptor *buf)
+/* Returns buffer id for the application, it differs from the device id only after a session resume */
+static
+int32_t icap_journal_add_buf(struct icap_instance *icap, struct icap_buf_descriptor *buf,
+		enum icap_dev_type dir, uint32_t dev_id)
 {
-	struct icap_msg response;
+	struct icap_journal_buf *jbuf = NULL;
+	uint32_t app_id = dev_id;
+	uint32_t i;
 	int32_t ret;
 
-	if (buf == NULL) {
-		return -ICAP_ERROR_INVALID;
+	icap_platform_irq_lock(icap);
+
+	for (i = 0; i < ICAP_JOURNAL_BUFS; i++) {
+		if (!icap->journal.bufs[i].used) {
+			jbuf = &icap->journal.bufs[i];
+			break;
+		}
 	}
 
-	ret = icap_send_msg(icap, ICAP_MSG_ADD_DST, buf, sizeof(struct icap_buf_descriptor), 1, &response);
-	if (ret) {
+	if (jbuf == NULL) {
+		/* Buffers above ICAP_JOURNAL_BUFS aren't restored by icap_session_resume() and
+		 * keep the device id, it can't be used if a resumed buffer has it already */
+		ret = icap_journal_find_app_id(icap, dev_id) ? -ICAP_ERROR_NOMEM : (int32_t)dev_id;
+		icap_platform_irq_unlock(icap);
 		return ret;
 	}
 
-	if (response.header.payload_len != sizeof(uint32_t)){
-		return -ICAP_ERROR_MSG_LEN;
+	/* Keep the device id unless an application id is already taken by a resumed buffer */
+	while (icap_journal_find_app_id(icap, app_id) != NULL) {
+		app_id++;
 	}
-	return response.payload.s32;
+
+	jbuf->used = 1;
+	jbuf->dir = dir;
+	jbuf->app_id = app_id;
+	jbuf->dev_id = dev_id;
+	memcpy(&jbuf->buf, buf, sizeof(struct icap_buf_descriptor));
+
+	icap_platform_irq_unlock(icap);
+	return app_id;
 }
 
-int32_t icap_remove_src(struct icap_instance *icap, uint32_t buf_id)
+static
+void icap_journal_remove_buf(struct icap_instance *icap, uint32_t app_id)
 {
-	return icap_send_msg(icap, ICAP_MSG_REMOVE_SRC, &buf_id, sizeof(buf_id), 1, NULL);
+	struct icap_journal_buf *jbuf;
+
+	icap_platform_irq_lock(icap);
+	jbuf = icap_journal_find_app_id(icap, app_id);
+	if (jbuf) {
+		jbuf->used = 0;
+	}
+	icap_platform_irq_unlock(icap);
+}
+
+static
+int32_t icap_journal_switch_buf(struct icap_instance *icap, struct icap_buf_switch *buf_switch,
+		uint32_t dev_id)
+{
+	struct icap_journal_buf *jbuf;
+	enum icap_dev_type dir = ICAP_DEV_PLAYBACK;
+
+	icap_platform_irq_lock(icap);
+	jbuf = icap_journal_find_app_id(icap, buf_switch->buf_id);
+	if (jbuf) {
+		dir = (enum icap_dev_type)jbuf->dir;
+		jbuf->used = 0;
+	}
+	icap_platform_irq_unlock(icap);
+
+	return icap_journal_add_buf(icap, &buf_switch->buf, dir, dev_id);
+}
+
+static
+void icap_journal_buf_geometry(struct icap_instance *icap, struct icap_buf_geometry *geometry)
+{
+	struct icap_journal_buf *jbuf;
+
+	icap_platform_irq_lock(icap);
+	jbuf = icap_journal_find_app_id(icap, geometry->buf_id);
+	if (jbuf) {
+		jbuf->buf.frag_size = geometry->frag_size;
+		jbuf->buf.gap_size = geometry->gap_size;
+	}
+	icap_platform_irq_unlock(icap);
+}
+
+static
+uint32_t icap_journal_dev_id(struct icap_instance *icap, uint32_t app_id)
+{
+	struct icap_journal_buf *jbuf;
+	uint32_t dev_id = app_id;
+
+	icap_platform_irq_lock(icap);
+	jbuf = icap_journal_find_app_id(icap, app_id);
+	if (jbuf) {
+		dev_id = jbuf->dev_id;
+	}
+	icap_platform_irq_unlock(icap);
+	return dev_id;
+}
+
+static
+uint32_t icap_journal_app_id(struct icap_instance *icap, uint32_t dev_id)
+{
+	struct icap_journal_buf *jbuf;
+	uint32_t app_id = dev_id;
+
+	icap_platform_irq_lock(icap);
+	jbuf = icap_journal_find_dev_id(icap, dev_id);
+	if (jbuf) {
+		app_id = jbuf->app_id;
+	}
+	icap_platform_irq_unlock(icap);
+	return app_id;
+}
+
+int32_t icap_set_cache(struct icap_instance *icap, struct icap_cache *cache,
+		const struct icap_cache_ops *ops)
+{
+	if (icap == NULL) {
+		return -ICAP_ERROR_INVALID;
+	}
+	if (cache == NULL) {
+		icap->cache = NULL;
+		return 0;
+	}
+	if ((ops == NULL) || (ops->clean == NULL) || (ops->invalidate == NULL)) {
+		return -ICAP_ERROR_INVALID;
+	}
+	memset(cache->bufs, 0, sizeof(cache->bufs));
+	cache->ops = ops;
+	icap->cache = cache;
+	return 0;
+}
+
+int32_t icap_set_arena(struct icap_instance *icap, struct icap_arena *arena)
+{
+	if (icap == NULL) {
+		return -ICAP_ERROR_INVALID;
+	}
+	icap->arena = arena;
+	return 0;
+}
+
+int32_t icap_set_xlat(struct icap_instance *icap, struct icap_xlat *xlat)
+{
+	if (icap == NULL) {
+		return -ICAP_ERROR_INVALID;
+	}
+	icap->xlat = xlat;
+	return 0;
+}
+
+/* Maps a received buffer to the local address space, the whole buffer must fit one region */
+static
+int32_t icap_xlat_buf(struct icap_instance *icap, struct icap_buf_descriptor *buf)
+{
+	uint64_t size = buf->buf_size;
+	uint64_t addr;
+	int32_t ret;
+
+	if (icap->xlat == NULL) {
+		return 0;
+	}
+	/* buf_size is the size of one plane */
+	if ((buf->type == ICAP_BUF_PLANAR) && (buf->channels > 1)) {
+		size += (uint64_t)(buf->channels - 1) * buf->channel_stride;
+	}
+	ret = icap_xlat_addr(icap->xlat, buf->buf, size, &addr);
+	if (ret == 0) {
+		buf->buf = addr;
+	}
+	return ret;
+}
+
+/* Maps a received control block to the local address space, 0 detaches and stays 0 */
+static
+int32_t icap_xlat_ctrl(struct icap_instance *icap, struct icap_ctrl_desc *desc)
+{
+	uint64_t addr;
+	int32_t ret;
+
+	if ((icap->xlat == NULL) || (desc->addr == 0)) {
+		return 0;
+	}
+	ret = icap_xlat_addr(icap->xlat, desc->addr, desc->size, &addr);
+	if (ret == 0) {
+		desc->addr = addr;
+	}
+	return ret;
+}
+
+static
+struct icap_cache_buf *icap_cache_find(struct icap_instance *icap, uint32_t buf_id)
+{
+	struct icap_cache_buf *cbuf;
+	uint32_t i;
+
+	for (i = 0; i < ICAP_CACHE_BUFS; i++) {
+		cbuf = &icap->cache->bufs[i];
+		if (cbuf->used && (cbuf->buf_id == buf_id)) {
+			return cbuf;
+		}
+	}
+	return NULL;
+}
+
+static
+void icap_cache_add(struct icap_instance *icap, uint32_t buf_id,
+		struct icap_buf_descriptor *buf, uint32_t dir)
+{
+	struct icap_cache_buf *cbuf;
+	uint32_t i;
+
+	if (icap->cache == NULL) {
+		return;
+	}
+
+	icap_platform_irq_lock(icap);
+	/* A replaced buffer still waiting for its switch point is gone if its id is reused */
+	cbuf = icap_cache_find(icap, buf_id);
+	if (cbuf) {
+		cbuf->used = 0;
+	}
+	for (i = 0; i < ICAP_CACHE_BUFS; i++) {
+		cbuf = &icap->cache->bufs[i];
+		if (!cbuf->used) {
+			if (icap_frag_init(&cbuf->cur, buf) == 0) {
+				cbuf->used = 1;
+				cbuf->buf_id = buf_id;
+				cbuf->dir = dir;
+				cbuf->planes = (buf->type == ICAP_BUF_PLANAR) && buf->channels ? buf->channels : 1;
+				cbuf->switch_pending = 0;
+				cbuf->retire_pending = 0;
+				memcpy(&cbuf->buf, buf, sizeof(struct icap_buf_descriptor));
+			}
+			break;
+		}
+	}
+	icap_platform_irq_unlock(icap);
+}
+
+static
+void icap_cache_remove(struct icap_instance *icap, uint32_t buf_id)
+{
+	struct icap_cache_buf *cbuf;
+
+	if (icap->cache == NULL) {
+		return;
+	}
+
+	icap_platform_irq_lock(icap);
+	cbuf = icap_cache_find(icap, buf_id);
+	if (cbuf) {
+		cbuf->used = 0;
+	}
+	icap_platform_irq_unlock(icap);
+}
+
+/* The new buffer keeps the direction of the replaced one, which is still
+ * reported until the switch point at fragment frag */
+static
+void icap_cache_switch(struct icap_instance *icap, uint32_t old_id, uint32_t new_id,
+		struct icap_buf_descriptor *buf, uint64_t frag)
+{
+	struct icap_cache_buf *cbuf;
+	uint32_t dir;
+
+	if (icap->cache == NULL) {
+		return;
+	}
+
+	icap_platform_irq_lock(icap);
+	cbuf = icap_cache_find(icap, old_id);
+	if (cbuf) {
+		dir = cbuf->dir;
+		if (cbuf->cur.pos >= frag) {
+			cbuf->used = 0;
+		} else {
+			cbuf->retire_frag = frag;
+			cbuf->retire_pending = 1;
+		}
+	}
+	icap_platform_irq_unlock(icap);
+
+	if (cbuf) {
+		icap_cache_add(icap, new_id, buf, dir);
+	}
+}
+
+static
+void icap_cache_geometry(struct icap_instance *icap, struct icap_buf_geometry *geometry)
+{
+	struct icap_cache_buf *cbuf;
+
+	if (icap->cache == NULL) {
+		return;
+	}
+
+	icap_platform_irq_lock(icap);
+	cbuf = icap_cache_find(icap, geometry->buf_id);
+	if (cbuf && !cbuf->retire_pending) {
+		cbuf->buf.frag_size = geometry->frag_size;
+		cbuf->buf.gap_size = geometry->gap_size;
+		cbuf->switch_frag = geometry->frag;
+		cbuf->switch_pending = 1;
+	}
+	icap_platform_irq_unlock(icap);
+}
+
+/* Runs the hook on the next frags fragments and moves the cursor past them */
+static
+void icap_cache_frags(struct icap_instance *icap, struct icap_cache_buf *cbuf, uint32_t frags,
+		void (*op)(struct icap_instance *icap, uint32_t buf_id, uint64_t addr, uint32_t size))
+{
+	struct icap_frag_cursor *cur = &cbuf->cur;
+	uint32_t plane;
+	uint32_t n;
+
+	while (frags) {
+		if (cbuf->retire_pending && (cur->pos >= cbuf->retire_frag)) {
+			cbuf->used = 0;
+			return;
+		}
+		if (cbuf->switch_pending && (cur->pos >= cbuf->switch_frag)) {
+			cbuf->switch_pending = 0;
+			if (icap_frag_init(cur, &cbuf->buf) || icap_frag_seek(cur, cbuf->switch_frag)) {
+				cbuf->used = 0;
+				return;
+			}
+		}
+		if (icap_frag_available(cur) == 0) {
+			return;
+		}
+
+		/* Gapless fragments up to the buffer end are one range */
+		n = 1;
+		if ((cur->type != ICAP_BUF_SCATTERED) && (cur->stride == cur->frag_size)) {
+			n = cur->frags - cur->index;
+			if (n > frags) {
+				n = frags;
+			}
+			if (cbuf->switch_pending && (cbuf->switch_frag - cur->pos < n)) {
+				n = (uint32_t)(cbuf->switch_frag - cur->pos);
+			}
+			if (cbuf->retire_pending && (cbuf->retire_frag - cur->pos < n)) {
+				n = (uint32_t)(cbuf->retire_frag - cur->pos);
+			}
+		}
+
+		for (plane = 0; plane < cbuf->planes; plane++) {
+			op(icap, cbuf->buf_id, cbuf->buf.buf + icap_frag_offset(cur, plane), n * cur->frag_size);
+		}
+		icap_frag_advance(cur, n);
+		frags -= n;
+	}
+	if (cbuf->retire_pending && (cur->pos >= cbuf->retire_frag)) {
+		cbuf->used = 0;
+	}
+}
+
+/* Maintains fragments of a dir buffer changing hands, followed by a memory barrier */
+static
+void icap_cache_sync(struct icap_instance *icap, uint32_t buf_id, uint32_t frags,
+		uint32_t dir, uint32_t clean)
+{
+	const struct icap_cache_ops *ops;
+	struct icap_cache_buf *cbuf;
+
+	if (icap->cache == NULL) {
+		return;
+	}
+	ops = icap->cache->ops;
+
+	icap_platform_irq_lock(icap);
+	cbuf = icap_cache_find(icap, buf_id);
+	if (cbuf && (cbuf->dir == dir)) {
+		icap_cache_frags(icap, cbuf, frags, clean ? ops->clean : ops->invalidate);
+	}
+	icap_platform_irq_unlock(icap);
+	ICAP_MEMORY_BARRIER();
+}
+
+/* Queues new scattered fragments, playback fragments are cleaned if clean_playback is set,
+ * other fragments invalidated. The ranges are maintained even if the queue is full. */
+static
+int32_t icap_cache_offsets(struct icap_instance *icap, struct icap_buf_offsets *offsets,
+		uint32_t buf_id, uint32_t clean_playback)
+{
+	void (*op)(struct icap_instance *icap, uint32_t buf_id, uint64_t addr, uint32_t size);
+	struct icap_cache_buf *cbuf;
+	uint32_t i;
+	int32_t ret = 0;
+
+	if (icap->cache == NULL) {
+		return 0;
+	}
+
+	icap_platform_irq_lock(icap);
+	cbuf = icap_cache_find(icap, buf_id);
+	if (cbuf) {
+		ret = icap_frag_push_offsets(&cbuf->cur, offsets);
+		op = icap->cache->ops->invalidate;
+		if (clean_playback && (cbuf->dir == ICAP_DEV_PLAYBACK)) {
+			op = icap->cache->ops->clean;
+		}
+		for (i = 0; (i < offsets->num) && (i < ICAP_BUF_MAX_FRAGS_OFFSETS_NUM); i++) {
+			op(icap, buf_id, cbuf->buf.buf + offsets->frags_offsets[i], cbuf->cur.frag_size);
+		}
+	}
+	icap_platform_irq_unlock(icap);
+	ICAP_MEMORY_BARRIER();
+	return ret;
+}
+
+/* Replayed buffers start from the first fragment again, replaced buffers are gone */
+static
+void icap_cache_restart(struct icap_instance *icap)
+{
+	struct icap_cache_buf *cbuf;
+	uint32_t i;
+
+	if (icap->cache == NULL) {
+		return;
+	}
+
+	icap_platform_irq_lock(icap);
+	for (i = 0; i < ICAP_CACHE_BUFS; i++) {
+		cbuf = &icap->cache->bufs[i];
+		if (!cbuf->used) {
+			continue;
+		}
+		if (cbuf->retire_pending || icap_frag_init(&cbuf->cur, &cbuf->buf)) {
+			cbuf->used = 0;
+		}
+		cbuf->switch_pending = 0;
+	}
+	icap_platform_irq_unlock(icap);
+}
+
+int32_t icap_get_subdevices(struct icap_instance *icap)
+{
+	struct icap_msg response;
+	int32_t ret;
+
+	ret = icap_send_msg(icap, ICAP_MSG_GET_DEV_NUM, NULL, 0, 1, &response);
+	if (ret) {
+		return ret;
+	}
+	if (response.header.payload_len != sizeof(uint32_t)){
+		return -ICAP_ERROR_MSG_LEN;
+	}
+	return response.payload.s32;
+}
+
+int32_t icap_get_subdevice_features(struct icap_instance *icap, uint32_t subdev_id,
+		struct icap_subdevice_features *features)
+{
+	struct icap_msg response;
+	int32_t ret;
+
+	if(features == NULL){
+		return -ICAP_ERROR_INVALID;
+	}
+
+	ret = icap_send_msg(icap, ICAP_MSG_GET_DEV_FEATURES, &subdev_id, sizeof(subdev_id), 1, &response);
+	if (ret) {
+		return ret;
+	}
+	if (response.header.payload_len != sizeof(struct icap_subdevice_features)){
+		return -ICAP_ERROR_MSG_LEN;
+	}
+	memcpy(features, &response.payload, sizeof(struct icap_subdevice_features));
+	return 0;
+}
+
+int32_t icap_subdevice_init(struct icap_instance *icap,
+		struct icap_subdevice_params *params)
+{
+	int32_t ret;
+
+	if(params == NULL){
+		return -ICAP_ERROR_INVALID;
+	}
+	ret = icap_send_msg(icap, ICAP_MSG_DEV_INIT, params, sizeof(struct icap_subdevice_params), 1, NULL);
+	if (ret == 0) {
+		icap_journal_subdev_init(icap, params);
+	}
+	return ret;
+}
+
+int32_t icap_subdevice_deinit(struct icap_instance *icap, uint32_t subdev_id)
+{
+	int32_t ret;
+
+	ret = icap_send_msg(icap, ICAP_MSG_DEV_DEINIT, &subdev_id, sizeof(subdev_id), 1, NULL);
+	if (ret == 0) {
+		icap_journal_subdev_deinit(icap, subdev_id);
+	}
+	return ret;
+}
+
+int32_t icap_add_src(struct icap_instance *icap, struct icap_buf_descriptor *buf)
+{
+	struct icap_msg response;
+	int32_t ret;
+
+	if (buf == NULL) {
+		return -ICAP_ERROR_INVALID;
+	}
+
+	ret = icap_send_msg(icap, ICAP_MSG_ADD_SRC, buf, sizeof(struct icap_buf_descriptor), 1, &response);
+	if (ret) {
+		return ret;
+	}
+
+	if (response.header.payload_len != sizeof(uint32_t)){
+		return -ICAP_ERROR_MSG_LEN;
+	}
+	ret = icap_journal_add_buf(icap, buf, ICAP_DEV_PLAYBACK, response.payload.u32);
+	if (ret < 0) {
+		/* The application has no id to refer to the buffer, detach it again */
+		icap_send_msg(icap, ICAP_MSG_REMOVE_SRC, &response.payload.u32, sizeof(uint32_t), 1, NULL);
+		return ret;
+	}
+	icap_cache_add(icap, ret, buf, ICAP_DEV_PLAYBACK);
+	if (icap->arena) {
+		icap_arena_bind(icap->arena, buf->buf, ret);
+	}
+	return ret;
+}
+
+int32_t icap_add_dst(struct icap_instance *icap, struct icap_buf_descriptor *buf)
+{
+	struct icap_msg response;
+	int32_t ret;
+
+	if (buf == NULL) {
+		return -ICAP_ERROR_INVALID;
+	}
+
+	ret = icap_send_msg(icap, ICAP_MSG_ADD_DST, buf, sizeof(struct icap_buf_descriptor), 1, &response);
+	if (ret) {
+		return ret;
+	}
+
+	if (response.header.payload_len != sizeof(uint32_t)){
+		return -ICAP_ERROR_MSG_LEN;
+	}
+	ret = icap_journal_add_buf(icap, buf, ICAP_DEV_RECORD, response.payload.u32);
+	if (ret < 0) {
+		/* The application has no id to refer to the buffer, detach it again */
+		icap_send_msg(icap, ICAP_MSG_REMOVE_DST, &response.payload.u32, sizeof(uint32_t), 1, NULL);
+		return ret;
+	}
+	icap_cache_add(icap, ret, buf, ICAP_DEV_RECORD);
+	if (icap->arena) {
+		icap_arena_bind(icap->arena, buf->buf, ret);
+	}
+	return ret;
+}
+
+int32_t icap_remove_src(struct icap_instance *icap, uint32_t buf_id)
+{
+	uint32_t dev_id = icap_journal_dev_id(icap, buf_id);
+	int32_t ret;
+
+	ret = icap_send_msg(icap, ICAP_MSG_REMOVE_SRC, &dev_id, sizeof(dev_id), 1, NULL);
+	if (ret == 0) {
+		icap_journal_remove_buf(icap, buf_id);
+		icap_cache_remove(icap, buf_id);
+		if (icap->arena) {
+			icap_arena_release(icap->arena, buf_id);
+		}
+	}
+	return ret;
 }
 
 int32_t icap_remove_dst(struct icap_instance *icap, uint32_t buf_id)
 {
-	return icap_send_msg(icap, ICAP_MSG_REMOVE_DST, &buf_id, sizeof(buf_id), 1, NULL);
+	uint32_t dev_id = icap_journal_dev_id(icap, buf_id);
+	int32_t ret;
+
+	ret = icap_send_msg(icap, ICAP_MSG_REMOVE_DST, &dev_id, sizeof(dev_id), 1, NULL);
+	if (ret == 0) {
+		icap_journal_remove_buf(icap, buf_id);
+		icap_cache_remove(icap, buf_id);
+		if (icap->arena) {
+			icap_arena_release(icap->arena, buf_id);
+		}
+	}
+	return ret;
+}
+
+int32_t icap_start(struct icap_instance *icap, uint32_t subdev_id)
+{
+	int32_t ret;
+
+	ret = icap_send_msg(icap, ICAP_MSG_START, &subdev_id, sizeof(subdev_id), 1, NULL);
+	if (ret == 0) {
+		icap_journal_run_state(icap, subdev_id, ICAP_RUN_RUNNING);
+	}
+	return ret;
+}
+
+int32_t icap_stop(struct icap_instance *icap, uint32_t subdev_id)
+{
+	int32_t ret;
+
+	ret = icap_send_msg(icap, ICAP_MSG_STOP, &subdev_id, sizeof(subdev_id), 1, NULL);
+	if (ret == 0) {
+		icap_journal_run_state(icap, subdev_id, ICAP_RUN_STOPPED);
+	}
+	return ret;
+}
+
+int32_t icap_pause(struct icap_instance *icap, uint32_t subdev_id)
+{
+	int32_t ret;
+
+	ret = icap_send_msg(icap, ICAP_MSG_PAUSE, &subdev_id, sizeof(subdev_id), 1, NULL);
+	if (ret == 0) {
+		icap_journal_run_state(icap, subdev_id, ICAP_RUN_PAUSED);
+	}
+	return ret;
+}
+
+int32_t icap_resume(struct icap_instance *icap, uint32_t subdev_id)
+{
+	int32_t ret;
+
+	ret = icap_send_msg(icap, ICAP_MSG_RESUME, &subdev_id, sizeof(subdev_id), 1, NULL);
+	if (ret == 0) {
+		icap_journal_run_state(icap, subdev_id, ICAP_RUN_RUNNING);
+	}
+	return ret;
+}
+
+int32_t icap_start_at(struct icap_instance *icap, struct icap_sched *sched)
+{
+	int32_t ret;
+
+	if (sched == NULL) {
+		return -ICAP_ERROR_INVALID;
+	}
+	ret = icap_send_msg(icap, ICAP_MSG_START_AT, sched, sizeof(struct icap_sched), 1, NULL);
+	if (ret == 0) {
+		/* Journaled as if already in effect, the replay drops the schedule */
+		icap_journal_run_state(icap, sched->subdev_id, ICAP_RUN_RUNNING);
+	}
+	return ret;
+}
+
+int32_t icap_stop_at(struct icap_instance *icap, struct icap_sched *sched)
+{
+	int32_t ret;
+
+	if (sched == NULL) {
+		return -ICAP_ERROR_INVALID;
+	}
+	ret = icap_send_msg(icap, ICAP_MSG_STOP_AT, sched, sizeof(struct icap_sched), 1, NULL);
+	if (ret == 0) {
+		icap_journal_run_state(icap, sched->subdev_id, ICAP_RUN_STOPPED);
+	}
+	return ret;
+}
+
+int32_t icap_pause_at(struct icap_instance *icap, struct icap_sched *sched)
+{
+	int32_t ret;
+
+	if (sched == NULL) {
+		return -ICAP_ERROR_INVALID;
+	}
+	ret = icap_send_msg(icap, ICAP_MSG_PAUSE_AT, sched, sizeof(struct icap_sched), 1, NULL);
+	if (ret == 0) {
+		icap_journal_run_state(icap, sched->subdev_id, ICAP_RUN_PAUSED);
+	}
+	return ret;
+}
+
+int32_t icap_resume_at(struct icap_instance *icap, struct icap_sched *sched)
+{
+	int32_t ret;
+
+	if (sched == NULL) {
+		return -ICAP_ERROR_INVALID;
+	}
+	ret = icap_send_msg(icap, ICAP_MSG_RESUME_AT, sched, sizeof(struct icap_sched), 1, NULL);
+	if (ret == 0) {
+		icap_journal_run_state(icap, sched->subdev_id, ICAP_RUN_RUNNING);
+	}
+	return ret;
+}
+
+int32_t icap_start_group(struct icap_instance *icap, struct icap_sched_group *group)
+{
+	uint32_t i;
+	int32_t ret;
+
+	if ((group == NULL) || (group->num == 0) || (group->num > ICAP_SCHED_GROUP_MAX)) {
+		return -ICAP_ERROR_INVALID;
+	}
+	ret = icap_send_msg(icap, ICAP_MSG_START_GROUP, group, sizeof(struct icap_sched_group), 1, NULL);
+	if (ret == 0) {
+		for (i = 0; i < group->num; i++) {
+			icap_journal_run_state(icap, group->subdev_ids[i], ICAP_RUN_RUNNING);
+		}
+	}
+	return ret;
+}
+
+int32_t icap_set_buf_geometry(struct icap_instance *icap, struct icap_buf_geometry *geometry)
+{
+	struct icap_buf_geometry dev_geometry;
+	struct icap_msg response;
+	int32_t ret;
+
+	if ((geometry == NULL) || (geometry->frag_size == 0)) {
+		return -ICAP_ERROR_INVALID;
+	}
+
+	memcpy(&dev_geometry, geometry, sizeof(struct icap_buf_geometry));
+	dev_geometry.buf_id = icap_journal_dev_id(icap, geometry->buf_id);
+
+	ret = icap_send_msg(icap, ICAP_MSG_BUF_GEOMETRY, &dev_geometry, sizeof(struct icap_buf_geometry), 1, &response);
+	if (ret) {
+		return ret;
+	}
+	if (response.header.payload_len != sizeof(struct icap_buf_geometry)){
+		return -ICAP_ERROR_MSG_LEN;
+	}
+	geometry->frag = response.payload.geometry.frag;
+	icap_journal_buf_geometry(icap, geometry);
+	icap_cache_geometry(icap, geometry);
+	return 0;
+}
+
+int32_t icap_switch_buf(struct icap_instance *icap, struct icap_buf_switch *buf_switch)
+{
+	struct icap_buf_switch dev_switch;
+	struct icap_msg response;
+	int32_t ret;
+
+	if (buf_switch == NULL) {
+		return -ICAP_ERROR_INVALID;
+	}
+
+	memcpy(&dev_switch, buf_switch, sizeof(struct icap_buf_switch));
+	dev_switch.buf_id = icap_journal_dev_id(icap, buf_switch->buf_id);
+
+	ret = icap_send_msg(icap, ICAP_MSG_BUF_SWITCH, &dev_switch, sizeof(struct icap_buf_switch), 1, &response);
+	if (ret) {
+		return ret;
+	}
+	if (response.header.payload_len != sizeof(struct icap_buf_switch_point)){
+		return -ICAP_ERROR_MSG_LEN;
+	}
+	buf_switch->frag = response.payload.switch_point.frag;
+	ret = icap_journal_switch_buf(icap, buf_switch, response.payload.switch_point.buf_id);
+	if (ret < 0) {
+		return ret;
+	}
+	icap_cache_switch(icap, buf_switch->buf_id, ret, &buf_switch->buf, buf_switch->frag);
+	if (icap->arena) {
+		/* The old block is still read until the switch point */
+		icap_arena_unbind(icap->arena, buf_switch->buf_id);
+		icap_arena_bind(icap->arena, buf_switch->buf.buf, ret);
+	}
+	return ret;
+}
+
+int32_t icap_set_dsp_chain(struct icap_instance *icap, struct icap_dsp_chain *chain)
+{
+	int32_t ret;
+
+	if ((chain == NULL) || (chain->num > ICAP_DSP_BLOCKS_MAX)) {
+		return -ICAP_ERROR_INVALID;
+	}
+	ret = icap_send_msg(icap, ICAP_MSG_DSP_CHAIN, chain, sizeof(struct icap_dsp_chain), 1, NULL);
+	if (ret == 0) {
+		icap_journal_dsp_chain(icap, chain);
+	}
+	return ret;
+}
+
+int32_t icap_set_dsp_params(struct icap_instance *icap, struct icap_dsp_params *params)
+{
+	int32_t ret;
+
+	if ((params == NULL) || (params->block >= ICAP_DSP_BLOCKS_MAX)) {
+		return -ICAP_ERROR_INVALID;
+	}
+	ret = icap_send_msg(icap, ICAP_MSG_DSP_PARAMS, params, sizeof(struct icap_dsp_params), 1, NULL);
+	if (ret == 0) {
+		icap_journal_dsp_params(icap, params);
+	}
+	return ret;
+}
+
+int32_t icap_set_ctrl_block(struct icap_instance *icap, struct icap_ctrl_desc *desc)
+{
+	int32_t ret;
+
+	if ((desc == NULL) || (desc->addr && (desc->size < sizeof(struct icap_ctrl_block)))) {
+		return -ICAP_ERROR_INVALID;
+	}
+	ret = icap_send_msg(icap, ICAP_MSG_CTRL_BLOCK, desc, sizeof(struct icap_ctrl_desc), 1, NULL);
+	if (ret == 0) {
+		icap_journal_ctrl_block(icap, desc);
+	}
+	return ret;
+}
+
+int32_t icap_set_monitor(struct icap_instance *icap, struct icap_monitor_route *route)
+{
+	int32_t ret;
+
+	if ((route == NULL) || (route->channels > ICAP_MONITOR_CHANNELS_MAX)) {
+		return -ICAP_ERROR_INVALID;
+	}
+	ret = icap_send_msg(icap, ICAP_MSG_MONITOR, route, sizeof(struct icap_monitor_route), 1, NULL);
+	if (ret == 0) {
+		icap_journal_monitor(icap, route);
+	}
+	return ret;
+}
+
+int32_t icap_frags(struct icap_instance *icap, struct icap_buf_offsets *offsets)
+{
+	struct icap_buf_offsets dev_offsets;
+	int32_t ret;
+
+	if (offsets == NULL) {
+		return -ICAP_ERROR_INVALID;
+	}
+
+	/* Translate the buffer id on a copy, the caller's table stays untouched */
+	memcpy(&dev_offsets, offsets, sizeof(struct icap_buf_offsets));
+	dev_offsets.buf_id = icap_journal_dev_id(icap, offsets->buf_id);
+	ret = icap_cache_offsets(icap, offsets, offsets->buf_id, 1);
+	if (ret) {
+		return ret;
+	}
+	return icap_send_msg(icap, ICAP_MSG_BUF_OFFSETS, &dev_offsets, sizeof(struct icap_buf_offsets), 1, NULL);
+}
+
+static
+int32_t icap_session_replay(struct icap_instance *icap)
+{
+	struct icap_journal *journal = &icap->journal;
+	struct icap_journal_subdev *subdev;
+	struct icap_journal_buf *jbuf;
+	struct icap_sched_group group;
+	struct icap_msg response;
+	enum icap_msg_cmd cmd;
+	uint32_t block;
+	uint32_t i;
+	int32_t ret;
+
+	for (i = 0; i < ICAP_JOURNAL_SUBDEVS; i++) {
+		subdev = &journal->subdevs[i];
+		if (!subdev->used) {
+			continue;
+		}
+		ret = icap_send_msg(icap, ICAP_MSG_DEV_INIT, &subdev->params, sizeof(struct icap_subdevice_params), 1, NULL);
+		if (ret) {
+			return ret;
+		}
+
+		/* The block in shared memory kept the params written meanwhile */
+		if (subdev->ctrl.addr) {
+			ret = icap_send_msg(icap, ICAP_MSG_CTRL_BLOCK, &subdev->ctrl, sizeof(struct icap_ctrl_desc), 1, NULL);
+			if (ret) {
+				return ret;
+			}
+		}
+
+		if (subdev->dsp_chain.num == 0) {
+			continue;
+		}
+		ret = icap_send_msg(icap, ICAP_MSG_DSP_CHAIN, &subdev->dsp_chain, sizeof(struct icap_dsp_chain), 1, NULL);
+		if (ret) {
+			return ret;
+		}
+		for (block = 0; block < subdev->dsp_chain.num; block++) {
+			if (!(subdev->dsp_params_set & (1u << block))) {
+				continue;
+			}
+			ret = icap_send_msg(icap, ICAP_MSG_DSP_PARAMS, &subdev->dsp_params[block],
+					sizeof(struct icap_dsp_params), 1, NULL);
+			if (ret) {
+				return ret;
+			}
+		}
+	}
+
+	icap_cache_restart(icap);
+	for (i = 0; i < ICAP_JOURNAL_BUFS; i++) {
+		jbuf = &journal->bufs[i];
+		if (!jbuf->used) {
+			continue;
+		}
+		cmd = (jbuf->dir == ICAP_DEV_RECORD) ? ICAP_MSG_ADD_DST : ICAP_MSG_ADD_SRC;
+		ret = icap_send_msg(icap, cmd, &jbuf->buf, sizeof(struct icap_buf_descriptor), 1, &response);
+		if (ret) {
+			return ret;
+		}
+		if (response.header.payload_len != sizeof(uint32_t)){
+			return -ICAP_ERROR_MSG_LEN;
+		}
+		/* The application keeps its buffer id, only the device id changes */
+		icap_platform_irq_lock(icap);
+		jbuf->dev_id = response.payload.u32;
+		icap_platform_irq_unlock(icap);
+	}
+
+	for (i = 0; i < ICAP_JOURNAL_MONITORS; i++) {
+		if (!journal->monitors[i].enable) {
+			continue;
+		}
+		ret = icap_send_msg(icap, ICAP_MSG_MONITOR, &journal->monitors[i], sizeof(struct icap_monitor_route), 1, NULL);
+		if (ret) {
+			return ret;
+		}
+	}
+
+	/* Restart the running subdevices phase-aligned if the device supports it */
+	group.time_base = ICAP_TIME_NOW;
+	group.time = 0;
+	group.num = 0;
+	for (i = 0; (i < ICAP_JOURNAL_SUBDEVS) && (group.num < ICAP_SCHED_GROUP_MAX); i++) {
+		subdev = &journal->subdevs[i];
+		if (subdev->used && (subdev->run_state != ICAP_RUN_STOPPED)) {
+			group.subdev_ids[group.num++] = i;
+		}
+	}
+	if (group.num == 0) {
+		return 0;
+	}
+
+	ret = icap_send_msg(icap, ICAP_MSG_START_GROUP, &group, sizeof(struct icap_sched_group), 1, NULL);
+	if (ret == -ICAP_ERROR_NOT_SUP) {
+		for (i = 0; i < group.num; i++) {
+			ret = icap_send_msg(icap, ICAP_MSG_START, &group.subdev_ids[i], sizeof(uint32_t), 1, NULL);
+			if (ret) {
+				return ret;
+			}
+		}
+	} else if (ret) {
+		return ret;
+	}
+
+	for (i = 0; i < group.num; i++) {
+		if (journal->subdevs[group.subdev_ids[i]].run_state == ICAP_RUN_PAUSED) {
+			ret = icap_send_msg(icap, ICAP_MSG_PAUSE, &group.subdev_ids[i], sizeof(uint32_t), 1, NULL);
+			if (ret) {
+				return ret;
+			}
+		}
+	}
+	return 0;
+}
+
+int32_t icap_session_resume(struct icap_instance *icap)
+{
+	int32_t ret;
+
+	if (icap->type != ICAP_APPLICATION_INSTANCE) {
+		return -ICAP_ERROR_INVALID;
+	}
+
+	icap_platform_irq_lock(icap);
+	icap->journal.resume_pending = 0;
+	icap_platform_irq_unlock(icap);
+
+	ret = icap_session_replay(icap);
+	if (ret) {
+		/* Replayed from the start on the next heartbeat, e.g. the device is still booting */
+		icap_platform_irq_lock(icap);
+		icap->journal.resume_pending = 1;
+		icap_platform_irq_unlock(icap);
+	}
+	return ret;
 }
 
-int32_t icap_start(struct icap_instance *icap, uint32_t subdev_id)
+static
+struct icap_session_buf *icap_session_find_buf(struct icap_instance *icap, uint32_t buf_id)
 {
-	return icap_send_msg(icap, ICAP_MSG_START, &subdev_id, sizeof(subdev_id), 1, NULL);
+	struct icap_session_buf *buf;
+	uint32_t i;
+
+	for (i = 0; i < ICAP_SESSION_BUFS; i++) {
+		buf = &icap->sessions.bufs[i];
+		if (buf->used && (buf->buf_id == buf_id)) {
+			return buf;
+		}
+	}
+	return NULL;
 }
 
-int32_t icap_stop(struct icap_instance *icap, uint32_t subdev_id)
+/* Buffer events are send only to the session which attached the buffer */
+static
+int32_t icap_send_buf_msg(struct icap_instance *icap, uint32_t buf_id,
+		enum icap_msg_cmd cmd, void *data, uint32_t size)
+{
+	struct icap_session_buf *buf;
+	uint32_t session;
+
+	if (!icap->sessions.enabled) {
+		return icap_send_async(icap, NULL, cmd, data, size);
+	}
+
+	icap_platform_irq_lock(icap);
+	buf = icap_session_find_buf(icap, buf_id);
+	session = buf ? buf->session : ICAP_SESSION_NONE;
+	icap_platform_irq_unlock(icap);
+
+	if (session == ICAP_SESSION_NONE) {
+		return -ICAP_ERROR_INVALID;
+	}
+	return icap_send_async(icap, &icap->sessions.sessions[session], cmd, data, size);
+}
+
+int32_t icap_frag_ready(struct icap_instance *icap, struct icap_buf_frags *frags)
+{
+	if (frags == NULL) {
+		return -ICAP_ERROR_INVALID;
+	}
+	icap_cache_sync(icap, frags->buf_id, frags->frags, ICAP_DEV_RECORD, 1);
+	icap_cache_sync(icap, frags->buf_id, frags->frags, ICAP_DEV_PLAYBACK, 0);
+	return icap_send_buf_msg(icap, frags->buf_id, ICAP_MSG_FRAG_READY, frags, sizeof(struct icap_buf_frags));
+}
+
+int32_t icap_frag_ready_ts(struct icap_instance *icap, struct icap_buf_frags_ts *frags)
+{
+	if (frags == NULL) {
+		return -ICAP_ERROR_INVALID;
+	}
+	icap_cache_sync(icap, frags->frags.buf_id, frags->frags.frags, ICAP_DEV_RECORD, 1);
+	icap_cache_sync(icap, frags->frags.buf_id, frags->frags.frags, ICAP_DEV_PLAYBACK, 0);
+	return icap_send_buf_msg(icap, frags->frags.buf_id, ICAP_MSG_FRAG_READY, frags, sizeof(struct icap_buf_frags_ts));
+}
+
+int32_t icap_xrun(struct icap_instance *icap, struct icap_buf_frags *frags)
+{
+	if (frags == NULL) {
+		return -ICAP_ERROR_INVALID;
+	}
+	return icap_send_buf_msg(icap, frags->buf_id, ICAP_MSG_XRUN, frags, sizeof(struct icap_buf_frags));
+}
+
+int32_t icap_error(struct icap_instance *icap, uint32_t error)
+{
+	return icap_send_broadcast(icap, ICAP_MSG_ERROR, &error, sizeof(error));
+}
+
+int32_t icap_device_enable_sessions(struct icap_instance *icap)
+{
+	struct icap_sessions *sessions = &icap->sessions;
+	uint32_t i;
+
+	if (icap->type != ICAP_DEVICE_INSTANCE) {
+		return -ICAP_ERROR_INVALID;
+	}
+
+	icap_platform_irq_lock(icap);
+	memset(sessions, 0, sizeof(*sessions));
+	for (i = 0; i < ICAP_SESSION_SUBDEVS; i++) {
+		sessions->subdev_access[i] = ICAP_SESSION_ANY;
+		sessions->subdev_owner[i] = ICAP_SESSION_NONE;
+	}
+	sessions->enabled = 1;
+	icap_platform_irq_unlock(icap);
+	return 0;
+}
+
+static
+int32_t icap_session_find(struct icap_instance *icap, union icap_remote_addr *addr)
+{
+	struct icap_session *session;
+	uint32_t i;
+
+	for (i = 0; i < ICAP_SESSIONS_MAX; i++) {
+		session = &icap->sessions.sessions[i];
+		if (session->used && (session->addr.rpmsg_addr == addr->rpmsg_addr)) {
+			return i;
+		}
+	}
+	return -ICAP_ERROR_REMOTE_ADDR;
+}
+
+int32_t icap_device_add_session(struct icap_instance *icap, union icap_remote_addr *addr)
+{
+	struct icap_session *session;
+	uint64_t now;
+	int32_t ret;
+	uint32_t i;
+
+	if ((addr == NULL) || !icap->sessions.enabled) {
+		return -ICAP_ERROR_INVALID;
+	}
+
+	now = icap_platform_time_ns(icap);
+	icap_platform_irq_lock(icap);
+	ret = icap_session_find(icap, addr);
+	if (ret < 0) {
+		ret = -ICAP_ERROR_NOMEM;
+		for (i = 0; i < ICAP_SESSIONS_MAX; i++) {
+			session = &icap->sessions.sessions[i];
+			if (!session->used) {
+				memset(session, 0, sizeof(*session));
+				session->used = 1;
+				session->addr = *addr;
+				session->last_rx = now;
+				ret = i;
+				break;
+			}
+		}
+	}
+	icap_platform_irq_unlock(icap);
+	return ret;
+}
+
+/* Frees the session with its subdevices and buffers, called with irq lock held */
+static
+void icap_session_release(struct icap_sessions *sessions, uint32_t index)
+{
+	uint32_t i;
+
+	sessions->sessions[index].used = 0;
+	for (i = 0; i < ICAP_SESSION_SUBDEVS; i++) {
+		if (sessions->subdev_owner[i] == index) {
+			sessions->subdev_owner[i] = ICAP_SESSION_NONE;
+		}
+	}
+	for (i = 0; i < ICAP_SESSION_BUFS; i++) {
+		if (sessions->bufs[i].session == index) {
+			sessions->bufs[i].used = 0;
+		}
+	}
+}
+
+int32_t icap_device_remove_session(struct icap_instance *icap, union icap_remote_addr *addr)
+{
+	struct icap_sessions *sessions = &icap->sessions;
+	int32_t ret;
+
+	if ((addr == NULL) || !sessions->enabled) {
+		return -ICAP_ERROR_INVALID;
+	}
+
+	icap_platform_irq_lock(icap);
+	ret = icap_session_find(icap, addr);
+	if (ret >= 0) {
+		icap_session_release(sessions, ret);
+		ret = 0;
+	}
+	icap_platform_irq_unlock(icap);
+	return ret;
+}
+
+static
+uint32_t icap_session_stale(struct icap_session *session, uint64_t now, uint64_t period)
+{
+	return session->used && (now > session->last_rx) &&
+			(now - session->last_rx > period * ICAP_HEARTBEAT_MISS_MAX);
+}
+
+/* Removes the sessions of application endpoints which stopped responding */
+static
+void icap_session_expire(struct icap_instance *icap, uint64_t now, uint64_t period)
+{
+	const struct icap_device_callbacks *cb = ICAP_DEVICE_CB(icap);
+	struct icap_sessions *sessions = &icap->sessions;
+	uint32_t lost;
+	uint32_t i;
+
+	for (i = 0; i < ICAP_SESSIONS_MAX; i++) {
+		icap_platform_irq_lock(icap);
+		lost = icap_session_stale(&sessions->sessions[i], now, period);
+		icap_platform_irq_unlock(icap);
+		if (!lost) {
+			continue;
+		}
+
+		if (cb->session_lost) {
+			cb->session_lost(icap, i);
+		}
+
+		/* Unless the endpoint responded meanwhile */
+		icap_platform_irq_lock(icap);
+		if (icap_session_stale(&sessions->sessions[i], now, period)) {
+			icap_session_release(sessions, i);
+		}
+		icap_platform_irq_unlock(icap);
+	}
+}
+
+int32_t icap_device_subdevice_access(struct icap_instance *icap, uint32_t subdev_id,
+		uint32_t access)
+{
+	struct icap_sessions *sessions = &icap->sessions;
+
+	if (!sessions->enabled || (subdev_id >= ICAP_SESSION_SUBDEVS)) {
+		return -ICAP_ERROR_INVALID;
+	}
+	if ((access != ICAP_SESSION_SHARED) && (access != ICAP_SESSION_ANY) &&
+			(access >= ICAP_SESSIONS_MAX)) {
+		return -ICAP_ERROR_INVALID;
+	}
+
+	icap_platform_irq_lock(icap);
+	sessions->subdev_access[subdev_id] = access;
+	sessions->subdev_owner[subdev_id] = ICAP_SESSION_NONE;
+	icap_platform_irq_unlock(icap);
+	return 0;
+}
+
+int32_t icap_device_get_session(struct icap_instance *icap)
+{
+	if (!icap->sessions.enabled) {
+		return -ICAP_ERROR_INVALID;
+	}
+	return icap->sessions.current;
+}
+
+/* Find the session of the sender, new endpoints get a free session */
+static
+int32_t icap_session_rx(struct icap_instance *icap, union icap_remote_addr *src_addr)
+{
+	int32_t ret;
+
+	if (src_addr == NULL) {
+		return -ICAP_ERROR_REMOTE_ADDR;
+	}
+
+	icap_platform_irq_lock(icap);
+	ret = icap_session_find(icap, src_addr);
+	icap_platform_irq_unlock(icap);
+
+	if (ret < 0) {
+		ret = icap_device_add_session(icap, src_addr);
+		if (ret < 0) {
+			return -ICAP_ERROR_REMOTE_ADDR;
+		}
+	}
+	icap->sessions.current = ret;
+	icap->sessions.sessions[ret].last_rx = icap_platform_time_ns(icap);
+	return 0;
+}
+
+/* Subdevice addressed by the message, returns 0 if there is none */
+static
+uint32_t icap_session_msg_subdev(struct icap_msg *msg, uint32_t *subdev_id)
+{
+	switch (msg->header.cmd) {
+	case ICAP_MSG_DEV_INIT:
+		*subdev_id = msg->payload.dev_params.subdev_id;
+		return 1;
+	case ICAP_MSG_DEV_DEINIT:
+	case ICAP_MSG_START:
+	case ICAP_MSG_STOP:
+	case ICAP_MSG_PAUSE:
+	case ICAP_MSG_RESUME:
+		*subdev_id = msg->payload.u32;
+		return 1;
+	case ICAP_MSG_ADD_SRC:
+	case ICAP_MSG_ADD_DST:
+		*subdev_id = msg->payload.buf.subdev_id;
+		return 1;
+	case ICAP_MSG_START_AT:
+	case ICAP_MSG_STOP_AT:
+	case ICAP_MSG_PAUSE_AT:
+	case ICAP_MSG_RESUME_AT:
+		*subdev_id = msg->payload.sched.subdev_id;
+		return 1;
+	case ICAP_MSG_DSP_CHAIN:
+		*subdev_id = msg->payload.dsp_chain.subdev_id;
+		return 1;
+	case ICAP_MSG_DSP_PARAMS:
+		*subdev_id = msg->payload.dsp_params.subdev_id;
+		return 1;
+	case ICAP_MSG_CTRL_BLOCK:
+		*subdev_id = msg->payload.ctrl_desc.subdev_id;
+		return 1;
+	case ICAP_MSG_MONITOR:
+		*subdev_id = msg->payload.monitor.dst_subdev_id;
+		return 1;
+	default:
+		return 0;
+	}
+}
+
+/* Buffer addressed by the message, returns 0 if there is none */
+static
+uint32_t icap_session_msg_buf(struct icap_msg *msg, uint32_t *buf_id)
+{
+	switch (msg->header.cmd) {
+	case ICAP_MSG_REMOVE_SRC:
+	case ICAP_MSG_REMOVE_DST:
+		*buf_id = msg->payload.u32;
+		return 1;
+	case ICAP_MSG_BUF_OFFSETS:
+		*buf_id = msg->payload.offsets.buf_id;
+		return 1;
+	case ICAP_MSG_BUF_GEOMETRY:
+		*buf_id = msg->payload.geometry.buf_id;
+		return 1;
+	case ICAP_MSG_BUF_SWITCH:
+		*buf_id = msg->payload.buf_switch.buf_id;
+		return 1;
+	default:
+		return 0;
+	}
+}
+
+static
+int32_t icap_session_subdev_access(struct icap_instance *icap, uint32_t subdev_id)
+{
+	struct icap_sessions *sessions = &icap->sessions;
+	uint32_t access;
+	uint32_t owner;
+
+	/* Subdevices out of the table are shared */
+	if (subdev_id >= ICAP_SESSION_SUBDEVS) {
+		return 0;
+	}
+
+	access = sessions->subdev_access[subdev_id];
+	owner = sessions->subdev_owner[subdev_id];
+	if (access == ICAP_SESSION_SHARED) {
+		return 0;
+	}
+	if (access == ICAP_SESSION_ANY) {
+		access = (owner == ICAP_SESSION_NONE) ? sessions->current : owner;
+	}
+	return (access == sessions->current) ? 0 : -ICAP_ERROR_ACCESS;
+}
+
+static
+int32_t icap_session_check(struct icap_instance *icap, struct icap_msg *msg)
+{
+	struct icap_session_buf *buf;
+	uint32_t id;
+	uint32_t i;
+	int32_t ret = 0;
+
+	icap_platform_irq_lock(icap);
+	if (icap_session_msg_subdev(msg, &id)) {
+		ret = icap_session_subdev_access(icap, id);
+	} else if (icap_session_msg_buf(msg, &id)) {
+		/* Buffers attached before enabling the sessions are not tracked */
+		buf = icap_session_find_buf(icap, id);
+		if (buf && (buf->session != icap->sessions.current)) {
+			ret = -ICAP_ERROR_ACCESS;
+		}
+	} else if ((msg->header.cmd == ICAP_MSG_START_GROUP) &&
+			(msg->payload.sched_group.num <= ICAP_SCHED_GROUP_MAX)) {
+		for (i = 0; (i < msg->payload.sched_group.num) && (ret == 0); i++) {
+			ret = icap_session_subdev_access(icap, msg->payload.sched_group.subdev_ids[i]);
+		}
+	}
+	/* The monitored record subdevice must be accessible too, only the playback one is claimed */
+	if ((ret == 0) && (msg->header.cmd == ICAP_MSG_MONITOR)) {
+		ret = icap_session_subdev_access(icap, msg->payload.monitor.src_subdev_id);
+	}
+	/* A buffer the session can't track would lose its fragment reports, refuse it upfront */
+	if ((ret == 0) && ((msg->header.cmd == ICAP_MSG_ADD_SRC) || (msg->header.cmd == ICAP_MSG_ADD_DST))) {
+		ret = -ICAP_ERROR_NOMEM;
+		for (i = 0; i < ICAP_SESSION_BUFS; i++) {
+			if (!icap->sessions.bufs[i].used) {
+				ret = 0;
+				break;
+			}
+		}
+	}
+	icap_platform_irq_unlock(icap);
+	return ret;
+}
+
+static
+void icap_session_claim(struct icap_instance *icap, uint32_t subdev_id)
+{
+	struct icap_sessions *sessions = &icap->sessions;
+
+	if ((subdev_id < ICAP_SESSION_SUBDEVS) &&
+			(sessions->subdev_access[subdev_id] == ICAP_SESSION_ANY)) {
+		sessions->subdev_owner[subdev_id] = sessions->current;
+	}
+}
+
+/* Update the ownership after successfully executed message */
+static
+void icap_session_update(struct icap_instance *icap, struct icap_msg *msg, int32_t ret)
+{
+	struct icap_sessions *sessions = &icap->sessions;
+	struct icap_session_buf *buf;
+	uint32_t id;
+	uint32_t i;
+
+	if (ret < 0) {
+		return;
+	}
+
+	icap_platform_irq_lock(icap);
+	switch (msg->header.cmd) {
+	case ICAP_MSG_DEV_DEINIT:
+		id = msg->payload.u32;
+		if (id < ICAP_SESSION_SUBDEVS) {
+			sessions->subdev_owner[id] = ICAP_SESSION_NONE;
+		}
+		for (i = 0; i < ICAP_SESSION_BUFS; i++) {
+			if (sessions->bufs[i].subdev_id == id) {
+				sessions->bufs[i].used = 0;
+			}
+		}
+		break;
+	case ICAP_MSG_ADD_SRC:
+	case ICAP_MSG_ADD_DST:
+		icap_session_claim(icap, msg->payload.buf.subdev_id);
+		for (i = 0; i < ICAP_SESSION_BUFS; i++) {
+			buf = &sessions->bufs[i];
+			if (!buf->used) {
+				buf->used = 1;
+				buf->buf_id = ret;
+				buf->subdev_id = msg->payload.buf.subdev_id;
+				buf->session = sessions->current;
+				break;
+			}
+		}
+		break;
+	case ICAP_MSG_REMOVE_SRC:
+	case ICAP_MSG_REMOVE_DST:
+		buf = icap_session_find_buf(icap, msg->payload.u32);
+		if (buf) {
+			buf->used = 0;
+		}
+		break;
+	case ICAP_MSG_BUF_SWITCH:
+		buf = icap_session_find_buf(icap, msg->payload.buf_switch.buf_id);
+		if (buf) {
+			buf->buf_id = ret;
+		}
+		break;
+	case ICAP_MSG_START_GROUP:
+		for (i = 0; i < msg->payload.sched_group.num; i++) {
+			icap_session_claim(icap, msg->payload.sched_group.subdev_ids[i]);
+		}
+		break;
+	default:
+		if (icap_session_msg_subdev(msg, &id)) {
+			icap_session_claim(icap, id);
+		}
+		break;
+	}
+	icap_platform_irq_unlock(icap);
+}
+
+static
+uint32_t icap_bit_len(uint64_t val)
+{
+	uint32_t len = 0;
+
+	while (val) {
+		val >>= 1;
+		len++;
+	}
+	return len;
+}
+
+/*
+ * Rate correction of a device time interval, (delta * rate_dev) >> 32.
+ * Split in 32bit halves, the product of a long interval overflows 64bits.
+ */
+static
+int64_t icap_clock_correction(int64_t delta, int64_t rate_dev)
 {
-	return icap_send_msg(icap, ICAP_MSG_STOP, &subdev_id, sizeof(subdev_id), 1, NULL);
+	uint64_t mag = (delta < 0) ? -(uint64_t)delta : (uint64_t)delta;
+	uint64_t rate = (rate_dev < 0) ? -(uint64_t)rate_dev : (uint64_t)rate_dev;
+	uint64_t corr;
+
+	/* rate_dev is clamped to ICAP_CLOCK_RATE_DEV_MAX, neither half overflows */
+	corr = (mag >> 32) * rate + (((mag & 0xffffffff) * rate) >> 32);
+	if ((delta < 0) != (rate_dev < 0)) {
+		return -(int64_t)corr;
+	}
+	return (int64_t)corr;
 }
 
-int32_t icap_pause(struct icap_instance *icap, uint32_t subdev_id)
-{
-	return icap_send_msg(icap, ICAP_MSG_PAUSE, &subdev_id, sizeof(subdev_id), 1, NULL);
-}
+/*
+ * Second order DLL mapping device timestamps to the local clock.
+ * The rate correction is normalised to the report interval with power of two
+ * shifts, it keeps the loop free of 64bit divisions (safe in linux kernel).
+ */
+static
+void icap_clock_update(struct icap_instance *icap, struct icap_buf_frags_ts *ts)
+{
+	struct icap_clock_est *clk = &icap->clock;
+	uint64_t now = icap_platform_time_ns(icap);
+	uint64_t dev_delta;
+	uint64_t pred;
+	int64_t err;
+	uint32_t shift;
+
+	icap_platform_irq_lock(icap);
+
+	dev_delta = ts->timestamp - clk->dev_base;
+	if ((clk->samples == 0) || (ts->timestamp < clk->dev_base) ||
+			(dev_delta >> ICAP_CLOCK_MAX_GAP_SHIFT)) {
+		/* First report, long gap or device clock restarted, keep the rate
+		 * estimation only if the device clock still runs forward */
+		if ((clk->samples == 0) || (ts->timestamp < clk->dev_base)) {
+			clk->rate_dev = 0;
+		}
+		clk->local_base = now;
+		goto clock_update_done;
+	}
+
+	pred = clk->local_base + dev_delta + icap_clock_correction(dev_delta, clk->rate_dev);
+	err = (int64_t)(now - pred);
+
+	/* Treat errors larger than the report interval as outliers */
+	if (err > (int64_t)dev_delta) {
+		err = dev_delta;
+	} else if (err < -(int64_t)dev_delta) {
+		err = -(int64_t)dev_delta;
+	}
+
+	clk->local_base = pred + (err >> ICAP_CLOCK_PHASE_SHIFT);
 
-int32_t icap_resume(struct icap_instance *icap, uint32_t subdev_id)
-{
-	return icap_send_msg(icap, ICAP_MSG_RESUME, &subdev_id, sizeof(subdev_id), 1, NULL);
-}
+	shift = icap_bit_len(dev_delta);
+	if (shift <= 32) {
+		clk->rate_dev += (err * ((int64_t)1 << (32 - shift))) >> ICAP_CLOCK_RATE_SHIFT;
+	} else {
+		clk->rate_dev += (err >> (shift - 32)) >> ICAP_CLOCK_RATE_SHIFT;
+	}
 
-int32_t icap_frags(struct icap_instance *icap, struct icap_buf_offsets *offsets)
-{
-	if (offsets == NULL) {
-		return -ICAP_ERROR_INVALID;
+	if (clk->rate_dev > ICAP_CLOCK_RATE_DEV_MAX) {
+		clk->rate_dev = ICAP_CLOCK_RATE_DEV_MAX;
+	} else if (clk->rate_dev < -ICAP_CLOCK_RATE_DEV_MAX) {
+		clk->rate_dev = -ICAP_CLOCK_RATE_DEV_MAX;
 	}
-	return icap_send_msg(icap, ICAP_MSG_BUF_OFFSETS, offsets, sizeof(struct icap_buf_offsets), 1, NULL);
+
+clock_update_done:
+	clk->dev_base = ts->timestamp;
+	clk->position = ts->position;
+	clk->buf_id = ts->frags.buf_id;
+	clk->samples++;
+	icap_platform_irq_unlock(icap);
 }
 
-int32_t icap_frag_ready(struct icap_instance *icap, struct icap_buf_frags *frags)
+int32_t icap_get_clock_sync(struct icap_instance *icap, struct icap_clock_sync *sync)
 {
-	if (frags == NULL) {
+	struct icap_clock_est clk;
+	uint64_t now;
+
+	if (sync == NULL) {
 		return -ICAP_ERROR_INVALID;
 	}
-	return icap_send_msg(icap, ICAP_MSG_FRAG_READY, frags, sizeof(struct icap_buf_frags), 0, NULL);
-}
 
-int32_t icap_xrun(struct icap_instance *icap, struct icap_buf_frags *frags)
-{
-	if (frags == NULL) {
-		return -ICAP_ERROR_INVALID;
+	icap_platform_irq_lock(icap);
+	clk = icap->clock;
+	icap_platform_irq_unlock(icap);
+
+	if (clk.samples == 0) {
+		return -ICAP_ERROR_INIT;
 	}
-	return icap_send_msg(icap, ICAP_MSG_XRUN, frags, sizeof(struct icap_buf_frags), 0, NULL);
+
+	now = icap_platform_time_ns(icap);
+	sync->buf_id = clk.buf_id;
+	sync->position = clk.position;
+	sync->dev_timestamp = clk.dev_base;
+	sync->local_timestamp = clk.local_base;
+	sync->offset = (int64_t)(clk.local_base - clk.dev_base);
+	sync->drift_ppb = (int32_t)(-(clk.rate_dev * 1000000000) >> 32);
+	sync->delay = (now > clk.local_base) ? (now - clk.local_base) : 0;
+	return 0;
 }
 
-int32_t icap_error(struct icap_instance *icap, uint32_t error)
+uint64_t icap_dev_to_local_time(struct icap_instance *icap, uint64_t dev_timestamp)
 {
-	return icap_send_msg(icap, ICAP_MSG_ERROR, &error, sizeof(error), 0, NULL);
+	struct icap_clock_est clk;
+	int64_t dev_delta;
+
+	icap_platform_irq_lock(icap);
+	clk = icap->clock;
+	icap_platform_irq_unlock(icap);
+
+	dev_delta = (int64_t)(dev_timestamp - clk.dev_base);
+	return clk.local_base + dev_delta + icap_clock_correction(dev_delta, clk.rate_dev);
 }
 
 static
@@ -369,7 +2417,7 @@ static
 int32_t icap_application_parse_msg(struct icap_instance *icap,
 		struct icap_msg *msg)
 {
-	struct icap_application_callbacks *cb = (struct icap_application_callbacks *)icap->callbacks;
+	const struct icap_application_callbacks *cb = ICAP_APPLICATION_CB(icap);
 	struct icap_msg_header *msg_header = &msg->header;
 	int32_t send_generic_ack = 1;
 	uint32_t buf_id;
@@ -377,29 +2425,36 @@ int32_t icap_application_parse_msg(struct icap_instance *icap,
 
 	switch (msg_header->cmd) {
 	case ICAP_MSG_FRAG_READY:
+		/* Acknowledge with the device buffer id, the callback gets the application one */
+		buf_id = msg->payload.frags.buf_id;
+		msg->payload.frags.buf_id = icap_journal_app_id(icap, buf_id);
+		if (msg_header->payload_len == sizeof(struct icap_buf_frags_ts)) {
+			icap_clock_update(icap, &msg->payload.frags_ts);
+		}
+		icap_cache_sync(icap, msg->payload.frags.buf_id, msg->payload.frags.frags, ICAP_DEV_RECORD, 0);
 		if (cb->frag_ready){
-			buf_id = msg->payload.frags.buf_id;
 			ret = cb->frag_ready(icap, &msg->payload.frags);
+			icap_cache_sync(icap, msg->payload.frags.buf_id, msg->payload.frags.frags, ICAP_DEV_PLAYBACK, 1);
 			if (ret == 0) {
 				icap_send_ack(icap, (enum icap_msg_cmd)msg_header->cmd, msg_header->seq_num, &buf_id, sizeof(buf_id));
 				send_generic_ack = 0;
 			}
 		} else {
-			buf_id = msg->payload.frags.buf_id;
+			icap_cache_sync(icap, msg->payload.frags.buf_id, msg->payload.frags.frags, ICAP_DEV_PLAYBACK, 1);
 			icap_send_ack(icap, (enum icap_msg_cmd)msg_header->cmd, msg_header->seq_num, &buf_id, sizeof(buf_id));
 			send_generic_ack = 0;
 		}
 		break;
 	case ICAP_MSG_XRUN:
+		buf_id = msg->payload.frags.buf_id;
+		msg->payload.frags.buf_id = icap_journal_app_id(icap, buf_id);
 		if (cb->xrun){
-			buf_id = msg->payload.frags.buf_id;
 			ret = cb->xrun(icap, &msg->payload.frags);
 			if (ret == 0) {
 				icap_send_ack(icap, (enum icap_msg_cmd)msg_header->cmd, msg_header->seq_num, &buf_id, sizeof(buf_id));
 				send_generic_ack = 0;
 			}
 		} else {
-			buf_id = msg->payload.frags.buf_id;
 			icap_send_ack(icap, (enum icap_msg_cmd)msg_header->cmd, msg_header->seq_num, &buf_id, sizeof(buf_id));
 			send_generic_ack = 0;
 		}
@@ -429,7 +2484,7 @@ static
 int32_t icap_device_parse_response(struct icap_instance *icap,
 		struct icap_msg *msg)
 {
-	struct icap_device_callbacks *cb = (struct icap_device_callbacks *)icap->callbacks;
+	const struct icap_device_callbacks *cb = ICAP_DEVICE_CB(icap);
 	struct icap_msg_header *msg_header = &msg->header;
 	int32_t ret = 0;
 	int32_t error;
@@ -477,13 +2532,22 @@ int32_t icap_device_parse_response(struct icap_instance *icap,
 static
 int32_t icap_device_parse_msg(struct icap_instance *icap, struct icap_msg *msg)
 {
-	struct icap_device_callbacks *cb = (struct icap_device_callbacks *)icap->callbacks;
+	const struct icap_device_callbacks *cb = ICAP_DEVICE_CB(icap);
 	struct icap_msg_header *msg_header = &msg->header;
 	int32_t send_generic_ack = 1;
 	int32_t ret = 0;
 	uint32_t buf_id;
 	uint32_t dev_num;
 	struct icap_subdevice_features features;
+	struct icap_buf_switch_point switch_point;
+
+	if (icap->sessions.enabled) {
+		ret = icap_session_check(icap, msg);
+		if (ret) {
+			icap_send_nak(icap, (enum icap_msg_cmd)msg_header->cmd, msg_header->seq_num, ret);
+			return 0;
+		}
+	}
 
 	switch (msg_header->cmd) {
 	case ICAP_MSG_GET_DEV_NUM:
@@ -516,20 +2580,24 @@ int32_t icap_device_parse_msg(struct icap_instance *icap, struct icap_msg *msg)
 		}
 		break;
 	case ICAP_MSG_ADD_SRC:
-		if (cb->add_src){
+		ret = icap_xlat_buf(icap, &msg->payload.buf);
+		if ((ret == 0) && cb->add_src){
 			ret = cb->add_src(icap, &msg->payload.buf);
 			if (ret >= 0) {
 				buf_id = ret;
+				icap_cache_add(icap, buf_id, &msg->payload.buf, ICAP_DEV_PLAYBACK);
 				icap_send_ack(icap, (enum icap_msg_cmd)msg_header->cmd, msg_header->seq_num, &buf_id, sizeof(buf_id));
 				send_generic_ack = 0;
 			}
 		}
 		break;
 	case ICAP_MSG_ADD_DST:
-		if (cb->add_dst){
+		ret = icap_xlat_buf(icap, &msg->payload.buf);
+		if ((ret == 0) && cb->add_dst){
 			ret = cb->add_dst(icap, &msg->payload.buf);
 			if (ret >= 0) {
 				buf_id = ret;
+				icap_cache_add(icap, buf_id, &msg->payload.buf, ICAP_DEV_RECORD);
 				icap_send_ack(icap, (enum icap_msg_cmd)msg_header->cmd, msg_header->seq_num, &buf_id, sizeof(buf_id));
 				send_generic_ack = 0;
 			}
@@ -539,11 +2607,17 @@ int32_t icap_device_parse_msg(struct icap_instance *icap, struct icap_msg *msg)
 		if (cb->remove_src){
 			ret = cb->remove_src(icap, msg->payload.u32);
 		}
+		if (ret == 0) {
+			icap_cache_remove(icap, msg->payload.u32);
+		}
 		break;
 	case ICAP_MSG_REMOVE_DST:
 		if (cb->remove_dst){
 			ret = cb->remove_dst(icap, msg->payload.u32);
 		}
+		if (ret == 0) {
+			icap_cache_remove(icap, msg->payload.u32);
+		}
 		break;
 	case ICAP_MSG_START:
 		if (cb->start){
@@ -566,15 +2640,137 @@ int32_t icap_device_parse_msg(struct icap_instance *icap, struct icap_msg *msg)
 		}
 		break;
 	case ICAP_MSG_BUF_OFFSETS:
-		if (cb->frags){
+		ret = icap_cache_offsets(icap, &msg->payload.offsets, msg->payload.offsets.buf_id, 0);
+		if ((ret == 0) && cb->frags){
 			ret = cb->frags(icap, &msg->payload.offsets);
 		}
 		break;
+	case ICAP_MSG_START_AT:
+		if (cb->start_at){
+			ret = cb->start_at(icap, &msg->payload.sched);
+		} else if (msg->payload.sched.time_base != ICAP_TIME_NOW) {
+			ret = -ICAP_ERROR_NOT_SUP;
+		} else if (cb->start){
+			ret = cb->start(icap, msg->payload.sched.subdev_id);
+		}
+		break;
+	case ICAP_MSG_STOP_AT:
+		if (cb->stop_at){
+			ret = cb->stop_at(icap, &msg->payload.sched);
+		} else if (msg->payload.sched.time_base != ICAP_TIME_NOW) {
+			ret = -ICAP_ERROR_NOT_SUP;
+		} else if (cb->stop){
+			ret = cb->stop(icap, msg->payload.sched.subdev_id);
+		}
+		break;
+	case ICAP_MSG_PAUSE_AT:
+		if (cb->pause_at){
+			ret = cb->pause_at(icap, &msg->payload.sched);
+		} else if (msg->payload.sched.time_base != ICAP_TIME_NOW) {
+			ret = -ICAP_ERROR_NOT_SUP;
+		} else if (cb->pause){
+			ret = cb->pause(icap, msg->payload.sched.subdev_id);
+		}
+		break;
+	case ICAP_MSG_RESUME_AT:
+		if (cb->resume_at){
+			ret = cb->resume_at(icap, &msg->payload.sched);
+		} else if (msg->payload.sched.time_base != ICAP_TIME_NOW) {
+			ret = -ICAP_ERROR_NOT_SUP;
+		} else if (cb->resume){
+			ret = cb->resume(icap, msg->payload.sched.subdev_id);
+		}
+		break;
+	case ICAP_MSG_BUF_GEOMETRY:
+		if (cb->buf_geometry){
+			ret = cb->buf_geometry(icap, &msg->payload.geometry);
+			if (ret == 0) {
+				icap_cache_geometry(icap, &msg->payload.geometry);
+				icap_send_ack(icap, (enum icap_msg_cmd)msg_header->cmd, msg_header->seq_num, &msg->payload.geometry, sizeof(struct icap_buf_geometry));
+				send_generic_ack = 0;
+			}
+		} else {
+			ret = -ICAP_ERROR_NOT_SUP;
+		}
+		break;
+	case ICAP_MSG_BUF_SWITCH:
+		ret = icap_xlat_buf(icap, &msg->payload.buf_switch.buf);
+		if (ret) {
+			break;
+		}
+		if (cb->switch_buf){
+			ret = cb->switch_buf(icap, &msg->payload.buf_switch);
+			if (ret >= 0) {
+				icap_cache_switch(icap, msg->payload.buf_switch.buf_id, ret, &msg->payload.buf_switch.buf,
+						msg->payload.buf_switch.frag);
+				switch_point.buf_id = ret;
+				switch_point.frag = msg->payload.buf_switch.frag;
+				icap_send_ack(icap, (enum icap_msg_cmd)msg_header->cmd, msg_header->seq_num, &switch_point, sizeof(struct icap_buf_switch_point));
+				send_generic_ack = 0;
+			}
+		} else {
+			ret = -ICAP_ERROR_NOT_SUP;
+		}
+		break;
+	case ICAP_MSG_DSP_CHAIN:
+		if (msg->payload.dsp_chain.num > ICAP_DSP_BLOCKS_MAX) {
+			ret = -ICAP_ERROR_INVALID;
+		} else if (cb->dsp_chain){
+			ret = cb->dsp_chain(icap, &msg->payload.dsp_chain);
+		} else {
+			ret = -ICAP_ERROR_NOT_SUP;
+		}
+		break;
+	case ICAP_MSG_DSP_PARAMS:
+		if (msg->payload.dsp_params.block >= ICAP_DSP_BLOCKS_MAX) {
+			ret = -ICAP_ERROR_INVALID;
+		} else if (cb->dsp_params){
+			ret = cb->dsp_params(icap, &msg->payload.dsp_params);
+		} else {
+			ret = -ICAP_ERROR_NOT_SUP;
+		}
+		break;
+	case ICAP_MSG_CTRL_BLOCK:
+		if (msg->payload.ctrl_desc.addr &&
+				(msg->payload.ctrl_desc.size < sizeof(struct icap_ctrl_block))) {
+			ret = -ICAP_ERROR_INVALID;
+		} else if (cb->ctrl_block){
+			ret = icap_xlat_ctrl(icap, &msg->payload.ctrl_desc);
+			if (ret == 0) {
+				ret = cb->ctrl_block(icap, &msg->payload.ctrl_desc);
+			}
+		} else {
+			ret = -ICAP_ERROR_NOT_SUP;
+		}
+		break;
+	case ICAP_MSG_MONITOR:
+		if (msg->payload.monitor.channels > ICAP_MONITOR_CHANNELS_MAX) {
+			ret = -ICAP_ERROR_INVALID;
+		} else if (cb->monitor){
+			ret = cb->monitor(icap, &msg->payload.monitor);
+		} else {
+			ret = -ICAP_ERROR_NOT_SUP;
+		}
+		break;
+	case ICAP_MSG_START_GROUP:
+		if ((msg->payload.sched_group.num == 0) ||
+				(msg->payload.sched_group.num > ICAP_SCHED_GROUP_MAX)) {
+			ret = -ICAP_ERROR_INVALID;
+		} else if (cb->start_group){
+			ret = cb->start_group(icap, &msg->payload.sched_group);
+		} else {
+			ret = -ICAP_ERROR_NOT_SUP;
+		}
+		break;
 	default:
 		ret = -ICAP_ERROR_MSG_ID;
 		break;
 	}
 
+	if (icap->sessions.enabled) {
+		icap_session_update(icap, msg, ret);
+	}
+
 	if (send_generic_ack) {
 		if (ret) {
 			icap_send_nak(icap, (enum icap_msg_cmd)msg_header->cmd, msg_header->seq_num, ret);
@@ -585,6 +2781,416 @@ int32_t icap_device_parse_msg(struct icap_instance *icap, struct icap_msg *msg)
 	return 0;
 }
 
+int32_t icap_set_heartbeat(struct icap_instance *icap, uint32_t period_us)
+{
+	struct icap_link *link = &icap->link;
+	uint64_t now = icap_platform_time_ns(icap);
+
+	icap_platform_irq_lock(icap);
+	link->heartbeat_us = period_us;
+	link->last_rx = now;
+	link->last_heartbeat = now;
+	icap_platform_irq_unlock(icap);
+	return 0;
+}
+
+int32_t icap_set_msg_timeout(struct icap_instance *icap, uint32_t min_us,
+		uint32_t max_us, uint32_t rtt_mult)
+{
+	struct icap_link *link = &icap->link;
+
+	if ((min_us == 0) || (min_us > max_us)) {
+		return -ICAP_ERROR_INVALID;
+	}
+
+	icap_platform_irq_lock(icap);
+	link->timeout_min_us = min_us;
+	link->timeout_max_us = max_us;
+	link->timeout_mult = rtt_mult;
+	icap_platform_irq_unlock(icap);
+	return 0;
+}
+
+static
+void icap_link_state_changed(struct icap_instance *icap, uint32_t peer_alive)
+{
+	const struct icap_application_callbacks *app_cb;
+	const struct icap_device_callbacks *dev_cb;
+
+	if (icap->type == ICAP_APPLICATION_INSTANCE){
+		app_cb = ICAP_APPLICATION_CB(icap);
+		if (app_cb->link_state) {
+			app_cb->link_state(icap, peer_alive);
+		}
+	} else {
+		dev_cb = ICAP_DEVICE_CB(icap);
+		if (dev_cb->link_state) {
+			dev_cb->link_state(icap, peer_alive);
+		}
+	}
+}
+
+int32_t icap_heartbeat(struct icap_instance *icap)
+{
+	struct icap_link *link = &icap->link;
+	uint64_t now, period;
+	uint32_t send = 0;
+	uint32_t lost = 0;
+	uint32_t resume;
+	int32_t ret = 0;
+
+	if ( icap->callbacks == NULL ) {
+		return -ICAP_ERROR_INIT;
+	}
+
+	if (link->heartbeat_us == 0) {
+		return 0;
+	}
+
+	now = icap_platform_time_ns(icap);
+	period = (uint64_t)link->heartbeat_us * 1000;
+
+	icap_platform_irq_lock(icap);
+	if (now - link->last_heartbeat >= period) {
+		link->last_heartbeat = now;
+		send = 1;
+	}
+	if (link->peer_alive && (now - link->last_rx > period * ICAP_HEARTBEAT_MISS_MAX)) {
+		link->peer_alive = 0;
+		lost = 1;
+	}
+	/* Don't resume from inside of a response wait loop */
+	resume = icap->journal.resume_pending && link->peer_alive && (link->sync_depth == 0);
+	icap_platform_irq_unlock(icap);
+
+	if (lost) {
+		icap_link_state_changed(icap, 0);
+	}
+
+	if (icap->sessions.enabled) {
+		icap_session_expire(icap, now, period);
+	}
+
+	if (send) {
+		ret = icap_send_broadcast(icap, ICAP_MSG_HEARTBEAT, &link->session, sizeof(link->session));
+	}
+
+	if ((ret == 0) && resume) {
+		ret = icap_session_resume(icap);
+	}
+	return ret;
+}
+
+static
+void icap_link_rx(struct icap_instance *icap)
+{
+	struct icap_link *link = &icap->link;
+	uint64_t now = icap_platform_time_ns(icap);
+	uint32_t restored = 0;
+
+	icap_platform_irq_lock(icap);
+	link->last_rx = now;
+	if (!link->peer_alive) {
+		link->peer_alive = 1;
+		restored = 1;
+	}
+	icap_platform_irq_unlock(icap);
+
+	if (restored) {
+		icap_link_state_changed(icap, 1);
+	}
+}
+
+/* Heartbeat is handled internally without any callback */
+static
+int32_t icap_parse_heartbeat(struct icap_instance *icap, struct icap_msg *msg)
+{
+	struct icap_link *link = &icap->link;
+	struct icap_msg_header *msg_header = &msg->header;
+	uint32_t *peer_session = &link->peer_session;
+	uint32_t known_session;
+
+	if (icap->sessions.enabled) {
+		peer_session = &icap->sessions.sessions[icap->sessions.current].peer_session;
+	}
+
+	if (msg_header->type == ICAP_MSG) {
+		/* Echo the session known before, the peer detects lost state by it */
+		known_session = *peer_session;
+		*peer_session = msg_header->session;
+		return icap_send_ack(icap, ICAP_MSG_HEARTBEAT, msg_header->seq_num, &known_session, sizeof(known_session));
+	}
+
+	if ((msg_header->type != ICAP_ACK) || (msg_header->payload_len != sizeof(uint32_t))) {
+		return 0;
+	}
+
+	if (msg->payload.u32 == link->session) {
+		link->peer_synced = 1;
+	} else if (link->peer_synced && (icap->type == ICAP_APPLICATION_INSTANCE)) {
+		/* The device restarted and lost the session state */
+		icap->journal.resume_pending = 1;
+	}
+	return 0;
+}
+
+int32_t icap_proxy_init(struct icap_proxy *proxy, struct icap_instance *upstream,
+		struct icap_instance *downstream)
+{
+	if ((proxy == NULL) || (upstream == NULL) || (downstream == NULL)) {
+		return -ICAP_ERROR_INVALID;
+	}
+	if ((upstream->type != ICAP_DEVICE_INSTANCE) ||
+			(downstream->type != ICAP_APPLICATION_INSTANCE) ||
+			upstream->sessions.enabled) {
+		return -ICAP_ERROR_INVALID;
+	}
+	if ((upstream->callbacks == NULL) || (downstream->callbacks == NULL)) {
+		return -ICAP_ERROR_INIT;
+	}
+	if (upstream->proxy || downstream->proxy) {
+		return -ICAP_ERROR_BUSY;
+	}
+
+	proxy->upstream = upstream;
+	proxy->downstream = downstream;
+	memset(proxy->requests, 0, sizeof(proxy->requests));
+	memset(proxy->events, 0, sizeof(proxy->events));
+	upstream->proxy = proxy;
+	downstream->proxy = proxy;
+	return 0;
+}
+
+int32_t icap_proxy_deinit(struct icap_proxy *proxy)
+{
+	if ((proxy == NULL) || (proxy->upstream == NULL)) {
+		return -ICAP_ERROR_INVALID;
+	}
+	proxy->upstream->proxy = NULL;
+	proxy->downstream->proxy = NULL;
+	proxy->upstream = NULL;
+	proxy->downstream = NULL;
+	return 0;
+}
+
+/* Free entry, entries not answered within the timeout are reused */
+static
+struct icap_proxy_pending *icap_proxy_alloc(struct icap_proxy_pending *table,
+		uint64_t now, uint64_t expire)
+{
+	uint32_t i;
+
+	for (i = 0; i < ICAP_PROXY_PENDING; i++) {
+		if (!table[i].used || (now - table[i].time > expire)) {
+			return &table[i];
+		}
+	}
+	return NULL;
+}
+
+static
+struct icap_proxy_pending *icap_proxy_find(struct icap_proxy_pending *table,
+		uint32_t cmd, uint32_t fwd_seq_num)
+{
+	uint32_t i;
+
+	for (i = 0; i < ICAP_PROXY_PENDING; i++) {
+		if (table[i].used && (table[i].cmd == cmd) && (table[i].fwd_seq_num == fwd_seq_num)) {
+			return &table[i];
+		}
+	}
+	return NULL;
+}
+
+/* Forward message from the upstream application to the downstream device */
+static
+int32_t icap_proxy_request(struct icap_proxy *proxy, struct icap_msg *msg)
+{
+	struct icap_instance *up = proxy->upstream;
+	struct icap_instance *down = proxy->downstream;
+	struct icap_msg_header *msg_header = &msg->header;
+	struct icap_proxy_pending *pending = NULL;
+	uint64_t now = icap_platform_time_ns(up);
+	uint64_t expire = (uint64_t)down->link.timeout_max_us * 1000;
+	uint32_t fwd_seq_num;
+	uint32_t flags = 0;
+	uint32_t i;
+	int32_t ret = 0;
+
+	if (!down->link.peer_alive) {
+		ret = -ICAP_ERROR_BROKEN_CON;
+	} else if ((msg_header->cmd == ICAP_MSG_ADD_SRC) || (msg_header->cmd == ICAP_MSG_ADD_DST)) {
+		ret = icap_xlat_buf(up, &msg->payload.buf);
+		if ((ret == 0) && proxy->translate_buf) {
+			ret = proxy->translate_buf(proxy, &msg->payload.buf);
+		}
+	} else if (msg_header->cmd == ICAP_MSG_BUF_SWITCH) {
+		ret = icap_xlat_buf(up, &msg->payload.buf_switch.buf);
+		if ((ret == 0) && proxy->translate_buf) {
+			ret = proxy->translate_buf(proxy, &msg->payload.buf_switch.buf);
+		}
+	} else if (msg_header->cmd == ICAP_MSG_CTRL_BLOCK) {
+		ret = icap_xlat_ctrl(up, &msg->payload.ctrl_desc);
+	}
+	if (ret) {
+		return icap_send_nak(up, (enum icap_msg_cmd)msg_header->cmd, msg_header->seq_num, ret);
+	}
+
+	fwd_seq_num = icap_next_seq_num(down, NULL);
+
+	icap_platform_irq_lock(up);
+	/* Retransmission of a message still waiting for the downstream response */
+	for (i = 0; i < ICAP_PROXY_PENDING; i++) {
+		if (proxy->requests[i].used && (proxy->requests[i].cmd == msg_header->cmd) &&
+				(proxy->requests[i].seq_num == msg_header->seq_num) &&
+				(proxy->requests[i].session == msg_header->session) &&
+				(now - proxy->requests[i].time <= expire)) {
+			pending = &proxy->requests[i];
+			fwd_seq_num = pending->fwd_seq_num;
+			flags = ICAP_MSG_FLAG_RETRANSMIT;
+			break;
+		}
+	}
+	if (pending == NULL) {
+		pending = icap_proxy_alloc(proxy->requests, now, expire);
+		if (pending) {
+			pending->used = 1;
+			pending->cmd = msg_header->cmd;
+			pending->fwd_seq_num = fwd_seq_num;
+			pending->seq_num = msg_header->seq_num;
+			pending->session = msg_header->session;
+			pending->time = now;
+		}
+	}
+	icap_platform_irq_unlock(up);
+
+	if (pending == NULL) {
+		return icap_send_nak(up, (enum icap_msg_cmd)msg_header->cmd, msg_header->seq_num, -ICAP_ERROR_NO_BUFS);
+	}
+
+	ret = icap_send_raw(down, NULL, (enum icap_msg_cmd)msg_header->cmd, ICAP_MSG,
+			fwd_seq_num, flags, &msg->payload, msg_header->payload_len);
+	if (ret && !flags) {
+		icap_platform_irq_lock(up);
+		pending->used = 0;
+		icap_platform_irq_unlock(up);
+		return icap_send_nak(up, (enum icap_msg_cmd)msg_header->cmd, msg_header->seq_num, ret);
+	}
+	return ret;
+}
+
+/* Forward response of the downstream device to the upstream application */
+static
+int32_t icap_proxy_response(struct icap_proxy *proxy, struct icap_msg *msg)
+{
+	struct icap_msg_header *msg_header = &msg->header;
+	struct icap_proxy_pending *pending;
+	uint32_t seq_num = 0;
+	uint32_t session = 0;
+
+	icap_platform_irq_lock(proxy->upstream);
+	pending = icap_proxy_find(proxy->requests, msg_header->cmd, msg_header->seq_num);
+	if (pending) {
+		seq_num = pending->seq_num;
+		session = pending->session;
+		pending->used = 0;
+	}
+	icap_platform_irq_unlock(proxy->upstream);
+
+	if (pending == NULL) {
+		/* Response to a call made on the downstream instance itself,
+		 * e.g. icap_session_resume() started by its heartbeat */
+		return icap_application_parse_response(proxy->downstream, msg);
+	}
+	return icap_send_cached_response(proxy->upstream, session,
+			(enum icap_msg_cmd)msg_header->cmd, (enum icap_msg_type)msg_header->type,
+			seq_num, &msg->payload, msg_header->payload_len);
+}
+
+/* Forward notification of the downstream device to the upstream application */
+static
+int32_t icap_proxy_event(struct icap_proxy *proxy, struct icap_msg *msg)
+{
+	struct icap_instance *up = proxy->upstream;
+	struct icap_instance *down = proxy->downstream;
+	struct icap_msg_header *msg_header = &msg->header;
+	struct icap_proxy_pending *pending;
+	uint64_t now = icap_platform_time_ns(up);
+	uint64_t expire = (uint64_t)up->link.timeout_max_us * 1000;
+	uint32_t fwd_seq_num;
+	int32_t ret;
+
+	fwd_seq_num = icap_next_seq_num(up, NULL);
+
+	icap_platform_irq_lock(up);
+	pending = icap_proxy_alloc(proxy->events, now, expire);
+	if (pending) {
+		pending->used = 1;
+		pending->cmd = msg_header->cmd;
+		pending->fwd_seq_num = fwd_seq_num;
+		pending->seq_num = msg_header->seq_num;
+		pending->session = msg_header->session;
+		pending->time = now;
+	}
+	icap_platform_irq_unlock(up);
+
+	if (pending == NULL) {
+		return icap_send_nak(down, (enum icap_msg_cmd)msg_header->cmd, msg_header->seq_num, -ICAP_ERROR_NO_BUFS);
+	}
+
+	ret = icap_send_raw(up, NULL, (enum icap_msg_cmd)msg_header->cmd, ICAP_MSG,
+			fwd_seq_num, 0, &msg->payload, msg_header->payload_len);
+	if (ret) {
+		icap_platform_irq_lock(up);
+		pending->used = 0;
+		icap_platform_irq_unlock(up);
+		return icap_send_nak(down, (enum icap_msg_cmd)msg_header->cmd, msg_header->seq_num, ret);
+	}
+	return 0;
+}
+
+/* Forward response of the upstream application to the downstream device */
+static
+int32_t icap_proxy_event_response(struct icap_proxy *proxy, struct icap_msg *msg)
+{
+	struct icap_msg_header *msg_header = &msg->header;
+	struct icap_proxy_pending *pending;
+	uint32_t seq_num = 0;
+
+	icap_platform_irq_lock(proxy->upstream);
+	pending = icap_proxy_find(proxy->events, msg_header->cmd, msg_header->seq_num);
+	if (pending) {
+		seq_num = pending->seq_num;
+		pending->used = 0;
+	}
+	icap_platform_irq_unlock(proxy->upstream);
+
+	if (pending == NULL) {
+		return -ICAP_ERROR_MSG_ID;
+	}
+	return icap_send_raw(proxy->downstream, NULL, (enum icap_msg_cmd)msg_header->cmd,
+			(enum icap_msg_type)msg_header->type, seq_num, 0,
+			&msg->payload, msg_header->payload_len);
+}
+
+static
+int32_t icap_proxy_parse_msg(struct icap_instance *icap, struct icap_msg *msg)
+{
+	struct icap_proxy *proxy = icap->proxy;
+
+	if (icap == proxy->upstream) {
+		if (msg->header.type == ICAP_MSG) {
+			return icap_proxy_request(proxy, msg);
+		}
+		return icap_proxy_event_response(proxy, msg);
+	}
+
+	if (msg->header.type == ICAP_MSG) {
+		return icap_proxy_event(proxy, msg);
+	}
+	return icap_proxy_response(proxy, msg);
+}
+
 int32_t icap_parse_msg(struct icap_instance *icap,
 		union icap_remote_addr *src_addr, void *data, uint32_t size)
 {
@@ -604,11 +3210,45 @@ int32_t icap_parse_msg(struct icap_instance *icap,
 		return -ICAP_ERROR_MSG_LEN;
 	}
 
-	ret = icap_verify_remote(icap, src_addr);
+	if (icap->sessions.enabled) {
+		ret = icap_session_rx(icap, src_addr);
+	} else {
+		ret = icap_verify_remote(icap, src_addr);
+	}
 	if (ret) {
 		return ret;
 	}
-	
+
+	icap_link_rx(icap);
+
+	if (msg_header->cmd == ICAP_MSG_HEARTBEAT) {
+		return icap_parse_heartbeat(icap, msg);
+	}
+
+	if (msg_header->type == ICAP_MSG) {
+		if ((msg_header->flags & ICAP_MSG_FLAG_RETRANSMIT) &&
+				(icap_resp_cache_replay(icap, msg_header) == 0)) {
+			/* Duplicate of already executed message */
+			return 0;
+		}
+		icap->resp_cache.rx_session = msg_header->session;
+
+		if ((msg_header->cmd > ICAP_MSG_HEARTBEAT) ||
+				!(icap_msg_info[msg_header->cmd].rx & (1 << icap->type))) {
+			icap_send_nak(icap, (enum icap_msg_cmd)msg_header->cmd, msg_header->seq_num, -ICAP_ERROR_MSG_ID);
+			return -ICAP_ERROR_MSG_ID;
+		}
+		if (msg_header->payload_len < icap_msg_info[msg_header->cmd].payload_len) {
+			icap_send_nak(icap, (enum icap_msg_cmd)msg_header->cmd, msg_header->seq_num, -ICAP_ERROR_MSG_LEN);
+			return -ICAP_ERROR_MSG_LEN;
+		}
+	}
+
+	if (icap->proxy && ((msg_header->type == ICAP_MSG) ||
+			(msg_header->type == ICAP_ACK) || (msg_header->type == ICAP_NAK))) {
+		return icap_proxy_parse_msg(icap, msg);
+	}
+
 	if ( (msg_header->type == ICAP_ACK) || (msg_header->type == ICAP_NAK) ) {
 		if (icap->type == ICAP_APPLICATION_INSTANCE){
 			return icap_application_parse_response(icap, msg);
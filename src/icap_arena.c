@@ -0,0 +1,444 @@
+// SPDX-License-Identifier: (GPL-2.0-or-later OR Apache-2.0)
+
+/*
+ *  Copyright 2021-2022 Analog Devices Inc.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+/*
+ * Copyright (C) 2021-2022 Analog Devices Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301,USA.
+ */
+
+/*
+ * Authors:
+ *   Piotr Wojtaszczyk <piotr.wojtaszczyk@timesys.com>
+ */
+
+/**
+ * @file icap_arena.c
+ * @author Piotr Wojtaszczyk <piotr.wojtaszczyk@timesys.com>
+ * @brief Shared memory allocator, see icap_arena.h.
+ *
+ * @copyright Copyright 2021-2022 Analog Devices Inc.
+ */
+
+#include "../include/icap_arena.h"
+
+#define ICAP_ARENA_NONE (-1)
+
+/* Index of the highest set bit, val must not be 0 */
+static
+uint32_t icap_arena_log2(uint32_t val)
+{
+	uint32_t n = 0;
+
+	while (val >>= 1) {
+		n++;
+	}
+	return n;
+}
+
+/* Index of the lowest set bit, val must not be 0 */
+static
+uint32_t icap_arena_lowest(uint32_t val)
+{
+	uint32_t n = 0;
+
+	while (!(val & 1)) {
+		val >>= 1;
+		n++;
+	}
+	return n;
+}
+
+static
+uint32_t icap_arena_class(struct icap_arena *arena, uint32_t size)
+{
+	return icap_arena_log2(size / arena->align);
+}
+
+static
+void icap_arena_list_add(struct icap_arena *arena, int32_t idx)
+{
+	struct icap_arena_block *block = &arena->blocks[idx];
+	uint32_t cls = icap_arena_class(arena, block->size);
+
+	block->free_prev = ICAP_ARENA_NONE;
+	block->free_next = arena->free_lists[cls];
+	if (block->free_next != ICAP_ARENA_NONE) {
+		arena->blocks[block->free_next].free_prev = idx;
+	}
+	arena->free_lists[cls] = idx;
+	arena->free_map |= 1u << cls;
+}
+
+static
+void icap_arena_list_remove(struct icap_arena *arena, int32_t idx)
+{
+	struct icap_arena_block *block = &arena->blocks[idx];
+	uint32_t cls = icap_arena_class(arena, block->size);
+
+	if (block->free_prev != ICAP_ARENA_NONE) {
+		arena->blocks[block->free_prev].free_next = block->free_next;
+	} else {
+		arena->free_lists[cls] = block->free_next;
+		if (block->free_next == ICAP_ARENA_NONE) {
+			arena->free_map &= ~(1u << cls);
+		}
+	}
+	if (block->free_next != ICAP_ARENA_NONE) {
+		arena->blocks[block->free_next].free_prev = block->free_prev;
+	}
+}
+
+/* Returns the block table entry to the unused list */
+static
+void icap_arena_put_entry(struct icap_arena *arena, int32_t idx)
+{
+	arena->blocks[idx].next = arena->unused;
+	arena->unused = idx;
+}
+
+int32_t icap_arena_init(struct icap_arena *arena, void *vaddr, uint64_t addr,
+		uint32_t size, uint32_t align, uint32_t guard)
+{
+	uint32_t i;
+
+	if ((arena == NULL) || (align < sizeof(uint32_t)) || (align & (align - 1)) ||
+			((guard != 0) && (vaddr == NULL))) {
+		return -ICAP_ERROR_INVALID;
+	}
+
+	memset(arena, 0, sizeof(struct icap_arena));
+	arena->vaddr = vaddr;
+	arena->addr = addr;
+	arena->align = align;
+	arena->guard = guard;
+	for (i = 0; i < ICAP_ARENA_CLASSES; i++) {
+		arena->free_lists[i] = ICAP_ARENA_NONE;
+	}
+	arena->unused = ICAP_ARENA_NONE;
+	for (i = ICAP_ARENA_BLOCKS; i > 1; i--) {
+		icap_arena_put_entry(arena, i - 1);
+	}
+
+	/* The region start may be unaligned, skip to the first aligned address */
+	i = (uint32_t)(-addr & (align - 1));
+	if (size < i + align) {
+		return -ICAP_ERROR_NOMEM;
+	}
+	arena->size = size;
+	arena->blocks[0].offset = i;
+	arena->blocks[0].size = (size - i) & ~(align - 1);
+	arena->blocks[0].buf_id = ICAP_ARENA_NO_BUF;
+	arena->blocks[0].prev = ICAP_ARENA_NONE;
+	arena->blocks[0].next = ICAP_ARENA_NONE;
+	icap_arena_list_add(arena, 0);
+	return 0;
+}
+
+/* Free block of at least size bytes, ICAP_ARENA_NONE if there is none */
+static
+int32_t icap_arena_find(struct icap_arena *arena, uint32_t size)
+{
+	uint32_t units = size / arena->align;
+	uint32_t cls = icap_arena_log2(units);
+	uint32_t map;
+	int32_t idx;
+
+	/* Any block of a higher class fits, the own class only if the size isn't a power of two */
+	map = arena->free_map;
+	if (units & (units - 1)) {
+		map &= ~((2u << cls) - 1);
+	} else {
+		map &= ~((1u << cls) - 1);
+	}
+	if (map) {
+		return arena->free_lists[icap_arena_lowest(map)];
+	}
+
+	for (idx = arena->free_lists[cls]; idx != ICAP_ARENA_NONE; idx = arena->blocks[idx].free_next) {
+		if (arena->blocks[idx].size >= size) {
+			return idx;
+		}
+	}
+	return ICAP_ARENA_NONE;
+}
+
+int32_t icap_arena_alloc(struct icap_arena *arena, uint32_t size, uint32_t *offset)
+{
+	struct icap_arena_block *block;
+	struct icap_arena_block *rest;
+	uint32_t need;
+	int32_t idx;
+	int32_t ridx;
+
+	if ((arena == NULL) || (offset == NULL) || (size == 0) ||
+			(size > arena->size - arena->guard)) {
+		return -ICAP_ERROR_INVALID;
+	}
+
+	need = (size + arena->guard + arena->align - 1) & ~(arena->align - 1);
+	idx = icap_arena_find(arena, need);
+	if (idx == ICAP_ARENA_NONE) {
+		return -ICAP_ERROR_NOMEM;
+	}
+	block = &arena->blocks[idx];
+	icap_arena_list_remove(arena, idx);
+
+	/* Split off the rest, without a spare table entry the block stays bigger */
+	if ((block->size > need) && (arena->unused != ICAP_ARENA_NONE)) {
+		ridx = arena->unused;
+		rest = &arena->blocks[ridx];
+		arena->unused = rest->next;
+
+		rest->offset = block->offset + need;
+		rest->size = block->size - need;
+		rest->req_size = 0;
+		rest->buf_id = ICAP_ARENA_NO_BUF;
+		rest->prev = idx;
+		rest->next = block->next;
+		if (block->next != ICAP_ARENA_NONE) {
+			arena->blocks[block->next].prev = ridx;
+		}
+		block->next = ridx;
+		block->size = need;
+		icap_arena_list_add(arena, ridx);
+	}
+
+	block->req_size = size;
+	block->buf_id = ICAP_ARENA_NO_BUF;
+	if (arena->guard) {
+		memset(arena->vaddr + block->offset + size, ICAP_ARENA_GUARD_PATTERN, arena->guard);
+	}
+	*offset = block->offset;
+	return 0;
+}
+
+static
+int32_t icap_arena_find_used(struct icap_arena *arena, uint32_t offset)
+{
+	int32_t idx;
+
+	/* The table isn't in address order, scan all entries */
+	for (idx = 0; idx < ICAP_ARENA_BLOCKS; idx++) {
+		if (arena->blocks[idx].req_size && (arena->blocks[idx].offset <= offset) &&
+				(offset < arena->blocks[idx].offset + arena->blocks[idx].size)) {
+			return idx;
+		}
+	}
+	return ICAP_ARENA_NONE;
+}
+
+static
+void icap_arena_free_block(struct icap_arena *arena, int32_t idx)
+{
+	struct icap_arena_block *block = &arena->blocks[idx];
+	struct icap_arena_block *next;
+	struct icap_arena_block *prev;
+	int32_t nidx = block->next;
+	int32_t pidx = block->prev;
+
+	block->req_size = 0;
+	block->buf_id = ICAP_ARENA_NO_BUF;
+
+	if ((nidx != ICAP_ARENA_NONE) && (arena->blocks[nidx].req_size == 0)) {
+		next = &arena->blocks[nidx];
+		icap_arena_list_remove(arena, nidx);
+		block->size += next->size;
+		block->next = next->next;
+		if (next->next != ICAP_ARENA_NONE) {
+			arena->blocks[next->next].prev = idx;
+		}
+		icap_arena_put_entry(arena, nidx);
+	}
+
+	if ((pidx != ICAP_ARENA_NONE) && (arena->blocks[pidx].req_size == 0)) {
+		prev = &arena->blocks[pidx];
+		icap_arena_list_remove(arena, pidx);
+		prev->size += block->size;
+		prev->next = block->next;
+		if (block->next != ICAP_ARENA_NONE) {
+			arena->blocks[block->next].prev = pidx;
+		}
+		icap_arena_put_entry(arena, idx);
+		idx = pidx;
+	}
+	icap_arena_list_add(arena, idx);
+}
+
+int32_t icap_arena_free(struct icap_arena *arena, uint32_t offset)
+{
+	int32_t idx = icap_arena_find_used(arena, offset);
+
+	if ((idx == ICAP_ARENA_NONE) || (arena->blocks[idx].offset != offset)) {
+		return -ICAP_ERROR_INVALID;
+	}
+	icap_arena_free_block(arena, idx);
+	return 0;
+}
+
+int32_t icap_arena_alloc_buf(struct icap_arena *arena, struct icap_buf_descriptor *buf)
+{
+	uint32_t stride;
+	uint32_t frags;
+	uint32_t plane;
+	uint32_t planes = 1;
+	uint32_t offset;
+	int32_t ret;
+
+	if ((arena == NULL) || (buf == NULL) || (buf->frag_size == 0)) {
+		return -ICAP_ERROR_INVALID;
+	}
+
+	if (buf->type == ICAP_BUF_SCATTERED) {
+		plane = buf->buf_size;
+	} else {
+		/* Pad the gaps so every fragment starts on a cache line */
+		stride = buf->frag_size + buf->gap_size;
+		frags = (buf->buf_size + buf->gap_size) / stride;
+		if (frags == 0) {
+			return -ICAP_ERROR_INVALID;
+		}
+		stride = (stride + arena->align - 1) & ~(arena->align - 1);
+		buf->gap_size = stride - buf->frag_size;
+		buf->buf_size = frags * stride - buf->gap_size;
+		plane = frags * stride;
+		if (buf->type == ICAP_BUF_PLANAR) {
+			planes = buf->channels ? buf->channels : 1;
+			buf->channel_stride = plane;
+		}
+	}
+	if (plane > (arena->size / planes)) {
+		return -ICAP_ERROR_NOMEM;
+	}
+
+	ret = icap_arena_alloc(arena, plane * planes, &offset);
+	if (ret) {
+		return ret;
+	}
+	buf->buf = arena->addr + offset;
+	return 0;
+}
+
+int32_t icap_arena_bind(struct icap_arena *arena, uint64_t addr, uint32_t buf_id)
+{
+	int32_t idx = ICAP_ARENA_NONE;
+
+	if ((addr >= arena->addr) && (addr - arena->addr < arena->size)) {
+		idx = icap_arena_find_used(arena, (uint32_t)(addr - arena->addr));
+	}
+	if (idx == ICAP_ARENA_NONE) {
+		return -ICAP_ERROR_INVALID;
+	}
+	arena->blocks[idx].buf_id = buf_id;
+	return 0;
+}
+
+static
+int32_t icap_arena_find_buf(struct icap_arena *arena, uint32_t buf_id)
+{
+	int32_t idx;
+
+	for (idx = 0; idx < ICAP_ARENA_BLOCKS; idx++) {
+		if (arena->blocks[idx].req_size && (arena->blocks[idx].buf_id == buf_id)) {
+			return idx;
+		}
+	}
+	return ICAP_ARENA_NONE;
+}
+
+int32_t icap_arena_release(struct icap_arena *arena, uint32_t buf_id)
+{
+	int32_t idx = icap_arena_find_buf(arena, buf_id);
+
+	if (idx == ICAP_ARENA_NONE) {
+		return -ICAP_ERROR_INVALID;
+	}
+	icap_arena_free_block(arena, idx);
+	return 0;
+}
+
+int32_t icap_arena_unbind(struct icap_arena *arena, uint32_t buf_id)
+{
+	int32_t idx = icap_arena_find_buf(arena, buf_id);
+
+	if (idx == ICAP_ARENA_NONE) {
+		return -ICAP_ERROR_INVALID;
+	}
+	arena->blocks[idx].buf_id = ICAP_ARENA_NO_BUF;
+	return 0;
+}
+
+void icap_arena_get_stats(struct icap_arena *arena, struct icap_arena_stats *stats)
+{
+	struct icap_arena_block *block;
+	int32_t idx;
+
+	memset(stats, 0, sizeof(struct icap_arena_stats));
+	stats->total = arena->size;
+	for (idx = 0; idx != ICAP_ARENA_NONE; idx = block->next) {
+		block = &arena->blocks[idx];
+		if (block->req_size) {
+			stats->used += block->size;
+			stats->used_blocks++;
+		} else {
+			stats->free += block->size;
+			stats->free_blocks++;
+			if (block->size > stats->largest_free) {
+				stats->largest_free = block->size;
+			}
+		}
+	}
+}
+
+int32_t icap_arena_check(struct icap_arena *arena)
+{
+	struct icap_arena_block *block;
+	int32_t damaged = 0;
+	uint32_t i;
+	int32_t idx;
+
+	if (arena->guard == 0) {
+		return 0;
+	}
+
+	for (idx = 0; idx != ICAP_ARENA_NONE; idx = block->next) {
+		block = &arena->blocks[idx];
+		if (block->req_size == 0) {
+			continue;
+		}
+		for (i = 0; i < arena->guard; i++) {
+			if (arena->vaddr[block->offset + block->req_size + i] != ICAP_ARENA_GUARD_PATTERN) {
+				damaged++;
+				break;
+			}
+		}
+	}
+	return damaged;
+}
@@ -0,0 +1,147 @@
+// SPDX-License-Identifier: (GPL-2.0-or-later OR Apache-2.0)
+
+/*
+ *  Copyright 2021-2022 Analog Devices Inc.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+/*
+ * Copyright (C) 2021-2022 Analog Devices Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301,USA.
+ */
+
+/*
+ * Authors:
+ *   Piotr Wojtaszczyk <piotr.wojtaszczyk@timesys.com>
+ */
+
+/**
+ * @file icap_ctrl.c
+ * @author Piotr Wojtaszczyk <piotr.wojtaszczyk@timesys.com>
+ * @brief Shared memory control block, see icap_ctrl.h.
+ *
+ * @copyright Copyright 2021-2022 Analog Devices Inc.
+ */
+
+#include "../include/icap_ctrl.h"
+
+/* Words of the block at a member offset, the packed members can't be addressed directly */
+#define ICAP_CTRL_WORDS(block, offset) ((volatile uint32_t *)((uintptr_t)(block) + (offset)))
+
+/* Word by word copy, volatile so the compiler keeps the accesses between the barriers */
+static
+void icap_ctrl_copy(volatile uint32_t *dst, const volatile uint32_t *src, uint32_t size)
+{
+	uint32_t i;
+
+	for (i = 0; i < size / sizeof(uint32_t); i++) {
+		dst[i] = src[i];
+	}
+}
+
+static
+void icap_ctrl_write(struct icap_ctrl_block *block, uint32_t seq_offset,
+		uint32_t data_offset, const void *src, uint32_t size)
+{
+	volatile uint32_t *seq = ICAP_CTRL_WORDS(block, seq_offset);
+	uint32_t s = *seq;
+
+	*seq = s + 1;
+	ICAP_MEMORY_BARRIER();
+	icap_ctrl_copy(ICAP_CTRL_WORDS(block, data_offset), src, size);
+	ICAP_MEMORY_BARRIER();
+	*seq = s + 2;
+}
+
+static
+int32_t icap_ctrl_read(struct icap_ctrl_block *block, uint32_t seq_offset,
+		uint32_t data_offset, void *dst, uint32_t size)
+{
+	volatile uint32_t *seq = ICAP_CTRL_WORDS(block, seq_offset);
+	uint32_t retries;
+	uint32_t s;
+
+	for (retries = 0; retries < ICAP_CTRL_READ_RETRIES; retries++) {
+		s = *seq;
+		if (s & 1) {
+			continue;
+		}
+		ICAP_MEMORY_BARRIER();
+		icap_ctrl_copy(dst, ICAP_CTRL_WORDS(block, data_offset), size);
+		ICAP_MEMORY_BARRIER();
+		if (*seq == s) {
+			return 0;
+		}
+	}
+	return -ICAP_ERROR_BUSY;
+}
+
+void icap_ctrl_init(struct icap_ctrl_block *block)
+{
+	memset(block, 0, sizeof(struct icap_ctrl_block));
+	block->params.gain = 1 << 16;
+	block->params.channel_mask = 0xffffffff;
+	ICAP_MEMORY_BARRIER();
+}
+
+void icap_ctrl_write_params(struct icap_ctrl_block *block, const struct icap_ctrl_params *params)
+{
+	icap_ctrl_write(block, offsetof(struct icap_ctrl_block, params_seq),
+			offsetof(struct icap_ctrl_block, params), params, sizeof(struct icap_ctrl_params));
+}
+
+int32_t icap_ctrl_read_params(struct icap_ctrl_block *block, struct icap_ctrl_params *params)
+{
+	struct icap_ctrl_params tmp;
+	int32_t ret;
+
+	ret = icap_ctrl_read(block, offsetof(struct icap_ctrl_block, params_seq),
+			offsetof(struct icap_ctrl_block, params), &tmp, sizeof(struct icap_ctrl_params));
+	if (ret == 0) {
+		memcpy(params, &tmp, sizeof(struct icap_ctrl_params));
+	}
+	return ret;
+}
+
+void icap_ctrl_write_meters(struct icap_ctrl_block *block, const struct icap_ctrl_meters *meters)
+{
+	icap_ctrl_write(block, offsetof(struct icap_ctrl_block, meters_seq),
+			offsetof(struct icap_ctrl_block, meters), meters, sizeof(struct icap_ctrl_meters));
+}
+
+int32_t icap_ctrl_read_meters(struct icap_ctrl_block *block, struct icap_ctrl_meters *meters)
+{
+	struct icap_ctrl_meters tmp;
+	int32_t ret;
+
+	ret = icap_ctrl_read(block, offsetof(struct icap_ctrl_block, meters_seq),
+			offsetof(struct icap_ctrl_block, meters), &tmp, sizeof(struct icap_ctrl_meters));
+	if (ret == 0) {
+		memcpy(meters, &tmp, sizeof(struct icap_ctrl_meters));
+	}
+	return ret;
+}
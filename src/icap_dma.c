@@ -0,0 +1,169 @@
+// SPDX-License-Identifier: (GPL-2.0-or-later OR Apache-2.0)
+
+/*
+ *  Copyright 2021-2022 Analog Devices Inc.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+/*
+ * Copyright (C) 2021-2022 Analog Devices Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301,USA.
+ */
+
+/*
+ * Authors:
+ *   Piotr Wojtaszczyk <piotr.wojtaszczyk@timesys.com>
+ */
+
+/**
+ * @file icap_dma.c
+ * @author Piotr Wojtaszczyk <piotr.wojtaszczyk@timesys.com>
+ * @brief DMA descriptor chain builder, see icap_dma.h.
+ *
+ * @copyright Copyright 2021-2022 Analog Devices Inc.
+ */
+
+#include "../include/icap_dma.h"
+
+static
+void icap_dma_write(struct icap_dma_chain *chain, uint32_t index)
+{
+	if (chain->write_desc) {
+		chain->write_desc(chain, index, &chain->descs[index]);
+	}
+}
+
+int32_t icap_dma_init(struct icap_dma_chain *chain, const struct icap_buf_descriptor *buf,
+		uint64_t base, void (*write_desc)(struct icap_dma_chain *chain, uint32_t index,
+		const struct icap_dma_desc *desc), void *priv)
+{
+	struct icap_dma_desc *desc;
+	uint32_t frag;
+	uint32_t plane;
+	uint32_t i;
+	int32_t ret;
+
+	if (chain == NULL) {
+		return -ICAP_ERROR_INVALID;
+	}
+	memset(chain, 0, sizeof(struct icap_dma_chain));
+	ret = icap_frag_init(&chain->cur, buf);
+	if (ret) {
+		return ret;
+	}
+	chain->base = base;
+	chain->write_desc = write_desc;
+	chain->priv = priv;
+	chain->planes = (buf->type == ICAP_BUF_PLANAR) && buf->channels ? buf->channels : 1;
+
+	if (buf->type == ICAP_BUF_SCATTERED) {
+		chain->num = ICAP_DMA_DESCS_MAX;
+	} else {
+		if (chain->cur.frags > ICAP_DMA_DESCS_MAX / chain->planes) {
+			return -ICAP_ERROR_NOMEM;
+		}
+		chain->num = chain->cur.frags * chain->planes;
+	}
+
+	/* The links never change, only scattered records get new addresses */
+	for (i = 0; i < chain->num; i++) {
+		desc = &chain->descs[i];
+		desc->addr = 0;
+		desc->len = chain->cur.frag_size;
+		desc->next = i + 1 < chain->num ? i + 1 : 0;
+		desc->flags = 0;
+	}
+	if (buf->type == ICAP_BUF_SCATTERED) {
+		return 0;
+	}
+
+	i = 0;
+	for (frag = 0; frag < chain->cur.frags; frag++) {
+		for (plane = 0; plane < chain->planes; plane++, i++) {
+			chain->descs[i].addr = base + icap_frag_offset(&chain->cur, plane);
+			icap_dma_write(chain, i);
+		}
+		icap_frag_advance(&chain->cur, 1);
+	}
+	return 0;
+}
+
+int32_t icap_dma_push_offsets(struct icap_dma_chain *chain, const struct icap_buf_offsets *offsets)
+{
+	uint32_t head = chain->head;
+	uint32_t last;
+	uint32_t index;
+	uint32_t i;
+
+	if ((chain->cur.type != ICAP_BUF_SCATTERED) || (offsets == NULL) ||
+			(offsets->num > ICAP_BUF_MAX_FRAGS_OFFSETS_NUM)) {
+		return -ICAP_ERROR_INVALID;
+	}
+	if (offsets->num == 0) {
+		return 0;
+	}
+	if (chain->tail - head + offsets->num > chain->num) {
+		return -ICAP_ERROR_NOMEM;
+	}
+
+	index = chain->tail & (ICAP_DMA_DESCS_MAX - 1);
+	for (i = 0; i < offsets->num; i++) {
+		chain->descs[index].addr = chain->base + offsets->frags_offsets[i];
+		chain->descs[index].flags = 0;
+		if (i + 1 == offsets->num) {
+			chain->descs[index].flags = ICAP_DMA_FLAG_STOP;
+		}
+		icap_dma_write(chain, index);
+		index = chain->descs[index].next;
+	}
+
+	/* Let the DMA continue to the new records, only after they are written */
+	ICAP_MEMORY_BARRIER();
+	if (chain->tail != head) {
+		last = (chain->tail - 1) & (ICAP_DMA_DESCS_MAX - 1);
+		chain->descs[last].flags &= ~ICAP_DMA_FLAG_STOP;
+		icap_dma_write(chain, last);
+	}
+	chain->tail += offsets->num;
+	ICAP_MEMORY_BARRIER();
+
+	/* The DMA stopped at the end of an empty ring */
+	return chain->tail - offsets->num == head ? 1 : 0;
+}
+
+void icap_dma_complete(struct icap_dma_chain *chain, uint32_t descs)
+{
+	chain->head += descs;
+}
+
+uint32_t icap_dma_pending(const struct icap_dma_chain *chain)
+{
+	if (chain->cur.type != ICAP_BUF_SCATTERED) {
+		return chain->num;
+	}
+	return chain->tail - chain->head;
+}
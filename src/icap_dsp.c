@@ -0,0 +1,368 @@
+// SPDX-License-Identifier: (GPL-2.0-or-later OR Apache-2.0)
+
+/*
+ *  Copyright 2021-2022 Analog Devices Inc.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+/*
+ * Copyright (C) 2021-2022 Analog Devices Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301,USA.
+ */
+
+/*
+ * Authors:
+ *   Piotr Wojtaszczyk <piotr.wojtaszczyk@timesys.com>
+ */
+
+/**
+ * @file icap_dsp.c
+ * @author Piotr Wojtaszczyk <piotr.wojtaszczyk@timesys.com>
+ * @brief Processing chain runtime, see icap_dsp.h.
+ *
+ * @copyright Copyright 2021-2022 Analog Devices Inc.
+ */
+
+#include "../include/icap_dsp.h"
+#include "../include/icap_format.h"
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+/* Samples converted at once to floating point on the stack */
+#define ICAP_DSP_BLOCK (256)
+
+/* Native byte order formats */
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+#define ICAP_DSP_S16 ICAP_FORMAT_S16_BE
+#define ICAP_DSP_S32 ICAP_FORMAT_S32_BE
+#define ICAP_DSP_FLOAT ICAP_FORMAT_FLOAT_BE
+#else
+#define ICAP_DSP_S16 ICAP_FORMAT_S16_LE
+#define ICAP_DSP_S32 ICAP_FORMAT_S32_LE
+#define ICAP_DSP_FLOAT ICAP_FORMAT_FLOAT_LE
+#endif
+
+int32_t icap_dsp_init(struct icap_dsp *dsp, uint32_t format, uint32_t channels)
+{
+	if ((dsp == NULL) || (channels == 0) || (channels > ICAP_DSP_CHANNELS_MAX)) {
+		return -ICAP_ERROR_INVALID;
+	}
+	if ((format != ICAP_DSP_S16) && (format != ICAP_DSP_S32) && (format != ICAP_DSP_FLOAT)) {
+		return -ICAP_ERROR_NOT_SUP;
+	}
+	memset(dsp, 0, sizeof(struct icap_dsp));
+	dsp->format = format;
+	dsp->channels = channels;
+	return 0;
+}
+
+/* Parameters passing the samples unchanged */
+static
+void icap_dsp_block_default(struct icap_dsp_block *block, uint32_t type)
+{
+	memset(block, 0, sizeof(struct icap_dsp_block));
+	block->type = type;
+	switch (type) {
+	case ICAP_DSP_GAIN:
+		block->u.gain.gain = 1.0f;
+		block->u.gain.target = 1.0f;
+		break;
+	case ICAP_DSP_BIQUAD:
+		block->u.biquad.b0 = 1.0f;
+		break;
+	case ICAP_DSP_LIMITER:
+		block->u.limiter.threshold = 1.0f;
+		block->u.limiter.attack = 1.0f;
+		block->u.limiter.release = 1.0f;
+		break;
+	default:
+		break;
+	}
+}
+
+int32_t icap_dsp_set_chain(struct icap_dsp *dsp, const struct icap_dsp_chain *chain)
+{
+	uint32_t i;
+
+	if ((dsp == NULL) || (chain == NULL) || (chain->num > ICAP_DSP_BLOCKS_MAX)) {
+		return -ICAP_ERROR_INVALID;
+	}
+	for (i = 0; i < chain->num; i++) {
+		if (chain->blocks[i] > ICAP_DSP_LIMITER) {
+			return -ICAP_ERROR_NOT_SUP;
+		}
+	}
+
+	for (i = 0; i < chain->num; i++) {
+		if ((i >= dsp->num) || (dsp->blocks[i].type != chain->blocks[i])) {
+			icap_dsp_block_default(&dsp->blocks[i], chain->blocks[i]);
+		}
+	}
+	dsp->num = chain->num;
+	return 0;
+}
+
+int32_t icap_dsp_set_params(struct icap_dsp *dsp, const struct icap_dsp_params *params)
+{
+	struct icap_dsp_block *block;
+	float target;
+
+	if ((dsp == NULL) || (params == NULL) || (params->block >= dsp->num)) {
+		return -ICAP_ERROR_INVALID;
+	}
+	block = &dsp->blocks[params->block];
+	if (block->type != params->type) {
+		return -ICAP_ERROR_INVALID;
+	}
+
+	switch (block->type) {
+	case ICAP_DSP_GAIN:
+		target = (float)params->u.gain.gain * (1.0f / 65536.0f);
+		block->u.gain.target = target;
+		block->u.gain.ramp_left = params->u.gain.ramp_frames;
+		if (params->u.gain.ramp_frames == 0) {
+			block->u.gain.gain = target;
+		} else {
+			block->u.gain.step = (target - block->u.gain.gain) / (float)params->u.gain.ramp_frames;
+		}
+		break;
+	case ICAP_DSP_BIQUAD:
+		block->u.biquad.b0 = (float)params->u.biquad.b0 * (1.0f / 1073741824.0f);
+		block->u.biquad.b1 = (float)params->u.biquad.b1 * (1.0f / 1073741824.0f);
+		block->u.biquad.b2 = (float)params->u.biquad.b2 * (1.0f / 1073741824.0f);
+		block->u.biquad.a1 = (float)params->u.biquad.a1 * (1.0f / 1073741824.0f);
+		block->u.biquad.a2 = (float)params->u.biquad.a2 * (1.0f / 1073741824.0f);
+		break;
+	case ICAP_DSP_LIMITER:
+		if (params->u.limiter.threshold == 0) {
+			return -ICAP_ERROR_INVALID;
+		}
+		block->u.limiter.threshold = (float)params->u.limiter.threshold * (1.0f / 2147483648.0f);
+		/* One pole envelope follower, time constant in frames */
+		block->u.limiter.attack = 1.0f / (float)(params->u.limiter.attack_frames + 1);
+		block->u.limiter.release = 1.0f / (float)(params->u.limiter.release_frames + 1);
+		break;
+	default:
+		break;
+	}
+	return 0;
+}
+
+void icap_dsp_reset(struct icap_dsp *dsp)
+{
+	struct icap_dsp_block *block;
+	uint32_t i;
+
+	for (i = 0; i < dsp->num; i++) {
+		block = &dsp->blocks[i];
+		switch (block->type) {
+		case ICAP_DSP_GAIN:
+			block->u.gain.gain = block->u.gain.target;
+			block->u.gain.ramp_left = 0;
+			break;
+		case ICAP_DSP_BIQUAD:
+			memset(block->u.biquad.z1, 0, sizeof(block->u.biquad.z1));
+			memset(block->u.biquad.z2, 0, sizeof(block->u.biquad.z2));
+			break;
+		case ICAP_DSP_LIMITER:
+			block->u.limiter.env = 0.0f;
+			break;
+		default:
+			break;
+		}
+	}
+}
+
+static
+void icap_dsp_scale(float *x, float gain, uint32_t n)
+{
+	uint32_t i = 0;
+
+#if defined(__SSE2__)
+	const __m128 g = _mm_set1_ps(gain);
+	for (; i + 4 <= n; i += 4) {
+		_mm_storeu_ps(&x[i], _mm_mul_ps(_mm_loadu_ps(&x[i]), g));
+	}
+#elif defined(__ARM_NEON)
+	for (; i + 4 <= n; i += 4) {
+		vst1q_f32(&x[i], vmulq_n_f32(vld1q_f32(&x[i]), gain));
+	}
+#endif
+	for (; i < n; i++) {
+		x[i] *= gain;
+	}
+}
+
+static
+void icap_dsp_gain(struct icap_dsp_block *block, float *x, uint32_t channels, uint32_t frames)
+{
+	float gain = block->u.gain.gain;
+	uint32_t ramp = block->u.gain.ramp_left;
+	uint32_t i;
+	uint32_t c;
+
+	if (ramp > frames) {
+		ramp = frames;
+	}
+	for (i = 0; i < ramp; i++) {
+		gain += block->u.gain.step;
+		for (c = 0; c < channels; c++) {
+			x[i * channels + c] *= gain;
+		}
+	}
+	block->u.gain.ramp_left -= ramp;
+	if (block->u.gain.ramp_left == 0) {
+		/* Land exactly on the target, the steps accumulate rounding errors */
+		gain = block->u.gain.target;
+	}
+	block->u.gain.gain = gain;
+
+	if ((ramp < frames) && (gain != 1.0f)) {
+		icap_dsp_scale(&x[ramp * channels], gain, (frames - ramp) * channels);
+	}
+}
+
+static
+void icap_dsp_biquad(struct icap_dsp_block *block, float *x, uint32_t channels, uint32_t frames)
+{
+	const float b0 = block->u.biquad.b0;
+	const float b1 = block->u.biquad.b1;
+	const float b2 = block->u.biquad.b2;
+	const float a1 = block->u.biquad.a1;
+	const float a2 = block->u.biquad.a2;
+	float z1, z2, in, out;
+	uint32_t i;
+	uint32_t c;
+
+	/* Transposed direct form II, the state stays in registers for the channel */
+	for (c = 0; c < channels; c++) {
+		z1 = block->u.biquad.z1[c];
+		z2 = block->u.biquad.z2[c];
+		for (i = c; i < frames * channels; i += channels) {
+			in = x[i];
+			out = b0 * in + z1;
+			z1 = b1 * in - a1 * out + z2;
+			z2 = b2 * in - a2 * out;
+			x[i] = out;
+		}
+		block->u.biquad.z1[c] = z1;
+		block->u.biquad.z2[c] = z2;
+	}
+}
+
+static
+void icap_dsp_limiter(struct icap_dsp_block *block, float *x, uint32_t channels, uint32_t frames)
+{
+	const float threshold = block->u.limiter.threshold;
+	float env = block->u.limiter.env;
+	float peak, v, gain;
+	uint32_t i;
+	uint32_t c;
+
+	for (i = 0; i < frames; i++, x += channels) {
+		peak = 0.0f;
+		for (c = 0; c < channels; c++) {
+			v = x[c] < 0.0f ? -x[c] : x[c];
+			if (v > peak) {
+				peak = v;
+			}
+		}
+		if (peak > env) {
+			env += block->u.limiter.attack * (peak - env);
+		} else {
+			env += block->u.limiter.release * (peak - env);
+		}
+		if (env > threshold) {
+			gain = threshold / env;
+			for (c = 0; c < channels; c++) {
+				x[c] *= gain;
+			}
+		}
+	}
+	block->u.limiter.env = env;
+}
+
+static
+void icap_dsp_run(struct icap_dsp *dsp, float *x, uint32_t frames)
+{
+	struct icap_dsp_block *block;
+	uint32_t i;
+
+	for (i = 0; i < dsp->num; i++) {
+		block = &dsp->blocks[i];
+		switch (block->type) {
+		case ICAP_DSP_GAIN:
+			icap_dsp_gain(block, x, dsp->channels, frames);
+			break;
+		case ICAP_DSP_BIQUAD:
+			icap_dsp_biquad(block, x, dsp->channels, frames);
+			break;
+		case ICAP_DSP_LIMITER:
+			icap_dsp_limiter(block, x, dsp->channels, frames);
+			break;
+		default:
+			break;
+		}
+	}
+}
+
+int32_t icap_dsp_process(struct icap_dsp *dsp, void *data, uint32_t frames)
+{
+	float buf[ICAP_DSP_BLOCK];
+	uint32_t sample_size;
+	uint32_t max_frames;
+	uint8_t *ptr = data;
+	uint32_t n;
+
+	if ((dsp == NULL) || (data == NULL)) {
+		return -ICAP_ERROR_INVALID;
+	}
+	if (dsp->num == 0) {
+		return 0;
+	}
+
+	/* Float fragments are processed directly */
+	if (dsp->format == ICAP_DSP_FLOAT) {
+		icap_dsp_run(dsp, (float *)data, frames);
+		return 0;
+	}
+
+	sample_size = icap_format_size(dsp->format);
+	max_frames = ICAP_DSP_BLOCK / dsp->channels;
+	for (; frames; frames -= n) {
+		n = frames < max_frames ? frames : max_frames;
+		icap_format_convert(buf, ICAP_DSP_FLOAT, ptr, dsp->format, n * dsp->channels);
+		icap_dsp_run(dsp, buf, n);
+		icap_format_convert(ptr, dsp->format, buf, ICAP_DSP_FLOAT, n * dsp->channels);
+		ptr += n * dsp->channels * sample_size;
+	}
+	return 0;
+}
@@ -0,0 +1,926 @@
+// SPDX-License-Identifier: (GPL-2.0-or-later OR Apache-2.0)
+
+/*
+ *  Copyright 2021-2022 Analog Devices Inc.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+/*
+ * Copyright (C) 2021-2022 Analog Devices Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301,USA.
+ */
+
+/*
+ * Authors:
+ *   Piotr Wojtaszczyk <piotr.wojtaszczyk@timesys.com>
+ */
+
+/**
+ * @file icap_format.c
+ * @author Piotr Wojtaszczyk <piotr.wojtaszczyk@timesys.com>
+ * @brief Sample format conversion, see icap_format.h.
+ *
+ * @copyright Copyright 2021-2022 Analog Devices Inc.
+ */
+
+#include "../include/icap_format.h"
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+/* Samples converted at once through the intermediate buffers on the stack */
+#define ICAP_FORMAT_BLOCK (64)
+
+/* Set when the byte order of a format differs from the host */
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+#define ICAP_SWAP_LE (1)
+#define ICAP_SWAP_BE (0)
+#else
+#define ICAP_SWAP_LE (0)
+#define ICAP_SWAP_BE (1)
+#endif
+
+/* Kind of a format, also the intermediate representation used for it */
+#define ICAP_FORMAT_INT (0)
+#define ICAP_FORMAT_FLOAT (1)
+#define ICAP_FORMAT_DOUBLE (2)
+
+struct icap_format_info {
+	/* Size of a sample in bytes */
+	uint8_t size;
+	/* Significant bits */
+	uint8_t bits;
+	/* One of ICAP_FORMAT_INT, ICAP_FORMAT_FLOAT, ICAP_FORMAT_DOUBLE */
+	uint8_t kind;
+	/* Byte order differs from the host */
+	uint8_t swap;
+	/* Xor-ed with unsigned samples to get the signed value */
+	uint32_t offset;
+};
+
+static const struct icap_format_info icap_formats[] = {
+	[ICAP_FORMAT_S8] = {1, 8, ICAP_FORMAT_INT, 0, 0},
+	[ICAP_FORMAT_U8] = {1, 8, ICAP_FORMAT_INT, 0, 0x80},
+	[ICAP_FORMAT_S16_LE] = {2, 16, ICAP_FORMAT_INT, ICAP_SWAP_LE, 0},
+	[ICAP_FORMAT_S16_BE] = {2, 16, ICAP_FORMAT_INT, ICAP_SWAP_BE, 0},
+	[ICAP_FORMAT_U16_LE] = {2, 16, ICAP_FORMAT_INT, ICAP_SWAP_LE, 0x8000},
+	[ICAP_FORMAT_U16_BE] = {2, 16, ICAP_FORMAT_INT, ICAP_SWAP_BE, 0x8000},
+	[ICAP_FORMAT_S24_LE] = {4, 24, ICAP_FORMAT_INT, ICAP_SWAP_LE, 0},
+	[ICAP_FORMAT_S24_BE] = {4, 24, ICAP_FORMAT_INT, ICAP_SWAP_BE, 0},
+	[ICAP_FORMAT_U24_LE] = {4, 24, ICAP_FORMAT_INT, ICAP_SWAP_LE, 0x800000},
+	[ICAP_FORMAT_U24_BE] = {4, 24, ICAP_FORMAT_INT, ICAP_SWAP_BE, 0x800000},
+	[ICAP_FORMAT_S32_LE] = {4, 32, ICAP_FORMAT_INT, ICAP_SWAP_LE, 0},
+	[ICAP_FORMAT_S32_BE] = {4, 32, ICAP_FORMAT_INT, ICAP_SWAP_BE, 0},
+	[ICAP_FORMAT_U32_LE] = {4, 32, ICAP_FORMAT_INT, ICAP_SWAP_LE, 0x80000000},
+	[ICAP_FORMAT_U32_BE] = {4, 32, ICAP_FORMAT_INT, ICAP_SWAP_BE, 0x80000000},
+	[ICAP_FORMAT_FLOAT_LE] = {4, 32, ICAP_FORMAT_FLOAT, ICAP_SWAP_LE, 0},
+	[ICAP_FORMAT_FLOAT_BE] = {4, 32, ICAP_FORMAT_FLOAT, ICAP_SWAP_BE, 0},
+	[ICAP_FORMAT_FLOAT64_LE] = {8, 64, ICAP_FORMAT_DOUBLE, ICAP_SWAP_LE, 0},
+	[ICAP_FORMAT_FLOAT64_BE] = {8, 64, ICAP_FORMAT_DOUBLE, ICAP_SWAP_BE, 0},
+	[ICAP_FORMAT_S24_3LE] = {3, 24, ICAP_FORMAT_INT, ICAP_SWAP_LE, 0},
+	[ICAP_FORMAT_S24_3BE] = {3, 24, ICAP_FORMAT_INT, ICAP_SWAP_BE, 0},
+};
+
+#define ICAP_FORMATS_NUM (sizeof(icap_formats) / sizeof(icap_formats[0]))
+
+/* Intermediate samples, integers are left justified to 32 bits */
+union icap_sample32 {
+	int32_t s;
+	uint32_t u;
+	float f;
+};
+
+union icap_sample64 {
+	uint64_t u;
+	double f;
+};
+
+static
+uint16_t icap_bswap16(uint16_t v)
+{
+	return (uint16_t)((v >> 8) | (v << 8));
+}
+
+static
+uint32_t icap_bswap32(uint32_t v)
+{
+	return (v >> 24) | ((v >> 8) & 0xff00) | ((v << 8) & 0xff0000) | (v << 24);
+}
+
+static
+uint64_t icap_bswap64(uint64_t v)
+{
+	return ((uint64_t)icap_bswap32((uint32_t)v) << 32) | icap_bswap32((uint32_t)(v >> 32));
+}
+
+static
+void icap_format_bswap32(const uint32_t *src, union icap_sample32 *dst, uint32_t n)
+{
+	uint32_t i = 0;
+
+#if defined(__AVX2__)
+	const __m256i mask = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+			3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+	for (; i + 8 <= n; i += 8) {
+		__m256i v = _mm256_loadu_si256((const __m256i *)&src[i]);
+		_mm256_storeu_si256((__m256i *)&dst[i], _mm256_shuffle_epi8(v, mask));
+	}
+#elif defined(__SSSE3__)
+	const __m128i mask = _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+	for (; i + 4 <= n; i += 4) {
+		__m128i v = _mm_loadu_si128((const __m128i *)&src[i]);
+		_mm_storeu_si128((__m128i *)&dst[i], _mm_shuffle_epi8(v, mask));
+	}
+#elif defined(__ARM_NEON)
+	for (; i + 4 <= n; i += 4) {
+		uint8x16_t v = vld1q_u8((const uint8_t *)&src[i]);
+		vst1q_u8((uint8_t *)&dst[i], vrev32q_u8(v));
+	}
+#endif
+	for (; i < n; i++) {
+		dst[i].u = icap_bswap32(src[i]);
+	}
+}
+
+/* Native signed 16 bit samples to left justified 32 bits */
+static
+void icap_format_widen16(const int16_t *src, union icap_sample32 *dst, uint32_t n)
+{
+	uint32_t i = 0;
+
+#if defined(__SSE2__)
+	const __m128i zero = _mm_setzero_si128();
+	for (; i + 8 <= n; i += 8) {
+		__m128i v = _mm_loadu_si128((const __m128i *)&src[i]);
+		_mm_storeu_si128((__m128i *)&dst[i], _mm_unpacklo_epi16(zero, v));
+		_mm_storeu_si128((__m128i *)&dst[i + 4], _mm_unpackhi_epi16(zero, v));
+	}
+#elif defined(__ARM_NEON)
+	for (; i + 8 <= n; i += 8) {
+		int16x8_t v = vld1q_s16(&src[i]);
+		vst1q_s32((int32_t *)&dst[i], vshll_n_s16(vget_low_s16(v), 16));
+		vst1q_s32((int32_t *)&dst[i + 4], vshll_n_s16(vget_high_s16(v), 16));
+	}
+#endif
+	for (; i < n; i++) {
+		dst[i].u = (uint32_t)(uint16_t)src[i] << 16;
+	}
+}
+
+/* Left justified 32 bits to native signed 16 bit samples */
+static
+void icap_format_narrow16(const union icap_sample32 *src, int16_t *dst, uint32_t n)
+{
+	uint32_t i = 0;
+
+#if defined(__SSE2__)
+	for (; i + 8 <= n; i += 8) {
+		__m128i lo = _mm_srai_epi32(_mm_loadu_si128((const __m128i *)&src[i]), 16);
+		__m128i hi = _mm_srai_epi32(_mm_loadu_si128((const __m128i *)&src[i + 4]), 16);
+		_mm_storeu_si128((__m128i *)&dst[i], _mm_packs_epi32(lo, hi));
+	}
+#elif defined(__ARM_NEON)
+	for (; i + 8 <= n; i += 8) {
+		int16x4_t lo = vshrn_n_s32(vld1q_s32((const int32_t *)&src[i]), 16);
+		int16x4_t hi = vshrn_n_s32(vld1q_s32((const int32_t *)&src[i + 4]), 16);
+		vst1q_s16(&dst[i], vcombine_s16(lo, hi));
+	}
+#endif
+	for (; i < n; i++) {
+		dst[i] = (int16_t)(src[i].s >> 16);
+	}
+}
+
+/* Packed 24 bit samples to left justified 32 bits */
+static
+void icap_format_unpack24(const uint8_t *src, union icap_sample32 *dst, uint32_t n,
+		uint32_t big_endian)
+{
+	uint32_t i = 0;
+
+#if defined(__SSSE3__)
+	/* Each load reads 16 bytes and uses 12 of them */
+	const __m128i mask = big_endian ?
+			_mm_setr_epi8(-1, 2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9) :
+			_mm_setr_epi8(-1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11);
+	for (; i + 6 <= n; i += 4) {
+		__m128i v = _mm_loadu_si128((const __m128i *)&src[i * 3]);
+		_mm_storeu_si128((__m128i *)&dst[i], _mm_shuffle_epi8(v, mask));
+	}
+#elif defined(__ARM_NEON) && (ICAP_SWAP_LE == 0)
+	for (; i + 8 <= n; i += 8) {
+		uint8x8x3_t v = vld3_u8(&src[i * 3]);
+		uint8x8_t hi = big_endian ? v.val[0] : v.val[2];
+		uint8x8_t lo = big_endian ? v.val[2] : v.val[0];
+		uint16x8_t low16 = vorrq_u16(vmovl_u8(lo), vshll_n_u8(v.val[1], 8));
+		uint16x8_t high16 = vmovl_u8(hi);
+		vst1q_u32((uint32_t *)&dst[i], vorrq_u32(vshll_n_u16(vget_low_u16(low16), 8),
+				vshlq_n_u32(vshll_n_u16(vget_low_u16(high16), 16), 8)));
+		vst1q_u32((uint32_t *)&dst[i + 4], vorrq_u32(vshll_n_u16(vget_high_u16(low16), 8),
+				vshlq_n_u32(vshll_n_u16(vget_high_u16(high16), 16), 8)));
+	}
+#endif
+	if (big_endian) {
+		for (; i < n; i++) {
+			dst[i].u = ((uint32_t)src[i * 3] << 24) | ((uint32_t)src[i * 3 + 1] << 16) |
+					((uint32_t)src[i * 3 + 2] << 8);
+		}
+	} else {
+		for (; i < n; i++) {
+			dst[i].u = ((uint32_t)src[i * 3] << 8) | ((uint32_t)src[i * 3 + 1] << 16) |
+					((uint32_t)src[i * 3 + 2] << 24);
+		}
+	}
+}
+
+/* Left justified 32 bits to packed 24 bit samples */
+static
+void icap_format_pack24(const union icap_sample32 *src, uint8_t *dst, uint32_t n,
+		uint32_t big_endian)
+{
+	uint32_t i = 0;
+
+#if defined(__SSSE3__)
+	/* Each iteration stores 12 bytes, 8 + 4 to not write past the end */
+	const __m128i mask = big_endian ?
+			_mm_setr_epi8(3, 2, 1, 7, 6, 5, 11, 10, 9, 15, 14, 13, -1, -1, -1, -1) :
+			_mm_setr_epi8(1, 2, 3, 5, 6, 7, 9, 10, 11, 13, 14, 15, -1, -1, -1, -1);
+	for (; i + 4 <= n; i += 4) {
+		__m128i v = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)&src[i]), mask);
+		uint32_t tail = (uint32_t)_mm_cvtsi128_si32(_mm_srli_si128(v, 8));
+		_mm_storel_epi64((__m128i *)&dst[i * 3], v);
+		memcpy(&dst[i * 3 + 8], &tail, sizeof(tail));
+	}
+#elif defined(__ARM_NEON) && (ICAP_SWAP_LE == 0)
+	for (; i + 8 <= n; i += 8) {
+		uint32x4_t a = vld1q_u32((const uint32_t *)&src[i]);
+		uint32x4_t b = vld1q_u32((const uint32_t *)&src[i + 4]);
+		uint8x8x3_t v;
+		uint8x8_t b0 = vmovn_u16(vcombine_u16(vmovn_u32(vshrq_n_u32(a, 8)), vmovn_u32(vshrq_n_u32(b, 8))));
+		uint8x8_t b1 = vmovn_u16(vcombine_u16(vmovn_u32(vshrq_n_u32(a, 16)), vmovn_u32(vshrq_n_u32(b, 16))));
+		uint8x8_t b2 = vmovn_u16(vcombine_u16(vmovn_u32(vshrq_n_u32(a, 24)), vmovn_u32(vshrq_n_u32(b, 24))));
+		v.val[0] = big_endian ? b2 : b0;
+		v.val[1] = b1;
+		v.val[2] = big_endian ? b0 : b2;
+		vst3_u8(&dst[i * 3], v);
+	}
+#endif
+	if (big_endian) {
+		for (; i < n; i++) {
+			dst[i * 3] = (uint8_t)(src[i].u >> 24);
+			dst[i * 3 + 1] = (uint8_t)(src[i].u >> 16);
+			dst[i * 3 + 2] = (uint8_t)(src[i].u >> 8);
+		}
+	} else {
+		for (; i < n; i++) {
+			dst[i * 3] = (uint8_t)(src[i].u >> 8);
+			dst[i * 3 + 1] = (uint8_t)(src[i].u >> 16);
+			dst[i * 3 + 2] = (uint8_t)(src[i].u >> 24);
+		}
+	}
+}
+
+static
+void icap_format_s32_to_float(union icap_sample32 *buf, uint32_t n)
+{
+	uint32_t i = 0;
+
+#if defined(__AVX2__)
+	const __m256 scale = _mm256_set1_ps(1.0f / 2147483648.0f);
+	for (; i + 8 <= n; i += 8) {
+		__m256i v = _mm256_loadu_si256((const __m256i *)&buf[i]);
+		_mm256_storeu_ps((float *)&buf[i], _mm256_mul_ps(_mm256_cvtepi32_ps(v), scale));
+	}
+#elif defined(__SSE2__)
+	const __m128 scale = _mm_set1_ps(1.0f / 2147483648.0f);
+	for (; i + 4 <= n; i += 4) {
+		__m128i v = _mm_loadu_si128((const __m128i *)&buf[i]);
+		_mm_storeu_ps((float *)&buf[i], _mm_mul_ps(_mm_cvtepi32_ps(v), scale));
+	}
+#elif defined(__ARM_NEON)
+	for (; i + 4 <= n; i += 4) {
+		int32x4_t v = vld1q_s32((const int32_t *)&buf[i]);
+		vst1q_f32((float *)&buf[i], vmulq_n_f32(vcvtq_f32_s32(v), 1.0f / 2147483648.0f));
+	}
+#endif
+	for (; i < n; i++) {
+		buf[i].f = (float)buf[i].s * (1.0f / 2147483648.0f);
+	}
+}
+
+/*
+ * Float to integer conversions round to the nearest integer with ties to even,
+ * saturate out of range values and convert NaN to 0 on every code path, so the
+ * result does not depend on the instruction set the library is built for.
+ * The SSE2/AVX2 and aarch64 NEON conversions round to nearest even natively
+ * (default MXCSR rounding mode), ARMv7 NEON only truncates so the value is
+ * rounded with the 2^23 trick first, the scalar code rounds in integer
+ * arithmetic to not depend on the floating point environment.
+ */
+static
+void icap_format_float_to_s32(union icap_sample32 *buf, uint32_t n)
+{
+	float v, d;
+	int32_t r;
+	uint32_t i = 0;
+
+#if defined(__AVX2__)
+	/* Conversion overflow and NaN give 0x80000000, flip overflow to 0x7fffffff
+	 * for positive values and mask NaN to 0 */
+	const __m256 scale = _mm256_set1_ps(2147483648.0f);
+	for (; i + 8 <= n; i += 8) {
+		__m256 f = _mm256_mul_ps(_mm256_loadu_ps((const float *)&buf[i]), scale);
+		__m256i over = _mm256_castps_si256(_mm256_cmp_ps(f, scale, _CMP_GE_OQ));
+		__m256i ord = _mm256_castps_si256(_mm256_cmp_ps(f, f, _CMP_ORD_Q));
+		_mm256_storeu_si256((__m256i *)&buf[i],
+				_mm256_and_si256(_mm256_xor_si256(_mm256_cvtps_epi32(f), over), ord));
+	}
+#elif defined(__SSE2__)
+	const __m128 scale = _mm_set1_ps(2147483648.0f);
+	for (; i + 4 <= n; i += 4) {
+		__m128 f = _mm_mul_ps(_mm_loadu_ps((const float *)&buf[i]), scale);
+		__m128i over = _mm_castps_si128(_mm_cmpge_ps(f, scale));
+		__m128i ord = _mm_castps_si128(_mm_cmpord_ps(f, f));
+		_mm_storeu_si128((__m128i *)&buf[i],
+				_mm_and_si128(_mm_xor_si128(_mm_cvtps_epi32(f), over), ord));
+	}
+#elif defined(__ARM_NEON)
+	/* NEON conversion saturates and converts NaN to 0 */
+#if !defined(__aarch64__)
+	const float32x4_t limit = vdupq_n_f32(8388608.0f);
+	const uint32x4_t sign = vdupq_n_u32(0x80000000);
+#endif
+	for (; i + 4 <= n; i += 4) {
+		float32x4_t f = vmulq_n_f32(vld1q_f32((const float *)&buf[i]), 2147483648.0f);
+#if defined(__aarch64__)
+		vst1q_s32((int32_t *)&buf[i], vcvtnq_s32_f32(f));
+#else
+		/* Adding and subtracting +/-2^23 rounds |f| < 2^23 to nearest even,
+		 * larger values are already integers */
+		float32x4_t magic = vreinterpretq_f32_u32(vorrq_u32(vreinterpretq_u32_f32(limit),
+				vandq_u32(vreinterpretq_u32_f32(f), sign)));
+		uint32x4_t small = vcaltq_f32(f, limit);
+		f = vbslq_f32(small, vsubq_f32(vaddq_f32(f, magic), magic), f);
+		vst1q_s32((int32_t *)&buf[i], vcvtq_s32_f32(f));
+#endif
+	}
+#endif
+	for (; i < n; i++) {
+		v = buf[i].f * 2147483648.0f;
+		if (v != v) {
+			buf[i].s = 0;
+		} else if (v >= 2147483648.0f) {
+			buf[i].s = 0x7fffffff;
+		} else if (!(v > -2147483648.0f)) {
+			buf[i].u = 0x80000000;
+		} else {
+			/* The fraction v - r is exact */
+			r = (int32_t)v;
+			d = v - (float)r;
+			if ((d > 0.5f) || ((d == 0.5f) && (r & 1))) {
+				r++;
+			} else if ((d < -0.5f) || ((d == -0.5f) && (r & 1))) {
+				r--;
+			}
+			buf[i].s = r;
+		}
+	}
+}
+
+static
+void icap_format_s32_to_double(const union icap_sample32 *src, union icap_sample64 *dst, uint32_t n)
+{
+	uint32_t i;
+
+	for (i = 0; i < n; i++) {
+		dst[i].f = (double)src[i].s * (1.0 / 2147483648.0);
+	}
+}
+
+static
+void icap_format_double_to_s32(const union icap_sample64 *src, union icap_sample32 *dst, uint32_t n)
+{
+	double v, d;
+	int32_t r;
+	uint32_t i;
+
+	/* Same rounding as icap_format_float_to_s32() */
+	for (i = 0; i < n; i++) {
+		v = src[i].f * 2147483648.0;
+		if (v != v) {
+			dst[i].s = 0;
+		} else if (v >= 2147483647.0) {
+			dst[i].s = 0x7fffffff;
+		} else if (!(v > -2147483648.0)) {
+			dst[i].u = 0x80000000;
+		} else {
+			r = (int32_t)v;
+			d = v - (double)r;
+			if ((d > 0.5) || ((d == 0.5) && (r & 1))) {
+				r++;
+			} else if ((d < -0.5) || ((d == -0.5) && (r & 1))) {
+				r--;
+			}
+			dst[i].s = r;
+		}
+	}
+}
+
+static
+void icap_format_float_to_double(const union icap_sample32 *src, union icap_sample64 *dst, uint32_t n)
+{
+	uint32_t i;
+
+	for (i = 0; i < n; i++) {
+		dst[i].f = src[i].f;
+	}
+}
+
+static
+void icap_format_double_to_float(const union icap_sample64 *src, union icap_sample32 *dst, uint32_t n)
+{
+	uint32_t i;
+
+	for (i = 0; i < n; i++) {
+		dst[i].f = (float)src[i].f;
+	}
+}
+
+static
+void icap_format_load_int(const struct icap_format_info *info, const void *src,
+		union icap_sample32 *dst, uint32_t n)
+{
+	const uint8_t *src8 = (const uint8_t *)src;
+	const uint16_t *src16 = (const uint16_t *)src;
+	uint32_t shift = 32 - info->bits;
+	uint32_t i;
+
+	switch (info->size) {
+	case 1:
+		for (i = 0; i < n; i++) {
+			dst[i].u = (uint32_t)(src8[i] ^ info->offset) << 24;
+		}
+		break;
+	case 2:
+		if (!info->swap && !info->offset) {
+			icap_format_widen16((const int16_t *)src, dst, n);
+		} else if (!info->swap) {
+			for (i = 0; i < n; i++) {
+				dst[i].u = (uint32_t)(src16[i] ^ info->offset) << 16;
+			}
+		} else {
+			for (i = 0; i < n; i++) {
+				dst[i].u = (uint32_t)(icap_bswap16(src16[i]) ^ info->offset) << 16;
+			}
+		}
+		break;
+	case 3:
+		icap_format_unpack24(src8, dst, n, info->swap == ICAP_SWAP_BE);
+		break;
+	case 4:
+		if (info->swap) {
+			icap_format_bswap32((const uint32_t *)src, dst, n);
+		} else {
+			memcpy(dst, src, n * sizeof(uint32_t));
+		}
+		if (info->offset || shift) {
+			for (i = 0; i < n; i++) {
+				dst[i].u = (dst[i].u ^ info->offset) << shift;
+			}
+		}
+		break;
+	}
+}
+
+/* Modifies the intermediate samples */
+static
+void icap_format_store_int(const struct icap_format_info *info, union icap_sample32 *src,
+		void *dst, uint32_t n)
+{
+	uint8_t *dst8 = (uint8_t *)dst;
+	uint16_t *dst16 = (uint16_t *)dst;
+	uint32_t shift = 32 - info->bits;
+	uint32_t i;
+
+	switch (info->size) {
+	case 1:
+		for (i = 0; i < n; i++) {
+			dst8[i] = (uint8_t)((src[i].u >> 24) ^ info->offset);
+		}
+		break;
+	case 2:
+		if (!info->swap && !info->offset) {
+			icap_format_narrow16(src, (int16_t *)dst, n);
+		} else if (!info->swap) {
+			for (i = 0; i < n; i++) {
+				dst16[i] = (uint16_t)((src[i].u >> 16) ^ info->offset);
+			}
+		} else {
+			for (i = 0; i < n; i++) {
+				dst16[i] = icap_bswap16((uint16_t)((src[i].u >> 16) ^ info->offset));
+			}
+		}
+		break;
+	case 3:
+		icap_format_pack24(src, dst8, n, info->swap == ICAP_SWAP_BE);
+		break;
+	case 4:
+		/* Signed samples narrower than the container are sign extended */
+		if (info->offset) {
+			for (i = 0; i < n; i++) {
+				src[i].u = (src[i].u >> shift) ^ info->offset;
+			}
+		} else if (shift) {
+			for (i = 0; i < n; i++) {
+				src[i].s = src[i].s >> shift;
+			}
+		}
+		if (info->swap) {
+			icap_format_bswap32(&src[0].u, (union icap_sample32 *)dst, n);
+		} else {
+			memcpy(dst, src, n * sizeof(uint32_t));
+		}
+		break;
+	}
+}
+
+static
+void icap_format_load(const struct icap_format_info *info, const void *src,
+		union icap_sample32 *tmp32, union icap_sample64 *tmp64, uint32_t n)
+{
+	const uint64_t *src64 = (const uint64_t *)src;
+	uint32_t i;
+
+	switch (info->kind) {
+	case ICAP_FORMAT_INT:
+		icap_format_load_int(info, src, tmp32, n);
+		break;
+	case ICAP_FORMAT_FLOAT:
+		if (info->swap) {
+			icap_format_bswap32((const uint32_t *)src, tmp32, n);
+		} else {
+			memcpy(tmp32, src, n * sizeof(uint32_t));
+		}
+		break;
+	case ICAP_FORMAT_DOUBLE:
+		if (info->swap) {
+			for (i = 0; i < n; i++) {
+				tmp64[i].u = icap_bswap64(src64[i]);
+			}
+		} else {
+			memcpy(tmp64, src, n * sizeof(uint64_t));
+		}
+		break;
+	}
+}
+
+static
+void icap_format_store(const struct icap_format_info *info, union icap_sample32 *tmp32,
+		union icap_sample64 *tmp64, void *dst, uint32_t n)
+{
+	uint64_t *dst64 = (uint64_t *)dst;
+	uint32_t i;
+
+	switch (info->kind) {
+	case ICAP_FORMAT_INT:
+		icap_format_store_int(info, tmp32, dst, n);
+		break;
+	case ICAP_FORMAT_FLOAT:
+		if (info->swap) {
+			icap_format_bswap32(&tmp32[0].u, (union icap_sample32 *)dst, n);
+		} else {
+			memcpy(dst, tmp32, n * sizeof(uint32_t));
+		}
+		break;
+	case ICAP_FORMAT_DOUBLE:
+		if (info->swap) {
+			for (i = 0; i < n; i++) {
+				dst64[i] = icap_bswap64(tmp64[i].u);
+			}
+		} else {
+			memcpy(dst, tmp64, n * sizeof(uint64_t));
+		}
+		break;
+	}
+}
+
+/* Converts the intermediate samples from the source to the destination kind */
+static
+void icap_format_kind(uint32_t dst_kind, uint32_t src_kind,
+		union icap_sample32 *tmp32, union icap_sample64 *tmp64, uint32_t n)
+{
+	if (dst_kind == src_kind) {
+		return;
+	}
+
+	switch (src_kind) {
+	case ICAP_FORMAT_INT:
+		if (dst_kind == ICAP_FORMAT_FLOAT) {
+			icap_format_s32_to_float(tmp32, n);
+		} else {
+			icap_format_s32_to_double(tmp32, tmp64, n);
+		}
+		break;
+	case ICAP_FORMAT_FLOAT:
+		if (dst_kind == ICAP_FORMAT_INT) {
+			icap_format_float_to_s32(tmp32, n);
+		} else {
+			icap_format_float_to_double(tmp32, tmp64, n);
+		}
+		break;
+	case ICAP_FORMAT_DOUBLE:
+		if (dst_kind == ICAP_FORMAT_INT) {
+			icap_format_double_to_s32(tmp64, tmp32, n);
+		} else {
+			icap_format_double_to_float(tmp64, tmp32, n);
+		}
+		break;
+	}
+}
+
+uint32_t icap_format_size(uint32_t format)
+{
+	if (format >= ICAP_FORMATS_NUM) {
+		return 0;
+	}
+	return icap_formats[format].size;
+}
+
+int32_t icap_format_select(uint32_t formats, uint32_t format)
+{
+	const struct icap_format_info *want;
+	const struct icap_format_info *info;
+	int32_t best = -ICAP_ERROR_NOT_SUP;
+	uint32_t best_score = 0;
+	uint32_t score;
+	uint32_t i;
+
+	if (format >= ICAP_FORMATS_NUM) {
+		return -ICAP_ERROR_INVALID;
+	}
+	if (formats & (1u << format)) {
+		return format;
+	}
+
+	want = &icap_formats[format];
+	for (i = 0; i < ICAP_FORMATS_NUM; i++) {
+		if (!(formats & (1u << i))) {
+			continue;
+		}
+		info = &icap_formats[i];
+		/* Same kind first, then resolution, then signedness and byte order */
+		score = ((info->kind == want->kind) ? 1024 : 0) + info->bits * 4 +
+				((info->offset == 0) == (want->offset == 0) ? 2 : 0) +
+				((info->swap == want->swap) ? 1 : 0);
+		if (score > best_score) {
+			best_score = score;
+			best = i;
+		}
+	}
+	return best;
+}
+
+int32_t icap_format_convert(void *dst, uint32_t dst_format, const void *src,
+		uint32_t src_format, uint32_t samples)
+{
+	const struct icap_format_info *dst_info;
+	const struct icap_format_info *src_info;
+	union icap_sample32 tmp32[ICAP_FORMAT_BLOCK];
+	union icap_sample64 tmp64[ICAP_FORMAT_BLOCK];
+	uint32_t backward;
+	uint32_t offset;
+	uint32_t n;
+
+	if ((dst == NULL) || (src == NULL) || (dst_format >= ICAP_FORMATS_NUM) ||
+			(src_format >= ICAP_FORMATS_NUM)) {
+		return -ICAP_ERROR_INVALID;
+	}
+	dst_info = &icap_formats[dst_format];
+	src_info = &icap_formats[src_format];
+
+	if (dst_format == src_format) {
+		if (dst != src) {
+			memcpy(dst, src, samples * src_info->size);
+		}
+		return 0;
+	}
+
+	/* In place widening goes from the end so the source isn't overwritten before it's read */
+	backward = (dst == src) && (dst_info->size > src_info->size);
+
+	for (offset = 0; offset < samples; offset += n) {
+		n = samples - offset;
+		if (n > ICAP_FORMAT_BLOCK) {
+			n = ICAP_FORMAT_BLOCK;
+		}
+
+		if (backward) {
+			icap_format_load(src_info, (const uint8_t *)src + (samples - offset - n) * src_info->size,
+					tmp32, tmp64, n);
+			icap_format_kind(dst_info->kind, src_info->kind, tmp32, tmp64, n);
+			icap_format_store(dst_info, tmp32, tmp64,
+					(uint8_t *)dst + (samples - offset - n) * dst_info->size, n);
+		} else {
+			icap_format_load(src_info, (const uint8_t *)src + offset * src_info->size,
+					tmp32, tmp64, n);
+			icap_format_kind(dst_info->kind, src_info->kind, tmp32, tmp64, n);
+			icap_format_store(dst_info, tmp32, tmp64,
+					(uint8_t *)dst + offset * dst_info->size, n);
+		}
+	}
+	return 0;
+}
+
+/* Stereo interleaving of 16 and 32 bit samples, returns number of frames done */
+static
+uint32_t icap_format_interleave2(void *dst, const void *left, const void *right,
+		uint32_t frames, uint32_t size)
+{
+	uint32_t i = 0;
+
+#if defined(__SSE2__)
+	if (size == 2) {
+		for (; i + 8 <= frames; i += 8) {
+			__m128i l = _mm_loadu_si128((const __m128i *)((const int16_t *)left + i));
+			__m128i r = _mm_loadu_si128((const __m128i *)((const int16_t *)right + i));
+			_mm_storeu_si128((__m128i *)((int16_t *)dst + 2 * i), _mm_unpacklo_epi16(l, r));
+			_mm_storeu_si128((__m128i *)((int16_t *)dst + 2 * i + 8), _mm_unpackhi_epi16(l, r));
+		}
+	} else if (size == 4) {
+		for (; i + 4 <= frames; i += 4) {
+			__m128i l = _mm_loadu_si128((const __m128i *)((const int32_t *)left + i));
+			__m128i r = _mm_loadu_si128((const __m128i *)((const int32_t *)right + i));
+			_mm_storeu_si128((__m128i *)((int32_t *)dst + 2 * i), _mm_unpacklo_epi32(l, r));
+			_mm_storeu_si128((__m128i *)((int32_t *)dst + 2 * i + 4), _mm_unpackhi_epi32(l, r));
+		}
+	}
+#elif defined(__ARM_NEON)
+	if (size == 2) {
+		for (; i + 8 <= frames; i += 8) {
+			int16x8x2_t v;
+			v.val[0] = vld1q_s16((const int16_t *)left + i);
+			v.val[1] = vld1q_s16((const int16_t *)right + i);
+			vst2q_s16((int16_t *)dst + 2 * i, v);
+		}
+	} else if (size == 4) {
+		for (; i + 4 <= frames; i += 4) {
+			int32x4x2_t v;
+			v.val[0] = vld1q_s32((const int32_t *)left + i);
+			v.val[1] = vld1q_s32((const int32_t *)right + i);
+			vst2q_s32((int32_t *)dst + 2 * i, v);
+		}
+	}
+#endif
+	return i;
+}
+
+/* Stereo deinterleaving of 16 and 32 bit samples, returns number of frames done */
+static
+uint32_t icap_format_deinterleave2(void *left, void *right, const void *src,
+		uint32_t frames, uint32_t size)
+{
+	uint32_t i = 0;
+
+#if defined(__SSE2__)
+	if (size == 2) {
+		for (; i + 8 <= frames; i += 8) {
+			__m128i a = _mm_loadu_si128((const __m128i *)((const int16_t *)src + 2 * i));
+			__m128i b = _mm_loadu_si128((const __m128i *)((const int16_t *)src + 2 * i + 8));
+			/* Sign extend the even samples and shift down the odd ones, then pack */
+			__m128i la = _mm_srai_epi32(_mm_slli_epi32(a, 16), 16);
+			__m128i lb = _mm_srai_epi32(_mm_slli_epi32(b, 16), 16);
+			__m128i ra = _mm_srai_epi32(a, 16);
+			__m128i rb = _mm_srai_epi32(b, 16);
+			_mm_storeu_si128((__m128i *)((int16_t *)left + i), _mm_packs_epi32(la, lb));
+			_mm_storeu_si128((__m128i *)((int16_t *)right + i), _mm_packs_epi32(ra, rb));
+		}
+	} else if (size == 4) {
+		for (; i + 4 <= frames; i += 4) {
+			__m128 a = _mm_loadu_ps((const float *)((const int32_t *)src + 2 * i));
+			__m128 b = _mm_loadu_ps((const float *)((const int32_t *)src + 2 * i + 4));
+			_mm_storeu_ps((float *)((int32_t *)left + i), _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+			_mm_storeu_ps((float *)((int32_t *)right + i), _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+		}
+	}
+#elif defined(__ARM_NEON)
+	if (size == 2) {
+		for (; i + 8 <= frames; i += 8) {
+			int16x8x2_t v = vld2q_s16((const int16_t *)src + 2 * i);
+			vst1q_s16((int16_t *)left + i, v.val[0]);
+			vst1q_s16((int16_t *)right + i, v.val[1]);
+		}
+	} else if (size == 4) {
+		for (; i + 4 <= frames; i += 4) {
+			int32x4x2_t v = vld2q_s32((const int32_t *)src + 2 * i);
+			vst1q_s32((int32_t *)left + i, v.val[0]);
+			vst1q_s32((int32_t *)right + i, v.val[1]);
+		}
+	}
+#endif
+	return i;
+}
+
+/* Copies samples of one channel between planar and interleaved layout */
+static
+void icap_format_copy_strided(uint8_t *dst, uint32_t dst_step, const uint8_t *src,
+		uint32_t src_step, uint32_t frames, uint32_t size)
+{
+	uint32_t i;
+
+	switch (size) {
+	case 1:
+		for (i = 0; i < frames; i++) {
+			dst[i * dst_step] = src[i * src_step];
+		}
+		break;
+	case 2:
+		for (i = 0; i < frames; i++) {
+			*(uint16_t *)(dst + i * dst_step) = *(const uint16_t *)(src + i * src_step);
+		}
+		break;
+	case 4:
+		for (i = 0; i < frames; i++) {
+			*(uint32_t *)(dst + i * dst_step) = *(const uint32_t *)(src + i * src_step);
+		}
+		break;
+	default:
+		for (i = 0; i < frames; i++) {
+			memcpy(dst + i * dst_step, src + i * src_step, size);
+		}
+		break;
+	}
+}
+
+int32_t icap_format_interleave(void *dst, const void *src, uint32_t channel_stride,
+		uint32_t channels, uint32_t frames, uint32_t format)
+{
+	const uint8_t *plane = (const uint8_t *)src;
+	uint32_t size = icap_format_size(format);
+	uint32_t done = 0;
+	uint32_t ch;
+
+	if ((dst == NULL) || (src == NULL) || (size == 0) || (channels == 0)) {
+		return -ICAP_ERROR_INVALID;
+	}
+
+	if (channels == 2) {
+		done = icap_format_interleave2(dst, plane, plane + channel_stride, frames, size);
+	}
+
+	for (ch = 0; ch < channels; ch++) {
+		icap_format_copy_strided((uint8_t *)dst + (done * channels + ch) * size, channels * size,
+				plane + ch * channel_stride + done * size, size, frames - done, size);
+	}
+	return 0;
+}
+
+int32_t icap_format_deinterleave(void *dst, uint32_t channel_stride, const void *src,
+		uint32_t channels, uint32_t frames, uint32_t format)
+{
+	uint8_t *plane = (uint8_t *)dst;
+	uint32_t size = icap_format_size(format);
+	uint32_t done = 0;
+	uint32_t ch;
+
+	if ((dst == NULL) || (src == NULL) || (size == 0) || (channels == 0)) {
+		return -ICAP_ERROR_INVALID;
+	}
+
+	if (channels == 2) {
+		done = icap_format_deinterleave2(plane, plane + channel_stride, src, frames, size);
+	}
+
+	for (ch = 0; ch < channels; ch++) {
+		icap_format_copy_strided(plane + ch * channel_stride + done * size, size,
+				(const uint8_t *)src + (done * channels + ch) * size, channels * size,
+				frames - done, size);
+	}
+	return 0;
+}
@@ -0,0 +1,203 @@
+// SPDX-License-Identifier: (GPL-2.0-or-later OR Apache-2.0)
+
+/*
+ *  Copyright 2021-2022 Analog Devices Inc.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+/*
+ * Copyright (C) 2021-2022 Analog Devices Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301,USA.
+ */
+
+/*
+ * Authors:
+ *   Piotr Wojtaszczyk <piotr.wojtaszczyk@timesys.com>
+ */
+
+/**
+ * @file icap_frag.c
+ * @author Piotr Wojtaszczyk <piotr.wojtaszczyk@timesys.com>
+ * @brief Fragment cursor, see icap_frag.h.
+ *
+ * @copyright Copyright 2021-2022 Analog Devices Inc.
+ */
+
+#include "../include/icap_frag.h"
+
+#define ICAP_FRAG_QUEUE_MASK (ICAP_FRAG_QUEUE_SIZE - 1)
+
+static
+uint32_t icap_frag_is_pow2(uint32_t val)
+{
+	return val && !(val & (val - 1));
+}
+
+int32_t icap_frag_init(struct icap_frag_cursor *cur, const struct icap_buf_descriptor *buf)
+{
+	uint32_t stride;
+
+	if ((cur == NULL) || (buf == NULL) || (buf->frag_size == 0)) {
+		return -ICAP_ERROR_INVALID;
+	}
+	if (buf->type > ICAP_BUF_PLANAR) {
+		return -ICAP_ERROR_NOT_SUP;
+	}
+
+	memset(cur, 0, sizeof(struct icap_frag_cursor));
+	cur->type = buf->type;
+	cur->frag_size = buf->frag_size;
+	if (buf->type == ICAP_BUF_SCATTERED) {
+		return 0;
+	}
+
+	stride = buf->frag_size + buf->gap_size;
+	cur->stride = stride;
+	if (buf->type == ICAP_BUF_PLANAR) {
+		cur->channel_stride = buf->channel_stride;
+	}
+
+	/* The gap after the last fragment is optional */
+	cur->frags = (buf->buf_size + buf->gap_size) / stride;
+	/* Planes of buf_size bytes must not overlap */
+	if ((cur->frags == 0) || ((buf->type == ICAP_BUF_PLANAR) && (buf->channels > 1) &&
+			(buf->channel_stride < buf->buf_size))) {
+		return -ICAP_ERROR_INVALID;
+	}
+
+	if (icap_frag_is_pow2(cur->frags) && icap_frag_is_pow2(stride)) {
+		cur->mask = cur->frags - 1;
+		while ((1u << cur->shift) < stride) {
+			cur->shift++;
+		}
+	}
+	return 0;
+}
+
+int32_t icap_frag_push_offsets(struct icap_frag_cursor *cur, const struct icap_buf_offsets *offsets)
+{
+	uint32_t i;
+
+	if ((cur->type != ICAP_BUF_SCATTERED) || (offsets == NULL) ||
+			(offsets->num > ICAP_BUF_MAX_FRAGS_OFFSETS_NUM)) {
+		return -ICAP_ERROR_INVALID;
+	}
+	if (cur->tail - cur->head + offsets->num > ICAP_FRAG_QUEUE_SIZE) {
+		return -ICAP_ERROR_NOMEM;
+	}
+
+	for (i = 0; i < offsets->num; i++) {
+		cur->queue[(cur->tail + i) & ICAP_FRAG_QUEUE_MASK] = offsets->frags_offsets[i];
+	}
+	cur->tail += offsets->num;
+	cur->offset = cur->queue[cur->head & ICAP_FRAG_QUEUE_MASK];
+	return 0;
+}
+
+uint32_t icap_frag_available(const struct icap_frag_cursor *cur)
+{
+	if (cur->type != ICAP_BUF_SCATTERED) {
+		return 0xffffffff;
+	}
+	return cur->tail - cur->head;
+}
+
+uint32_t icap_frag_offset(const struct icap_frag_cursor *cur, uint32_t channel)
+{
+	return cur->offset + channel * cur->channel_stride;
+}
+
+int32_t icap_frag_advance(struct icap_frag_cursor *cur, uint32_t frags)
+{
+	uint32_t index;
+
+	if (cur->type == ICAP_BUF_SCATTERED) {
+		if (cur->tail - cur->head < frags) {
+			return -ICAP_ERROR_NO_BUFS;
+		}
+		cur->head += frags;
+		/* An empty queue gets the offset with the next icap_frag_push_offsets() */
+		cur->offset = cur->queue[cur->head & ICAP_FRAG_QUEUE_MASK];
+		cur->pos += frags;
+		return 0;
+	}
+
+	if (cur->mask) {
+		index = (cur->index + frags) & cur->mask;
+		cur->offset = index << cur->shift;
+	} else if (frags == 1) {
+		index = cur->index + 1;
+		cur->offset += cur->stride;
+		if (index == cur->frags) {
+			index = 0;
+			cur->offset = 0;
+		}
+	} else {
+		/* Moving by more than the whole buffer is rare, divide only then */
+		index = frags < cur->frags ? frags : frags % cur->frags;
+		index += cur->index;
+		if (index >= cur->frags) {
+			index -= cur->frags;
+		}
+		cur->offset = index * cur->stride;
+	}
+	cur->index = index;
+	cur->pos += frags;
+	return 0;
+}
+
+/* Remainder of 64 bit division by shifts, the linux kernel lacks 64 bit division on 32 bit targets */
+static
+uint32_t icap_frag_mod64(uint64_t val, uint32_t div)
+{
+	uint64_t rem = 0;
+	int32_t bit;
+
+	for (bit = 63; bit >= 0; bit--) {
+		rem = (rem << 1) | ((val >> bit) & 1);
+		if (rem >= div) {
+			rem -= div;
+		}
+	}
+	return (uint32_t)rem;
+}
+
+int32_t icap_frag_seek(struct icap_frag_cursor *cur, uint64_t frag)
+{
+	if (cur->type == ICAP_BUF_SCATTERED) {
+		return -ICAP_ERROR_NOT_SUP;
+	}
+
+	if (cur->mask) {
+		cur->index = (uint32_t)frag & cur->mask;
+	} else {
+		cur->index = icap_frag_mod64(frag, cur->frags);
+	}
+	cur->offset = cur->index * cur->stride;
+	cur->pos = frag;
+	return 0;
+}
@@ -0,0 +1,385 @@
+// SPDX-License-Identifier: (GPL-2.0-or-later OR Apache-2.0)
+
+/*
+ *  Copyright 2021-2022 Analog Devices Inc.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+/*
+ * Copyright (C) 2021-2022 Analog Devices Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301,USA.
+ */
+
+/*
+ * Authors:
+ *   Piotr Wojtaszczyk <piotr.wojtaszczyk@timesys.com>
+ */
+
+/**
+ * @file icap_mixer.c
+ * @author Piotr Wojtaszczyk <piotr.wojtaszczyk@timesys.com>
+ * @brief Mixer of source buffers, see icap_mixer.h.
+ *
+ * @copyright Copyright 2021-2022 Analog Devices Inc.
+ */
+
+#include "../include/icap_mixer.h"
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+/* Samples mixed at once through the accumulator on the stack */
+#define ICAP_MIXER_BLOCK (128)
+
+/* Native byte order formats */
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+#define ICAP_MIXER_S16 ICAP_FORMAT_S16_BE
+#define ICAP_MIXER_S32 ICAP_FORMAT_S32_BE
+#define ICAP_MIXER_FLOAT ICAP_FORMAT_FLOAT_BE
+#else
+#define ICAP_MIXER_S16 ICAP_FORMAT_S16_LE
+#define ICAP_MIXER_S32 ICAP_FORMAT_S32_LE
+#define ICAP_MIXER_FLOAT ICAP_FORMAT_FLOAT_LE
+#endif
+
+/* 16 bit samples use Q4.12 gains so the products fit 32 bits */
+#define ICAP_MIXER_S16_GAIN_SHIFT (12)
+
+union icap_mixer_acc {
+	int32_t s32[ICAP_MIXER_BLOCK];
+	int64_t s64[ICAP_MIXER_BLOCK];
+	float f[ICAP_MIXER_BLOCK];
+};
+
+int32_t icap_mixer_init(struct icap_mixer *mixer, uint32_t format, uint32_t channels)
+{
+	if ((mixer == NULL) || (channels == 0)) {
+		return -ICAP_ERROR_INVALID;
+	}
+	if ((format != ICAP_MIXER_S16) && (format != ICAP_MIXER_S32) && (format != ICAP_MIXER_FLOAT)) {
+		return -ICAP_ERROR_NOT_SUP;
+	}
+	memset(mixer, 0, sizeof(struct icap_mixer));
+	mixer->format = format;
+	mixer->channels = channels;
+	return 0;
+}
+
+static
+struct icap_mixer_input *icap_mixer_find(struct icap_mixer *mixer, uint32_t buf_id)
+{
+	uint32_t i;
+
+	for (i = 0; i < ICAP_MIXER_INPUTS; i++) {
+		if (mixer->inputs[i].used && (mixer->inputs[i].buf_id == buf_id)) {
+			return &mixer->inputs[i];
+		}
+	}
+	return NULL;
+}
+
+int32_t icap_mixer_add_input(struct icap_mixer *mixer, uint32_t buf_id, uint32_t gain)
+{
+	struct icap_mixer_input *input;
+	uint32_t i;
+
+	if (gain > ICAP_MIXER_GAIN_MAX) {
+		return -ICAP_ERROR_INVALID;
+	}
+	if (icap_mixer_find(mixer, buf_id)) {
+		return -ICAP_ERROR_BUSY;
+	}
+
+	for (i = 0; i < ICAP_MIXER_INPUTS; i++) {
+		input = &mixer->inputs[i];
+		if (!input->used) {
+			input->buf_id = buf_id;
+			input->paused = 0;
+			input->gain = gain;
+			input->used = 1;
+			return i;
+		}
+	}
+	return -ICAP_ERROR_NOMEM;
+}
+
+int32_t icap_mixer_remove_input(struct icap_mixer *mixer, uint32_t buf_id)
+{
+	struct icap_mixer_input *input = icap_mixer_find(mixer, buf_id);
+
+	if (input == NULL) {
+		return -ICAP_ERROR_INVALID;
+	}
+	input->used = 0;
+	return 0;
+}
+
+int32_t icap_mixer_set_gain(struct icap_mixer *mixer, uint32_t buf_id, uint32_t gain)
+{
+	struct icap_mixer_input *input = icap_mixer_find(mixer, buf_id);
+
+	if ((input == NULL) || (gain > ICAP_MIXER_GAIN_MAX)) {
+		return -ICAP_ERROR_INVALID;
+	}
+	input->gain = gain;
+	return 0;
+}
+
+int32_t icap_mixer_pause_input(struct icap_mixer *mixer, uint32_t buf_id, uint32_t paused)
+{
+	struct icap_mixer_input *input = icap_mixer_find(mixer, buf_id);
+
+	if (input == NULL) {
+		return -ICAP_ERROR_INVALID;
+	}
+	input->paused = paused ? 1 : 0;
+	return 0;
+}
+
+static
+void icap_mixer_acc_s16(int32_t *acc, const int16_t *src, int16_t gain, uint32_t n)
+{
+	uint32_t i = 0;
+
+#if defined(__SSE2__)
+	const __m128i g = _mm_set1_epi16(gain);
+	for (; i + 8 <= n; i += 8) {
+		__m128i x = _mm_loadu_si128((const __m128i *)&src[i]);
+		__m128i lo = _mm_mullo_epi16(x, g);
+		__m128i hi = _mm_mulhi_epi16(x, g);
+		__m128i p0 = _mm_srai_epi32(_mm_unpacklo_epi16(lo, hi), ICAP_MIXER_S16_GAIN_SHIFT);
+		__m128i p1 = _mm_srai_epi32(_mm_unpackhi_epi16(lo, hi), ICAP_MIXER_S16_GAIN_SHIFT);
+		_mm_storeu_si128((__m128i *)&acc[i],
+				_mm_add_epi32(_mm_loadu_si128((const __m128i *)&acc[i]), p0));
+		_mm_storeu_si128((__m128i *)&acc[i + 4],
+				_mm_add_epi32(_mm_loadu_si128((const __m128i *)&acc[i + 4]), p1));
+	}
+#elif defined(__ARM_NEON)
+	for (; i + 8 <= n; i += 8) {
+		int16x8_t x = vld1q_s16(&src[i]);
+		int32x4_t p0 = vshrq_n_s32(vmull_n_s16(vget_low_s16(x), gain), ICAP_MIXER_S16_GAIN_SHIFT);
+		int32x4_t p1 = vshrq_n_s32(vmull_n_s16(vget_high_s16(x), gain), ICAP_MIXER_S16_GAIN_SHIFT);
+		vst1q_s32(&acc[i], vaddq_s32(vld1q_s32(&acc[i]), p0));
+		vst1q_s32(&acc[i + 4], vaddq_s32(vld1q_s32(&acc[i + 4]), p1));
+	}
+#endif
+	for (; i < n; i++) {
+		acc[i] += ((int32_t)src[i] * gain) >> ICAP_MIXER_S16_GAIN_SHIFT;
+	}
+}
+
+static
+void icap_mixer_store_s16(int16_t *dst, const int32_t *acc, uint32_t n)
+{
+	uint32_t i = 0;
+
+#if defined(__SSE2__)
+	for (; i + 8 <= n; i += 8) {
+		__m128i a = _mm_loadu_si128((const __m128i *)&acc[i]);
+		__m128i b = _mm_loadu_si128((const __m128i *)&acc[i + 4]);
+		_mm_storeu_si128((__m128i *)&dst[i], _mm_packs_epi32(a, b));
+	}
+#elif defined(__ARM_NEON)
+	for (; i + 8 <= n; i += 8) {
+		vst1q_s16(&dst[i], vcombine_s16(vqmovn_s32(vld1q_s32(&acc[i])),
+				vqmovn_s32(vld1q_s32(&acc[i + 4]))));
+	}
+#endif
+	for (; i < n; i++) {
+		if (acc[i] > 32767) {
+			dst[i] = 32767;
+		} else if (acc[i] < -32768) {
+			dst[i] = -32768;
+		} else {
+			dst[i] = (int16_t)acc[i];
+		}
+	}
+}
+
+static
+void icap_mixer_acc_s32(int64_t *acc, const int32_t *src, uint32_t gain, uint32_t n)
+{
+	uint32_t i;
+
+	for (i = 0; i < n; i++) {
+		acc[i] += ((int64_t)src[i] * gain) >> 16;
+	}
+}
+
+static
+void icap_mixer_store_s32(int32_t *dst, const int64_t *acc, uint32_t n)
+{
+	uint32_t i;
+
+	for (i = 0; i < n; i++) {
+		if (acc[i] > 0x7fffffff) {
+			dst[i] = 0x7fffffff;
+		} else if (acc[i] < -(int64_t)0x80000000) {
+			dst[i] = (int32_t)0x80000000;
+		} else {
+			dst[i] = (int32_t)acc[i];
+		}
+	}
+}
+
+static
+void icap_mixer_acc_float(float *acc, const float *src, float gain, uint32_t n)
+{
+	uint32_t i = 0;
+
+#if defined(__SSE2__)
+	const __m128 g = _mm_set1_ps(gain);
+	for (; i + 4 <= n; i += 4) {
+		_mm_storeu_ps(&acc[i], _mm_add_ps(_mm_loadu_ps(&acc[i]),
+				_mm_mul_ps(_mm_loadu_ps(&src[i]), g)));
+	}
+#elif defined(__ARM_NEON)
+	for (; i + 4 <= n; i += 4) {
+		vst1q_f32(&acc[i], vmlaq_n_f32(vld1q_f32(&acc[i]), vld1q_f32(&src[i]), gain));
+	}
+#endif
+	for (; i < n; i++) {
+		acc[i] += src[i] * gain;
+	}
+}
+
+int32_t icap_mixer_mix(struct icap_mixer *mixer, void *out,
+		const void *const src[ICAP_MIXER_INPUTS], uint32_t frames)
+{
+	uint32_t active[ICAP_MIXER_INPUTS];
+	union icap_mixer_acc acc;
+	struct icap_mixer_input *input;
+	uint32_t samples;
+	uint32_t offset;
+	uint32_t num = 0;
+	uint32_t n;
+	uint32_t i;
+
+	if ((mixer == NULL) || (out == NULL) || (src == NULL)) {
+		return -ICAP_ERROR_INVALID;
+	}
+
+	for (i = 0; i < ICAP_MIXER_INPUTS; i++) {
+		input = &mixer->inputs[i];
+		if (input->used && !input->paused && input->gain && src[i]) {
+			active[num++] = i;
+		}
+	}
+
+	samples = frames * mixer->channels;
+	for (offset = 0; offset < samples; offset += n) {
+		n = samples - offset;
+		if (n > ICAP_MIXER_BLOCK) {
+			n = ICAP_MIXER_BLOCK;
+		}
+
+		if (mixer->format == ICAP_MIXER_S16) {
+			memset(acc.s32, 0, n * sizeof(int32_t));
+			for (i = 0; i < num; i++) {
+				icap_mixer_acc_s16(acc.s32, (const int16_t *)src[active[i]] + offset,
+						(int16_t)(mixer->inputs[active[i]].gain >> (16 - ICAP_MIXER_S16_GAIN_SHIFT)), n);
+			}
+			icap_mixer_store_s16((int16_t *)out + offset, acc.s32, n);
+		} else if (mixer->format == ICAP_MIXER_S32) {
+			memset(acc.s64, 0, n * sizeof(int64_t));
+			for (i = 0; i < num; i++) {
+				icap_mixer_acc_s32(acc.s64, (const int32_t *)src[active[i]] + offset,
+						mixer->inputs[active[i]].gain, n);
+			}
+			icap_mixer_store_s32((int32_t *)out + offset, acc.s64, n);
+		} else {
+			memset(acc.f, 0, n * sizeof(float));
+			for (i = 0; i < num; i++) {
+				icap_mixer_acc_float(acc.f, (const float *)src[active[i]] + offset,
+						mixer->inputs[active[i]].gain * (1.0f / ICAP_MIXER_GAIN_UNITY), n);
+			}
+			memcpy((float *)out + offset, acc.f, n * sizeof(float));
+		}
+	}
+	return num;
+}
+
+int32_t icap_mixer_monitor(struct icap_mixer *mixer, void *out, const void *in,
+		uint32_t in_channels, const struct icap_monitor_route *route, uint32_t frames)
+{
+	uint32_t channels;
+	uint32_t src;
+	uint32_t c;
+	uint32_t i;
+	int64_t v;
+
+	if ((mixer == NULL) || (out == NULL) || (in == NULL) || (route == NULL) ||
+			(route->channels > ICAP_MONITOR_CHANNELS_MAX) ||
+			(route->gain > ICAP_MIXER_GAIN_MAX)) {
+		return -ICAP_ERROR_INVALID;
+	}
+	if (!route->enable || (route->gain == 0)) {
+		return 0;
+	}
+
+	channels = route->channels < mixer->channels ? route->channels : mixer->channels;
+	for (c = 0; c < channels; c++) {
+		src = route->channel_map[c];
+		if ((src != ICAP_MONITOR_CHANNEL_NONE) && (src >= in_channels)) {
+			return -ICAP_ERROR_INVALID;
+		}
+	}
+
+	for (c = 0; c < channels; c++) {
+		src = route->channel_map[c];
+		if (src == ICAP_MONITOR_CHANNEL_NONE) {
+			continue;
+		}
+
+		if (mixer->format == ICAP_MIXER_S16) {
+			const int16_t *x = (const int16_t *)in + src;
+			int16_t *y = (int16_t *)out + c;
+			for (i = 0; i < frames; i++, x += in_channels, y += mixer->channels) {
+				v = *y + ((*x * (int32_t)(route->gain >> (16 - ICAP_MIXER_S16_GAIN_SHIFT))) >> ICAP_MIXER_S16_GAIN_SHIFT);
+				*y = v > 32767 ? 32767 : (v < -32768 ? -32768 : (int16_t)v);
+			}
+		} else if (mixer->format == ICAP_MIXER_S32) {
+			const int32_t *x = (const int32_t *)in + src;
+			int32_t *y = (int32_t *)out + c;
+			for (i = 0; i < frames; i++, x += in_channels, y += mixer->channels) {
+				v = *y + (((int64_t)*x * route->gain) >> 16);
+				*y = v > 0x7fffffff ? 0x7fffffff : (v < -(int64_t)0x80000000 ? (int32_t)0x80000000 : (int32_t)v);
+			}
+		} else {
+			const float *x = (const float *)in + src;
+			float *y = (float *)out + c;
+			const float g = route->gain * (1.0f / ICAP_MIXER_GAIN_UNITY);
+			for (i = 0; i < frames; i++, x += in_channels, y += mixer->channels) {
+				*y += *x * g;
+			}
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,179 @@
+// SPDX-License-Identifier: (GPL-2.0-or-later OR Apache-2.0)
+
+/*
+ *  Copyright 2021-2022 Analog Devices Inc.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+/*
+ * Copyright (C) 2021-2022 Analog Devices Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301,USA.
+ */
+
+/*
+ * Authors:
+ *   Piotr Wojtaszczyk <piotr.wojtaszczyk@timesys.com>
+ */
+
+/**
+ * @file icap_pool.c
+ * @author Piotr Wojtaszczyk <piotr.wojtaszczyk@timesys.com>
+ * @brief Scattered fragment pool, see icap_pool.h.
+ *
+ * @copyright Copyright 2021-2022 Analog Devices Inc.
+ */
+
+#include "../include/icap_pool.h"
+#include "../include/icap_application.h"
+
+int32_t icap_pool_init(struct icap_pool *pool, struct icap_instance *icap, uint32_t buf_id,
+		const struct icap_buf_descriptor *buf, uint32_t low_watermark)
+{
+	uint32_t stride;
+	uint32_t num;
+	uint32_t i;
+
+	if ((pool == NULL) || (icap == NULL) || (buf == NULL) ||
+			(buf->type != ICAP_BUF_SCATTERED) || (buf->frag_size == 0)) {
+		return -ICAP_ERROR_INVALID;
+	}
+
+	stride = buf->frag_size + buf->gap_size;
+	num = (buf->buf_size + buf->gap_size) / stride;
+	if (num == 0) {
+		return -ICAP_ERROR_INVALID;
+	}
+	if (num > ICAP_POOL_FRAGS) {
+		return -ICAP_ERROR_NOMEM;
+	}
+
+	memset(pool, 0, sizeof(struct icap_pool));
+	pool->icap = icap;
+	pool->buf_id = buf_id;
+	pool->num = num;
+	pool->low_watermark = low_watermark;
+	pool->max_in_flight = ICAP_FRAG_QUEUE_SIZE;
+	for (i = 0; i < num; i++) {
+		pool->offsets[i] = i * stride;
+	}
+	return 0;
+}
+
+int32_t icap_pool_set_offsets(struct icap_pool *pool, const uint32_t *offsets, uint32_t num)
+{
+	if ((offsets == NULL) || (num == 0) || (num > ICAP_POOL_FRAGS) || pool->submitted) {
+		return -ICAP_ERROR_INVALID;
+	}
+	memcpy(pool->offsets, offsets, num * sizeof(uint32_t));
+	pool->num = num;
+	return 0;
+}
+
+uint32_t icap_pool_in_flight(struct icap_pool *pool)
+{
+	return pool->submitted - pool->consumed;
+}
+
+int32_t icap_pool_frag_ready(struct icap_pool *pool, const struct icap_buf_frags *frags)
+{
+	uint32_t n = frags->frags;
+
+	if (n > icap_pool_in_flight(pool)) {
+		return -ICAP_ERROR_INVALID;
+	}
+
+	while (n--) {
+		if (pool->consume) {
+			pool->consume(pool, pool->offsets[pool->consume_idx]);
+		}
+		if (++pool->consume_idx == pool->num) {
+			pool->consume_idx = 0;
+		}
+	}
+
+	/* The consume callbacks are done with the data before the fragments are refilled */
+	ICAP_MEMORY_BARRIER();
+	pool->consumed += frags->frags;
+	return icap_pool_in_flight(pool) <= pool->low_watermark;
+}
+
+int32_t icap_pool_refill(struct icap_pool *pool)
+{
+	struct icap_buf_offsets offsets;
+	uint32_t start_idx;
+	uint32_t limit;
+	uint32_t free;
+	uint32_t sent = 0;
+	int32_t ret = 0;
+	int32_t err;
+
+	if (icap_pool_in_flight(pool) > pool->low_watermark) {
+		return 0;
+	}
+	ICAP_MEMORY_BARRIER();
+	/* More than the device queue holds would be rejected */
+	limit = pool->num < pool->max_in_flight ? pool->num : pool->max_in_flight;
+	free = 0;
+	if (icap_pool_in_flight(pool) < limit) {
+		free = limit - icap_pool_in_flight(pool);
+	}
+
+	offsets.buf_id = pool->buf_id;
+	while (free && (ret == 0)) {
+		start_idx = pool->submit_idx;
+		offsets.num = 0;
+		while (free && (offsets.num < ICAP_BUF_MAX_FRAGS_OFFSETS_NUM)) {
+			if (pool->fill) {
+				ret = pool->fill(pool, pool->offsets[pool->submit_idx]);
+				if (ret < 0) {
+					break;
+				}
+				ret = 0;
+			}
+			offsets.frags_offsets[offsets.num++] = pool->offsets[pool->submit_idx];
+			if (++pool->submit_idx == pool->num) {
+				pool->submit_idx = 0;
+			}
+			free--;
+		}
+		if (offsets.num == 0) {
+			break;
+		}
+
+		/* Counted before sending, the report may arrive before icap_frags() returns */
+		ICAP_MEMORY_BARRIER();
+		pool->submitted += offsets.num;
+		err = icap_frags(pool->icap, &offsets);
+		if (err) {
+			pool->submitted -= offsets.num;
+			pool->submit_idx = start_idx;
+			return sent ? (int32_t)sent : err;
+		}
+		sent += offsets.num;
+	}
+	return sent ? (int32_t)sent : ret;
+}
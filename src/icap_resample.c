@@ -0,0 +1,358 @@
+// SPDX-License-Identifier: (GPL-2.0-or-later OR Apache-2.0)
+
+/*
+ *  Copyright 2021-2022 Analog Devices Inc.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+/*
+ * Copyright (C) 2021-2022 Analog Devices Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301,USA.
+ */
+
+/*
+ * Authors:
+ *   Piotr Wojtaszczyk <piotr.wojtaszczyk@timesys.com>
+ */
+
+/**
+ * @file icap_resample.c
+ * @author Piotr Wojtaszczyk <piotr.wojtaszczyk@timesys.com>
+ * @brief Polyphase sample rate converter, see icap_resample.h.
+ *
+ * @copyright Copyright 2021-2022 Analog Devices Inc.
+ */
+
+#include <math.h>
+#include "../include/icap_resample.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#if defined(__SSE__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+struct icap_resample_preset {
+	/* Filter taps per phase, multiple of 8 for the vector loops */
+	uint32_t taps;
+	/* Cutoff relative to the lower Nyquist frequency */
+	double rolloff;
+	/* Kaiser window beta */
+	double beta;
+};
+
+static const struct icap_resample_preset icap_resample_presets[] = {
+	[ICAP_RESAMPLE_LOW] = {8, 0.80, 5.0},
+	[ICAP_RESAMPLE_MEDIUM] = {16, 0.90, 7.0},
+	[ICAP_RESAMPLE_HIGH] = {32, 0.94, 9.5},
+};
+
+#define ICAP_RESAMPLE_PRESETS_NUM (sizeof(icap_resample_presets) / sizeof(icap_resample_presets[0]))
+
+/* Frequencies of the @ref sample_rate bits */
+static const uint32_t icap_resample_rates[] = {
+	5512, 8000, 11025, 16000, 22050, 32000, 44100, 48000,
+	64000, 88200, 96000, 176400, 192000, 352800, 384000,
+};
+
+#define ICAP_RESAMPLE_RATES_NUM (sizeof(icap_resample_rates) / sizeof(icap_resample_rates[0]))
+
+static
+uint32_t icap_resample_gcd(uint32_t a, uint32_t b)
+{
+	uint32_t t;
+
+	while (b) {
+		t = a % b;
+		a = b;
+		b = t;
+	}
+	return a;
+}
+
+static
+int32_t icap_resample_ratio(uint32_t in_rate, uint32_t out_rate, uint32_t *up, uint32_t *down)
+{
+	uint32_t gcd;
+
+	if ((in_rate == 0) || (out_rate == 0)) {
+		return -ICAP_ERROR_INVALID;
+	}
+	gcd = icap_resample_gcd(in_rate, out_rate);
+	*up = out_rate / gcd;
+	*down = in_rate / gcd;
+	if (*up > ICAP_RESAMPLE_PHASES_MAX) {
+		return -ICAP_ERROR_NOT_SUP;
+	}
+	return 0;
+}
+
+uint32_t icap_resample_mem_size(uint32_t in_rate, uint32_t out_rate,
+		uint32_t channels, uint32_t quality)
+{
+	uint32_t up, down, taps;
+
+	if ((quality >= ICAP_RESAMPLE_PRESETS_NUM) || (channels == 0) ||
+			icap_resample_ratio(in_rate, out_rate, &up, &down)) {
+		return 0;
+	}
+	taps = icap_resample_presets[quality].taps;
+	return (up * taps + channels * 2 * taps) * sizeof(float);
+}
+
+/* Zeroth order modified Bessel function of the first kind */
+static
+double icap_resample_bessel_i0(double x)
+{
+	double sum = 1.0;
+	double term = 1.0;
+	uint32_t k;
+
+	for (k = 1; k < 50; k++) {
+		term *= (x / (2.0 * k)) * (x / (2.0 * k));
+		sum += term;
+		if (term < sum * 1e-12) {
+			break;
+		}
+	}
+	return sum;
+}
+
+/*
+ * Prototype lowpass filter of up * taps coefficients at the up-sampled rate,
+ * phase p uses coefficients p, p + up, p + 2 * up, ... stored in reverse order
+ * so the dot product runs over the history from the oldest sample.
+ */
+static
+void icap_resample_design(struct icap_resampler *rs, const struct icap_resample_preset *preset)
+{
+	uint32_t len = rs->up * rs->taps;
+	double center = (len - 1) / 2.0;
+	double cutoff = preset->rolloff / (rs->up > rs->down ? rs->up : rs->down);
+	double i0_beta = icap_resample_bessel_i0(preset->beta);
+	double sum = 0.0;
+	double t, r, h;
+	uint32_t n, p, k;
+
+	for (n = 0; n < len; n++) {
+		t = n - center;
+		h = (t == 0.0) ? cutoff : sin(M_PI * cutoff * t) / (M_PI * t);
+		r = t / (center + 1.0);
+		h *= icap_resample_bessel_i0(preset->beta * sqrt(1.0 - r * r)) / i0_beta;
+		p = n % rs->up;
+		k = n / rs->up;
+		rs->coefs[p * rs->taps + (rs->taps - 1 - k)] = (float)h;
+		sum += h;
+	}
+
+	/* Unity gain, each phase sees 1/up of the coefficients */
+	for (n = 0; n < len; n++) {
+		rs->coefs[n] = (float)(rs->coefs[n] * rs->up / sum);
+	}
+}
+
+int32_t icap_resample_init(struct icap_resampler *rs, uint32_t in_rate, uint32_t out_rate,
+		uint32_t channels, uint32_t quality, void *mem, uint32_t mem_size)
+{
+	uint32_t size = icap_resample_mem_size(in_rate, out_rate, channels, quality);
+	int32_t ret;
+
+	if ((rs == NULL) || (mem == NULL) || (quality >= ICAP_RESAMPLE_PRESETS_NUM) || (channels == 0)) {
+		return -ICAP_ERROR_INVALID;
+	}
+	ret = icap_resample_ratio(in_rate, out_rate, &rs->up, &rs->down);
+	if (ret) {
+		return ret;
+	}
+	if (mem_size < size) {
+		return -ICAP_ERROR_NOMEM;
+	}
+
+	rs->channels = channels;
+	rs->taps = icap_resample_presets[quality].taps;
+	rs->coefs = (float *)mem;
+	rs->history = rs->coefs + rs->up * rs->taps;
+	icap_resample_design(rs, &icap_resample_presets[quality]);
+	icap_resample_reset(rs);
+	return 0;
+}
+
+void icap_resample_reset(struct icap_resampler *rs)
+{
+	memset(rs->history, 0, rs->channels * 2 * rs->taps * sizeof(float));
+	rs->phase = 0;
+	rs->skip = 1;
+	rs->pos = 0;
+}
+
+static
+float icap_resample_dot(const float *a, const float *b, uint32_t n)
+{
+	float sum = 0.0f;
+	uint32_t i = 0;
+
+#if defined(__AVX__)
+	__m256 acc = _mm256_setzero_ps();
+	__m128 acc4;
+	for (; i + 8 <= n; i += 8) {
+#if defined(__FMA__)
+		acc = _mm256_fmadd_ps(_mm256_loadu_ps(&a[i]), _mm256_loadu_ps(&b[i]), acc);
+#else
+		acc = _mm256_add_ps(acc, _mm256_mul_ps(_mm256_loadu_ps(&a[i]), _mm256_loadu_ps(&b[i])));
+#endif
+	}
+	acc4 = _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+	acc4 = _mm_add_ps(acc4, _mm_movehl_ps(acc4, acc4));
+	acc4 = _mm_add_ss(acc4, _mm_shuffle_ps(acc4, acc4, 1));
+	sum = _mm_cvtss_f32(acc4);
+#elif defined(__SSE__)
+	__m128 acc = _mm_setzero_ps();
+	for (; i + 4 <= n; i += 4) {
+		acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(&a[i]), _mm_loadu_ps(&b[i])));
+	}
+	acc = _mm_add_ps(acc, _mm_movehl_ps(acc, acc));
+	acc = _mm_add_ss(acc, _mm_shuffle_ps(acc, acc, 1));
+	sum = _mm_cvtss_f32(acc);
+#elif defined(__ARM_NEON)
+	float32x4_t acc = vdupq_n_f32(0.0f);
+	float32x2_t acc2;
+	for (; i + 4 <= n; i += 4) {
+		acc = vmlaq_f32(acc, vld1q_f32(&a[i]), vld1q_f32(&b[i]));
+	}
+	acc2 = vadd_f32(vget_low_f32(acc), vget_high_f32(acc));
+	sum = vget_lane_f32(vpadd_f32(acc2, acc2), 0);
+#endif
+	for (; i < n; i++) {
+		sum += a[i] * b[i];
+	}
+	return sum;
+}
+
+int32_t icap_resample_process(struct icap_resampler *rs, const float *in, uint32_t in_frames,
+		uint32_t *in_used, float *out, uint32_t out_frames)
+{
+	uint32_t taps = rs->taps;
+	uint32_t in_pos = 0;
+	uint32_t out_pos = 0;
+	const float *coefs;
+	float *history;
+	uint32_t ch;
+
+	if ((in == NULL) || (out == NULL) || (in_used == NULL)) {
+		return -ICAP_ERROR_INVALID;
+	}
+
+	for (;;) {
+		/* Shift in the input needed for the next output sample */
+		while (rs->skip) {
+			if (in_pos == in_frames) {
+				goto done;
+			}
+			for (ch = 0; ch < rs->channels; ch++) {
+				history = &rs->history[ch * 2 * taps];
+				history[rs->pos] = in[in_pos * rs->channels + ch];
+				history[rs->pos + taps] = in[in_pos * rs->channels + ch];
+			}
+			rs->pos++;
+			if (rs->pos == taps) {
+				rs->pos = 0;
+			}
+			in_pos++;
+			rs->skip--;
+		}
+
+		if (out_pos == out_frames) {
+			break;
+		}
+
+		coefs = &rs->coefs[rs->phase * taps];
+		for (ch = 0; ch < rs->channels; ch++) {
+			out[out_pos * rs->channels + ch] = icap_resample_dot(coefs,
+					&rs->history[ch * 2 * taps + rs->pos], taps);
+		}
+		out_pos++;
+
+		rs->phase += rs->down;
+		rs->skip = rs->phase / rs->up;
+		rs->phase %= rs->up;
+	}
+done:
+	*in_used = in_pos;
+	return out_pos;
+}
+
+int32_t icap_resample_select_rate(uint32_t rates, uint32_t rate)
+{
+	int32_t best = -ICAP_ERROR_NOT_SUP;
+	uint32_t best_up = 0;
+	uint32_t up, down;
+	uint32_t candidate;
+	uint32_t better;
+	uint32_t i;
+
+	if (rate == 0) {
+		return -ICAP_ERROR_INVALID;
+	}
+	if (rates & ICAP_RATE_ALL_FREQ) {
+		return rate;
+	}
+
+	for (i = 0; i < ICAP_RESAMPLE_RATES_NUM; i++) {
+		candidate = icap_resample_rates[i];
+		if (!(rates & (1u << i))) {
+			continue;
+		}
+		if (candidate == rate) {
+			return rate;
+		}
+		if (icap_resample_ratio(rate, candidate, &up, &down)) {
+			continue;
+		}
+		/* Not losing bandwidth, then fewer phases, then less output samples.
+		 * Below the native rate losing less bandwidth goes first. */
+		if (best < 0) {
+			better = 1;
+		} else if ((candidate >= rate) != ((uint32_t)best >= rate)) {
+			better = candidate >= rate;
+		} else if (candidate < rate) {
+			better = candidate > (uint32_t)best;
+		} else if (up != best_up) {
+			better = up < best_up;
+		} else {
+			better = candidate < (uint32_t)best;
+		}
+		if (better) {
+			best = candidate;
+			best_up = up;
+		}
+	}
+	return best;
+}
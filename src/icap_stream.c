@@ -0,0 +1,209 @@
+// SPDX-License-Identifier: (GPL-2.0-or-later OR Apache-2.0)
+
+/*
+ *  Copyright 2021-2022 Analog Devices Inc.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+/*
+ * Copyright (C) 2021-2022 Analog Devices Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301,USA.
+ */
+
+/*
+ * Authors:
+ *   Piotr Wojtaszczyk <piotr.wojtaszczyk@timesys.com>
+ */
+
+/**
+ * @file icap_stream.c
+ * @author Piotr Wojtaszczyk <piotr.wojtaszczyk@timesys.com>
+ * @brief Zero-copy stream, see icap_stream.h.
+ *
+ * @copyright Copyright 2021-2022 Analog Devices Inc.
+ */
+
+#include "../include/icap_stream.h"
+
+int32_t icap_stream_init(struct icap_stream *stream, const struct icap_buf_descriptor *buf,
+		uint32_t dir, void *vaddr, uint32_t avail_min)
+{
+	int32_t ret;
+
+	if ((stream == NULL) || (buf == NULL) || (vaddr == NULL) || (avail_min == 0) ||
+			(buf->type == ICAP_BUF_SCATTERED) ||
+			((dir != ICAP_DEV_PLAYBACK) && (dir != ICAP_DEV_RECORD))) {
+		return -ICAP_ERROR_INVALID;
+	}
+
+	memset(stream, 0, sizeof(struct icap_stream));
+	ret = icap_frag_init(&stream->cur, buf);
+	if (ret) {
+		return ret;
+	}
+	if (avail_min > stream->cur.frags) {
+		return -ICAP_ERROR_INVALID;
+	}
+	stream->dir = dir;
+	stream->vaddr = vaddr;
+	stream->avail_min = avail_min;
+	stream->contiguous = (stream->cur.stride == stream->cur.frag_size);
+	return 0;
+}
+
+int32_t icap_stream_avail(struct icap_stream *stream)
+{
+	uint32_t filled;
+
+	if (stream->dir == ICAP_DEV_PLAYBACK) {
+		filled = stream->appl - stream->reported;
+		/* The device played fragments which weren't committed */
+		if (filled > stream->cur.frags) {
+			return -ICAP_ERROR_NO_BUFS;
+		}
+		return stream->cur.frags - filled;
+	}
+
+	filled = stream->reported - stream->appl;
+	/* The device recorded over fragments which weren't released */
+	if (filled > stream->cur.frags) {
+		return -ICAP_ERROR_NO_BUFS;
+	}
+	return filled;
+}
+
+void icap_stream_frag_ready(struct icap_stream *stream, const struct icap_buf_frags *frags)
+{
+	int32_t avail;
+
+	/* The recorded data is in memory before it is counted */
+	ICAP_MEMORY_BARRIER();
+	stream->reported += frags->frags;
+	if (stream->wake) {
+		/* Underruns and overruns wake up too, the client has to recover */
+		avail = icap_stream_avail(stream);
+		if ((avail < 0) || ((uint32_t)avail >= stream->avail_min)) {
+			stream->wake(stream);
+		}
+	}
+}
+
+int32_t icap_stream_wait(struct icap_stream *stream, uint32_t timeout_us)
+{
+	int32_t avail;
+	int32_t ret;
+
+	for (;;) {
+		avail = icap_stream_avail(stream);
+		if ((avail < 0) || ((uint32_t)avail >= stream->avail_min)) {
+			return avail;
+		}
+		if (timeout_us == 0) {
+			return -ICAP_ERROR_BUSY;
+		}
+		if (stream->wait == NULL) {
+			return -ICAP_ERROR_NOT_SUP;
+		}
+		ret = stream->wait(stream, timeout_us);
+		if (ret) {
+			return ret;
+		}
+	}
+}
+
+static
+int32_t icap_stream_begin(struct icap_stream *stream, uint32_t dir, void **ptr)
+{
+	int32_t avail;
+	uint32_t frags;
+
+	if ((ptr == NULL) || (stream->dir != dir)) {
+		return -ICAP_ERROR_INVALID;
+	}
+
+	avail = icap_stream_avail(stream);
+	if (avail <= 0) {
+		stream->pending = 0;
+		return avail;
+	}
+
+	frags = 1;
+	if (stream->contiguous) {
+		/* Up to the end of the buffer */
+		frags = stream->cur.frags - stream->cur.index;
+		if (frags > (uint32_t)avail) {
+			frags = avail;
+		}
+	}
+	*ptr = stream->vaddr + icap_frag_offset(&stream->cur, 0);
+	stream->pending = frags;
+	return frags;
+}
+
+static
+int32_t icap_stream_end(struct icap_stream *stream, uint32_t dir, uint32_t frags)
+{
+	if ((stream->dir != dir) || (frags > stream->pending)) {
+		return -ICAP_ERROR_INVALID;
+	}
+
+	icap_frag_advance(&stream->cur, frags);
+	stream->pending = 0;
+	/* The written data is in memory before the fragments are handed over */
+	ICAP_MEMORY_BARRIER();
+	stream->appl += frags;
+	return 0;
+}
+
+int32_t icap_stream_begin_write(struct icap_stream *stream, void **ptr)
+{
+	return icap_stream_begin(stream, ICAP_DEV_PLAYBACK, ptr);
+}
+
+int32_t icap_stream_commit(struct icap_stream *stream, uint32_t frags)
+{
+	return icap_stream_end(stream, ICAP_DEV_PLAYBACK, frags);
+}
+
+int32_t icap_stream_begin_read(struct icap_stream *stream, void **ptr)
+{
+	return icap_stream_begin(stream, ICAP_DEV_RECORD, ptr);
+}
+
+int32_t icap_stream_release(struct icap_stream *stream, uint32_t frags)
+{
+	return icap_stream_end(stream, ICAP_DEV_RECORD, frags);
+}
+
+void icap_stream_recover(struct icap_stream *stream)
+{
+	uint32_t reported = stream->reported;
+
+	icap_frag_advance(&stream->cur, reported - stream->appl);
+	stream->pending = 0;
+	stream->appl = reported;
+}
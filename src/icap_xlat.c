@@ -0,0 +1,114 @@
+// SPDX-License-Identifier: (GPL-2.0-or-later OR Apache-2.0)
+
+/*
+ *  Copyright 2021-2022 Analog Devices Inc.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+/*
+ * Copyright (C) 2021-2022 Analog Devices Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301,USA.
+ */
+
+/*
+ * Authors:
+ *   Piotr Wojtaszczyk <piotr.wojtaszczyk@timesys.com>
+ */
+
+/**
+ * @file icap_xlat.c
+ * @author Piotr Wojtaszczyk <piotr.wojtaszczyk@timesys.com>
+ * @brief Address translation tables, see icap_xlat.h.
+ *
+ * @copyright Copyright 2021-2022 Analog Devices Inc.
+ */
+
+#include "../include/icap_xlat.h"
+
+void icap_xlat_init(struct icap_xlat *xlat)
+{
+	memset(xlat, 0, sizeof(struct icap_xlat));
+}
+
+int32_t icap_xlat_add(struct icap_xlat *xlat, uint64_t peer_addr, uint64_t local_addr, uint64_t size)
+{
+	struct icap_xlat_region *region;
+	uint32_t i;
+
+	if ((size == 0) || (peer_addr + size - 1 < peer_addr) || (local_addr + size - 1 < local_addr)) {
+		return -ICAP_ERROR_INVALID;
+	}
+
+	for (i = 0; i < xlat->num; i++) {
+		region = &xlat->regions[i];
+		if ((peer_addr < region->peer_addr + region->size) &&
+				(region->peer_addr < peer_addr + size)) {
+			return -ICAP_ERROR_INVALID;
+		}
+	}
+	if (xlat->num >= ICAP_XLAT_REGIONS) {
+		return -ICAP_ERROR_NOMEM;
+	}
+
+	region = &xlat->regions[xlat->num++];
+	region->peer_addr = peer_addr;
+	region->local_addr = local_addr;
+	region->size = size;
+	return 0;
+}
+
+static
+int32_t icap_xlat_match(struct icap_xlat_region *region, uint64_t addr, uint64_t size)
+{
+	return (addr >= region->peer_addr) && (addr - region->peer_addr < region->size) &&
+			(size <= region->size - (addr - region->peer_addr));
+}
+
+int32_t icap_xlat_addr(struct icap_xlat *xlat, uint64_t addr, uint64_t size, uint64_t *local)
+{
+	struct icap_xlat_region *region;
+	uint32_t i;
+
+	/* Buffers of a stream usually come from the same region */
+	if (xlat->last < xlat->num) {
+		region = &xlat->regions[xlat->last];
+		if (icap_xlat_match(region, addr, size)) {
+			*local = region->local_addr + (addr - region->peer_addr);
+			return 0;
+		}
+	}
+
+	for (i = 0; i < xlat->num; i++) {
+		region = &xlat->regions[i];
+		if (icap_xlat_match(region, addr, size)) {
+			xlat->last = i;
+			*local = region->local_addr + (addr - region->peer_addr);
+			return 0;
+		}
+	}
+	return -ICAP_ERROR_INVALID;
+}
@@ -43,6 +43,8 @@ int32_t icap_init_transport(struct icap_instance *icap)
 
 	memset(&icap->transport.msg_fifo, 0, sizeof(struct _icap_msg_fifo));
 	icap->transport.remote_addr = (uint32_t)-1;
+	icap->transport.time_last_tick = platform_us_clock_tick();
+	icap->transport.time_wraps = 0;
 	return 0;
 }
 
@@ -64,12 +66,19 @@ int32_t icap_verify_remote(struct icap_instance *icap,
 	return 0;
 }
 
-int32_t icap_send_platform(struct icap_instance *icap, void *data, uint32_t size)
+int32_t icap_send_platform(struct icap_instance *icap, union icap_remote_addr *dst,
+		void *data, uint32_t size)
 {
+	uint32_t remote_addr = icap->transport.remote_addr;
+
+	if (dst) {
+		remote_addr = dst->rpmsg_addr;
+	}
+
 	return rpmsg_lite_send(
 			icap->transport.rpmsg_instance,
 			icap->transport.rpmsg_ept,
-			icap->transport.remote_addr,
+			remote_addr,
 			data, size, 0);
 }
 
@@ -108,6 +117,8 @@ int32_t icap_loop(struct icap_instance *icap)
 	atomic_t tail_next;
 	int32_t ret;
 
+	icap_heartbeat(icap);
+
 	if (fifo->tail == fifo->head) {
 		return 0;
 	}
@@ -141,7 +152,7 @@ int32_t icap_response_notify(struct icap_instance *icap, struct icap_msg *respon
 }
 
 int32_t icap_wait_for_response(struct icap_instance *icap, uint32_t seq_num,
-		struct icap_msg *response)
+		struct icap_msg *response, uint32_t timeout_us)
 {
 	struct icap_msg *last_response = (struct icap_msg *)icap->transport.last_response;
     uint32_t start, elapsed, size;
@@ -165,7 +176,7 @@ int32_t icap_wait_for_response(struct icap_instance *icap, uint32_t seq_num,
     		}
     	}
         elapsed = platform_us_clock_tick() - start;
-    }while(elapsed < ICAP_MSG_TIMEOUT_US);
+    }while(elapsed < timeout_us);
 
     return -ICAP_ERROR_TIMEOUT;
 }
@@ -180,4 +191,32 @@ void icap_platform_unlock(struct icap_instance *icap)
 	return;
 }
 
+void icap_platform_irq_lock(struct icap_instance *icap)
+{
+	return;
+}
+
+void icap_platform_irq_unlock(struct icap_instance *icap)
+{
+	return;
+}
+
+uint64_t icap_platform_time_ns(struct icap_instance *icap)
+{
+	struct icap_transport *transport = &icap->transport;
+	uint32_t tick = platform_us_clock_tick();
+
+	/* Extend the 32bit microsecond tick to 64bit */
+	if (tick < transport->time_last_tick) {
+		transport->time_wraps++;
+	}
+	transport->time_last_tick = tick;
+	return ((((uint64_t)transport->time_wraps) << 32) | tick) * 1000;
+}
+
+uint32_t icap_platform_entropy(struct icap_instance *icap)
+{
+	return icap->transport.seed ^ platform_us_clock_tick();
+}
+
 #endif /* ICAP_BM_RPMSG_LITE */
@@ -38,8 +38,26 @@
 
 #include <linux/types.h>
 #include <linux/kobject.h>
+#include <linux/timekeeping.h>
+#include <linux/random.h>
 
-#define __ICAP_MSG_TIMEOUT usecs_to_jiffies(ICAP_MSG_TIMEOUT_US)
+/* Heartbeat work interval when the heartbeat is disabled */
+#define __ICAP_HEARTBEAT_IDLE msecs_to_jiffies(1000)
+
+static
+void icap_heartbeat_work(struct work_struct *work)
+{
+	struct icap_transport *transport = container_of(to_delayed_work(work),
+			struct icap_transport, heartbeat_work);
+	struct icap_instance *icap = container_of(transport, struct icap_instance, transport);
+	unsigned long delay = __ICAP_HEARTBEAT_IDLE;
+
+	icap_heartbeat(icap);
+	if (icap->link.heartbeat_us) {
+		delay = usecs_to_jiffies(icap->link.heartbeat_us);
+	}
+	schedule_delayed_work(&transport->heartbeat_work, delay);
+}
 
 int32_t icap_init_transport(struct icap_instance *icap)
 {
@@ -49,8 +67,11 @@ int32_t icap_init_transport(struct icap_instance *icap)
 	mutex_init(&transport->platform_lock);
 	mutex_init(&transport->response_lock);
 	spin_lock_init(&transport->skb_spinlock);
+	spin_lock_init(&transport->irq_spinlock);
 	init_waitqueue_head(&transport->response_event);
 	skb_queue_head_init(&transport->response_queue);
+	INIT_DELAYED_WORK(&transport->heartbeat_work, icap_heartbeat_work);
+	schedule_delayed_work(&transport->heartbeat_work, __ICAP_HEARTBEAT_IDLE);
 	return 0;
 }
 
@@ -60,6 +81,8 @@ int32_t icap_deinit_transport(struct icap_instance *icap)
 	struct sk_buff *skb;
 	unsigned long flags;
 
+	cancel_delayed_work_sync(&transport->heartbeat_work);
+
 	mutex_lock(&transport->rpdev_lock);
 
 	spin_lock_irqsave(&transport->skb_spinlock, flags);
@@ -78,11 +101,13 @@ int32_t icap_deinit_transport(struct icap_instance *icap)
 int32_t icap_verify_remote(struct icap_instance *icap,
 		union icap_remote_addr *src_addr)
 {
-	/* rpmsg endpoints on linux are one to one - no need to verify src address*/
+	/* rpmsg endpoints on linux are one to one - no need to verify src address,
+	 * for the same reason icap_send_platform() ignores the destination */
 	return 0;
 }
 
-int32_t icap_send_platform(struct icap_instance *icap, void *data, uint32_t size)
+int32_t icap_send_platform(struct icap_instance *icap, union icap_remote_addr *dst,
+		void *data, uint32_t size)
 {
 	struct icap_transport *transport = &icap->transport;
 	int32_t ret;
@@ -186,7 +211,7 @@ int32_t icap_response_notify(struct icap_instance *icap, struct icap_msg *respon
 }
 
 int32_t icap_wait_for_response(struct icap_instance *icap, uint32_t seq_num,
-		struct icap_msg *response)
+		struct icap_msg *response, uint32_t timeout_us)
 {
 	struct icap_transport *transport = &icap->transport;
 	struct device *dev;
@@ -212,7 +237,7 @@ int32_t icap_wait_for_response(struct icap_instance *icap, uint32_t seq_num,
 	}
 	hint = (struct _icap_wait_hint *)skb->head;
 
-	timeout = wait_event_interruptible_timeout(transport->response_event, hint->received, __ICAP_MSG_TIMEOUT);
+	timeout = wait_event_interruptible_timeout(transport->response_event, hint->received, usecs_to_jiffies(timeout_us));
 
 	/* Remove the skb from response queue */
 	mutex_lock(&transport->response_lock);
@@ -267,4 +292,29 @@ void icap_platform_unlock(struct icap_instance *icap)
 	mutex_unlock(&transport->platform_lock);
 }
 
+void icap_platform_irq_lock(struct icap_instance *icap)
+{
+	struct icap_transport *transport = &icap->transport;
+	unsigned long flags;
+
+	spin_lock_irqsave(&transport->irq_spinlock, flags);
+	transport->irq_flags = flags;
+}
+
+void icap_platform_irq_unlock(struct icap_instance *icap)
+{
+	struct icap_transport *transport = &icap->transport;
+	spin_unlock_irqrestore(&transport->irq_spinlock, transport->irq_flags);
+}
+
+uint64_t icap_platform_time_ns(struct icap_instance *icap)
+{
+	return ktime_get_ns();
+}
+
+uint32_t icap_platform_entropy(struct icap_instance *icap)
+{
+	return get_random_u32();
+}
+
 #endif /* ICAP_LINUX_KERNEL_RPMSG */
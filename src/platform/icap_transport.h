@@ -53,7 +53,7 @@
 
 #include "../../include/icap.h"
 
-#define ICAP_PROTOCOL_VERSION (1)
+#define ICAP_PROTOCOL_VERSION (2)
 
 /**
  * @brief ICAP message type
@@ -89,11 +89,26 @@ enum icap_msg_cmd {
 	ICAP_MSG_BUF_OFFSETS = 58, /**< Send offsets for new fragments, used in #ICAP_BUF_SCATTERED. */
 	ICAP_MSG_FRAG_READY = 59, /**< Audio fragment consumed. */
 	ICAP_MSG_XRUN = 60, /**< Report buffer xrun. */
+	ICAP_MSG_START_AT = 61, /**< Start subdevice at a scheduled time. */
+	ICAP_MSG_STOP_AT = 62, /**< Stop subdevice at a scheduled time. */
+	ICAP_MSG_PAUSE_AT = 63, /**< Pause subdevice at a scheduled time. */
+	ICAP_MSG_RESUME_AT = 64, /**< Resume subdevice at a scheduled time. */
+	ICAP_MSG_START_GROUP = 65, /**< Start group of subdevices phase-aligned. */
+	ICAP_MSG_BUF_GEOMETRY = 66, /**< Change fragment geometry of a running buffer. */
+	ICAP_MSG_BUF_SWITCH = 67, /**< Replace a running buffer at a fragment boundary. */
+	ICAP_MSG_DSP_CHAIN = 68, /**< Set processing chain of a subdevice. */
+	ICAP_MSG_DSP_PARAMS = 69, /**< Set parameters of a processing block. */
+	ICAP_MSG_CTRL_BLOCK = 70, /**< Attach shared control block to a subdevice. */
+	ICAP_MSG_MONITOR = 71, /**< Route record subdevice to playback subdevice. */
 
 	/* Other messages */
 	ICAP_MSG_ERROR = 200, /**< Report error. */
+	ICAP_MSG_HEARTBEAT = 201, /**< Peer liveness check, handled internally. */
 };
 
+/** @brief Set in icap_msg_header.flags when the message is a retransmission */
+#define ICAP_MSG_FLAG_RETRANSMIT (1 << 0)
+
 /**
  * @brief Message payload, valid union field depends on command.
  * 
@@ -106,9 +121,19 @@ union icap_msg_payload {
 	int32_t s32;
 	struct icap_buf_descriptor buf;
 	struct icap_buf_frags frags;
+	struct icap_buf_frags_ts frags_ts;
 	struct icap_buf_offsets offsets;
 	struct icap_subdevice_features features;
 	struct icap_subdevice_params dev_params;
+	struct icap_sched sched;
+	struct icap_sched_group sched_group;
+	struct icap_buf_geometry geometry;
+	struct icap_buf_switch buf_switch;
+	struct icap_buf_switch_point switch_point;
+	struct icap_dsp_chain dsp_chain;
+	struct icap_dsp_params dsp_params;
+	struct icap_ctrl_desc ctrl_desc;
+	struct icap_monitor_route monitor;
 }ICAP_PACKED_END;
 
 /**
@@ -121,7 +146,9 @@ struct icap_msg_header {
 	uint32_t seq_num; /**< Sequence number of a message, increments every msg.*/
 	uint32_t cmd; /**< Command ID of the message.*/
 	uint32_t type; /**< Specifies if message or response to a message: ICAP_MSG, ICAP_ACK, ICAP_NAK. */
-	uint32_t reserved[5]; /**< Reserved for future use.*/
+	uint32_t session; /**< Session id of the sender, 0 if unknown.*/
+	uint32_t flags; /**< Message flags, @ref ICAP_MSG_FLAG_RETRANSMIT.*/
+	uint32_t reserved[3]; /**< Reserved for future use.*/
 	uint32_t payload_len; /**< Payload length in bytes.*/
 }ICAP_PACKED_END;
 
@@ -164,11 +191,13 @@ int32_t icap_verify_remote(struct icap_instance *icap, union icap_remote_addr *s
  * @brief Send ICAP message using platform specific transport.
  * 
  * @param icap Pointer to ICAP instance.
+ * @param dst Destination address, NULL for the remote endpoint verified by icap_verify_remote().
  * @param data Pointer to ICAP message.
  * @param size Totall size of the ICAP message.
  * @return int32_t Returns 0 on success, negative error code on failure.
  */
-int32_t icap_send_platform(struct icap_instance *icap, void *data, uint32_t size);
+int32_t icap_send_platform(struct icap_instance *icap, union icap_remote_addr *dst,
+		void *data, uint32_t size);
 
 /**
  * @brief Notifies about received responce, may unblock a thread waiting for the response.
@@ -196,9 +225,11 @@ int32_t icap_prepare_wait(struct icap_instance *icap, struct icap_msg *msg);
  * @param icap Pointer to ICAP instance.
  * @param seq_num Sequence number of the expected response.
  * @param response If not NULL the expected response is copied to the struct.
+ * @param timeout_us Time to wait for the response in microseconds.
  * @return int32_t Returns 0 on success, negative error code on failure.
  */
-int32_t icap_wait_for_response(struct icap_instance *icap, uint32_t seq_num, struct icap_msg *response);
+int32_t icap_wait_for_response(struct icap_instance *icap, uint32_t seq_num,
+		struct icap_msg *response, uint32_t timeout_us);
 
 /**
  * @brief Lock critical section.
@@ -214,4 +245,36 @@ void icap_platform_lock(struct icap_instance *icap);
  */
 void icap_platform_unlock(struct icap_instance *icap);
 
+/**
+ * @brief Lock critical section shared with message parsing,
+ * may be called in interrupt context.
+ * 
+ * @param icap Pointer to ICAP instance.
+ */
+void icap_platform_irq_lock(struct icap_instance *icap);
+
+/**
+ * @brief Unlock critical section shared with message parsing.
+ * 
+ * @param icap Pointer to ICAP instance.
+ */
+void icap_platform_irq_unlock(struct icap_instance *icap);
+
+/**
+ * @brief Get monotonic local time. May be called in interrupt context.
+ * 
+ * @param icap Pointer to ICAP instance.
+ * @return uint64_t Returns local time in nanoseconds.
+ */
+uint64_t icap_platform_time_ns(struct icap_instance *icap);
+
+/**
+ * @brief Get a value which differs on each boot, e.g. from a hardware RNG.
+ * Seeds the session id, a restarted peer must not reuse its previous id.
+ * 
+ * @param icap Pointer to ICAP instance.
+ * @return uint32_t Returns the random value.
+ */
+uint32_t icap_platform_entropy(struct icap_instance *icap);
+
 #endif /* _ICAP_TRANSPORT_H_ */
@@ -0,0 +1,70 @@
+/*
+ * Throughput of icap_format_convert() and icap_format_interleave() in
+ * samples per second.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "icap_format.h"
+
+#define BENCH_SAMPLES (4096)
+#define BENCH_ROUNDS (4000)
+
+static uint8_t src_buf[BENCH_SAMPLES * 8];
+static uint8_t dst_buf[BENCH_SAMPLES * 8];
+
+static double bench_now(void)
+{
+	struct timespec t;
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static void bench_convert(const char *name, uint32_t dst_format, uint32_t src_format)
+{
+	double t;
+	uint32_t i;
+
+	t = bench_now();
+	for (i = 0; i < BENCH_ROUNDS; i++)
+		icap_format_convert(dst_buf, dst_format, src_buf, src_format, BENCH_SAMPLES);
+	t = bench_now() - t;
+	printf("%-24s %8.1f Msamples/s\n", name, (double)BENCH_SAMPLES * BENCH_ROUNDS / t * 1e-6);
+}
+
+static void bench_interleave(const char *name, uint32_t channels, uint32_t format)
+{
+	uint32_t frames = BENCH_SAMPLES / channels;
+	uint32_t stride = frames * icap_format_size(format);
+	double t;
+	uint32_t i;
+
+	t = bench_now();
+	for (i = 0; i < BENCH_ROUNDS; i++)
+		icap_format_interleave(dst_buf, src_buf, stride, channels, frames, format);
+	t = bench_now() - t;
+	printf("%-24s %8.1f Msamples/s\n", name, (double)BENCH_SAMPLES * BENCH_ROUNDS / t * 1e-6);
+}
+
+int main(void)
+{
+	float *f = (float *)src_buf;
+	uint32_t i;
+
+	for (i = 0; i < BENCH_SAMPLES; i++)
+		f[i] = (float)((int32_t)(i * 2654435761u)) / 2147483648.0f;
+
+	bench_convert("float -> s32", ICAP_FORMAT_S32_LE, ICAP_FORMAT_FLOAT_LE);
+	bench_convert("float -> s16", ICAP_FORMAT_S16_LE, ICAP_FORMAT_FLOAT_LE);
+	bench_convert("float -> s24_3le", ICAP_FORMAT_S24_3LE, ICAP_FORMAT_FLOAT_LE);
+	bench_convert("s32 -> float", ICAP_FORMAT_FLOAT_LE, ICAP_FORMAT_S32_LE);
+	bench_convert("s16 -> float", ICAP_FORMAT_FLOAT_LE, ICAP_FORMAT_S16_LE);
+	bench_convert("s24_3le -> s32", ICAP_FORMAT_S32_LE, ICAP_FORMAT_S24_3LE);
+	bench_convert("s32 -> s16_be", ICAP_FORMAT_S16_BE, ICAP_FORMAT_S32_LE);
+	bench_convert("float -> float64", ICAP_FORMAT_FLOAT64_LE, ICAP_FORMAT_FLOAT_LE);
+	bench_interleave("interleave 2ch s16", 2, ICAP_FORMAT_S16_LE);
+	bench_interleave("interleave 8ch s32", 8, ICAP_FORMAT_S32_LE);
+	return 0;
+}
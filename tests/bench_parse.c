@@ -0,0 +1,65 @@
+/*
+ * Cost of icap_parse_msg() on the device side, one START message at a time.
+ * Built twice, with callbacks passed to icap_device_init() and bound at
+ * compile time with ICAP_STATIC_CALLBACKS.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "rpmsg_lite.h"
+#include "icap_device.h"
+#include "../src/platform/icap_transport.h"
+
+#define BENCH_MSGS (2000000)
+
+static uint32_t starts;
+
+int32_t bench_parse_start(struct icap_instance *icap, uint32_t subdev_id)
+{
+	starts++;
+	return 0;
+}
+
+static struct icap_device_callbacks dev_cb = {
+	.start = bench_parse_start,
+};
+
+int main(void)
+{
+	static struct icap_instance dev;
+	struct rpmsg_lite_instance rpmsg;
+	struct rpmsg_lite_endpoint ept = {0x401, &dev, 0, 0, 0, 0};
+	union icap_remote_addr src = {.rpmsg_addr = 0x400};
+	struct timespec t0, t1;
+	struct icap_msg msg;
+	uint32_t size = sizeof(struct icap_msg_header) + sizeof(uint32_t);
+	uint32_t i;
+	double ns;
+
+	icap_device_init(&dev, "bench", &dev_cb, NULL);
+	dev.transport.rpmsg_instance = &rpmsg;
+	dev.transport.rpmsg_ept = &ept;
+
+	memset(&msg, 0, sizeof(msg));
+	msg.header.protocol_version = ICAP_PROTOCOL_VERSION;
+	msg.header.cmd = ICAP_MSG_START;
+	msg.header.type = ICAP_MSG;
+	msg.header.session = 1;
+	msg.header.payload_len = sizeof(uint32_t);
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (i = 0; i < BENCH_MSGS; i++) {
+		msg.header.seq_num = i;
+		icap_parse_msg(&dev, &src, &msg, size);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+
+	ns = (t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec);
+#ifdef ICAP_STATIC_CALLBACKS
+	printf("icap_parse_msg, static callbacks: %.1f ns/msg (%u started)\n", ns / BENCH_MSGS, starts);
+#else
+	printf("icap_parse_msg, runtime callbacks: %.1f ns/msg (%u started)\n", ns / BENCH_MSGS, starts);
+#endif
+	return 0;
+}
@@ -0,0 +1,7 @@
+/*
+ * Callbacks bound at compile time for bench_parse.c built with ICAP_STATIC_CALLBACKS.
+ */
+
+int32_t bench_parse_start(struct icap_instance *icap, uint32_t subdev_id);
+
+#define ICAP_STATIC_DEVICE_CALLBACKS {.start = bench_parse_start}
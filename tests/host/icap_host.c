@@ -0,0 +1,38 @@
+/*
+ * Application and device instance pair, see icap_host.h.
+ */
+
+#include <string.h>
+#include "icap_host.h"
+
+int32_t icap_host_pair_init(struct icap_host_pair *pair, struct icap_application_callbacks *app_cb,
+		struct icap_device_callbacks *dev_cb)
+{
+	int32_t ret;
+
+	memset(pair, 0, sizeof(struct icap_host_pair));
+	rpmsg_lite_host_reset();
+
+	ret = icap_application_init(&pair->app, "app", app_cb, NULL);
+	if (ret) {
+		return ret;
+	}
+	ret = icap_device_init(&pair->dev, "dev", dev_cb, NULL);
+	if (ret) {
+		return ret;
+	}
+
+	pair->app_ept.addr = ICAP_HOST_APP_ADDR;
+	pair->app_ept.icap = &pair->app;
+	pair->dev_ept.addr = ICAP_HOST_DEV_ADDR;
+	pair->dev_ept.icap = &pair->dev;
+	rpmsg_lite_host_register(&pair->app_ept);
+	rpmsg_lite_host_register(&pair->dev_ept);
+
+	pair->app.transport.rpmsg_instance = &pair->rpmsg;
+	pair->app.transport.rpmsg_ept = &pair->app_ept;
+	pair->app.transport.remote_addr = ICAP_HOST_DEV_ADDR;
+	pair->dev.transport.rpmsg_instance = &pair->rpmsg;
+	pair->dev.transport.rpmsg_ept = &pair->dev_ept;
+	return 0;
+}
@@ -0,0 +1,31 @@
+/*
+ * Application and device instance pair connected through the host
+ * rpmsg-lite stand-in, for tests of src/icap.c.
+ */
+
+#ifndef _ICAP_HOST_H_
+#define _ICAP_HOST_H_
+
+#include "icap_application.h"
+#include "icap_device.h"
+
+#define ICAP_HOST_APP_ADDR (0x400)
+#define ICAP_HOST_DEV_ADDR (0x401)
+
+struct icap_host_pair {
+	struct rpmsg_lite_instance rpmsg;
+	struct rpmsg_lite_endpoint app_ept;
+	struct rpmsg_lite_endpoint dev_ept;
+	struct icap_instance app;
+	struct icap_instance dev;
+};
+
+/**
+ * @brief Initializes both instances and connects them.
+ * 
+ * @return int32_t Returns 0 on success, negative error code on failure.
+ */
+int32_t icap_host_pair_init(struct icap_host_pair *pair, struct icap_application_callbacks *app_cb,
+		struct icap_device_callbacks *dev_cb);
+
+#endif /* _ICAP_HOST_H_ */
@@ -0,0 +1,62 @@
+/*
+ * Host stand-in for rpmsg-lite used by the ICAP tests. Messages sent to an
+ * endpoint are parsed immediately by the ICAP instance owning it, so an
+ * application and a device instance can talk within one process.
+ */
+
+#ifndef _RPMSG_LITE_H_
+#define _RPMSG_LITE_H_
+
+#include <stdint.h>
+
+#define RL_BUFFER_PAYLOAD_SIZE (496)
+#define RL_SUCCESS (0)
+#define RL_ERR_NO_BUFF (-1)
+#define RL_HOLD (1)
+
+struct icap_instance;
+
+struct rpmsg_lite_instance {
+	uint32_t unused;
+};
+
+struct rpmsg_lite_endpoint {
+	/** @brief Endpoint address */
+	uint32_t addr;
+
+	/** @brief Instance parsing the messages sent to the endpoint */
+	struct icap_instance *icap;
+
+	/** @brief Messages sent to the endpoint are lost while set */
+	uint32_t drop;
+
+	/** @brief Number of messages sent to the endpoint, including the dropped ones */
+	uint32_t received;
+
+	/** @brief Number of next messages sent to the endpoint which are lost */
+	uint32_t drop_next;
+
+	/** @brief Header flags of the last message sent to the endpoint */
+	uint32_t last_flags;
+};
+
+/** @brief Makes the endpoint reachable by rpmsg_lite_send() */
+void rpmsg_lite_host_register(struct rpmsg_lite_endpoint *ept);
+
+/** @brief Forgets all registered endpoints */
+void rpmsg_lite_host_reset(void);
+
+int32_t rpmsg_lite_send(struct rpmsg_lite_instance *rpmsg, struct rpmsg_lite_endpoint *ept,
+		uint32_t dst, void *data, uint32_t size, uint32_t timeout);
+
+int32_t rpmsg_lite_release_rx_buffer(struct rpmsg_lite_instance *rpmsg, void *data);
+
+/** @brief Microsecond tick, advances by 10 us on each call unless changed
+ * by rpmsg_lite_host_set_clock() */
+uint32_t platform_us_clock_tick(void);
+
+/** @brief Sets the tick and its advance on each call, 0 stops the clock.
+ * rpmsg_lite_host_reset() restarts the tick from 0 with the 10 us advance. */
+void rpmsg_lite_host_set_clock(uint32_t tick, uint32_t step);
+
+#endif /* _RPMSG_LITE_H_ */
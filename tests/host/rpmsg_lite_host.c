@@ -0,0 +1,83 @@
+/*
+ * Host stand-in for rpmsg-lite, see rpmsg_lite.h.
+ */
+
+#include <string.h>
+#include "icap.h"
+#include "../../src/platform/icap_transport.h"
+
+#define RPMSG_LITE_HOST_EPTS 8
+
+static struct rpmsg_lite_endpoint *rpmsg_lite_host_epts[RPMSG_LITE_HOST_EPTS];
+static uint32_t rpmsg_lite_host_tick;
+static uint32_t rpmsg_lite_host_step = 10;
+
+void rpmsg_lite_host_register(struct rpmsg_lite_endpoint *ept)
+{
+	uint32_t i;
+
+	for (i = 0; i < RPMSG_LITE_HOST_EPTS; i++) {
+		if (rpmsg_lite_host_epts[i] == NULL) {
+			rpmsg_lite_host_epts[i] = ept;
+			return;
+		}
+	}
+}
+
+void rpmsg_lite_host_reset(void)
+{
+	memset(rpmsg_lite_host_epts, 0, sizeof(rpmsg_lite_host_epts));
+	rpmsg_lite_host_tick = 0;
+	rpmsg_lite_host_step = 10;
+}
+
+void rpmsg_lite_host_set_clock(uint32_t tick, uint32_t step)
+{
+	rpmsg_lite_host_tick = tick;
+	rpmsg_lite_host_step = step;
+}
+
+int32_t rpmsg_lite_send(struct rpmsg_lite_instance *rpmsg, struct rpmsg_lite_endpoint *ept,
+		uint32_t dst, void *data, uint32_t size, uint32_t timeout)
+{
+	uint8_t msg[RL_BUFFER_PAYLOAD_SIZE];
+	union icap_remote_addr src_addr;
+	struct rpmsg_lite_endpoint *dst_ept;
+	uint32_t i;
+
+	if (size > sizeof(msg)) {
+		return RL_ERR_NO_BUFF;
+	}
+
+	for (i = 0; i < RPMSG_LITE_HOST_EPTS; i++) {
+		dst_ept = rpmsg_lite_host_epts[i];
+		if (dst_ept && (dst_ept->addr == dst)) {
+			dst_ept->received++;
+			dst_ept->last_flags = ((struct icap_msg_header *)data)->flags;
+			if (dst_ept->drop_next) {
+				dst_ept->drop_next--;
+				return RL_SUCCESS;
+			}
+			if (dst_ept->drop) {
+				return RL_SUCCESS;
+			}
+			/* The receiver may send from its callbacks, parse a private copy */
+			memcpy(msg, data, size);
+			src_addr.rpmsg_addr = ept->addr;
+			icap_parse_msg(dst_ept->icap, &src_addr, msg, size);
+			return RL_SUCCESS;
+		}
+	}
+	return RL_SUCCESS;
+}
+
+int32_t rpmsg_lite_release_rx_buffer(struct rpmsg_lite_instance *rpmsg, void *data)
+{
+	return RL_SUCCESS;
+}
+
+uint32_t platform_us_clock_tick(void)
+{
+	rpmsg_lite_host_tick += rpmsg_lite_host_step;
+	return rpmsg_lite_host_tick;
+}
@@ -0,0 +1,32 @@
+/*
+ * Minimal checks shared by the ICAP host tests. Each test is a standalone
+ * program returning non-zero if any check failed.
+ */
+
+#ifndef _ICAP_TEST_H_
+#define _ICAP_TEST_H_
+
+#include <stdio.h>
+
+static int test_failures;
+
+#define TEST_CHECK(cond) do { \
+	if (!(cond)) { \
+		printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+		test_failures++; \
+	} \
+} while (0)
+
+#define TEST_CHECK_EQ(a, b) do { \
+	long long _a = (long long)(a); \
+	long long _b = (long long)(b); \
+	if (_a != _b) { \
+		printf("%s:%d: check failed: %s == %s (%lld != %lld)\n", __FILE__, __LINE__, #a, #b, _a, _b); \
+		test_failures++; \
+	} \
+} while (0)
+
+#define TEST_RESULT() (test_failures ? (printf("%s: %d checks failed\n", __FILE__, test_failures), 1) : \
+	(printf("%s: passed\n", __FILE__), 0))
+
+#endif /* _ICAP_TEST_H_ */
@@ -0,0 +1,320 @@
+/*
+ * Shared memory arena, icap_arena.c, and its use by icap_set_arena().
+ */
+
+#include <string.h>
+#include "rpmsg_lite.h"
+#include "icap_host.h"
+#include "icap_arena.h"
+#include "test.h"
+
+#define REGION_ADDR (0x80000000ull)
+#define REGION_SIZE (0x10000)
+#define ALIGN (64)
+
+static uint8_t region[REGION_SIZE];
+static struct icap_arena arena;
+static struct icap_host_pair pair;
+static uint32_t next_buf_id;
+
+static void check_stats(uint32_t used, uint32_t used_blocks, uint32_t free_blocks)
+{
+	struct icap_arena_stats stats;
+
+	icap_arena_get_stats(&arena, &stats);
+	TEST_CHECK_EQ(stats.total, REGION_SIZE);
+	TEST_CHECK_EQ(stats.used, used);
+	TEST_CHECK_EQ(stats.free, REGION_SIZE - used);
+	TEST_CHECK_EQ(stats.used_blocks, used_blocks);
+	TEST_CHECK_EQ(stats.free_blocks, free_blocks);
+}
+
+static void test_init(void)
+{
+	struct icap_arena_stats stats;
+
+	TEST_CHECK_EQ(icap_arena_init(&arena, NULL, REGION_ADDR, REGION_SIZE, 48, 0), -ICAP_ERROR_INVALID);
+	TEST_CHECK_EQ(icap_arena_init(&arena, NULL, REGION_ADDR, REGION_SIZE, 2, 0), -ICAP_ERROR_INVALID);
+	TEST_CHECK_EQ(icap_arena_init(&arena, NULL, REGION_ADDR, REGION_SIZE, ALIGN, 16), -ICAP_ERROR_INVALID);
+	TEST_CHECK_EQ(icap_arena_init(&arena, NULL, REGION_ADDR, ALIGN - 1, ALIGN, 0), -ICAP_ERROR_NOMEM);
+
+	/* An unaligned region loses its head and tail */
+	TEST_CHECK_EQ(icap_arena_init(&arena, NULL, REGION_ADDR + 8, REGION_SIZE, ALIGN, 0), 0);
+	icap_arena_get_stats(&arena, &stats);
+	TEST_CHECK_EQ(stats.free, REGION_SIZE - ALIGN);
+	TEST_CHECK_EQ(stats.largest_free, REGION_SIZE - ALIGN);
+	TEST_CHECK_EQ(stats.free_blocks, 1);
+
+	TEST_CHECK_EQ(icap_arena_init(&arena, NULL, REGION_ADDR, REGION_SIZE, ALIGN, 0), 0);
+	check_stats(0, 0, 1);
+}
+
+static void test_alloc_free(void)
+{
+	struct icap_arena_stats stats;
+	uint32_t off[4];
+
+	TEST_CHECK_EQ(icap_arena_init(&arena, NULL, REGION_ADDR, REGION_SIZE, ALIGN, 0), 0);
+	TEST_CHECK_EQ(icap_arena_alloc(&arena, 0, &off[0]), -ICAP_ERROR_INVALID);
+	TEST_CHECK_EQ(icap_arena_alloc(&arena, REGION_SIZE + 1, &off[0]), -ICAP_ERROR_INVALID);
+
+	/* Sizes are rounded up to the alignment */
+	TEST_CHECK_EQ(icap_arena_alloc(&arena, 1, &off[0]), 0);
+	TEST_CHECK_EQ(icap_arena_alloc(&arena, ALIGN + 1, &off[1]), 0);
+	TEST_CHECK_EQ(icap_arena_alloc(&arena, ALIGN, &off[2]), 0);
+	TEST_CHECK_EQ(icap_arena_alloc(&arena, 0x1000, &off[3]), 0);
+	TEST_CHECK_EQ(off[0] % ALIGN, 0);
+	TEST_CHECK_EQ(off[1] % ALIGN, 0);
+	TEST_CHECK_EQ(off[2] % ALIGN, 0);
+	TEST_CHECK_EQ(off[3] % ALIGN, 0);
+	check_stats(4 * ALIGN + 0x1000, 4, 1);
+
+	TEST_CHECK_EQ(icap_arena_free(&arena, off[1] + ALIGN), -ICAP_ERROR_INVALID);
+	TEST_CHECK_EQ(icap_arena_free(&arena, REGION_SIZE - ALIGN), -ICAP_ERROR_INVALID);
+
+	/* Freed neighbours coalesce in either order */
+	TEST_CHECK_EQ(icap_arena_free(&arena, off[0]), 0);
+	TEST_CHECK_EQ(icap_arena_free(&arena, off[0]), -ICAP_ERROR_INVALID);
+	TEST_CHECK_EQ(icap_arena_free(&arena, off[2]), 0);
+	check_stats(2 * ALIGN + 0x1000, 2, 3);
+	TEST_CHECK_EQ(icap_arena_free(&arena, off[1]), 0);
+	check_stats(0x1000, 1, 2);
+	icap_arena_get_stats(&arena, &stats);
+	TEST_CHECK_EQ(stats.largest_free, REGION_SIZE - 4 * ALIGN - 0x1000);
+	TEST_CHECK_EQ(icap_arena_free(&arena, off[3]), 0);
+	check_stats(0, 0, 1);
+	icap_arena_get_stats(&arena, &stats);
+	TEST_CHECK_EQ(stats.largest_free, REGION_SIZE);
+}
+
+static void test_nomem(void)
+{
+	struct icap_arena_stats stats;
+	uint32_t off[ICAP_ARENA_BLOCKS];
+	uint32_t num;
+	uint32_t i;
+
+	/* Exhaust the region */
+	TEST_CHECK_EQ(icap_arena_init(&arena, NULL, REGION_ADDR, REGION_SIZE, ALIGN, 0), 0);
+	TEST_CHECK_EQ(icap_arena_alloc(&arena, REGION_SIZE / 2, &off[0]), 0);
+	TEST_CHECK_EQ(icap_arena_alloc(&arena, REGION_SIZE / 2, &off[1]), 0);
+	TEST_CHECK_EQ(icap_arena_alloc(&arena, 1, &off[2]), -ICAP_ERROR_NOMEM);
+	check_stats(REGION_SIZE, 2, 0);
+
+	/* Enough free bytes but no block big enough */
+	TEST_CHECK_EQ(icap_arena_init(&arena, NULL, REGION_ADDR, REGION_SIZE, ALIGN, 0), 0);
+	for (i = 0; i < 4; i++) {
+		TEST_CHECK_EQ(icap_arena_alloc(&arena, REGION_SIZE / 4, &off[i]), 0);
+	}
+	TEST_CHECK_EQ(icap_arena_free(&arena, off[0]), 0);
+	TEST_CHECK_EQ(icap_arena_free(&arena, off[2]), 0);
+	TEST_CHECK_EQ(icap_arena_alloc(&arena, REGION_SIZE / 2, &off[0]), -ICAP_ERROR_NOMEM);
+	TEST_CHECK_EQ(icap_arena_alloc(&arena, REGION_SIZE / 4, &off[0]), 0);
+
+	/* Running out of table entries leaves the last block unsplit */
+	TEST_CHECK_EQ(icap_arena_init(&arena, NULL, REGION_ADDR, REGION_SIZE, ALIGN, 0), 0);
+	for (num = 0; num < ICAP_ARENA_BLOCKS; num++) {
+		if (icap_arena_alloc(&arena, ALIGN, &off[num])) {
+			break;
+		}
+	}
+	TEST_CHECK_EQ(num, ICAP_ARENA_BLOCKS);
+	icap_arena_get_stats(&arena, &stats);
+	TEST_CHECK_EQ(stats.used, REGION_SIZE);
+	TEST_CHECK_EQ(stats.used_blocks, ICAP_ARENA_BLOCKS);
+	for (i = 0; i < num; i++) {
+		TEST_CHECK_EQ(icap_arena_free(&arena, off[i]), 0);
+	}
+	check_stats(0, 0, 1);
+}
+
+static void test_guard(void)
+{
+	uint32_t off[2];
+
+	memset(region, 0, sizeof(region));
+	TEST_CHECK_EQ(icap_arena_init(&arena, region, REGION_ADDR, REGION_SIZE, ALIGN, 8), 0);
+	TEST_CHECK_EQ(icap_arena_alloc(&arena, 100, &off[0]), 0);
+	TEST_CHECK_EQ(icap_arena_alloc(&arena, ALIGN, &off[1]), 0);
+	TEST_CHECK_EQ(icap_arena_check(&arena), 0);
+
+	/* The guard follows the requested size and may need another line */
+	TEST_CHECK_EQ(off[1] - off[0], 2 * ALIGN);
+	TEST_CHECK_EQ(region[off[0] + 100], ICAP_ARENA_GUARD_PATTERN);
+	check_stats(4 * ALIGN, 2, 1);
+
+	/* Writing within the block is fine, one byte past it isn't */
+	memset(&region[off[0]], 0x11, 100);
+	memset(&region[off[1]], 0x22, ALIGN);
+	TEST_CHECK_EQ(icap_arena_check(&arena), 0);
+	region[off[0] + 100] = 0;
+	region[off[1] + ALIGN + 7] = 0;
+	TEST_CHECK_EQ(icap_arena_check(&arena), 2);
+
+	/* Freed blocks aren't checked */
+	TEST_CHECK_EQ(icap_arena_free(&arena, off[1]), 0);
+	TEST_CHECK_EQ(icap_arena_check(&arena), 1);
+	TEST_CHECK_EQ(icap_arena_alloc(&arena, REGION_SIZE - 8, &off[1]), -ICAP_ERROR_NOMEM);
+	TEST_CHECK_EQ(icap_arena_alloc(&arena, REGION_SIZE - 7, &off[1]), -ICAP_ERROR_INVALID);
+}
+
+static void test_alloc_buf(void)
+{
+	struct icap_buf_descriptor buf;
+
+	TEST_CHECK_EQ(icap_arena_init(&arena, NULL, REGION_ADDR, REGION_SIZE, ALIGN, 0), 0);
+
+	/* Fragments of 100 bytes with a 20 byte gap start on every 128 bytes */
+	memset(&buf, 0, sizeof(buf));
+	buf.type = ICAP_BUF_CIRCURAL;
+	buf.frag_size = 100;
+	buf.gap_size = 20;
+	buf.buf_size = 4 * 120 - 20;
+	TEST_CHECK_EQ(icap_arena_alloc_buf(&arena, &buf), 0);
+	TEST_CHECK_EQ(buf.buf, REGION_ADDR);
+	TEST_CHECK_EQ(buf.gap_size, 28);
+	TEST_CHECK_EQ(buf.buf_size, 4 * 128 - 28);
+	check_stats(4 * 128, 1, 1);
+
+	/* Planar buffers get one aligned plane per channel */
+	memset(&buf, 0, sizeof(buf));
+	buf.type = ICAP_BUF_PLANAR;
+	buf.frag_size = 96;
+	buf.buf_size = 3 * 96;
+	buf.channels = 2;
+	TEST_CHECK_EQ(icap_arena_alloc_buf(&arena, &buf), 0);
+	TEST_CHECK_EQ(buf.buf, REGION_ADDR + 4 * 128);
+	TEST_CHECK_EQ(buf.gap_size, 32);
+	TEST_CHECK_EQ(buf.buf_size, 3 * 128 - 32);
+	TEST_CHECK_EQ(buf.channel_stride, 3 * 128);
+	check_stats(4 * 128 + 2 * 3 * 128, 2, 1);
+
+	/* Scattered buffers are allocated as they are */
+	memset(&buf, 0, sizeof(buf));
+	buf.type = ICAP_BUF_SCATTERED;
+	buf.frag_size = 100;
+	buf.buf_size = 1000;
+	TEST_CHECK_EQ(icap_arena_alloc_buf(&arena, &buf), 0);
+	TEST_CHECK_EQ(buf.buf_size, 1000);
+	check_stats(4 * 128 + 2 * 3 * 128 + 1024, 3, 1);
+
+	/* Invalid and oversized buffers */
+	memset(&buf, 0, sizeof(buf));
+	buf.type = ICAP_BUF_CIRCURAL;
+	buf.buf_size = 1000;
+	TEST_CHECK_EQ(icap_arena_alloc_buf(&arena, &buf), -ICAP_ERROR_INVALID);
+	buf.frag_size = 2000;
+	TEST_CHECK_EQ(icap_arena_alloc_buf(&arena, &buf), -ICAP_ERROR_INVALID);
+	buf.type = ICAP_BUF_PLANAR;
+	buf.frag_size = REGION_SIZE / 4;
+	buf.buf_size = REGION_SIZE / 2;
+	buf.channels = 4;
+	TEST_CHECK_EQ(icap_arena_alloc_buf(&arena, &buf), -ICAP_ERROR_NOMEM);
+}
+
+static void test_bind(void)
+{
+	uint32_t off[2];
+
+	TEST_CHECK_EQ(icap_arena_init(&arena, NULL, REGION_ADDR, REGION_SIZE, ALIGN, 0), 0);
+	TEST_CHECK_EQ(icap_arena_alloc(&arena, 0x100, &off[0]), 0);
+	TEST_CHECK_EQ(icap_arena_alloc(&arena, 0x100, &off[1]), 0);
+
+	/* Any address within an allocated block binds it */
+	TEST_CHECK_EQ(icap_arena_bind(&arena, REGION_ADDR + off[0] + 0x80, 1), 0);
+	TEST_CHECK_EQ(icap_arena_bind(&arena, REGION_ADDR + off[1], 2), 0);
+	TEST_CHECK_EQ(icap_arena_bind(&arena, REGION_ADDR - 1, 3), -ICAP_ERROR_INVALID);
+	TEST_CHECK_EQ(icap_arena_bind(&arena, REGION_ADDR + REGION_SIZE, 3), -ICAP_ERROR_INVALID);
+	TEST_CHECK_EQ(icap_arena_bind(&arena, REGION_ADDR + 0x1000, 3), -ICAP_ERROR_INVALID);
+
+	/* An unbound block stays allocated */
+	TEST_CHECK_EQ(icap_arena_unbind(&arena, 2), 0);
+	TEST_CHECK_EQ(icap_arena_unbind(&arena, 2), -ICAP_ERROR_INVALID);
+	TEST_CHECK_EQ(icap_arena_release(&arena, 2), -ICAP_ERROR_INVALID);
+	check_stats(0x200, 2, 1);
+
+	TEST_CHECK_EQ(icap_arena_release(&arena, 1), 0);
+	TEST_CHECK_EQ(icap_arena_release(&arena, 1), -ICAP_ERROR_INVALID);
+	check_stats(0x100, 1, 2);
+	TEST_CHECK_EQ(icap_arena_free(&arena, off[1]), 0);
+	check_stats(0, 0, 1);
+}
+
+static int32_t dev_add_buf(struct icap_instance *icap, struct icap_buf_descriptor *buf)
+{
+	return next_buf_id++;
+}
+
+static int32_t dev_remove_buf(struct icap_instance *icap, uint32_t buf_id)
+{
+	return 0;
+}
+
+static int32_t dev_switch_buf(struct icap_instance *icap, struct icap_buf_switch *buf_switch)
+{
+	return next_buf_id++;
+}
+
+static void test_set_arena(void)
+{
+	struct icap_application_callbacks app_cb;
+	struct icap_device_callbacks dev_cb;
+	struct icap_buf_descriptor buf;
+	struct icap_buf_switch buf_switch;
+	int32_t src;
+	int32_t dst;
+	int32_t next;
+
+	memset(&app_cb, 0, sizeof(app_cb));
+	memset(&dev_cb, 0, sizeof(dev_cb));
+	dev_cb.add_src = dev_add_buf;
+	dev_cb.add_dst = dev_add_buf;
+	dev_cb.remove_src = dev_remove_buf;
+	dev_cb.remove_dst = dev_remove_buf;
+	dev_cb.switch_buf = dev_switch_buf;
+	TEST_CHECK_EQ(icap_host_pair_init(&pair, &app_cb, &dev_cb), 0);
+	TEST_CHECK_EQ(icap_arena_init(&arena, NULL, REGION_ADDR, REGION_SIZE, ALIGN, 0), 0);
+	TEST_CHECK_EQ(icap_set_arena(&pair.app, &arena), 0);
+
+	memset(&buf, 0, sizeof(buf));
+	buf.type = ICAP_BUF_CIRCURAL;
+	buf.frag_size = 0x100;
+	buf.buf_size = 0x400;
+	TEST_CHECK_EQ(icap_arena_alloc_buf(&arena, &buf), 0);
+	src = icap_add_src(&pair.app, &buf);
+	TEST_CHECK(src >= 0);
+	TEST_CHECK_EQ(icap_arena_alloc_buf(&arena, &buf), 0);
+	dst = icap_add_dst(&pair.app, &buf);
+	TEST_CHECK(dst >= 0);
+	check_stats(0x800, 2, 1);
+
+	/* The replaced block stays allocated, it's read until the switch point */
+	memset(&buf_switch, 0, sizeof(buf_switch));
+	buf_switch.buf_id = src;
+	buf_switch.buf = buf;
+	TEST_CHECK_EQ(icap_arena_alloc_buf(&arena, &buf_switch.buf), 0);
+	next = icap_switch_buf(&pair.app, &buf_switch);
+	TEST_CHECK(next >= 0);
+	check_stats(0xc00, 3, 1);
+	TEST_CHECK_EQ(icap_arena_release(&arena, src), -ICAP_ERROR_INVALID);
+	TEST_CHECK_EQ(icap_arena_free(&arena, 0), 0);
+
+	/* Removing a buffer releases its block */
+	TEST_CHECK_EQ(icap_remove_src(&pair.app, next), 0);
+	TEST_CHECK_EQ(icap_remove_dst(&pair.app, dst), 0);
+	check_stats(0, 0, 1);
+
+	TEST_CHECK_EQ(icap_set_arena(&pair.app, NULL), 0);
+}
+
+int main(void)
+{
+	test_init();
+	test_alloc_free();
+	test_nomem();
+	test_guard();
+	test_alloc_buf();
+	test_bind();
+	test_set_arena();
+	return TEST_RESULT();
+}
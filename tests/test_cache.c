@@ -0,0 +1,261 @@
+/*
+ * Cache maintenance, icap_set_cache(), on both sides of the host pair.
+ */
+
+#include <string.h>
+#include "rpmsg_lite.h"
+#include "icap_host.h"
+#include "icap_cache.h"
+#include "test.h"
+
+#define OPS_MAX (256)
+
+struct op {
+	struct icap_instance *icap;
+	uint32_t clean;
+	uint32_t buf_id;
+	uint64_t addr;
+	uint32_t size;
+};
+
+static struct icap_host_pair pair;
+static struct icap_cache app_cache;
+static struct icap_cache dev_cache;
+static struct op ops[OPS_MAX];
+static uint32_t ops_num;
+static uint32_t next_buf_id;
+static uint32_t dev_frags_calls;
+
+static void log_op(struct icap_instance *icap, uint32_t clean, uint32_t buf_id, uint64_t addr, uint32_t size)
+{
+	if (ops_num < OPS_MAX) {
+		ops[ops_num].icap = icap;
+		ops[ops_num].clean = clean;
+		ops[ops_num].buf_id = buf_id;
+		ops[ops_num].addr = addr;
+		ops[ops_num].size = size;
+	}
+	ops_num++;
+}
+
+static void cache_clean(struct icap_instance *icap, uint32_t buf_id, uint64_t addr, uint32_t size)
+{
+	log_op(icap, 1, buf_id, addr, size);
+}
+
+static void cache_invalidate(struct icap_instance *icap, uint32_t buf_id, uint64_t addr, uint32_t size)
+{
+	log_op(icap, 0, buf_id, addr, size);
+}
+
+static const struct icap_cache_ops cache_ops = {
+	.clean = cache_clean,
+	.invalidate = cache_invalidate,
+};
+
+/* Returns the only op logged by icap since the last call */
+static struct op *single_op(struct icap_instance *icap)
+{
+	struct op *found = NULL;
+	uint32_t num = 0;
+	uint32_t i;
+
+	for (i = 0; (i < ops_num) && (i < OPS_MAX); i++) {
+		if (ops[i].icap == icap) {
+			found = &ops[i];
+			num++;
+		}
+	}
+	TEST_CHECK_EQ(num, 1);
+	return num == 1 ? found : NULL;
+}
+
+static int32_t dev_add_src(struct icap_instance *icap, struct icap_buf_descriptor *buf)
+{
+	return next_buf_id++;
+}
+
+static int32_t dev_switch_buf(struct icap_instance *icap, struct icap_buf_switch *buf_switch)
+{
+	return next_buf_id++;
+}
+
+static int32_t dev_frags(struct icap_instance *icap, struct icap_buf_offsets *offsets)
+{
+	dev_frags_calls++;
+	return 0;
+}
+
+static int32_t dev_subdevice_init(struct icap_instance *icap, struct icap_subdevice_params *params)
+{
+	return 0;
+}
+
+static int32_t app_frag_ready(struct icap_instance *icap, struct icap_buf_frags *frags)
+{
+	return 0;
+}
+
+static struct icap_application_callbacks app_cb = {
+	.frag_ready = app_frag_ready,
+};
+static struct icap_device_callbacks dev_cb = {
+	.subdevice_init = dev_subdevice_init,
+	.add_src = dev_add_src,
+	.switch_buf = dev_switch_buf,
+	.frags = dev_frags,
+};
+
+static void pair_init(void)
+{
+	TEST_CHECK_EQ(icap_host_pair_init(&pair, &app_cb, &dev_cb), 0);
+	TEST_CHECK_EQ(icap_set_cache(&pair.app, &app_cache, &cache_ops), 0);
+	TEST_CHECK_EQ(icap_set_cache(&pair.dev, &dev_cache, &cache_ops), 0);
+	next_buf_id = 0;
+}
+
+static void buf_init(struct icap_buf_descriptor *buf, uint64_t addr)
+{
+	memset(buf, 0, sizeof(*buf));
+	buf->buf = addr;
+	buf->frag_size = 0x100;
+	buf->gap_size = 0x80;
+	buf->buf_size = 4 * 0x180 - 0x80;
+}
+
+/* Device reports one playback fragment, returns the address the application cleaned */
+static uint64_t report(uint32_t dev_id)
+{
+	struct icap_buf_frags frags = {dev_id, 1};
+	struct op *dev_op, *app_op;
+
+	ops_num = 0;
+	TEST_CHECK_EQ(icap_frag_ready(&pair.dev, &frags), 0);
+	dev_op = single_op(&pair.dev);
+	app_op = single_op(&pair.app);
+	if ((dev_op == NULL) || (app_op == NULL)) {
+		return 0;
+	}
+	/* The device invalidates, the application cleans the same fragment */
+	TEST_CHECK_EQ(dev_op->clean, 0);
+	TEST_CHECK_EQ(app_op->clean, 1);
+	TEST_CHECK_EQ(dev_op->addr, app_op->addr);
+	TEST_CHECK_EQ(app_op->size, 0x100);
+	return app_op->addr;
+}
+
+static void test_playback(void)
+{
+	struct icap_buf_descriptor buf;
+	uint32_t i;
+
+	pair_init();
+	buf_init(&buf, 0x10000);
+	TEST_CHECK_EQ(icap_add_src(&pair.app, &buf), 0);
+	for (i = 0; i < 6; i++) {
+		TEST_CHECK_EQ(report(0), 0x10000 + (i % 4) * 0x180);
+	}
+}
+
+static void test_switch(void)
+{
+	struct icap_buf_switch buf_switch;
+	struct icap_buf_descriptor buf;
+	int32_t id;
+
+	pair_init();
+	buf_init(&buf, 0x10000);
+	TEST_CHECK_EQ(icap_add_src(&pair.app, &buf), 0);
+	TEST_CHECK_EQ(report(0), 0x10000);
+
+	memset(&buf_switch, 0, sizeof(buf_switch));
+	buf_switch.buf_id = 0;
+	buf_switch.frag = 3;
+	buf_init(&buf_switch.buf, 0x20000);
+	id = icap_switch_buf(&pair.app, &buf_switch);
+	TEST_CHECK_EQ(id, 1);
+
+	/* The old buffer is still maintained up to the switch point */
+	TEST_CHECK_EQ(report(0), 0x10180);
+	TEST_CHECK_EQ(report(0), 0x10300);
+	TEST_CHECK_EQ(report(1), 0x20000);
+	TEST_CHECK_EQ(report(1), 0x20180);
+
+	/* and released after it */
+	ops_num = 0;
+	{
+		struct icap_buf_frags frags = {0, 1};
+		icap_frag_ready(&pair.dev, &frags);
+	}
+	TEST_CHECK_EQ(ops_num, 0);
+}
+
+static void test_resume(void)
+{
+	struct icap_subdevice_params sp = {0, 2, 0, 48000};
+	struct icap_buf_descriptor buf;
+
+	pair_init();
+	TEST_CHECK_EQ(icap_subdevice_init(&pair.app, &sp), 0);
+	buf_init(&buf, 0x10000);
+	TEST_CHECK_EQ(icap_add_src(&pair.app, &buf), 0);
+	TEST_CHECK_EQ(report(0), 0x10000);
+	TEST_CHECK_EQ(report(0), 0x10180);
+
+	/* The restarted device starts the replayed buffer at its first fragment */
+	memset(dev_cache.bufs, 0, sizeof(dev_cache.bufs));
+	next_buf_id = 0;
+	TEST_CHECK_EQ(icap_session_resume(&pair.app), 0);
+	TEST_CHECK_EQ(report(0), 0x10000);
+}
+
+static void test_offsets_full(void)
+{
+	struct icap_buf_descriptor buf;
+	struct icap_buf_offsets offsets;
+	uint32_t i;
+
+	pair_init();
+	memset(&buf, 0, sizeof(buf));
+	buf.type = ICAP_BUF_SCATTERED;
+	buf.buf = 0x40000;
+	buf.frag_size = 0x100;
+	buf.buf_size = 0x10000;
+	TEST_CHECK_EQ(icap_add_src(&pair.app, &buf), 0);
+
+	memset(&offsets, 0, sizeof(offsets));
+	offsets.buf_id = 0;
+	offsets.num = ICAP_BUF_MAX_FRAGS_OFFSETS_NUM;
+	for (i = 0; i < offsets.num; i++)
+		offsets.frags_offsets[i] = i * 0x100;
+	for (i = 0; i < ICAP_FRAG_QUEUE_SIZE / ICAP_BUF_MAX_FRAGS_OFFSETS_NUM; i++)
+		TEST_CHECK_EQ(icap_frags(&pair.app, &offsets), 0);
+
+	/* The application queue is full, the ranges are still cleaned, nothing is sent */
+	ops_num = 0;
+	dev_frags_calls = 0;
+	offsets.num = 2;
+	TEST_CHECK_EQ(icap_frags(&pair.app, &offsets), -ICAP_ERROR_NOMEM);
+	TEST_CHECK_EQ(ops_num, 2);
+	TEST_CHECK_EQ(ops[0].clean, 1);
+	TEST_CHECK_EQ(ops[1].addr, 0x40100);
+	TEST_CHECK_EQ(dev_frags_calls, 0);
+
+	/* The device rejects offsets it can't track, after maintaining them */
+	TEST_CHECK_EQ(icap_set_cache(&pair.app, NULL, NULL), 0);
+	ops_num = 0;
+	TEST_CHECK_EQ(icap_frags(&pair.app, &offsets), -ICAP_ERROR_NOMEM);
+	TEST_CHECK_EQ(ops_num, 2);
+	TEST_CHECK(ops[0].icap == &pair.dev);
+	TEST_CHECK_EQ(ops[0].clean, 0);
+	TEST_CHECK_EQ(dev_frags_calls, 0);
+}
+
+int main(void)
+{
+	test_playback();
+	test_switch();
+	test_resume();
+	test_offsets_full();
+	return TEST_RESULT();
+}
@@ -0,0 +1,146 @@
+/*
+ * Device clock estimation from timestamped reports, icap_get_clock_sync().
+ */
+
+#include <string.h>
+#include "rpmsg_lite.h"
+#include "icap_host.h"
+#include "test.h"
+
+/* Device clock runs 100 ppm faster than the local one */
+#define PPM (100)
+#define PERIOD_US (1000)
+#define REPORTS (4000)
+#define LOCAL_START_US (1000000)
+
+static struct icap_host_pair pair;
+static uint32_t rand_state = 1;
+
+static int32_t dev_subdevice_init(struct icap_instance *icap, struct icap_subdevice_params *params)
+{
+	return 0;
+}
+
+static struct icap_application_callbacks app_cb;
+static struct icap_device_callbacks dev_cb = {
+	.subdevice_init = dev_subdevice_init,
+};
+
+static uint32_t rand_next(void)
+{
+	rand_state = rand_state * 1103515245 + 12345;
+	return (rand_state >> 16) & 0x7fff;
+}
+
+/* Local time in microseconds at which the device time passes dev_us */
+static uint64_t true_local_us(uint64_t dev_us)
+{
+	return LOCAL_START_US + dev_us - dev_us * PPM / 1000000;
+}
+
+static int64_t abs64(int64_t val)
+{
+	return val < 0 ? -val : val;
+}
+
+/* The device learns the application address from the first request */
+static void setup(void)
+{
+	struct icap_subdevice_params params = {0, 2, 0, 48000};
+
+	TEST_CHECK_EQ(icap_host_pair_init(&pair, &app_cb, &dev_cb), 0);
+	TEST_CHECK_EQ(icap_subdevice_init(&pair.app, &params), 0);
+}
+
+/* Reports every PERIOD_US of device time, arriving up to jitter_us late */
+static void feed(uint32_t reports, uint32_t jitter_us)
+{
+	struct icap_buf_frags_ts ts;
+	uint64_t dev_us;
+	uint32_t i;
+
+	memset(&ts, 0, sizeof(ts));
+	for (i = 1; i <= reports; i++) {
+		dev_us = (uint64_t)i * PERIOD_US;
+		ts.frags.frags = 1;
+		ts.timestamp = dev_us * 1000;
+		ts.position = i * 48;
+		rpmsg_lite_host_set_clock(true_local_us(dev_us) + (jitter_us ? rand_next() % jitter_us : 0), 0);
+		TEST_CHECK_EQ(icap_frag_ready_ts(&pair.dev, &ts), 0);
+	}
+}
+
+static void check_estimate(uint32_t drift_tol_ppb, uint32_t time_tol_us)
+{
+	struct icap_clock_sync sync;
+	uint64_t dev_us = (uint64_t)REPORTS * PERIOD_US;
+	uint64_t local_ns;
+
+	TEST_CHECK_EQ(icap_get_clock_sync(&pair.app, &sync), 0);
+	TEST_CHECK(abs64(sync.drift_ppb - PPM * 1000) <= drift_tol_ppb);
+	TEST_CHECK(sync.dev_timestamp == dev_us * 1000);
+	TEST_CHECK(sync.position == REPORTS * 48);
+	TEST_CHECK(abs64(sync.local_timestamp - true_local_us(dev_us) * 1000) <= time_tol_us * 1000);
+	TEST_CHECK_EQ(sync.offset, (int64_t)(sync.local_timestamp - sync.dev_timestamp));
+
+	/* Device time half a second ahead maps to the local time */
+	dev_us += 500000;
+	local_ns = icap_dev_to_local_time(&pair.app, dev_us * 1000);
+	TEST_CHECK(abs64(local_ns - true_local_us(dev_us) * 1000) <= time_tol_us * 1000);
+
+	/* Local time since the last report */
+	rpmsg_lite_host_set_clock(sync.local_timestamp / 1000 + 300, 0);
+	TEST_CHECK_EQ(icap_get_clock_sync(&pair.app, &sync), 0);
+	TEST_CHECK(abs64(sync.delay - 300000) <= 1000);
+}
+
+static void test_no_reports(void)
+{
+	struct icap_clock_sync sync;
+
+	setup();
+	TEST_CHECK_EQ(icap_get_clock_sync(&pair.app, NULL), -ICAP_ERROR_INVALID);
+	TEST_CHECK_EQ(icap_get_clock_sync(&pair.app, &sync), -ICAP_ERROR_INIT);
+}
+
+static void test_converge(void)
+{
+	setup();
+	feed(REPORTS, 0);
+	check_estimate(1000, 2);
+}
+
+static void test_jitter(void)
+{
+	setup();
+	/* The filtered time follows the mean arrival delay */
+	feed(REPORTS, 50);
+	check_estimate(15000, 50);
+}
+
+/* Conversion far from the last report doesn't overflow */
+static void test_long_interval(void)
+{
+	struct icap_clock_est *clk = &pair.app.clock;
+	int64_t delta = (int64_t)1 << 45;
+	uint64_t local;
+
+	clk->samples = 1;
+	clk->dev_base = 1000;
+	clk->local_base = 5000;
+	/* -100 ppm in Q32 */
+	clk->rate_dev = -429497;
+	local = icap_dev_to_local_time(&pair.app, 1000 + delta);
+	TEST_CHECK(abs64(local - (5000 + delta - (delta / 10000))) <= delta / 10000000);
+	local = icap_dev_to_local_time(&pair.app, 1000 - delta);
+	TEST_CHECK(abs64(local - (5000 - delta + (delta / 10000))) <= delta / 10000000);
+}
+
+int main(void)
+{
+	test_no_reports();
+	test_converge();
+	test_jitter();
+	test_long_interval();
+	return TEST_RESULT();
+}
@@ -0,0 +1,113 @@
+/*
+ * Shared control block, icap_ctrl.c, and its replay by icap_session_resume().
+ */
+
+#include <string.h>
+#include "rpmsg_lite.h"
+#include "icap_host.h"
+#include "icap_ctrl.h"
+#include "test.h"
+
+static struct icap_host_pair pair;
+static struct icap_ctrl_block block;
+static struct icap_ctrl_desc dev_desc;
+static uint32_t dev_ctrl_blocks;
+
+static int32_t dev_ctrl_block(struct icap_instance *icap, struct icap_ctrl_desc *desc)
+{
+	dev_ctrl_blocks++;
+	memcpy(&dev_desc, desc, sizeof(dev_desc));
+	return 0;
+}
+
+static int32_t dev_subdevice_init(struct icap_instance *icap, struct icap_subdevice_params *params)
+{
+	return 0;
+}
+
+static struct icap_application_callbacks app_cb;
+static struct icap_device_callbacks dev_cb = {
+	.subdevice_init = dev_subdevice_init,
+	.ctrl_block = dev_ctrl_block,
+};
+
+static void test_params(void)
+{
+	struct icap_ctrl_params params, read;
+
+	icap_ctrl_init(&block);
+	TEST_CHECK_EQ(icap_ctrl_read_params(&block, &read), 0);
+	TEST_CHECK_EQ(read.gain, 1 << 16);
+	TEST_CHECK_EQ(read.mute, 0);
+
+	memset(&params, 0, sizeof(params));
+	params.gain = 0x8000;
+	params.mute = 1;
+	params.channel_mask = 0x3;
+	icap_ctrl_write_params(&block, &params);
+	TEST_CHECK_EQ(icap_ctrl_read_params(&block, &read), 0);
+	TEST_CHECK(memcmp(&read, &params, sizeof(params)) == 0);
+	TEST_CHECK_EQ(block.params_seq & 1, 0);
+
+	/* A writer stuck in the middle of an update */
+	block.params_seq++;
+	read.gain = 123;
+	TEST_CHECK_EQ(icap_ctrl_read_params(&block, &read), -ICAP_ERROR_BUSY);
+	TEST_CHECK_EQ(read.gain, 123);
+	block.params_seq++;
+}
+
+static void test_meters(void)
+{
+	struct icap_ctrl_meters meters, read;
+
+	memset(&meters, 0, sizeof(meters));
+	meters.frames = 0x100000000ull;
+	meters.peak[0] = 0x40000000;
+	icap_ctrl_write_meters(&block, &meters);
+	TEST_CHECK_EQ(icap_ctrl_read_meters(&block, &read), 0);
+	TEST_CHECK(memcmp(&read, &meters, sizeof(meters)) == 0);
+	block.meters_seq++;
+	TEST_CHECK_EQ(icap_ctrl_read_meters(&block, &read), -ICAP_ERROR_BUSY);
+	block.meters_seq++;
+}
+
+static void test_resume(void)
+{
+	struct icap_subdevice_params sp = {2, 2, 0, 48000};
+	struct icap_ctrl_desc desc;
+
+	TEST_CHECK_EQ(icap_host_pair_init(&pair, &app_cb, &dev_cb), 0);
+	TEST_CHECK_EQ(icap_subdevice_init(&pair.app, &sp), 0);
+
+	desc.subdev_id = 2;
+	desc.addr = (uintptr_t)&block;
+	desc.size = sizeof(block) - 1;
+	TEST_CHECK_EQ(icap_set_ctrl_block(&pair.app, &desc), -ICAP_ERROR_INVALID);
+	desc.size = sizeof(block);
+	TEST_CHECK_EQ(icap_set_ctrl_block(&pair.app, &desc), 0);
+	TEST_CHECK_EQ(dev_ctrl_blocks, 1);
+
+	dev_ctrl_blocks = 0;
+	memset(&dev_desc, 0, sizeof(dev_desc));
+	TEST_CHECK_EQ(icap_session_resume(&pair.app), 0);
+	TEST_CHECK_EQ(dev_ctrl_blocks, 1);
+	TEST_CHECK_EQ(dev_desc.subdev_id, 2);
+	TEST_CHECK_EQ(dev_desc.addr, (uintptr_t)&block);
+	TEST_CHECK_EQ(dev_desc.size, sizeof(block));
+
+	/* Detached blocks aren't replayed */
+	desc.addr = 0;
+	TEST_CHECK_EQ(icap_set_ctrl_block(&pair.app, &desc), 0);
+	dev_ctrl_blocks = 0;
+	TEST_CHECK_EQ(icap_session_resume(&pair.app), 0);
+	TEST_CHECK_EQ(dev_ctrl_blocks, 0);
+}
+
+int main(void)
+{
+	test_params();
+	test_meters();
+	test_resume();
+	return TEST_RESULT();
+}
@@ -0,0 +1,169 @@
+/*
+ * DMA descriptor ring, icap_dma.c.
+ */
+
+#include <string.h>
+#include "icap_dma.h"
+#include "test.h"
+
+static uint32_t writes;
+static uint32_t last_write;
+
+static void write_desc(struct icap_dma_chain *chain, uint32_t index, const struct icap_dma_desc *desc)
+{
+	writes++;
+	last_write = index;
+}
+
+static void test_circular(void)
+{
+	static struct icap_dma_chain chain;
+	struct icap_buf_descriptor buf;
+	uint32_t i;
+
+	memset(&buf, 0, sizeof(buf));
+	buf.type = ICAP_BUF_CIRCURAL;
+	buf.frag_size = 0x100;
+	buf.gap_size = 0x40;
+	buf.buf_size = 5 * 0x140 - 0x40;
+
+	writes = 0;
+	TEST_CHECK_EQ(icap_dma_init(&chain, &buf, 0x80000000, write_desc, NULL), 0);
+	TEST_CHECK_EQ(chain.num, 5);
+	TEST_CHECK_EQ(writes, 5);
+	for (i = 0; i < 5; i++) {
+		TEST_CHECK_EQ(chain.descs[i].addr, 0x80000000 + i * 0x140);
+		TEST_CHECK_EQ(chain.descs[i].len, 0x100);
+		TEST_CHECK_EQ(chain.descs[i].flags, 0);
+	}
+	/* The ring wraps */
+	TEST_CHECK_EQ(chain.descs[3].next, 4);
+	TEST_CHECK_EQ(chain.descs[4].next, 0);
+	TEST_CHECK_EQ(icap_dma_pending(&chain), 5);
+	TEST_CHECK_EQ(icap_dma_push_offsets(&chain, NULL), -ICAP_ERROR_INVALID);
+
+	/* More fragments than records */
+	buf.gap_size = 0;
+	buf.buf_size = (ICAP_DMA_DESCS_MAX + 1) * 0x100;
+	TEST_CHECK_EQ(icap_dma_init(&chain, &buf, 0, NULL, NULL), -ICAP_ERROR_NOMEM);
+	buf.buf_size = ICAP_DMA_DESCS_MAX * 0x100;
+	TEST_CHECK_EQ(icap_dma_init(&chain, &buf, 0, NULL, NULL), 0);
+	TEST_CHECK_EQ(chain.descs[ICAP_DMA_DESCS_MAX - 1].next, 0);
+}
+
+static void test_planar(void)
+{
+	static struct icap_dma_chain chain;
+	struct icap_buf_descriptor buf;
+
+	memset(&buf, 0, sizeof(buf));
+	buf.type = ICAP_BUF_PLANAR;
+	buf.frag_size = 0x100;
+	buf.buf_size = 3 * 0x100;
+	buf.channels = 2;
+	buf.channel_stride = 0x1000;
+
+	TEST_CHECK_EQ(icap_dma_init(&chain, &buf, 0x10000, NULL, NULL), 0);
+	TEST_CHECK_EQ(chain.planes, 2);
+	TEST_CHECK_EQ(chain.num, 6);
+	/* Both planes of a fragment, then the next fragment */
+	TEST_CHECK_EQ(chain.descs[0].addr, 0x10000);
+	TEST_CHECK_EQ(chain.descs[1].addr, 0x11000);
+	TEST_CHECK_EQ(chain.descs[2].addr, 0x10100);
+	TEST_CHECK_EQ(chain.descs[5].addr, 0x11200);
+	TEST_CHECK_EQ(chain.descs[5].next, 0);
+
+	buf.channels = ICAP_DMA_DESCS_MAX / 3 + 1;
+	TEST_CHECK_EQ(icap_dma_init(&chain, &buf, 0, NULL, NULL), -ICAP_ERROR_NOMEM);
+}
+
+static void push(struct icap_dma_chain *chain, uint32_t first, uint32_t num, int32_t expected)
+{
+	struct icap_buf_offsets offsets;
+	uint32_t i;
+
+	memset(&offsets, 0, sizeof(offsets));
+	offsets.num = num;
+	for (i = 0; i < num; i++)
+		offsets.frags_offsets[i] = (first + i) * 0x100;
+	TEST_CHECK_EQ(icap_dma_push_offsets(chain, &offsets), expected);
+}
+
+static uint32_t stop_flags(struct icap_dma_chain *chain, uint32_t *index)
+{
+	uint32_t num = 0;
+	uint32_t i;
+
+	for (i = 0; i < ICAP_DMA_DESCS_MAX; i++) {
+		if (chain->descs[i].flags & ICAP_DMA_FLAG_STOP) {
+			*index = i;
+			num++;
+		}
+	}
+	return num;
+}
+
+static void test_scattered(void)
+{
+	static struct icap_dma_chain chain;
+	struct icap_buf_descriptor buf;
+	uint32_t index = 0;
+	uint32_t i;
+
+	memset(&buf, 0, sizeof(buf));
+	buf.type = ICAP_BUF_SCATTERED;
+	buf.frag_size = 0x100;
+	TEST_CHECK_EQ(icap_dma_init(&chain, &buf, 0x40000, write_desc, NULL), 0);
+	TEST_CHECK_EQ(chain.num, ICAP_DMA_DESCS_MAX);
+	TEST_CHECK_EQ(icap_dma_pending(&chain), 0);
+
+	/* Empty ring, the DMA must be started */
+	push(&chain, 0, 3, 1);
+	TEST_CHECK_EQ(icap_dma_pending(&chain), 3);
+	TEST_CHECK_EQ(stop_flags(&chain, &index), 1);
+	TEST_CHECK_EQ(index, 2);
+	TEST_CHECK_EQ(chain.descs[1].addr, 0x40100);
+
+	/* The stop flag moves to the new last record, cleared after the new records are written */
+	writes = 0;
+	push(&chain, 3, 2, 0);
+	TEST_CHECK_EQ(stop_flags(&chain, &index), 1);
+	TEST_CHECK_EQ(index, 4);
+	TEST_CHECK_EQ(writes, 3);
+	TEST_CHECK_EQ(last_write, 2);
+
+	icap_dma_complete(&chain, 2);
+	TEST_CHECK_EQ(icap_dma_pending(&chain), 3);
+	icap_dma_complete(&chain, 3);
+	TEST_CHECK_EQ(icap_dma_pending(&chain), 0);
+
+	/* Drained, restart again; the stale stop flag stays on the completed record */
+	push(&chain, 5, 1, 1);
+	TEST_CHECK_EQ(chain.descs[5].flags, ICAP_DMA_FLAG_STOP);
+
+	/* Full ring */
+	for (i = 1; i < ICAP_DMA_DESCS_MAX; i += 9)
+		push(&chain, i, ICAP_DMA_DESCS_MAX - i < 9 ? ICAP_DMA_DESCS_MAX - i : 9, 0);
+	TEST_CHECK_EQ(icap_dma_pending(&chain), ICAP_DMA_DESCS_MAX);
+	push(&chain, 0, 1, -ICAP_ERROR_NOMEM);
+	TEST_CHECK_EQ(icap_dma_pending(&chain), ICAP_DMA_DESCS_MAX);
+
+	/* Wraps over the ring end */
+	icap_dma_complete(&chain, 10);
+	push(&chain, 100, 10, 0);
+	TEST_CHECK_EQ(stop_flags(&chain, &index), 1);
+	TEST_CHECK_EQ(index, (5 + ICAP_DMA_DESCS_MAX + 10 - 1) & (ICAP_DMA_DESCS_MAX - 1));
+	TEST_CHECK_EQ(chain.descs[(5 + ICAP_DMA_DESCS_MAX) & (ICAP_DMA_DESCS_MAX - 1)].addr, 0x40000 + 100 * 0x100);
+
+	/* Empty push is a no-op, too many offsets are rejected */
+	push(&chain, 0, 0, 0);
+	push(&chain, 0, ICAP_BUF_MAX_FRAGS_OFFSETS_NUM + 1, -ICAP_ERROR_INVALID);
+}
+
+int main(void)
+{
+	test_circular();
+	test_planar();
+	test_scattered();
+	return TEST_RESULT();
+}
@@ -0,0 +1,191 @@
+/*
+ * Device processing chain, icap_dsp.c, and its replay by icap_session_resume().
+ */
+
+#include <math.h>
+#include <string.h>
+#include "rpmsg_lite.h"
+#include "icap_host.h"
+#include "icap_dsp.h"
+#include "test.h"
+
+#define FRAMES (64)
+
+static struct icap_host_pair pair;
+static struct icap_dsp dev_dsp;
+static uint32_t dev_chains;
+static uint32_t dev_params;
+
+static int32_t dev_dsp_chain(struct icap_instance *icap, struct icap_dsp_chain *chain)
+{
+	dev_chains++;
+	return icap_dsp_set_chain(&dev_dsp, chain);
+}
+
+static int32_t dev_dsp_params(struct icap_instance *icap, struct icap_dsp_params *params)
+{
+	dev_params++;
+	return icap_dsp_set_params(&dev_dsp, params);
+}
+
+static int32_t dev_subdevice_init(struct icap_instance *icap, struct icap_subdevice_params *params)
+{
+	return 0;
+}
+
+static struct icap_application_callbacks app_cb;
+static struct icap_device_callbacks dev_cb = {
+	.subdevice_init = dev_subdevice_init,
+	.dsp_chain = dev_dsp_chain,
+	.dsp_params = dev_dsp_params,
+};
+
+static void test_gain(void)
+{
+	struct icap_dsp_chain chain = {0, 1, {ICAP_DSP_GAIN}};
+	struct icap_dsp_params params;
+	struct icap_dsp dsp;
+	float data[FRAMES * 2];
+	uint32_t i;
+
+	TEST_CHECK_EQ(icap_dsp_init(&dsp, ICAP_FORMAT_FLOAT_LE, 2), 0);
+	TEST_CHECK_EQ(icap_dsp_set_chain(&dsp, &chain), 0);
+
+	/* No params yet, unchanged */
+	for (i = 0; i < FRAMES * 2; i++)
+		data[i] = 0.5f;
+	TEST_CHECK_EQ(icap_dsp_process(&dsp, data, FRAMES), 0);
+	TEST_CHECK(data[FRAMES * 2 - 1] == 0.5f);
+
+	memset(&params, 0, sizeof(params));
+	params.type = ICAP_DSP_GAIN;
+	params.u.gain.gain = 1 << 15;
+	TEST_CHECK_EQ(icap_dsp_set_params(&dsp, &params), 0);
+	TEST_CHECK_EQ(icap_dsp_process(&dsp, data, FRAMES), 0);
+	for (i = 0; i < FRAMES * 2; i++)
+		TEST_CHECK(data[i] == 0.25f);
+
+	/* Type mismatch and block out of the chain */
+	params.type = ICAP_DSP_BIQUAD;
+	TEST_CHECK(icap_dsp_set_params(&dsp, &params) < 0);
+	params.type = ICAP_DSP_GAIN;
+	params.block = 1;
+	TEST_CHECK(icap_dsp_set_params(&dsp, &params) < 0);
+
+	/* The gain stays when the chain keeps the block type */
+	chain.num = 2;
+	chain.blocks[1] = ICAP_DSP_LIMITER;
+	TEST_CHECK_EQ(icap_dsp_set_chain(&dsp, &chain), 0);
+	for (i = 0; i < FRAMES * 2; i++)
+		data[i] = 0.5f;
+	TEST_CHECK_EQ(icap_dsp_process(&dsp, data, FRAMES), 0);
+	TEST_CHECK(data[0] == 0.25f);
+}
+
+static void test_ramp_s16(void)
+{
+	struct icap_dsp_chain chain = {0, 1, {ICAP_DSP_GAIN}};
+	struct icap_dsp_params params;
+	struct icap_dsp dsp;
+	int16_t data[FRAMES];
+	uint32_t i;
+
+	TEST_CHECK_EQ(icap_dsp_init(&dsp, ICAP_FORMAT_S16_LE, 1), 0);
+	TEST_CHECK_EQ(icap_dsp_set_chain(&dsp, &chain), 0);
+	memset(&params, 0, sizeof(params));
+	params.type = ICAP_DSP_GAIN;
+	params.u.gain.gain = 0;
+	params.u.gain.ramp_frames = FRAMES;
+	TEST_CHECK_EQ(icap_dsp_set_params(&dsp, &params), 0);
+
+	for (i = 0; i < FRAMES; i++)
+		data[i] = 10000;
+	TEST_CHECK_EQ(icap_dsp_process(&dsp, data, FRAMES), 0);
+	/* Falls monotonically from unity towards silence */
+	TEST_CHECK(data[0] > 9000);
+	for (i = 1; i < FRAMES; i++)
+		TEST_CHECK(data[i] <= data[i - 1]);
+	TEST_CHECK(data[FRAMES - 1] < 1000);
+	TEST_CHECK_EQ(icap_dsp_process(&dsp, data, FRAMES), 0);
+	TEST_CHECK_EQ(data[0], 0);
+
+	/* Saturation */
+	params.u.gain.gain = 4 << 16;
+	params.u.gain.ramp_frames = 0;
+	TEST_CHECK_EQ(icap_dsp_set_params(&dsp, &params), 0);
+	for (i = 0; i < FRAMES; i++)
+		data[i] = -20000;
+	TEST_CHECK_EQ(icap_dsp_process(&dsp, data, FRAMES), 0);
+	TEST_CHECK_EQ(data[0], -32768);
+}
+
+static void test_limiter(void)
+{
+	struct icap_dsp_chain chain = {0, 1, {ICAP_DSP_LIMITER}};
+	struct icap_dsp_params params;
+	struct icap_dsp dsp;
+	float data[FRAMES];
+	uint32_t i;
+
+	TEST_CHECK_EQ(icap_dsp_init(&dsp, ICAP_FORMAT_FLOAT_LE, 1), 0);
+	TEST_CHECK_EQ(icap_dsp_set_chain(&dsp, &chain), 0);
+	memset(&params, 0, sizeof(params));
+	params.type = ICAP_DSP_LIMITER;
+	params.u.limiter.threshold = 0x40000000;
+	params.u.limiter.release_frames = 1000;
+	TEST_CHECK_EQ(icap_dsp_set_params(&dsp, &params), 0);
+	for (i = 0; i < FRAMES; i++)
+		data[i] = i & 1 ? 0.9f : -0.9f;
+	TEST_CHECK_EQ(icap_dsp_process(&dsp, data, FRAMES), 0);
+	for (i = 0; i < FRAMES; i++)
+		TEST_CHECK(fabsf(data[i]) <= 0.5f + 1e-6f);
+}
+
+static void test_resume(void)
+{
+	struct icap_subdevice_params sp = {1, 2, 0, 48000};
+	struct icap_dsp_chain chain = {1, 2, {ICAP_DSP_GAIN, ICAP_DSP_BIQUAD}};
+	struct icap_dsp_params params;
+
+	TEST_CHECK_EQ(icap_host_pair_init(&pair, &app_cb, &dev_cb), 0);
+	TEST_CHECK_EQ(icap_dsp_init(&dev_dsp, ICAP_FORMAT_FLOAT_LE, 2), 0);
+	TEST_CHECK_EQ(icap_subdevice_init(&pair.app, &sp), 0);
+	TEST_CHECK_EQ(icap_set_dsp_chain(&pair.app, &chain), 0);
+	memset(&params, 0, sizeof(params));
+	params.subdev_id = 1;
+	params.type = ICAP_DSP_GAIN;
+	params.u.gain.gain = 1 << 15;
+	TEST_CHECK_EQ(icap_set_dsp_params(&pair.app, &params), 0);
+
+	/* The device restarted with an empty chain */
+	TEST_CHECK_EQ(icap_dsp_init(&dev_dsp, ICAP_FORMAT_FLOAT_LE, 2), 0);
+	dev_chains = 0;
+	dev_params = 0;
+	TEST_CHECK_EQ(icap_session_resume(&pair.app), 0);
+	TEST_CHECK_EQ(dev_chains, 1);
+	TEST_CHECK_EQ(dev_params, 1);
+	TEST_CHECK_EQ(dev_dsp.num, 2);
+	TEST_CHECK(dev_dsp.blocks[0].u.gain.target == 0.5f);
+
+	/* Params of a block whose type changed aren't replayed */
+	chain.blocks[0] = ICAP_DSP_LIMITER;
+	TEST_CHECK_EQ(icap_set_dsp_chain(&pair.app, &chain), 0);
+	dev_params = 0;
+	TEST_CHECK_EQ(icap_session_resume(&pair.app), 0);
+	TEST_CHECK_EQ(dev_params, 0);
+
+	/* Nor anything after deinit */
+	TEST_CHECK_EQ(icap_subdevice_deinit(&pair.app, 1), 0);
+	dev_chains = 0;
+	TEST_CHECK_EQ(icap_session_resume(&pair.app), 0);
+	TEST_CHECK_EQ(dev_chains, 0);
+}
+
+int main(void)
+{
+	test_gain();
+	test_ramp_s16();
+	test_limiter();
+	test_resume();
+	return TEST_RESULT();
+}
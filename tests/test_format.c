@@ -0,0 +1,143 @@
+/*
+ * Sample format conversion, the rounding rule must not depend on whether
+ * a sample went through the vectorized kernel or the plain C tail.
+ */
+
+#include <math.h>
+#include <string.h>
+#include "icap_format.h"
+#include "test.h"
+
+/* More than one vector of every kernel plus a scalar tail */
+#define COPIES (11)
+
+static void check_float_to_s32(float f, int32_t expected)
+{
+	float src[COPIES];
+	int32_t dst[COPIES];
+	uint32_t i;
+
+	for (i = 0; i < COPIES; i++)
+		src[i] = f;
+	TEST_CHECK_EQ(icap_format_convert(dst, ICAP_FORMAT_S32_LE, src, ICAP_FORMAT_FLOAT_LE, COPIES), 0);
+	for (i = 0; i < COPIES; i++) {
+		if (dst[i] != expected) {
+			printf("float %g sample %u: %d, expected %d\n", f, i, dst[i], expected);
+			TEST_CHECK_EQ(dst[i], expected);
+		}
+	}
+}
+
+static void check_double_to_s32(double f, int32_t expected)
+{
+	double src = f;
+	int32_t dst;
+
+	TEST_CHECK_EQ(icap_format_convert(&dst, ICAP_FORMAT_S32_LE, &src, ICAP_FORMAT_FLOAT64_LE, 1), 0);
+	TEST_CHECK_EQ(dst, expected);
+}
+
+static void test_rounding(void)
+{
+	const float lsb = 1.0f / 2147483648.0f;
+
+	check_float_to_s32(0.0f, 0);
+	check_float_to_s32(0.3f * lsb, 0);
+	check_float_to_s32(0.7f * lsb, 1);
+	check_float_to_s32(-0.7f * lsb, -1);
+	/* Ties to even */
+	check_float_to_s32(0.5f * lsb, 0);
+	check_float_to_s32(1.5f * lsb, 2);
+	check_float_to_s32(2.5f * lsb, 2);
+	check_float_to_s32(-0.5f * lsb, 0);
+	check_float_to_s32(-1.5f * lsb, -2);
+	check_float_to_s32(-2.5f * lsb, -2);
+	check_float_to_s32(4194304.5f * lsb, 4194304);
+	check_float_to_s32(4194305.5f * lsb, 4194306);
+	check_float_to_s32(-4194305.5f * lsb, -4194306);
+	/* Already integer above 2^23 */
+	check_float_to_s32(8388609.0f * lsb, 8388609);
+	check_float_to_s32(-16777218.0f * lsb, -16777218);
+	check_float_to_s32(0.5f, 0x40000000);
+	check_float_to_s32(-0.5f, -0x40000000);
+
+	check_double_to_s32(0.5 * lsb, 0);
+	check_double_to_s32(1.5 * lsb, 2);
+	check_double_to_s32(2.5 * lsb, 2);
+	check_double_to_s32(-2.5 * lsb, -2);
+	check_double_to_s32(-3.5 * lsb, -4);
+	check_double_to_s32(0.7 * lsb, 1);
+}
+
+static void test_saturation(void)
+{
+	check_float_to_s32(1.0f, 0x7fffffff);
+	check_float_to_s32(2.0f, 0x7fffffff);
+	check_float_to_s32(INFINITY, 0x7fffffff);
+	check_float_to_s32(-1.0f, (int32_t)0x80000000);
+	check_float_to_s32(-2.0f, (int32_t)0x80000000);
+	check_float_to_s32(-INFINITY, (int32_t)0x80000000);
+	check_float_to_s32(NAN, 0);
+	check_float_to_s32(-NAN, 0);
+
+	check_double_to_s32(1.0, 0x7fffffff);
+	check_double_to_s32(-1.0, (int32_t)0x80000000);
+	check_double_to_s32(NAN, 0);
+}
+
+static void test_convert(void)
+{
+	int16_t s16[COPIES] = {0, 1, -1, 0x4000, -0x4000, 0x7fff, -0x8000, 3, -3, 100, -100};
+	int16_t back[COPIES];
+	float f[COPIES];
+	uint8_t s24[COPIES * 3];
+	int32_t s32[COPIES];
+	uint32_t i;
+
+	TEST_CHECK_EQ(icap_format_convert(f, ICAP_FORMAT_FLOAT_LE, s16, ICAP_FORMAT_S16_LE, COPIES), 0);
+	TEST_CHECK(f[3] == 0.5f);
+	TEST_CHECK(f[6] == -1.0f);
+	TEST_CHECK_EQ(icap_format_convert(back, ICAP_FORMAT_S16_LE, f, ICAP_FORMAT_FLOAT_LE, COPIES), 0);
+	TEST_CHECK(memcmp(back, s16, sizeof(s16)) == 0);
+
+	TEST_CHECK_EQ(icap_format_convert(s24, ICAP_FORMAT_S24_3LE, s16, ICAP_FORMAT_S16_LE, COPIES), 0);
+	TEST_CHECK_EQ(s24[9], 0x00);
+	TEST_CHECK_EQ(s24[10], 0x00);
+	TEST_CHECK_EQ(s24[11], 0x40);
+	TEST_CHECK_EQ(icap_format_convert(s32, ICAP_FORMAT_S32_LE, s24, ICAP_FORMAT_S24_3LE, COPIES), 0);
+	for (i = 0; i < COPIES; i++)
+		TEST_CHECK_EQ(s32[i], (int32_t)s16[i] * 65536);
+
+	/* In place */
+	TEST_CHECK_EQ(icap_format_convert(s32, ICAP_FORMAT_FLOAT_LE, s32, ICAP_FORMAT_S32_LE, COPIES), 0);
+	TEST_CHECK(((float *)s32)[4] == -0.5f);
+
+	TEST_CHECK(icap_format_convert(s32, 100, s16, ICAP_FORMAT_S16_LE, COPIES) < 0);
+}
+
+static void test_interleave(void)
+{
+	int16_t planar[2][8], inter[16], out[2][8];
+	uint32_t i;
+
+	for (i = 0; i < 8; i++) {
+		planar[0][i] = (int16_t)i;
+		planar[1][i] = (int16_t)(100 + i);
+	}
+	TEST_CHECK_EQ(icap_format_interleave(inter, planar, sizeof(planar[0]), 2, 8, ICAP_FORMAT_S16_LE), 0);
+	for (i = 0; i < 8; i++) {
+		TEST_CHECK_EQ(inter[2 * i], i);
+		TEST_CHECK_EQ(inter[2 * i + 1], 100 + i);
+	}
+	TEST_CHECK_EQ(icap_format_deinterleave(out, sizeof(out[0]), inter, 2, 8, ICAP_FORMAT_S16_LE), 0);
+	TEST_CHECK(memcmp(out, planar, sizeof(planar)) == 0);
+}
+
+int main(void)
+{
+	test_rounding();
+	test_saturation();
+	test_convert();
+	test_interleave();
+	return TEST_RESULT();
+}
@@ -0,0 +1,177 @@
+/*
+ * Fragment cursor, icap_frag.c.
+ */
+
+#include <string.h>
+#include "icap_frag.h"
+#include "test.h"
+
+static void test_planar(void)
+{
+	struct icap_buf_descriptor buf;
+	struct icap_frag_cursor cur;
+
+	memset(&buf, 0, sizeof(buf));
+	buf.type = ICAP_BUF_PLANAR;
+	buf.buf_size = 0x300;
+	buf.frag_size = 0x100;
+	buf.channels = 2;
+	buf.channel_stride = 0x400;
+
+	/* buf_size is the size of one plane */
+	TEST_CHECK_EQ(icap_frag_init(&cur, &buf), 0);
+	TEST_CHECK_EQ(cur.frags, 3);
+	TEST_CHECK_EQ(icap_frag_advance(&cur, 2), 0);
+	TEST_CHECK_EQ(icap_frag_offset(&cur, 0), 0x200);
+	TEST_CHECK_EQ(icap_frag_offset(&cur, 1), 0x600);
+
+	/* Overlapping planes */
+	buf.channel_stride = 0x200;
+	TEST_CHECK_EQ(icap_frag_init(&cur, &buf), -ICAP_ERROR_INVALID);
+	buf.channel_stride = 0;
+	TEST_CHECK_EQ(icap_frag_init(&cur, &buf), -ICAP_ERROR_INVALID);
+
+	/* One channel needs no stride */
+	buf.channels = 1;
+	TEST_CHECK_EQ(icap_frag_init(&cur, &buf), 0);
+}
+
+static void circular_init(struct icap_frag_cursor *cur, uint32_t frags, uint32_t frag_size, uint32_t gap)
+{
+	struct icap_buf_descriptor buf;
+
+	memset(&buf, 0, sizeof(buf));
+	buf.type = ICAP_BUF_CIRCURAL;
+	buf.frag_size = frag_size;
+	buf.gap_size = gap;
+	/* The gap after the last fragment is optional */
+	buf.buf_size = frags * (frag_size + gap) - gap;
+	TEST_CHECK_EQ(icap_frag_init(cur, &buf), 0);
+	TEST_CHECK_EQ(cur->frags, frags);
+}
+
+static void test_circular(void)
+{
+	struct icap_frag_cursor cur;
+	uint32_t i;
+
+	/* Power of two layout, masked */
+	circular_init(&cur, 4, 0x80, 0x80);
+	TEST_CHECK(cur.mask != 0);
+	TEST_CHECK_EQ(icap_frag_available(&cur), 0xffffffff);
+	for (i = 1; i <= 9; i++) {
+		TEST_CHECK_EQ(icap_frag_advance(&cur, 1), 0);
+		TEST_CHECK_EQ(icap_frag_offset(&cur, 0), (i % 4) * 0x100);
+	}
+	TEST_CHECK_EQ(icap_frag_advance(&cur, 7), 0);
+	TEST_CHECK_EQ(cur.index, 0);
+	TEST_CHECK_EQ(cur.pos, 16);
+
+	/* Any other layout */
+	circular_init(&cur, 3, 0x100, 0x20);
+	TEST_CHECK_EQ(cur.mask, 0);
+	for (i = 1; i <= 7; i++) {
+		TEST_CHECK_EQ(icap_frag_advance(&cur, 1), 0);
+		TEST_CHECK_EQ(icap_frag_offset(&cur, 0), (i % 3) * 0x120);
+	}
+	TEST_CHECK_EQ(icap_frag_advance(&cur, 2), 0);
+	TEST_CHECK_EQ(cur.index, 0);
+	TEST_CHECK_EQ(icap_frag_advance(&cur, 3 * 1000 + 2), 0);
+	TEST_CHECK_EQ(cur.index, 2);
+	TEST_CHECK_EQ(icap_frag_offset(&cur, 0), 0x240);
+	TEST_CHECK_EQ(cur.pos, 3011);
+}
+
+static void test_seek(void)
+{
+	struct icap_frag_cursor cur;
+
+	circular_init(&cur, 3, 0x100, 0);
+	TEST_CHECK_EQ(icap_frag_seek(&cur, 0x100000001ull), 0);
+	/* 2^32 + 1 = 3 * 1431655765 + 2 */
+	TEST_CHECK_EQ(cur.index, 2);
+	TEST_CHECK_EQ(icap_frag_offset(&cur, 0), 0x200);
+	TEST_CHECK_EQ(cur.pos, 0x100000001ull);
+	TEST_CHECK_EQ(icap_frag_advance(&cur, 1), 0);
+	TEST_CHECK_EQ(cur.index, 0);
+
+	circular_init(&cur, 8, 0x100, 0);
+	TEST_CHECK_EQ(icap_frag_seek(&cur, 0x100000005ull), 0);
+	TEST_CHECK_EQ(cur.index, 5);
+}
+
+static void test_scattered(void)
+{
+	struct icap_buf_descriptor buf;
+	struct icap_buf_offsets offsets;
+	struct icap_frag_cursor cur;
+	uint32_t i;
+
+	memset(&buf, 0, sizeof(buf));
+	buf.type = ICAP_BUF_SCATTERED;
+	buf.frag_size = 0x100;
+	TEST_CHECK_EQ(icap_frag_init(&cur, &buf), 0);
+	TEST_CHECK_EQ(icap_frag_available(&cur), 0);
+	TEST_CHECK_EQ(icap_frag_advance(&cur, 1), -ICAP_ERROR_NO_BUFS);
+	TEST_CHECK_EQ(icap_frag_seek(&cur, 0), -ICAP_ERROR_NOT_SUP);
+
+	memset(&offsets, 0, sizeof(offsets));
+	offsets.num = ICAP_BUF_MAX_FRAGS_OFFSETS_NUM;
+	for (i = 0; i < offsets.num; i++)
+		offsets.frags_offsets[i] = 0x1000 + i * 0x100;
+	for (i = 0; i < ICAP_FRAG_QUEUE_SIZE / ICAP_BUF_MAX_FRAGS_OFFSETS_NUM; i++)
+		TEST_CHECK_EQ(icap_frag_push_offsets(&cur, &offsets), 0);
+	TEST_CHECK_EQ(icap_frag_available(&cur), ICAP_FRAG_QUEUE_SIZE);
+	TEST_CHECK_EQ(icap_frag_offset(&cur, 0), 0x1000);
+
+	/* Full, nothing queued */
+	offsets.num = 1;
+	TEST_CHECK_EQ(icap_frag_push_offsets(&cur, &offsets), -ICAP_ERROR_NOMEM);
+	TEST_CHECK_EQ(icap_frag_available(&cur), ICAP_FRAG_QUEUE_SIZE);
+	offsets.num = ICAP_BUF_MAX_FRAGS_OFFSETS_NUM + 1;
+	TEST_CHECK_EQ(icap_frag_push_offsets(&cur, &offsets), -ICAP_ERROR_INVALID);
+
+	TEST_CHECK_EQ(icap_frag_advance(&cur, 3), 0);
+	TEST_CHECK_EQ(icap_frag_offset(&cur, 0), 0x1300);
+	TEST_CHECK_EQ(icap_frag_advance(&cur, ICAP_FRAG_QUEUE_SIZE), -ICAP_ERROR_NO_BUFS);
+	TEST_CHECK_EQ(icap_frag_available(&cur), ICAP_FRAG_QUEUE_SIZE - 3);
+
+	/* The queue wraps */
+	offsets.num = 3;
+	offsets.frags_offsets[0] = 0x9000;
+	TEST_CHECK_EQ(icap_frag_push_offsets(&cur, &offsets), 0);
+	TEST_CHECK_EQ(icap_frag_advance(&cur, ICAP_FRAG_QUEUE_SIZE - 3), 0);
+	TEST_CHECK_EQ(icap_frag_offset(&cur, 0), 0x9000);
+	TEST_CHECK_EQ(icap_frag_advance(&cur, 3), 0);
+	TEST_CHECK_EQ(icap_frag_available(&cur), 0);
+	TEST_CHECK_EQ(cur.pos, ICAP_FRAG_QUEUE_SIZE + 3);
+
+	/* Only scattered buffers take offsets */
+	circular_init(&cur, 4, 0x100, 0);
+	TEST_CHECK_EQ(icap_frag_push_offsets(&cur, &offsets), -ICAP_ERROR_INVALID);
+}
+
+static void test_invalid(void)
+{
+	struct icap_buf_descriptor buf;
+	struct icap_frag_cursor cur;
+
+	memset(&buf, 0, sizeof(buf));
+	buf.buf_size = 0x100;
+	TEST_CHECK_EQ(icap_frag_init(&cur, &buf), -ICAP_ERROR_INVALID);
+	buf.frag_size = 0x200;
+	TEST_CHECK_EQ(icap_frag_init(&cur, &buf), -ICAP_ERROR_INVALID);
+	buf.frag_size = 0x100;
+	buf.type = ICAP_BUF_PLANAR + 1;
+	TEST_CHECK_EQ(icap_frag_init(&cur, &buf), -ICAP_ERROR_NOT_SUP);
+}
+
+int main(void)
+{
+	test_circular();
+	test_seek();
+	test_scattered();
+	test_planar();
+	test_invalid();
+	return TEST_RESULT();
+}
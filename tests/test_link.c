@@ -0,0 +1,254 @@
+/*
+ * Peer liveness and message timeouts, icap_set_heartbeat() and icap_set_msg_timeout().
+ */
+
+#include <string.h>
+#include "rpmsg_lite.h"
+#include "icap_host.h"
+#include "test.h"
+
+#define PERIOD_US (1000)
+
+static struct icap_host_pair pair;
+static uint32_t dev_inits;
+static uint32_t dev_delay_us;
+static uint32_t link_ups;
+static uint32_t link_downs;
+static uint32_t tick;
+
+static int32_t dev_subdevice_init(struct icap_instance *icap, struct icap_subdevice_params *params)
+{
+	dev_inits++;
+	if (dev_delay_us) {
+		/* Slow device, the response takes dev_delay_us */
+		rpmsg_lite_host_set_clock(platform_us_clock_tick() + dev_delay_us, 10);
+	}
+	return 0;
+}
+
+static int32_t app_link_state(struct icap_instance *icap, uint32_t peer_alive)
+{
+	if (peer_alive) {
+		link_ups++;
+	} else {
+		link_downs++;
+	}
+	return 0;
+}
+
+static struct icap_application_callbacks app_cb = {
+	.link_state = app_link_state,
+};
+static struct icap_device_callbacks dev_cb = {
+	.subdevice_init = dev_subdevice_init,
+};
+
+static struct icap_subdevice_params params = {0, 2, 0, 48000};
+
+/* Moves the stopped clock and runs the application heartbeat */
+static void heartbeat_at(uint32_t us)
+{
+	tick = us;
+	rpmsg_lite_host_set_clock(tick, 0);
+	TEST_CHECK_EQ(icap_heartbeat(&pair.app), 0);
+}
+
+static void setup(void)
+{
+	TEST_CHECK_EQ(icap_host_pair_init(&pair, &app_cb, &dev_cb), 0);
+	TEST_CHECK_EQ(icap_subdevice_init(&pair.app, &params), 0);
+	link_ups = 0;
+	link_downs = 0;
+	dev_inits = 0;
+	dev_delay_us = 0;
+	tick = 1000;
+	rpmsg_lite_host_set_clock(tick, 0);
+	TEST_CHECK_EQ(icap_set_heartbeat(&pair.app, PERIOD_US), 0);
+}
+
+static void test_liveness(void)
+{
+	uint32_t received;
+	uint32_t last;
+	uint32_t i;
+
+	setup();
+
+	/* One heartbeat per period, each answered by the device */
+	received = pair.dev_ept.received;
+	heartbeat_at(tick + PERIOD_US / 2);
+	TEST_CHECK_EQ(pair.dev_ept.received, received);
+	for (i = 0; i < 10; i++) {
+		heartbeat_at(tick + PERIOD_US / 2);
+		heartbeat_at(tick + PERIOD_US / 2);
+	}
+	TEST_CHECK_EQ(pair.dev_ept.received - received, 10);
+	TEST_CHECK_EQ(pair.app.link.peer_alive, 1);
+	TEST_CHECK_EQ(link_downs, 0);
+
+	/* The device stops answering after the last heartbeat */
+	last = tick - PERIOD_US / 2;
+	pair.dev_ept.drop = 1;
+	for (i = 1; i <= ICAP_HEARTBEAT_MISS_MAX; i++) {
+		heartbeat_at(last + i * PERIOD_US);
+	}
+	TEST_CHECK_EQ(pair.app.link.peer_alive, 1);
+	TEST_CHECK_EQ(link_downs, 0);
+	heartbeat_at(tick + 1);
+	TEST_CHECK_EQ(pair.app.link.peer_alive, 0);
+	TEST_CHECK_EQ(link_downs, 1);
+
+	/* Synchronous calls fail without waiting or sending */
+	received = pair.dev_ept.received;
+	TEST_CHECK_EQ(icap_subdevice_init(&pair.app, &params), -ICAP_ERROR_BROKEN_CON);
+	TEST_CHECK_EQ(pair.dev_ept.received, received);
+	TEST_CHECK_EQ(platform_us_clock_tick(), tick);
+
+	/* Reported once, restored by the next answer */
+	heartbeat_at(tick + PERIOD_US);
+	TEST_CHECK_EQ(link_downs, 1);
+	TEST_CHECK_EQ(link_ups, 0);
+	pair.dev_ept.drop = 0;
+	heartbeat_at(tick + PERIOD_US);
+	TEST_CHECK_EQ(pair.app.link.peer_alive, 1);
+	TEST_CHECK_EQ(link_ups, 1);
+	rpmsg_lite_host_set_clock(tick, 10);
+	TEST_CHECK_EQ(icap_subdevice_init(&pair.app, &params), 0);
+}
+
+/* Disabled heartbeat neither sends nor detects anything */
+static void test_disabled(void)
+{
+	uint32_t received;
+
+	setup();
+	TEST_CHECK_EQ(icap_set_heartbeat(&pair.app, 0), 0);
+	received = pair.dev_ept.received;
+	pair.dev_ept.drop = 1;
+	heartbeat_at(tick + 100 * PERIOD_US);
+	TEST_CHECK_EQ(pair.dev_ept.received, received);
+	TEST_CHECK_EQ(pair.app.link.peer_alive, 1);
+	TEST_CHECK_EQ(link_downs, 0);
+}
+
+static void test_resume_trigger(void)
+{
+	setup();
+
+	/* The device echoes the application session from the second heartbeat on */
+	heartbeat_at(tick + PERIOD_US);
+	TEST_CHECK_EQ(pair.app.link.peer_synced, 0);
+	heartbeat_at(tick + PERIOD_US);
+	TEST_CHECK_EQ(pair.app.link.peer_synced, 1);
+	heartbeat_at(tick + PERIOD_US);
+	heartbeat_at(tick + PERIOD_US);
+	TEST_CHECK_EQ(pair.app.journal.resume_pending, 0);
+	TEST_CHECK_EQ(dev_inits, 0);
+
+	/* The restarted device doesn't know the session */
+	pair.dev.transport.seed++;
+	TEST_CHECK_EQ(icap_device_init(&pair.dev, "dev", &dev_cb, NULL), 0);
+	pair.dev.transport.rpmsg_instance = &pair.rpmsg;
+	pair.dev.transport.rpmsg_ept = &pair.dev_ept;
+	heartbeat_at(tick + PERIOD_US);
+	TEST_CHECK_EQ(pair.app.journal.resume_pending, 1);
+	TEST_CHECK_EQ(dev_inits, 0);
+
+	/* The next heartbeat replays the journal */
+	rpmsg_lite_host_set_clock(tick + PERIOD_US, 10);
+	TEST_CHECK_EQ(icap_heartbeat(&pair.app), 0);
+	TEST_CHECK_EQ(pair.app.journal.resume_pending, 0);
+	TEST_CHECK_EQ(dev_inits, 1);
+	TEST_CHECK_EQ(link_downs, 0);
+}
+
+/* Device boot at the given tick, returns the new session id */
+static uint32_t dev_boot(uint32_t us, uint32_t seed)
+{
+	rpmsg_lite_host_set_clock(us, 0);
+	pair.dev.transport.seed = seed;
+	TEST_CHECK_EQ(icap_device_init(&pair.dev, "dev", &dev_cb, NULL), 0);
+	TEST_CHECK(pair.dev.link.session & 1);
+	return pair.dev.link.session;
+}
+
+static void test_session_id(void)
+{
+	uint32_t session;
+
+	TEST_CHECK_EQ(icap_host_pair_init(&pair, &app_cb, &dev_cb), 0);
+	TEST_CHECK(pair.app.link.session & 1);
+	TEST_CHECK(pair.app.link.session != pair.dev.link.session);
+
+	/* A deterministic boot repeats the id unless the seed differs */
+	session = dev_boot(1000, 7);
+	TEST_CHECK_EQ(dev_boot(1000, 7), session);
+	TEST_CHECK(dev_boot(1000, 8) != session);
+
+	/* Without a seed the boot time still differs */
+	session = dev_boot(1000, 0);
+	TEST_CHECK(dev_boot(1001, 0) != session);
+}
+
+/* Time a lost subdevice init takes to fail, all attempts included */
+static uint32_t lost_call_us(void)
+{
+	uint32_t start;
+
+	pair.dev_ept.drop = 1;
+	start = platform_us_clock_tick();
+	TEST_CHECK_EQ(icap_subdevice_init(&pair.app, &params), -ICAP_ERROR_TIMEOUT);
+	pair.dev_ept.drop = 0;
+	return platform_us_clock_tick() - start;
+}
+
+static void test_timeout_clamp(void)
+{
+	uint32_t attempts = ICAP_MSG_RETRIES + 1;
+	uint32_t elapsed;
+	uint32_t i;
+
+	TEST_CHECK_EQ(icap_host_pair_init(&pair, &app_cb, &dev_cb), 0);
+	TEST_CHECK_EQ(icap_set_msg_timeout(&pair.app, 0, 1000, 2), -ICAP_ERROR_INVALID);
+	TEST_CHECK_EQ(icap_set_msg_timeout(&pair.app, 2000, 1000, 2), -ICAP_ERROR_INVALID);
+	TEST_CHECK_EQ(icap_set_msg_timeout(&pair.app, 5000, 90000, 2), 0);
+	dev_delay_us = 0;
+
+	/* Until the round trips are measured the attempts share the max timeout */
+	elapsed = lost_call_us();
+	TEST_CHECK(elapsed >= 90000);
+	TEST_CHECK(elapsed < 90000 + 1000);
+
+	/* A fast device, the timeout is raised to the min */
+	for (i = 0; i < 4; i++) {
+		TEST_CHECK_EQ(icap_subdevice_init(&pair.app, &params), 0);
+	}
+	elapsed = lost_call_us();
+	TEST_CHECK(elapsed >= attempts * 5000);
+	TEST_CHECK(elapsed < attempts * 5000 + 1000);
+
+	/* The timeout dropped the measurements */
+	elapsed = lost_call_us();
+	TEST_CHECK(elapsed >= 90000);
+	TEST_CHECK(elapsed < 90000 + 1000);
+
+	/* A slow device, the timeout is limited to the max */
+	dev_delay_us = 80000;
+	for (i = 0; i < 4; i++) {
+		TEST_CHECK_EQ(icap_subdevice_init(&pair.app, &params), 0);
+	}
+	dev_delay_us = 0;
+	elapsed = lost_call_us();
+	TEST_CHECK(elapsed >= attempts * 90000);
+	TEST_CHECK(elapsed < attempts * 90000 + 1000);
+}
+
+int main(void)
+{
+	test_liveness();
+	test_disabled();
+	test_resume_trigger();
+	test_session_id();
+	test_timeout_clamp();
+	return TEST_RESULT();
+}
@@ -0,0 +1,153 @@
+/*
+ * Device mixer, icap_mixer.c.
+ */
+
+#include <string.h>
+#include "icap_mixer.h"
+#include "test.h"
+
+/* Stereo, more samples than one mixing block and not a multiple of a vector */
+#define FRAMES (101)
+#define SAMPLES (FRAMES * 2)
+
+static void test_inputs(void)
+{
+	struct icap_mixer mixer;
+
+	TEST_CHECK_EQ(icap_mixer_init(&mixer, ICAP_FORMAT_S16_LE, 2), 0);
+	TEST_CHECK(icap_mixer_init(&mixer, ICAP_FORMAT_S24_3LE, 2) < 0);
+	TEST_CHECK_EQ(icap_mixer_init(&mixer, ICAP_FORMAT_S16_LE, 2), 0);
+
+	TEST_CHECK_EQ(icap_mixer_add_input(&mixer, 10, ICAP_MIXER_GAIN_UNITY), 0);
+	TEST_CHECK_EQ(icap_mixer_add_input(&mixer, 11, ICAP_MIXER_GAIN_UNITY), 1);
+	TEST_CHECK_EQ(icap_mixer_add_input(&mixer, 10, ICAP_MIXER_GAIN_UNITY), -ICAP_ERROR_BUSY);
+	TEST_CHECK_EQ(icap_mixer_add_input(&mixer, 12, ICAP_MIXER_GAIN_MAX + 1), -ICAP_ERROR_INVALID);
+	TEST_CHECK_EQ(icap_mixer_set_gain(&mixer, 12, ICAP_MIXER_GAIN_UNITY), -ICAP_ERROR_INVALID);
+	TEST_CHECK_EQ(icap_mixer_remove_input(&mixer, 10), 0);
+	TEST_CHECK_EQ(icap_mixer_remove_input(&mixer, 10), -ICAP_ERROR_INVALID);
+	/* The freed slot is reused */
+	TEST_CHECK_EQ(icap_mixer_add_input(&mixer, 12, ICAP_MIXER_GAIN_UNITY), 0);
+}
+
+static void test_mix_s16(void)
+{
+	static int16_t a[SAMPLES], b[SAMPLES], out[SAMPLES];
+	const void *src[ICAP_MIXER_INPUTS] = {a, b};
+	struct icap_mixer mixer;
+	uint32_t i;
+
+	for (i = 0; i < SAMPLES; i++) {
+		a[i] = (int16_t)(i * 50);
+		b[i] = (int16_t)(i & 1 ? 30000 : -30000);
+	}
+	TEST_CHECK_EQ(icap_mixer_init(&mixer, ICAP_FORMAT_S16_LE, 2), 0);
+	TEST_CHECK_EQ(icap_mixer_add_input(&mixer, 0, ICAP_MIXER_GAIN_UNITY), 0);
+	TEST_CHECK_EQ(icap_mixer_add_input(&mixer, 1, ICAP_MIXER_GAIN_UNITY / 2), 1);
+
+	TEST_CHECK_EQ(icap_mixer_mix(&mixer, out, src, FRAMES), 2);
+	for (i = 0; i < SAMPLES; i++) {
+		TEST_CHECK_EQ(out[i], a[i] + b[i] / 2);
+	}
+
+	/* Saturation */
+	TEST_CHECK_EQ(icap_mixer_set_gain(&mixer, 1, ICAP_MIXER_GAIN_UNITY * 2), 0);
+	TEST_CHECK_EQ(icap_mixer_mix(&mixer, out, src, FRAMES), 2);
+	TEST_CHECK_EQ(out[1], 32767);
+	TEST_CHECK_EQ(out[SAMPLES - 2], -32768);
+
+	/* Paused, muted and missing inputs are skipped */
+	TEST_CHECK_EQ(icap_mixer_pause_input(&mixer, 1, 1), 0);
+	TEST_CHECK_EQ(icap_mixer_mix(&mixer, out, src, FRAMES), 1);
+	TEST_CHECK(memcmp(out, a, sizeof(a)) == 0);
+	TEST_CHECK_EQ(icap_mixer_set_gain(&mixer, 0, 0), 0);
+	TEST_CHECK_EQ(icap_mixer_mix(&mixer, out, src, FRAMES), 0);
+	for (i = 0; i < SAMPLES; i++) {
+		TEST_CHECK_EQ(out[i], 0);
+	}
+	TEST_CHECK_EQ(icap_mixer_pause_input(&mixer, 1, 0), 0);
+	src[1] = NULL;
+	TEST_CHECK_EQ(icap_mixer_mix(&mixer, out, src, FRAMES), 0);
+}
+
+static void test_mix_s32(void)
+{
+	static int32_t a[SAMPLES], b[SAMPLES], out[SAMPLES];
+	const void *src[ICAP_MIXER_INPUTS] = {a, b};
+	struct icap_mixer mixer;
+	uint32_t i;
+
+	for (i = 0; i < SAMPLES; i++) {
+		a[i] = 0x40000000 - (int32_t)i;
+		b[i] = i & 1 ? 0x40000000 : -0x40000000;
+	}
+	TEST_CHECK_EQ(icap_mixer_init(&mixer, ICAP_FORMAT_S32_LE, 2), 0);
+	TEST_CHECK_EQ(icap_mixer_add_input(&mixer, 0, ICAP_MIXER_GAIN_UNITY), 0);
+	TEST_CHECK_EQ(icap_mixer_add_input(&mixer, 1, ICAP_MIXER_GAIN_UNITY), 1);
+	TEST_CHECK_EQ(icap_mixer_mix(&mixer, out, src, FRAMES), 2);
+	TEST_CHECK_EQ(out[0], 0);
+	TEST_CHECK_EQ(out[1], 0x7fffffff);
+	TEST_CHECK_EQ(out[2], -2);
+}
+
+static void test_mix_float(void)
+{
+	static float a[SAMPLES], b[SAMPLES], out[SAMPLES];
+	const void *src[ICAP_MIXER_INPUTS] = {NULL, a, NULL, b};
+	struct icap_mixer mixer;
+	uint32_t i;
+
+	for (i = 0; i < SAMPLES; i++) {
+		a[i] = 0.5f;
+		b[i] = 0.75f;
+	}
+	TEST_CHECK_EQ(icap_mixer_init(&mixer, ICAP_FORMAT_FLOAT_LE, 2), 0);
+	for (i = 0; i < 4; i++) {
+		TEST_CHECK_EQ(icap_mixer_add_input(&mixer, i, ICAP_MIXER_GAIN_UNITY), i);
+	}
+	TEST_CHECK_EQ(icap_mixer_mix(&mixer, out, src, FRAMES), 2);
+	/* Float isn't clipped */
+	for (i = 0; i < SAMPLES; i++) {
+		TEST_CHECK(out[i] == 1.25f);
+	}
+}
+
+static void test_monitor(void)
+{
+	static int16_t out[SAMPLES];
+	int16_t in[FRAMES * 4];
+	struct icap_monitor_route route;
+	struct icap_mixer mixer;
+	uint32_t i;
+
+	for (i = 0; i < FRAMES * 4; i++) {
+		in[i] = (int16_t)(i % 4 * 1000);
+	}
+	memset(out, 0, sizeof(out));
+	memset(&route, 0, sizeof(route));
+	route.enable = 1;
+	route.gain = ICAP_MIXER_GAIN_UNITY;
+	route.channels = 2;
+	route.channel_map[0] = 3;
+	route.channel_map[1] = ICAP_MONITOR_CHANNEL_NONE;
+
+	TEST_CHECK_EQ(icap_mixer_init(&mixer, ICAP_FORMAT_S16_LE, 2), 0);
+	TEST_CHECK_EQ(icap_mixer_monitor(&mixer, out, in, 4, &route, FRAMES), 0);
+	for (i = 0; i < FRAMES; i++) {
+		TEST_CHECK_EQ(out[2 * i], 3000);
+		TEST_CHECK_EQ(out[2 * i + 1], 0);
+	}
+
+	/* Record channel out of range */
+	route.channel_map[1] = 4;
+	TEST_CHECK_EQ(icap_mixer_monitor(&mixer, out, in, 4, &route, FRAMES), -ICAP_ERROR_INVALID);
+}
+
+int main(void)
+{
+	test_inputs();
+	test_mix_s16();
+	test_mix_s32();
+	test_mix_float();
+	test_monitor();
+	return TEST_RESULT();
+}
@@ -0,0 +1,106 @@
+/*
+ * Monitor routes, icap_set_monitor() and their replay by icap_session_resume().
+ */
+
+#include <string.h>
+#include "rpmsg_lite.h"
+#include "icap_host.h"
+#include "test.h"
+
+static struct icap_host_pair pair;
+static struct icap_monitor_route dev_routes[8];
+static uint32_t dev_num;
+
+static int32_t dev_monitor(struct icap_instance *icap, struct icap_monitor_route *route)
+{
+	if (dev_num < 8) {
+		memcpy(&dev_routes[dev_num], route, sizeof(*route));
+	}
+	dev_num++;
+	return 0;
+}
+
+static int32_t dev_subdevice_init(struct icap_instance *icap, struct icap_subdevice_params *params)
+{
+	return 0;
+}
+
+static struct icap_application_callbacks app_cb;
+static struct icap_device_callbacks dev_cb = {
+	.subdevice_init = dev_subdevice_init,
+	.monitor = dev_monitor,
+};
+
+static void route_init(struct icap_monitor_route *route, uint32_t src, uint32_t dst, uint32_t gain)
+{
+	memset(route, 0, sizeof(*route));
+	route->src_subdev_id = src;
+	route->dst_subdev_id = dst;
+	route->enable = 1;
+	route->gain = gain;
+	route->channels = 2;
+	route->channel_map[0] = 0;
+	route->channel_map[1] = 1;
+}
+
+static uint32_t resume(void)
+{
+	dev_num = 0;
+	TEST_CHECK_EQ(icap_session_resume(&pair.app), 0);
+	return dev_num;
+}
+
+static void test_resume(void)
+{
+	struct icap_subdevice_params sp = {0, 2, 0, 48000};
+	struct icap_monitor_route route;
+	uint32_t i;
+
+	TEST_CHECK_EQ(icap_host_pair_init(&pair, &app_cb, &dev_cb), 0);
+	for (i = 0; i < 4; i++) {
+		sp.subdev_id = i;
+		TEST_CHECK_EQ(icap_subdevice_init(&pair.app, &sp), 0);
+	}
+
+	route_init(&route, 0, 1, 0x10000);
+	route.channels = ICAP_MONITOR_CHANNELS_MAX + 1;
+	TEST_CHECK_EQ(icap_set_monitor(&pair.app, &route), -ICAP_ERROR_INVALID);
+	TEST_CHECK_EQ(resume(), 0);
+
+	route.channels = 2;
+	TEST_CHECK_EQ(icap_set_monitor(&pair.app, &route), 0);
+	TEST_CHECK_EQ(resume(), 1);
+	TEST_CHECK_EQ(dev_routes[0].gain, 0x10000);
+
+	/* The same pair replaces the route */
+	route.gain = 0x8000;
+	TEST_CHECK_EQ(icap_set_monitor(&pair.app, &route), 0);
+	route_init(&route, 2, 1, 0x4000);
+	TEST_CHECK_EQ(icap_set_monitor(&pair.app, &route), 0);
+	TEST_CHECK_EQ(resume(), 2);
+	TEST_CHECK_EQ(dev_routes[0].gain, 0x8000);
+	TEST_CHECK_EQ(dev_routes[1].src_subdev_id, 2);
+
+	/* Removed routes aren't replayed */
+	route.enable = 0;
+	TEST_CHECK_EQ(icap_set_monitor(&pair.app, &route), 0);
+	TEST_CHECK_EQ(resume(), 1);
+
+	/* More routes than the journal keeps */
+	for (i = 0; i < ICAP_JOURNAL_MONITORS + 1; i++) {
+		route_init(&route, 2, i, 0x10000);
+		TEST_CHECK_EQ(icap_set_monitor(&pair.app, &route), 0);
+	}
+	TEST_CHECK_EQ(resume(), ICAP_JOURNAL_MONITORS);
+
+	/* Routes of a deinitialized subdevice go with it */
+	TEST_CHECK_EQ(icap_subdevice_deinit(&pair.app, 2), 0);
+	TEST_CHECK_EQ(resume(), 1);
+	TEST_CHECK_EQ(dev_routes[0].src_subdev_id, 0);
+}
+
+int main(void)
+{
+	test_resume();
+	return TEST_RESULT();
+}
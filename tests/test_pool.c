@@ -0,0 +1,213 @@
+/*
+ * Scattered fragment pool, icap_pool.c, feeding a device queue.
+ */
+
+#include <string.h>
+#include "rpmsg_lite.h"
+#include "icap_host.h"
+#include "icap_pool.h"
+#include "icap_frag.h"
+#include "icap_dma.h"
+#include "test.h"
+
+#define FRAG_SIZE (0x100)
+
+static struct icap_host_pair pair;
+static struct icap_pool pool;
+static struct icap_frag_cursor cur;
+static struct icap_dma_chain chain;
+static uint32_t use_dma;
+static uint32_t dev_rejected;
+static uint32_t filled;
+static uint32_t fill_limit;
+
+static int32_t dev_add_src(struct icap_instance *icap, struct icap_buf_descriptor *buf)
+{
+	if (use_dma) {
+		return icap_dma_init(&chain, buf, 0, NULL, NULL);
+	}
+	return icap_frag_init(&cur, buf);
+}
+
+static int32_t dev_frags(struct icap_instance *icap, struct icap_buf_offsets *offsets)
+{
+	int32_t ret;
+
+	if (use_dma) {
+		ret = icap_dma_push_offsets(&chain, offsets);
+		ret = ret > 0 ? 0 : ret;
+	} else {
+		ret = icap_frag_push_offsets(&cur, offsets);
+	}
+	if (ret) {
+		dev_rejected++;
+	}
+	return ret;
+}
+
+static int32_t app_frag_ready(struct icap_instance *icap, struct icap_buf_frags *frags)
+{
+	return icap_pool_frag_ready(&pool, frags) < 0 ? -ICAP_ERROR_INVALID : 0;
+}
+
+static int32_t fill(struct icap_pool *pool, uint32_t offset)
+{
+	if (filled == fill_limit) {
+		return -1;
+	}
+	filled++;
+	return 0;
+}
+
+static struct icap_application_callbacks app_cb = {
+	.frag_ready = app_frag_ready,
+};
+static struct icap_device_callbacks dev_cb = {
+	.add_src = dev_add_src,
+	.frags = dev_frags,
+};
+
+/* Adds a scattered buffer of frags fragments and a pool for it */
+static void setup(uint32_t frags, uint32_t low_watermark)
+{
+	struct icap_buf_descriptor buf;
+	int32_t buf_id;
+
+	dev_rejected = 0;
+	TEST_CHECK_EQ(icap_host_pair_init(&pair, &app_cb, &dev_cb), 0);
+	memset(&buf, 0, sizeof(buf));
+	buf.type = ICAP_BUF_SCATTERED;
+	buf.frag_size = FRAG_SIZE;
+	buf.buf_size = frags * FRAG_SIZE;
+	buf_id = icap_add_src(&pair.app, &buf);
+	TEST_CHECK(buf_id >= 0);
+	TEST_CHECK_EQ(icap_pool_init(&pool, &pair.app, buf_id, &buf, low_watermark), 0);
+}
+
+/* Device consumes frags fragments and reports them */
+static void consume(uint32_t frags)
+{
+	struct icap_buf_frags report = {0, frags};
+
+	if (use_dma) {
+		icap_dma_complete(&chain, frags);
+	} else {
+		TEST_CHECK_EQ(icap_frag_advance(&cur, frags), 0);
+	}
+	TEST_CHECK_EQ(icap_frag_ready(&pair.dev, &report), 0);
+}
+
+static void test_init(void)
+{
+	struct icap_buf_descriptor buf;
+	uint32_t offsets[2] = {0x200, 0};
+
+	memset(&buf, 0, sizeof(buf));
+	buf.type = ICAP_BUF_CIRCURAL;
+	buf.frag_size = FRAG_SIZE;
+	buf.buf_size = 4 * FRAG_SIZE;
+	TEST_CHECK_EQ(icap_pool_init(&pool, &pair.app, 0, &buf, 0), -ICAP_ERROR_INVALID);
+	buf.type = ICAP_BUF_SCATTERED;
+	buf.buf_size = (ICAP_POOL_FRAGS + 1) * FRAG_SIZE;
+	TEST_CHECK_EQ(icap_pool_init(&pool, &pair.app, 0, &buf, 0), -ICAP_ERROR_NOMEM);
+	buf.buf_size = FRAG_SIZE - 1;
+	TEST_CHECK_EQ(icap_pool_init(&pool, &pair.app, 0, &buf, 0), -ICAP_ERROR_INVALID);
+
+	buf.gap_size = 0x80;
+	buf.buf_size = 3 * 0x180 - 0x80;
+	TEST_CHECK_EQ(icap_pool_init(&pool, &pair.app, 0, &buf, 0), 0);
+	TEST_CHECK_EQ(pool.num, 3);
+	TEST_CHECK_EQ(pool.offsets[2], 0x300);
+	TEST_CHECK_EQ(pool.max_in_flight, ICAP_FRAG_QUEUE_SIZE);
+	TEST_CHECK_EQ(icap_pool_set_offsets(&pool, offsets, 2), 0);
+	TEST_CHECK_EQ(pool.num, 2);
+	TEST_CHECK_EQ(icap_pool_set_offsets(&pool, offsets, 0), -ICAP_ERROR_INVALID);
+}
+
+/* A pool bigger than the device queue sends only what the queue holds */
+static void test_queue_depth(void)
+{
+	uint32_t i;
+
+	use_dma = 0;
+	setup(ICAP_POOL_FRAGS, 16);
+	TEST_CHECK_EQ(icap_pool_refill(&pool), ICAP_FRAG_QUEUE_SIZE);
+	TEST_CHECK_EQ(icap_pool_in_flight(&pool), ICAP_FRAG_QUEUE_SIZE);
+	TEST_CHECK_EQ(icap_frag_available(&cur), ICAP_FRAG_QUEUE_SIZE);
+	TEST_CHECK_EQ(dev_rejected, 0);
+
+	/* Nothing is sent above the low watermark */
+	consume(ICAP_FRAG_QUEUE_SIZE - 17);
+	TEST_CHECK_EQ(icap_pool_refill(&pool), 0);
+	consume(1);
+	TEST_CHECK_EQ(icap_pool_in_flight(&pool), 16);
+	TEST_CHECK_EQ(icap_pool_refill(&pool), ICAP_FRAG_QUEUE_SIZE - 16);
+	TEST_CHECK_EQ(icap_frag_available(&cur), ICAP_FRAG_QUEUE_SIZE);
+	TEST_CHECK_EQ(dev_rejected, 0);
+
+	/* The fragments circulate through the whole pool in order */
+	for (i = 0; i < 3 * ICAP_POOL_FRAGS; i++) {
+		TEST_CHECK_EQ(icap_frag_offset(&cur, 0), ((ICAP_FRAG_QUEUE_SIZE - 16 + i) % ICAP_POOL_FRAGS) * FRAG_SIZE);
+		consume(1);
+		TEST_CHECK(icap_pool_refill(&pool) >= 0);
+	}
+	TEST_CHECK_EQ(dev_rejected, 0);
+	TEST_CHECK(icap_pool_in_flight(&pool) <= ICAP_FRAG_QUEUE_SIZE);
+}
+
+/* A device feeding the DMA ring directly holds fewer fragments */
+static void test_dma_ring(void)
+{
+	use_dma = 1;
+	setup(ICAP_POOL_FRAGS, 8);
+	pool.max_in_flight = ICAP_DMA_DESCS_MAX;
+	TEST_CHECK_EQ(icap_pool_refill(&pool), ICAP_DMA_DESCS_MAX);
+	TEST_CHECK_EQ(icap_dma_pending(&chain), ICAP_DMA_DESCS_MAX);
+	TEST_CHECK_EQ(dev_rejected, 0);
+
+	consume(ICAP_DMA_DESCS_MAX - 8);
+	TEST_CHECK_EQ(icap_pool_refill(&pool), ICAP_DMA_DESCS_MAX - 8);
+	TEST_CHECK_EQ(icap_dma_pending(&chain), ICAP_DMA_DESCS_MAX);
+	TEST_CHECK_EQ(dev_rejected, 0);
+
+	/* A small pool is limited by its own size */
+	setup(4, 0);
+	pool.max_in_flight = ICAP_DMA_DESCS_MAX;
+	TEST_CHECK_EQ(icap_pool_refill(&pool), 4);
+	TEST_CHECK_EQ(icap_pool_refill(&pool), 0);
+	use_dma = 0;
+}
+
+static void test_fill(void)
+{
+	struct icap_buf_frags report = {0, 1};
+
+	use_dma = 0;
+	setup(8, 0);
+	pool.fill = fill;
+	filled = 0;
+	fill_limit = 3;
+	TEST_CHECK_EQ(icap_pool_refill(&pool), 3);
+	TEST_CHECK_EQ(icap_frag_available(&cur), 3);
+
+	/* Refill continues at the fragment that failed */
+	fill_limit = 8;
+	consume(3);
+	TEST_CHECK_EQ(icap_pool_refill(&pool), 5);
+	TEST_CHECK_EQ(icap_frag_offset(&cur, 0), 3 * FRAG_SIZE);
+
+	/* More reported than sent */
+	report.frags = 6;
+	TEST_CHECK_EQ(icap_pool_frag_ready(&pool, &report), -ICAP_ERROR_INVALID);
+	report.frags = 5;
+	TEST_CHECK_EQ(icap_pool_frag_ready(&pool, &report), 1);
+}
+
+int main(void)
+{
+	test_init();
+	test_queue_depth();
+	test_dma_ring();
+	test_fill();
+	return TEST_RESULT();
+}
@@ -0,0 +1,200 @@
+/*
+ * Forwarding between cascaded instances, icap_proxy_init().
+ */
+
+#include <string.h>
+#include "rpmsg_lite.h"
+#include "icap_host.h"
+#include "icap_proxy.h"
+#include "test.h"
+
+#define DOWN_APP_ADDR (0x402)
+#define DOWN_DEV_ADDR (0x403)
+
+/* Offset of the buffers in the downstream address space */
+#define DOWN_OFFSET (0x80000000)
+
+static struct icap_host_pair pair;
+static struct icap_host_pair down;
+static struct icap_proxy proxy;
+static struct icap_buf_descriptor dev_buf;
+static uint32_t dev_inits;
+static uint32_t dev_frag_responses;
+static int32_t dev_init_ret;
+static uint32_t app_frags;
+static struct icap_buf_frags app_frag;
+
+static int32_t dev_subdevice_init(struct icap_instance *icap, struct icap_subdevice_params *params)
+{
+	dev_inits++;
+	return dev_init_ret;
+}
+
+static int32_t dev_add_src(struct icap_instance *icap, struct icap_buf_descriptor *buf)
+{
+	memcpy(&dev_buf, buf, sizeof(dev_buf));
+	return 7;
+}
+
+static int32_t dev_frag_ready_response(struct icap_instance *icap, int32_t buf_id)
+{
+	dev_frag_responses++;
+	return 0;
+}
+
+static int32_t app_frag_ready(struct icap_instance *icap, struct icap_buf_frags *frags)
+{
+	app_frags++;
+	memcpy(&app_frag, frags, sizeof(app_frag));
+	return 0;
+}
+
+static int32_t translate_buf(struct icap_proxy *proxy, struct icap_buf_descriptor *buf)
+{
+	buf->buf += DOWN_OFFSET;
+	return 0;
+}
+
+static struct icap_application_callbacks app_cb = {
+	.frag_ready = app_frag_ready,
+};
+static struct icap_device_callbacks dev_cb = {
+	.subdevice_init = dev_subdevice_init,
+	.add_src = dev_add_src,
+	.frag_ready_response = dev_frag_ready_response,
+};
+
+/* pair.app -> pair.dev -> proxy -> down.app -> down.dev */
+static void setup(void)
+{
+	TEST_CHECK_EQ(icap_host_pair_init(&pair, &app_cb, &dev_cb), 0);
+	memset(&down, 0, sizeof(down));
+	TEST_CHECK_EQ(icap_application_init(&down.app, "down_app", &app_cb, NULL), 0);
+	TEST_CHECK_EQ(icap_device_init(&down.dev, "down_dev", &dev_cb, NULL), 0);
+	down.app_ept.addr = DOWN_APP_ADDR;
+	down.app_ept.icap = &down.app;
+	down.dev_ept.addr = DOWN_DEV_ADDR;
+	down.dev_ept.icap = &down.dev;
+	rpmsg_lite_host_register(&down.app_ept);
+	rpmsg_lite_host_register(&down.dev_ept);
+	down.app.transport.rpmsg_instance = &down.rpmsg;
+	down.app.transport.rpmsg_ept = &down.app_ept;
+	down.app.transport.remote_addr = DOWN_DEV_ADDR;
+	down.dev.transport.rpmsg_instance = &down.rpmsg;
+	down.dev.transport.rpmsg_ept = &down.dev_ept;
+
+	TEST_CHECK_EQ(icap_proxy_init(&proxy, &pair.dev, &down.app), 0);
+	proxy.translate_buf = translate_buf;
+	dev_inits = 0;
+	dev_init_ret = 0;
+	dev_frag_responses = 0;
+	app_frags = 0;
+}
+
+static void test_init(void)
+{
+	setup();
+	TEST_CHECK_EQ(icap_proxy_init(&proxy, &pair.dev, &down.app), -ICAP_ERROR_BUSY);
+	TEST_CHECK_EQ(icap_proxy_deinit(&proxy), 0);
+	TEST_CHECK_EQ(icap_proxy_init(&proxy, &down.app, &pair.dev), -ICAP_ERROR_INVALID);
+	TEST_CHECK_EQ(icap_proxy_init(NULL, &pair.dev, &down.app), -ICAP_ERROR_INVALID);
+}
+
+/* Commands reach the downstream device, responses come back upstream */
+static void test_command(void)
+{
+	struct icap_subdevice_params params = {0, 2, 0, 48000};
+
+	setup();
+	TEST_CHECK_EQ(icap_subdevice_init(&pair.app, &params), 0);
+	TEST_CHECK_EQ(dev_inits, 1);
+	TEST_CHECK_EQ(down.dev_ept.received, 1);
+
+	/* A NAK carries the downstream error */
+	dev_init_ret = -ICAP_ERROR_BUSY;
+	TEST_CHECK_EQ(icap_subdevice_init(&pair.app, &params), -ICAP_ERROR_BUSY);
+	TEST_CHECK_EQ(dev_inits, 2);
+
+	/* Nothing waits for a response */
+	TEST_CHECK_EQ(proxy.requests[0].used, 0);
+	TEST_CHECK_EQ(proxy.requests[1].used, 0);
+	TEST_CHECK_EQ(icap_proxy_deinit(&proxy), 0);
+}
+
+/* The downstream device assigns the buffer id, the address is rewritten */
+static void test_buf(void)
+{
+	struct icap_subdevice_params params = {0, 2, 0, 48000};
+	struct icap_buf_descriptor buf;
+
+	setup();
+	TEST_CHECK_EQ(icap_subdevice_init(&pair.app, &params), 0);
+	memset(&buf, 0, sizeof(buf));
+	buf.buf = 0x1000;
+	buf.buf_size = 0x400;
+	buf.frag_size = 0x100;
+	TEST_CHECK_EQ(icap_add_src(&pair.app, &buf), 7);
+	TEST_CHECK(dev_buf.buf == DOWN_OFFSET + 0x1000);
+	TEST_CHECK_EQ(dev_buf.buf_size, 0x400);
+	TEST_CHECK_EQ(pair.app.journal.bufs[0].app_id, 7);
+	TEST_CHECK_EQ(pair.app.journal.bufs[0].dev_id, 7);
+	TEST_CHECK(pair.app.journal.bufs[0].buf.buf == 0x1000);
+	TEST_CHECK_EQ(icap_proxy_deinit(&proxy), 0);
+}
+
+/* Notifications of the downstream device reach the upstream application */
+static void test_notification(void)
+{
+	struct icap_subdevice_params params = {0, 2, 0, 48000};
+	struct icap_buf_frags frags = {7, 3};
+
+	setup();
+	/* The downstream device learns the address from the first request */
+	TEST_CHECK_EQ(icap_subdevice_init(&pair.app, &params), 0);
+
+	TEST_CHECK_EQ(icap_frag_ready(&down.dev, &frags), 0);
+	TEST_CHECK_EQ(app_frags, 1);
+	TEST_CHECK_EQ(app_frag.buf_id, 7);
+	TEST_CHECK_EQ(app_frag.frags, 3);
+
+	/* The upstream response goes back with the downstream sequence number */
+	TEST_CHECK_EQ(dev_frag_responses, 1);
+	TEST_CHECK_EQ(proxy.events[0].used, 0);
+	TEST_CHECK_EQ(icap_proxy_deinit(&proxy), 0);
+}
+
+/* Synchronous calls of the downstream instance itself get their responses */
+static void test_direct(void)
+{
+	struct icap_subdevice_params params = {1, 2, 0, 48000};
+	uint32_t received;
+
+	setup();
+	received = pair.app_ept.received;
+	TEST_CHECK_EQ(icap_subdevice_init(&down.app, &params), 0);
+	TEST_CHECK_EQ(dev_inits, 1);
+	TEST_CHECK_EQ(pair.app_ept.received, received);
+
+	/* Journal replay after the downstream device restarted */
+	down.app.journal.resume_pending = 1;
+	TEST_CHECK_EQ(icap_session_resume(&down.app), 0);
+	TEST_CHECK_EQ(dev_inits, 2);
+	TEST_CHECK_EQ(down.app.journal.resume_pending, 0);
+	TEST_CHECK_EQ(pair.app_ept.received, received);
+
+	/* Forwarding still works */
+	params.subdev_id = 0;
+	TEST_CHECK_EQ(icap_subdevice_init(&pair.app, &params), 0);
+	TEST_CHECK_EQ(dev_inits, 3);
+	TEST_CHECK_EQ(icap_proxy_deinit(&proxy), 0);
+}
+
+int main(void)
+{
+	test_init();
+	test_command();
+	test_buf();
+	test_notification();
+	test_direct();
+	return TEST_RESULT();
+}
@@ -0,0 +1,63 @@
+/*
+ * Sample rate conversion, icap_resample.c.
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include "icap_resample.h"
+#include "test.h"
+
+static void test_select_rate(void)
+{
+	TEST_CHECK_EQ(icap_resample_select_rate(ICAP_RATE_44100 | ICAP_RATE_48000, 44100), 44100);
+	TEST_CHECK_EQ(icap_resample_select_rate(ICAP_RATE_ALL_FREQ, 12345), 12345);
+	/* Not lower first, then fewer phases */
+	TEST_CHECK_EQ(icap_resample_select_rate(ICAP_RATE_32000 | ICAP_RATE_48000 | ICAP_RATE_88200, 44100), 88200);
+	TEST_CHECK_EQ(icap_resample_select_rate(ICAP_RATE_32000 | ICAP_RATE_96000 | ICAP_RATE_192000, 48000), 96000);
+	/* Only lower rates, the one losing the least bandwidth */
+	TEST_CHECK_EQ(icap_resample_select_rate(ICAP_RATE_32000 | ICAP_RATE_22050, 44100), 32000);
+	TEST_CHECK_EQ(icap_resample_select_rate(ICAP_RATE_8000 | ICAP_RATE_16000 | ICAP_RATE_44100, 48000), 44100);
+	TEST_CHECK(icap_resample_select_rate(0, 48000) < 0);
+	TEST_CHECK(icap_resample_select_rate(ICAP_RATE_48000, 0) < 0);
+}
+
+static void test_process(void)
+{
+	struct icap_resampler rs;
+	uint32_t size = icap_resample_mem_size(48000, 32000, 2, ICAP_RESAMPLE_MEDIUM);
+	void *mem = malloc(size);
+	float in[2 * 480], out[2 * 400];
+	uint32_t used, total_in = 0, total_out = 0;
+	uint32_t i, j;
+	int32_t ret;
+
+	TEST_CHECK(size > 0);
+	TEST_CHECK_EQ(icap_resample_init(&rs, 48000, 32000, 2, ICAP_RESAMPLE_MEDIUM, mem, size), 0);
+
+	for (i = 0; i < 480; i++) {
+		in[2 * i] = 0.5f;
+		in[2 * i + 1] = -0.25f;
+	}
+	for (i = 0; i < 10; i++) {
+		ret = icap_resample_process(&rs, in, 480, &used, out, 400);
+		TEST_CHECK(ret >= 0);
+		TEST_CHECK_EQ(used, 480);
+		total_in += used;
+		total_out += ret;
+	}
+	/* 2:3 ratio, the last block is past the filter delay */
+	TEST_CHECK(total_out + 1 >= total_in * 2 / 3);
+	TEST_CHECK(total_out <= total_in * 2 / 3);
+	for (j = 0; j < (uint32_t)ret; j++) {
+		TEST_CHECK(fabsf(out[2 * j] - 0.5f) < 0.01f);
+		TEST_CHECK(fabsf(out[2 * j + 1] + 0.25f) < 0.01f);
+	}
+	free(mem);
+}
+
+int main(void)
+{
+	test_select_rate();
+	test_process();
+	return TEST_RESULT();
+}
@@ -0,0 +1,96 @@
+/*
+ * Retransmission of lost messages and duplicates answered from the response cache.
+ */
+
+#include <string.h>
+#include "rpmsg_lite.h"
+#include "icap_host.h"
+#include "../src/platform/icap_transport.h"
+#include "test.h"
+
+static struct icap_host_pair pair;
+static uint32_t dev_adds;
+static uint32_t next_buf_id;
+
+static int32_t dev_add_src(struct icap_instance *icap, struct icap_buf_descriptor *buf)
+{
+	dev_adds++;
+	return next_buf_id++;
+}
+
+static struct icap_application_callbacks app_cb;
+static struct icap_device_callbacks dev_cb = {
+	.add_src = dev_add_src,
+};
+
+static void setup(void)
+{
+	TEST_CHECK_EQ(icap_host_pair_init(&pair, &app_cb, &dev_cb), 0);
+	dev_adds = 0;
+	next_buf_id = 3;
+}
+
+static int32_t add_src(void)
+{
+	struct icap_buf_descriptor buf;
+
+	memset(&buf, 0, sizeof(buf));
+	buf.buf = 0x1000;
+	buf.buf_size = 0x400;
+	buf.frag_size = 0x100;
+	return icap_add_src(&pair.app, &buf);
+}
+
+/* The request is lost, the retransmission executes it */
+static void test_lost_request(void)
+{
+	setup();
+	pair.dev_ept.drop_next = 1;
+	TEST_CHECK_EQ(add_src(), 3);
+	TEST_CHECK_EQ(pair.dev_ept.received, 2);
+	TEST_CHECK(pair.dev_ept.last_flags & ICAP_MSG_FLAG_RETRANSMIT);
+	TEST_CHECK_EQ(dev_adds, 1);
+
+	/* Next requests go out without the flag */
+	TEST_CHECK_EQ(add_src(), 4);
+	TEST_CHECK_EQ(pair.dev_ept.last_flags & ICAP_MSG_FLAG_RETRANSMIT, 0);
+}
+
+/* The response is lost, the duplicate is answered from the cache */
+static void test_lost_response(void)
+{
+	setup();
+	pair.app_ept.drop_next = 1;
+	TEST_CHECK_EQ(add_src(), 3);
+	TEST_CHECK_EQ(pair.dev_ept.received, 2);
+	TEST_CHECK(pair.dev_ept.last_flags & ICAP_MSG_FLAG_RETRANSMIT);
+	TEST_CHECK_EQ(dev_adds, 1);
+
+	/* Both responses lost */
+	pair.app_ept.drop_next = 2;
+	TEST_CHECK_EQ(add_src(), 4);
+	TEST_CHECK_EQ(pair.dev_ept.received, 5);
+	TEST_CHECK_EQ(dev_adds, 2);
+}
+
+/* Every attempt lost */
+static void test_all_lost(void)
+{
+	setup();
+	pair.dev_ept.drop_next = ICAP_MSG_RETRIES + 1;
+	TEST_CHECK_EQ(add_src(), -ICAP_ERROR_TIMEOUT);
+	TEST_CHECK_EQ(pair.dev_ept.received, ICAP_MSG_RETRIES + 1);
+	TEST_CHECK_EQ(dev_adds, 0);
+
+	/* The link recovers */
+	TEST_CHECK_EQ(add_src(), 3);
+	TEST_CHECK_EQ(dev_adds, 1);
+}
+
+int main(void)
+{
+	test_lost_request();
+	test_lost_response();
+	test_all_lost();
+	return TEST_RESULT();
+}
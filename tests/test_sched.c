@@ -0,0 +1,239 @@
+/*
+ * Scheduled actions and group start, icap_start_at() and icap_start_group().
+ */
+
+#include <string.h>
+#include "rpmsg_lite.h"
+#include "icap_host.h"
+#include "test.h"
+
+static struct icap_host_pair pair;
+static struct icap_sched dev_sched;
+static struct icap_sched_group dev_group;
+static uint32_t dev_sched_cmd;
+static uint32_t dev_groups;
+static uint32_t dev_starts;
+static uint32_t dev_pauses;
+
+enum {
+	SCHED_START = 1,
+	SCHED_STOP,
+	SCHED_PAUSE,
+	SCHED_RESUME,
+};
+
+static int32_t dev_subdevice_init(struct icap_instance *icap, struct icap_subdevice_params *params)
+{
+	return 0;
+}
+
+static int32_t dev_start(struct icap_instance *icap, uint32_t subdev_id)
+{
+	dev_starts++;
+	return 0;
+}
+
+static int32_t dev_pause(struct icap_instance *icap, uint32_t subdev_id)
+{
+	dev_pauses++;
+	return 0;
+}
+
+static int32_t log_sched(uint32_t cmd, struct icap_sched *sched)
+{
+	dev_sched_cmd = cmd;
+	memcpy(&dev_sched, sched, sizeof(dev_sched));
+	return 0;
+}
+
+static int32_t dev_start_at(struct icap_instance *icap, struct icap_sched *sched)
+{
+	return log_sched(SCHED_START, sched);
+}
+
+static int32_t dev_stop_at(struct icap_instance *icap, struct icap_sched *sched)
+{
+	return log_sched(SCHED_STOP, sched);
+}
+
+static int32_t dev_pause_at(struct icap_instance *icap, struct icap_sched *sched)
+{
+	return log_sched(SCHED_PAUSE, sched);
+}
+
+static int32_t dev_resume_at(struct icap_instance *icap, struct icap_sched *sched)
+{
+	return log_sched(SCHED_RESUME, sched);
+}
+
+static int32_t dev_start_group(struct icap_instance *icap, struct icap_sched_group *group)
+{
+	dev_groups++;
+	memcpy(&dev_group, group, sizeof(dev_group));
+	return 0;
+}
+
+static struct icap_application_callbacks app_cb;
+static struct icap_device_callbacks dev_cb = {
+	.subdevice_init = dev_subdevice_init,
+	.start = dev_start,
+	.pause = dev_pause,
+	.start_at = dev_start_at,
+	.stop_at = dev_stop_at,
+	.pause_at = dev_pause_at,
+	.resume_at = dev_resume_at,
+	.start_group = dev_start_group,
+};
+
+static void sched_init(struct icap_sched *sched, uint32_t subdev_id, uint32_t time_base, uint64_t time)
+{
+	memset(sched, 0, sizeof(*sched));
+	sched->subdev_id = subdev_id;
+	sched->time_base = time_base;
+	sched->time = time;
+}
+
+/* The device gets the requested subdevice, time base and time unchanged */
+static void check_sched(uint32_t cmd, uint32_t subdev_id, uint32_t time_base, uint64_t time)
+{
+	TEST_CHECK_EQ(dev_sched_cmd, cmd);
+	TEST_CHECK_EQ(dev_sched.subdev_id, subdev_id);
+	TEST_CHECK_EQ(dev_sched.time_base, time_base);
+	TEST_CHECK(dev_sched.time == time);
+	dev_sched_cmd = 0;
+}
+
+static void test_sched(void)
+{
+	struct icap_subdevice_params params = {0, 2, 0, 48000};
+	struct icap_sched sched;
+
+	TEST_CHECK_EQ(icap_host_pair_init(&pair, &app_cb, &dev_cb), 0);
+	TEST_CHECK_EQ(icap_subdevice_init(&pair.app, &params), 0);
+	TEST_CHECK_EQ(icap_start_at(&pair.app, NULL), -ICAP_ERROR_INVALID);
+
+	sched_init(&sched, 0, ICAP_TIME_FRAMES, 48000);
+	TEST_CHECK_EQ(icap_start_at(&pair.app, &sched), 0);
+	check_sched(SCHED_START, 0, ICAP_TIME_FRAMES, 48000);
+	TEST_CHECK_EQ(pair.app.journal.subdevs[0].run_state, ICAP_RUN_RUNNING);
+
+	/* 64 bit timestamps pass unchanged */
+	sched_init(&sched, 0, ICAP_TIME_TIMESTAMP, 0x123456789abcdef0ull);
+	TEST_CHECK_EQ(icap_pause_at(&pair.app, &sched), 0);
+	check_sched(SCHED_PAUSE, 0, ICAP_TIME_TIMESTAMP, 0x123456789abcdef0ull);
+	TEST_CHECK_EQ(pair.app.journal.subdevs[0].run_state, ICAP_RUN_PAUSED);
+
+	sched_init(&sched, 0, ICAP_TIME_FRAMES, 96000);
+	TEST_CHECK_EQ(icap_resume_at(&pair.app, &sched), 0);
+	check_sched(SCHED_RESUME, 0, ICAP_TIME_FRAMES, 96000);
+
+	sched_init(&sched, 0, ICAP_TIME_TIMESTAMP, 5000000000ull);
+	TEST_CHECK_EQ(icap_stop_at(&pair.app, &sched), 0);
+	check_sched(SCHED_STOP, 0, ICAP_TIME_TIMESTAMP, 5000000000ull);
+	TEST_CHECK_EQ(pair.app.journal.subdevs[0].run_state, ICAP_RUN_STOPPED);
+}
+
+/* Without the scheduled callbacks only the immediate requests are served */
+static void test_sched_fallback(void)
+{
+	struct icap_device_callbacks cb = {
+		.start = dev_start,
+	};
+	struct icap_sched sched;
+
+	TEST_CHECK_EQ(icap_host_pair_init(&pair, &app_cb, &cb), 0);
+	dev_starts = 0;
+	sched_init(&sched, 0, ICAP_TIME_NOW, 0);
+	TEST_CHECK_EQ(icap_start_at(&pair.app, &sched), 0);
+	TEST_CHECK_EQ(dev_starts, 1);
+	sched_init(&sched, 0, ICAP_TIME_FRAMES, 48000);
+	TEST_CHECK_EQ(icap_start_at(&pair.app, &sched), -ICAP_ERROR_NOT_SUP);
+	TEST_CHECK_EQ(dev_starts, 1);
+
+	/* A group start needs the device callback */
+	memset(&dev_group, 0, sizeof(dev_group));
+	dev_group.num = 1;
+	TEST_CHECK_EQ(icap_start_group(&pair.app, &dev_group), -ICAP_ERROR_NOT_SUP);
+}
+
+static void test_group(void)
+{
+	struct icap_subdevice_params params = {0, 2, 0, 48000};
+	struct icap_sched_group group;
+	uint32_t received;
+	uint32_t i;
+
+	TEST_CHECK_EQ(icap_host_pair_init(&pair, &app_cb, &dev_cb), 0);
+	for (i = 0; i < 3; i++) {
+		params.subdev_id = i;
+		TEST_CHECK_EQ(icap_subdevice_init(&pair.app, &params), 0);
+	}
+
+	memset(&group, 0, sizeof(group));
+	TEST_CHECK_EQ(icap_start_group(&pair.app, &group), -ICAP_ERROR_INVALID);
+	group.num = ICAP_SCHED_GROUP_MAX + 1;
+	TEST_CHECK_EQ(icap_start_group(&pair.app, &group), -ICAP_ERROR_INVALID);
+
+	/* All subdevices arrive in one message */
+	group.time_base = ICAP_TIME_FRAMES;
+	group.time = 1024;
+	group.num = 3;
+	group.subdev_ids[0] = 2;
+	group.subdev_ids[1] = 0;
+	group.subdev_ids[2] = 1;
+	dev_groups = 0;
+	received = pair.dev_ept.received;
+	TEST_CHECK_EQ(icap_start_group(&pair.app, &group), 0);
+	TEST_CHECK_EQ(pair.dev_ept.received - received, 1);
+	TEST_CHECK_EQ(dev_groups, 1);
+	TEST_CHECK_EQ(dev_group.time_base, ICAP_TIME_FRAMES);
+	TEST_CHECK(dev_group.time == 1024);
+	TEST_CHECK_EQ(dev_group.num, 3);
+	TEST_CHECK_EQ(dev_group.subdev_ids[0], 2);
+	TEST_CHECK_EQ(dev_group.subdev_ids[1], 0);
+	TEST_CHECK_EQ(dev_group.subdev_ids[2], 1);
+	for (i = 0; i < 3; i++) {
+		TEST_CHECK_EQ(pair.app.journal.subdevs[i].run_state, ICAP_RUN_RUNNING);
+	}
+}
+
+/* The replay applies the scheduled state immediately, see icap_session_resume() */
+static void test_replay(void)
+{
+	struct icap_subdevice_params params = {0, 2, 0, 48000};
+	struct icap_sched sched;
+
+	TEST_CHECK_EQ(icap_host_pair_init(&pair, &app_cb, &dev_cb), 0);
+	TEST_CHECK_EQ(icap_subdevice_init(&pair.app, &params), 0);
+	params.subdev_id = 1;
+	TEST_CHECK_EQ(icap_subdevice_init(&pair.app, &params), 0);
+	sched_init(&sched, 0, ICAP_TIME_FRAMES, 480000);
+	TEST_CHECK_EQ(icap_start_at(&pair.app, &sched), 0);
+	sched_init(&sched, 1, ICAP_TIME_FRAMES, 480000);
+	TEST_CHECK_EQ(icap_start_at(&pair.app, &sched), 0);
+	sched_init(&sched, 1, ICAP_TIME_FRAMES, 960000);
+	TEST_CHECK_EQ(icap_pause_at(&pair.app, &sched), 0);
+
+	/* The device restarted before the scheduled frames */
+	dev_groups = 0;
+	dev_pauses = 0;
+	dev_sched_cmd = 0;
+	pair.app.journal.resume_pending = 1;
+	TEST_CHECK_EQ(icap_session_resume(&pair.app), 0);
+	TEST_CHECK_EQ(dev_groups, 1);
+	TEST_CHECK_EQ(dev_group.time_base, ICAP_TIME_NOW);
+	TEST_CHECK_EQ(dev_group.num, 2);
+	TEST_CHECK_EQ(dev_group.subdev_ids[0], 0);
+	TEST_CHECK_EQ(dev_group.subdev_ids[1], 1);
+	TEST_CHECK_EQ(dev_pauses, 1);
+	TEST_CHECK_EQ(dev_sched_cmd, 0);
+}
+
+int main(void)
+{
+	test_sched();
+	test_sched_fallback();
+	test_group();
+	test_replay();
+	return TEST_RESULT();
+}
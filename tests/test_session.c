@@ -0,0 +1,318 @@
+/*
+ * Session journal and icap_session_resume().
+ */
+
+#include <string.h>
+#include "rpmsg_lite.h"
+#include "icap_host.h"
+#include "test.h"
+
+static struct icap_host_pair pair;
+static uint32_t dev_inits;
+static uint32_t dev_starts;
+static uint32_t dev_removes;
+static uint32_t dev_adds;
+static uint32_t next_buf_id;
+static struct icap_buf_descriptor dev_buf;
+static struct icap_buf_geometry dev_geometry;
+static uint64_t dev_next_frag;
+static uint32_t dev_lost;
+static uint32_t dev_lost_bufs;
+
+static int32_t dev_subdevice_init(struct icap_instance *icap, struct icap_subdevice_params *params)
+{
+	dev_inits++;
+	return 0;
+}
+
+static int32_t dev_add_src(struct icap_instance *icap, struct icap_buf_descriptor *buf)
+{
+	dev_adds++;
+	memcpy(&dev_buf, buf, sizeof(dev_buf));
+	return next_buf_id++;
+}
+
+static int32_t dev_remove_src(struct icap_instance *icap, uint32_t buf_id)
+{
+	dev_removes++;
+	return 0;
+}
+
+static int32_t dev_start(struct icap_instance *icap, uint32_t subdev_id)
+{
+	dev_starts++;
+	return 0;
+}
+
+/* Switches two fragments after the requested one or at dev_next_frag */
+static int32_t dev_buf_geometry(struct icap_instance *icap, struct icap_buf_geometry *geometry)
+{
+	memcpy(&dev_geometry, geometry, sizeof(dev_geometry));
+	if (geometry->frag == ICAP_FRAG_NEXT) {
+		geometry->frag = dev_next_frag;
+	} else {
+		geometry->frag += 2;
+	}
+	return 0;
+}
+
+/* Counts the buffers of the lost session, still listed during the callback */
+static int32_t dev_session_lost(struct icap_instance *icap, uint32_t session)
+{
+	uint32_t i;
+
+	dev_lost++;
+	dev_lost_bufs = 0;
+	for (i = 0; i < ICAP_SESSION_BUFS; i++) {
+		if (icap->sessions.bufs[i].used && (icap->sessions.bufs[i].session == session)) {
+			dev_lost_bufs++;
+		}
+	}
+	return 0;
+}
+
+static struct icap_application_callbacks app_cb;
+static struct icap_device_callbacks dev_cb = {
+	.subdevice_init = dev_subdevice_init,
+	.add_src = dev_add_src,
+	.remove_src = dev_remove_src,
+	.start = dev_start,
+	.buf_geometry = dev_buf_geometry,
+	.session_lost = dev_session_lost,
+};
+
+static void test_resume_retry(void)
+{
+	struct icap_subdevice_params params = {0, 2, 0, 48000};
+	struct icap_buf_descriptor buf;
+	int32_t id;
+
+	memset(&buf, 0, sizeof(buf));
+	buf.buf = 0x1000;
+	buf.buf_size = 0x400;
+	buf.frag_size = 0x100;
+
+	TEST_CHECK_EQ(icap_host_pair_init(&pair, &app_cb, &dev_cb), 0);
+	next_buf_id = 5;
+	TEST_CHECK_EQ(icap_subdevice_init(&pair.app, &params), 0);
+	id = icap_add_src(&pair.app, &buf);
+	TEST_CHECK_EQ(id, 5);
+	TEST_CHECK_EQ(icap_start(&pair.app, 0), 0);
+
+	/* The device restarted and isn't listening yet */
+	next_buf_id = 0;
+	dev_inits = 0;
+	dev_starts = 0;
+	pair.app.journal.resume_pending = 1;
+	pair.dev_ept.drop = 1;
+	TEST_CHECK_EQ(icap_session_resume(&pair.app), -ICAP_ERROR_TIMEOUT);
+	TEST_CHECK_EQ(pair.app.journal.resume_pending, 1);
+
+	pair.dev_ept.drop = 0;
+	TEST_CHECK_EQ(icap_session_resume(&pair.app), 0);
+	TEST_CHECK_EQ(pair.app.journal.resume_pending, 0);
+	TEST_CHECK_EQ(dev_inits, 1);
+	TEST_CHECK_EQ(dev_starts, 1);
+
+	/* The application id stays, the device knows the buffer as 0 now */
+	TEST_CHECK_EQ(pair.app.journal.bufs[0].app_id, 5);
+	TEST_CHECK_EQ(pair.app.journal.bufs[0].dev_id, 0);
+}
+
+static void test_journal_full(void)
+{
+	struct icap_buf_descriptor buf;
+	uint32_t i;
+	int32_t id;
+
+	memset(&buf, 0, sizeof(buf));
+	buf.buf = 0x1000;
+	buf.buf_size = 0x400;
+	buf.frag_size = 0x100;
+
+	/* Continues with the resumed buffer 5 known to the device as 0 */
+	next_buf_id = 1;
+	for (i = 1; i < ICAP_JOURNAL_BUFS; i++) {
+		id = icap_add_src(&pair.app, &buf);
+		TEST_CHECK(id >= 0);
+	}
+
+	/* Not journaled, keeps the device id */
+	next_buf_id = 100;
+	TEST_CHECK_EQ(icap_add_src(&pair.app, &buf), 100);
+
+	/* Not journaled and the id belongs to the resumed buffer, detached again */
+	next_buf_id = 5;
+	dev_removes = 0;
+	TEST_CHECK_EQ(icap_add_src(&pair.app, &buf), -ICAP_ERROR_NOMEM);
+	TEST_CHECK_EQ(dev_removes, 1);
+}
+
+static void test_session_bufs_full(void)
+{
+	struct icap_subdevice_params params = {0, 2, 0, 48000};
+	struct icap_buf_descriptor buf;
+	uint32_t i;
+
+	memset(&buf, 0, sizeof(buf));
+	buf.buf = 0x1000;
+	buf.buf_size = 0x400;
+	buf.frag_size = 0x100;
+
+	TEST_CHECK_EQ(icap_host_pair_init(&pair, &app_cb, &dev_cb), 0);
+	TEST_CHECK_EQ(icap_device_enable_sessions(&pair.dev), 0);
+	TEST_CHECK_EQ(icap_subdevice_init(&pair.app, &params), 0);
+
+	next_buf_id = 0;
+	for (i = 0; i < ICAP_SESSION_BUFS; i++) {
+		TEST_CHECK_EQ(icap_add_src(&pair.app, &buf), i);
+	}
+
+	/* The device callback isn't called for a buffer the session can't track */
+	dev_adds = 0;
+	TEST_CHECK_EQ(icap_add_src(&pair.app, &buf), -ICAP_ERROR_NOMEM);
+	TEST_CHECK_EQ(dev_adds, 0);
+
+	TEST_CHECK_EQ(icap_remove_src(&pair.app, 3), 0);
+	TEST_CHECK_EQ(icap_add_src(&pair.app, &buf), ICAP_SESSION_BUFS);
+}
+
+static void test_buf_geometry(void)
+{
+	struct icap_device_callbacks cb = {
+		.add_src = dev_add_src,
+	};
+	struct icap_subdevice_params params = {0, 2, 0, 48000};
+	struct icap_buf_descriptor buf;
+	struct icap_buf_geometry geometry;
+
+	memset(&buf, 0, sizeof(buf));
+	buf.buf = 0x1000;
+	buf.buf_size = 0x400;
+	buf.frag_size = 0x100;
+
+	TEST_CHECK_EQ(icap_host_pair_init(&pair, &app_cb, &dev_cb), 0);
+	next_buf_id = 5;
+	TEST_CHECK_EQ(icap_subdevice_init(&pair.app, &params), 0);
+	TEST_CHECK_EQ(icap_add_src(&pair.app, &buf), 5);
+
+	memset(&geometry, 0, sizeof(geometry));
+	geometry.buf_id = 5;
+	TEST_CHECK_EQ(icap_set_buf_geometry(&pair.app, NULL), -ICAP_ERROR_INVALID);
+	TEST_CHECK_EQ(icap_set_buf_geometry(&pair.app, &geometry), -ICAP_ERROR_INVALID);
+
+	/* The caller gets the fragment confirmed by the device */
+	geometry.frag_size = 0x80;
+	geometry.gap_size = 0x20;
+	geometry.frag = 10;
+	TEST_CHECK_EQ(icap_set_buf_geometry(&pair.app, &geometry), 0);
+	TEST_CHECK(geometry.frag == 12);
+	TEST_CHECK_EQ(dev_geometry.buf_id, 5);
+	TEST_CHECK_EQ(dev_geometry.frag_size, 0x80);
+	TEST_CHECK_EQ(dev_geometry.gap_size, 0x20);
+	TEST_CHECK(dev_geometry.frag == 10);
+	dev_next_frag = 40;
+	geometry.frag = ICAP_FRAG_NEXT;
+	TEST_CHECK_EQ(icap_set_buf_geometry(&pair.app, &geometry), 0);
+	TEST_CHECK(geometry.frag == 40);
+
+	/* The replay adds the buffer with the new geometry */
+	next_buf_id = 0;
+	dev_adds = 0;
+	pair.app.journal.resume_pending = 1;
+	TEST_CHECK_EQ(icap_session_resume(&pair.app), 0);
+	TEST_CHECK_EQ(dev_adds, 1);
+	TEST_CHECK_EQ(dev_buf.frag_size, 0x80);
+	TEST_CHECK_EQ(dev_buf.gap_size, 0x20);
+	TEST_CHECK_EQ(dev_buf.buf_size, 0x400);
+
+	/* Later changes go to the device id of the replayed buffer */
+	geometry.frag = 50;
+	TEST_CHECK_EQ(icap_set_buf_geometry(&pair.app, &geometry), 0);
+	TEST_CHECK_EQ(dev_geometry.buf_id, 0);
+
+	/* A rejected change isn't journaled */
+	TEST_CHECK_EQ(icap_host_pair_init(&pair, &app_cb, &cb), 0);
+	TEST_CHECK_EQ(icap_add_src(&pair.app, &buf), 1);
+	geometry.buf_id = 1;
+	TEST_CHECK_EQ(icap_set_buf_geometry(&pair.app, &geometry), -ICAP_ERROR_NOT_SUP);
+	TEST_CHECK_EQ(pair.app.journal.bufs[0].buf.frag_size, 0x100);
+	TEST_CHECK_EQ(pair.app.journal.bufs[0].buf.gap_size, 0);
+}
+
+/* An application which stops responding loses its session */
+static void test_session_lost(void)
+{
+	struct icap_subdevice_params params = {0, 2, 0, 48000};
+	struct rpmsg_lite_endpoint app2_ept;
+	struct icap_instance app2;
+	struct icap_buf_descriptor buf;
+	uint32_t tick = 1000;
+	uint32_t i;
+
+	memset(&buf, 0, sizeof(buf));
+	buf.buf = 0x1000;
+	buf.buf_size = 0x400;
+	buf.frag_size = 0x100;
+
+	TEST_CHECK_EQ(icap_host_pair_init(&pair, &app_cb, &dev_cb), 0);
+	TEST_CHECK_EQ(icap_device_enable_sessions(&pair.dev), 0);
+
+	/* Second application endpoint of the same device */
+	memset(&app2, 0, sizeof(app2));
+	memset(&app2_ept, 0, sizeof(app2_ept));
+	TEST_CHECK_EQ(icap_application_init(&app2, "app2", &app_cb, NULL), 0);
+	app2_ept.addr = ICAP_HOST_APP_ADDR + 2;
+	app2_ept.icap = &app2;
+	rpmsg_lite_host_register(&app2_ept);
+	app2.transport.rpmsg_instance = &pair.rpmsg;
+	app2.transport.rpmsg_ept = &app2_ept;
+	app2.transport.remote_addr = ICAP_HOST_DEV_ADDR;
+
+	next_buf_id = 0;
+	rpmsg_lite_host_set_clock(tick, 0);
+	TEST_CHECK_EQ(icap_subdevice_init(&pair.app, &params), 0);
+	TEST_CHECK_EQ(icap_add_src(&pair.app, &buf), 0);
+	TEST_CHECK_EQ(icap_subdevice_init(&app2, &params), -ICAP_ERROR_ACCESS);
+	TEST_CHECK_EQ(pair.dev.sessions.sessions[0].used, 1);
+	TEST_CHECK_EQ(pair.dev.sessions.sessions[1].used, 1);
+
+	/* The first application dies, the second answers the heartbeats */
+	dev_lost = 0;
+	TEST_CHECK_EQ(icap_set_heartbeat(&pair.dev, 1000), 0);
+	pair.app_ept.drop = 1;
+	for (i = 0; i < ICAP_HEARTBEAT_MISS_MAX; i++) {
+		tick += 1000;
+		rpmsg_lite_host_set_clock(tick, 0);
+		TEST_CHECK_EQ(icap_heartbeat(&pair.dev), 0);
+	}
+	TEST_CHECK_EQ(dev_lost, 0);
+	rpmsg_lite_host_set_clock(tick + 1, 0);
+	TEST_CHECK_EQ(icap_heartbeat(&pair.dev), 0);
+	TEST_CHECK_EQ(dev_lost, 1);
+	TEST_CHECK_EQ(dev_lost_bufs, 1);
+	TEST_CHECK_EQ(pair.dev.sessions.sessions[0].used, 0);
+	TEST_CHECK_EQ(pair.dev.sessions.sessions[1].used, 1);
+	TEST_CHECK_EQ(pair.dev.sessions.bufs[0].used, 0);
+	TEST_CHECK_EQ(pair.dev.link.peer_alive, 1);
+
+	/* The subdevice is free for the living application */
+	rpmsg_lite_host_set_clock(tick + 1, 10);
+	TEST_CHECK_EQ(icap_subdevice_init(&app2, &params), 0);
+
+	/* The restarted application gets a new session */
+	pair.app_ept.drop = 0;
+	TEST_CHECK_EQ(icap_subdevice_init(&pair.app, &params), -ICAP_ERROR_ACCESS);
+	TEST_CHECK_EQ(pair.dev.sessions.sessions[0].used, 1);
+	TEST_CHECK_EQ(dev_lost, 1);
+}
+
+int main(void)
+{
+	test_resume_retry();
+	test_journal_full();
+	test_session_bufs_full();
+	test_buf_geometry();
+	test_session_lost();
+	return TEST_RESULT();
+}
@@ -0,0 +1,235 @@
+/*
+ * Zero-copy stream, icap_stream.c.
+ */
+
+#include <string.h>
+#include "icap_stream.h"
+#include "test.h"
+
+#define FRAGS (8)
+#define FRAG_SIZE (0x100)
+
+static uint8_t region[2 * FRAGS * FRAG_SIZE];
+static struct icap_stream stream;
+static uint32_t wakes;
+static uint32_t waits;
+static uint32_t wait_report;
+
+static void buf_init(struct icap_buf_descriptor *buf, uint32_t gap)
+{
+	memset(buf, 0, sizeof(*buf));
+	buf->type = ICAP_BUF_CIRCURAL;
+	buf->frag_size = FRAG_SIZE;
+	buf->gap_size = gap;
+	buf->buf_size = FRAGS * (FRAG_SIZE + gap) - gap;
+}
+
+static void report(uint32_t frags)
+{
+	struct icap_buf_frags report = {0, frags};
+
+	icap_stream_frag_ready(&stream, &report);
+}
+
+static void wake(struct icap_stream *stream)
+{
+	wakes++;
+}
+
+/* Reports wait_report fragments on each wait, as if they arrived meanwhile */
+static int32_t wait(struct icap_stream *stream, uint32_t timeout_us)
+{
+	waits++;
+	if (wait_report == 0) {
+		return -ICAP_ERROR_TIMEOUT;
+	}
+	report(wait_report);
+	return 0;
+}
+
+static void test_init(void)
+{
+	struct icap_buf_descriptor buf;
+
+	buf_init(&buf, 0);
+	TEST_CHECK_EQ(icap_stream_init(&stream, &buf, ICAP_DEV_PLAYBACK, NULL, 1), -ICAP_ERROR_INVALID);
+	TEST_CHECK_EQ(icap_stream_init(&stream, &buf, ICAP_DEV_PLAYBACK, region, 0), -ICAP_ERROR_INVALID);
+	TEST_CHECK_EQ(icap_stream_init(&stream, &buf, ICAP_DEV_PLAYBACK, region, FRAGS + 1), -ICAP_ERROR_INVALID);
+	TEST_CHECK_EQ(icap_stream_init(&stream, &buf, 7, region, 1), -ICAP_ERROR_INVALID);
+	buf.type = ICAP_BUF_SCATTERED;
+	TEST_CHECK_EQ(icap_stream_init(&stream, &buf, ICAP_DEV_PLAYBACK, region, 1), -ICAP_ERROR_INVALID);
+	buf_init(&buf, 0);
+	buf.frag_size = 0;
+	TEST_CHECK(icap_stream_init(&stream, &buf, ICAP_DEV_PLAYBACK, region, 1) < 0);
+
+	buf_init(&buf, 0);
+	TEST_CHECK_EQ(icap_stream_init(&stream, &buf, ICAP_DEV_PLAYBACK, region, FRAGS), 0);
+	TEST_CHECK_EQ(stream.contiguous, 1);
+	buf_init(&buf, 0x40);
+	TEST_CHECK_EQ(icap_stream_init(&stream, &buf, ICAP_DEV_RECORD, region, 1), 0);
+	TEST_CHECK_EQ(stream.contiguous, 0);
+}
+
+static void test_playback(void)
+{
+	struct icap_buf_descriptor buf;
+	void *ptr;
+
+	buf_init(&buf, 0);
+	TEST_CHECK_EQ(icap_stream_init(&stream, &buf, ICAP_DEV_PLAYBACK, region, 2), 0);
+
+	/* The whole buffer can be filled before the start */
+	TEST_CHECK_EQ(icap_stream_avail(&stream), FRAGS);
+	TEST_CHECK_EQ(icap_stream_begin_write(&stream, &ptr), FRAGS);
+	TEST_CHECK(ptr == region);
+	TEST_CHECK_EQ(icap_stream_commit(&stream, FRAGS + 1), -ICAP_ERROR_INVALID);
+	TEST_CHECK_EQ(icap_stream_commit(&stream, 6), 0);
+	TEST_CHECK_EQ(icap_stream_avail(&stream), 2);
+	TEST_CHECK_EQ(icap_stream_begin_read(&stream, &ptr), -ICAP_ERROR_INVALID);
+	TEST_CHECK_EQ(icap_stream_release(&stream, 0), -ICAP_ERROR_INVALID);
+
+	/* A begin without commit doesn't move */
+	TEST_CHECK_EQ(icap_stream_begin_write(&stream, &ptr), 2);
+	TEST_CHECK(ptr == region + 6 * FRAG_SIZE);
+	TEST_CHECK_EQ(icap_stream_begin_write(&stream, &ptr), 2);
+	TEST_CHECK(ptr == region + 6 * FRAG_SIZE);
+	TEST_CHECK_EQ(icap_stream_commit(&stream, 2), 0);
+	TEST_CHECK_EQ(icap_stream_commit(&stream, 1), -ICAP_ERROR_INVALID);
+	TEST_CHECK_EQ(icap_stream_avail(&stream), 0);
+	TEST_CHECK_EQ(icap_stream_begin_write(&stream, &ptr), 0);
+
+	/* Played fragments are free again, contiguous up to the buffer end */
+	report(3);
+	TEST_CHECK_EQ(icap_stream_avail(&stream), 3);
+	TEST_CHECK_EQ(icap_stream_begin_write(&stream, &ptr), 3);
+	TEST_CHECK(ptr == region);
+	TEST_CHECK_EQ(icap_stream_commit(&stream, 3), 0);
+	report(FRAGS);
+	TEST_CHECK_EQ(icap_stream_begin_write(&stream, &ptr), FRAGS - 3);
+	TEST_CHECK(ptr == region + 3 * FRAG_SIZE);
+	TEST_CHECK_EQ(icap_stream_commit(&stream, FRAGS - 3), 0);
+	TEST_CHECK_EQ(icap_stream_begin_write(&stream, &ptr), 3);
+	TEST_CHECK(ptr == region);
+	TEST_CHECK_EQ(icap_stream_commit(&stream, 0), 0);
+
+	/* Underrun, the device played 2 fragments which weren't written */
+	report(7);
+	TEST_CHECK_EQ(icap_stream_avail(&stream), -ICAP_ERROR_NO_BUFS);
+	TEST_CHECK_EQ(icap_stream_begin_write(&stream, &ptr), -ICAP_ERROR_NO_BUFS);
+	TEST_CHECK_EQ(icap_stream_commit(&stream, 1), -ICAP_ERROR_INVALID);
+	icap_stream_recover(&stream);
+	TEST_CHECK_EQ(icap_stream_avail(&stream), FRAGS);
+	TEST_CHECK_EQ(icap_stream_begin_write(&stream, &ptr), FRAGS - 2);
+	TEST_CHECK(ptr == region + 2 * FRAG_SIZE);
+}
+
+static void test_record(void)
+{
+	struct icap_buf_descriptor buf;
+	void *ptr;
+
+	/* Fragments with gaps are returned one by one */
+	buf_init(&buf, 0x40);
+	TEST_CHECK_EQ(icap_stream_init(&stream, &buf, ICAP_DEV_RECORD, region, 1), 0);
+	TEST_CHECK_EQ(icap_stream_avail(&stream), 0);
+	TEST_CHECK_EQ(icap_stream_begin_read(&stream, &ptr), 0);
+	TEST_CHECK_EQ(icap_stream_begin_write(&stream, &ptr), -ICAP_ERROR_INVALID);
+
+	report(3);
+	TEST_CHECK_EQ(icap_stream_avail(&stream), 3);
+	TEST_CHECK_EQ(icap_stream_begin_read(&stream, &ptr), 1);
+	TEST_CHECK(ptr == region);
+	TEST_CHECK_EQ(icap_stream_release(&stream, 2), -ICAP_ERROR_INVALID);
+	TEST_CHECK_EQ(icap_stream_release(&stream, 1), 0);
+	TEST_CHECK_EQ(icap_stream_begin_read(&stream, &ptr), 1);
+	TEST_CHECK(ptr == region + (FRAG_SIZE + 0x40));
+	TEST_CHECK_EQ(icap_stream_release(&stream, 1), 0);
+	TEST_CHECK_EQ(icap_stream_avail(&stream), 1);
+
+	/* A full buffer is still readable */
+	report(FRAGS - 1);
+	TEST_CHECK_EQ(icap_stream_avail(&stream), FRAGS);
+
+	/* Overrun, the device recorded over an unread fragment */
+	report(1);
+	TEST_CHECK_EQ(icap_stream_avail(&stream), -ICAP_ERROR_NO_BUFS);
+	TEST_CHECK_EQ(icap_stream_begin_read(&stream, &ptr), -ICAP_ERROR_NO_BUFS);
+	icap_stream_recover(&stream);
+	TEST_CHECK_EQ(icap_stream_avail(&stream), 0);
+
+	/* The client continues at the next fragment the device records */
+	report(1);
+	TEST_CHECK_EQ(icap_stream_begin_read(&stream, &ptr), 1);
+	TEST_CHECK(ptr == region + 3 * (FRAG_SIZE + 0x40));
+}
+
+static void test_planar(void)
+{
+	struct icap_buf_descriptor buf;
+	void *ptr;
+
+	memset(&buf, 0, sizeof(buf));
+	buf.type = ICAP_BUF_PLANAR;
+	buf.frag_size = FRAG_SIZE;
+	buf.buf_size = FRAGS * FRAG_SIZE;
+	buf.channels = 2;
+	buf.channel_stride = FRAGS * FRAG_SIZE;
+	TEST_CHECK_EQ(icap_stream_init(&stream, &buf, ICAP_DEV_RECORD, region, 1), 0);
+
+	/* Contiguous within the plane of the first channel */
+	report(5);
+	TEST_CHECK_EQ(icap_stream_begin_read(&stream, &ptr), 5);
+	TEST_CHECK(ptr == region);
+	TEST_CHECK_EQ(icap_stream_release(&stream, 5), 0);
+	report(FRAGS);
+	TEST_CHECK_EQ(icap_stream_begin_read(&stream, &ptr), FRAGS - 5);
+	TEST_CHECK(ptr == region + 5 * FRAG_SIZE);
+}
+
+static void test_wait(void)
+{
+	struct icap_buf_descriptor buf;
+
+	buf_init(&buf, 0);
+	TEST_CHECK_EQ(icap_stream_init(&stream, &buf, ICAP_DEV_RECORD, region, 4), 0);
+	TEST_CHECK_EQ(icap_stream_wait(&stream, 0), -ICAP_ERROR_BUSY);
+	TEST_CHECK_EQ(icap_stream_wait(&stream, 1000), -ICAP_ERROR_NOT_SUP);
+
+	/* Woken only once avail_min fragments are there */
+	stream.wake = wake;
+	stream.wait = wait;
+	wakes = 0;
+	report(3);
+	TEST_CHECK_EQ(wakes, 0);
+	report(1);
+	TEST_CHECK_EQ(wakes, 1);
+	TEST_CHECK_EQ(icap_stream_wait(&stream, 0), 4);
+
+	/* Waits until enough fragments arrived */
+	icap_stream_recover(&stream);
+	waits = 0;
+	wait_report = 1;
+	TEST_CHECK_EQ(icap_stream_wait(&stream, 1000), 4);
+	TEST_CHECK_EQ(waits, 4);
+
+	/* The wait timeout is returned */
+	icap_stream_recover(&stream);
+	wait_report = 0;
+	TEST_CHECK_EQ(icap_stream_wait(&stream, 1000), -ICAP_ERROR_TIMEOUT);
+
+	/* An overrun wakes up too */
+	wakes = 0;
+	report(FRAGS + 1);
+	TEST_CHECK_EQ(wakes, 1);
+	TEST_CHECK_EQ(icap_stream_wait(&stream, 1000), -ICAP_ERROR_NO_BUFS);
+}
+
+int main(void)
+{
+	test_init();
+	test_playback();
+	test_record();
+	test_planar();
+	test_wait();
+	return TEST_RESULT();
+}
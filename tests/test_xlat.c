@@ -0,0 +1,140 @@
+/*
+ * Translation of the addresses received by the device, icap_set_xlat().
+ */
+
+#include <string.h>
+#include "rpmsg_lite.h"
+#include "icap_host.h"
+#include "icap_xlat.h"
+#include "icap_proxy.h"
+#include "test.h"
+
+/* Endpoints of the downstream pair behind the proxy */
+#define DOWN_APP_ADDR (0x402)
+#define DOWN_DEV_ADDR (0x403)
+
+static struct icap_host_pair pair;
+static struct icap_host_pair down;
+static struct icap_proxy proxy;
+static struct icap_xlat xlat;
+static uint64_t dev_buf_addr;
+static uint64_t dev_ctrl_addr;
+
+static int32_t dev_add_src(struct icap_instance *icap, struct icap_buf_descriptor *buf)
+{
+	dev_buf_addr = buf->buf;
+	return 0;
+}
+
+static int32_t dev_ctrl_block(struct icap_instance *icap, struct icap_ctrl_desc *desc)
+{
+	dev_ctrl_addr = desc->addr;
+	return 0;
+}
+
+static struct icap_application_callbacks app_cb;
+static struct icap_device_callbacks dev_cb = {
+	.add_src = dev_add_src,
+	.ctrl_block = dev_ctrl_block,
+};
+
+static void test_planar_span(void)
+{
+	struct icap_buf_descriptor buf;
+
+	TEST_CHECK_EQ(icap_host_pair_init(&pair, &app_cb, &dev_cb), 0);
+	icap_xlat_init(&xlat);
+	/* Two planes of 0x300 bytes 0x400 apart span 0x700 bytes */
+	TEST_CHECK_EQ(icap_xlat_add(&xlat, 0x10000, 0x80010000, 0x700), 0);
+	TEST_CHECK_EQ(icap_set_xlat(&pair.dev, &xlat), 0);
+
+	memset(&buf, 0, sizeof(buf));
+	buf.type = ICAP_BUF_PLANAR;
+	buf.buf = 0x10000;
+	buf.buf_size = 0x300;
+	buf.frag_size = 0x100;
+	buf.channels = 2;
+	buf.channel_stride = 0x400;
+	TEST_CHECK(icap_add_src(&pair.app, &buf) >= 0);
+	TEST_CHECK_EQ(dev_buf_addr, 0x80010000);
+
+	/* The last plane doesn't fit */
+	buf.channels = 3;
+	dev_buf_addr = 0;
+	TEST_CHECK(icap_add_src(&pair.app, &buf) < 0);
+	TEST_CHECK_EQ(dev_buf_addr, 0);
+
+	buf.type = ICAP_BUF_CIRCURAL;
+	buf.buf = 0x10100;
+	buf.buf_size = 0x600;
+	TEST_CHECK(icap_add_src(&pair.app, &buf) >= 0);
+	TEST_CHECK_EQ(dev_buf_addr, 0x80010100);
+}
+
+/* Checks the control block translation of the instance serving pair.app */
+static void check_ctrl_block(void)
+{
+	struct icap_ctrl_desc desc;
+
+	icap_xlat_init(&xlat);
+	TEST_CHECK_EQ(icap_xlat_add(&xlat, 0x20000, 0x80020000, 0x1000), 0);
+
+	memset(&desc, 0, sizeof(desc));
+	desc.addr = 0x20800;
+	desc.size = 0x800;
+	TEST_CHECK_EQ(icap_set_ctrl_block(&pair.app, &desc), 0);
+	TEST_CHECK_EQ(dev_ctrl_addr, 0x80020800);
+
+	/* The block crosses the region end */
+	dev_ctrl_addr = 0;
+	desc.size = 0x801;
+	TEST_CHECK(icap_set_ctrl_block(&pair.app, &desc) < 0);
+	TEST_CHECK_EQ(dev_ctrl_addr, 0);
+
+	/* Detaching needs no region */
+	dev_ctrl_addr = 1;
+	desc.addr = 0;
+	TEST_CHECK_EQ(icap_set_ctrl_block(&pair.app, &desc), 0);
+	TEST_CHECK_EQ(dev_ctrl_addr, 0);
+}
+
+static void test_ctrl_block(void)
+{
+	TEST_CHECK_EQ(icap_host_pair_init(&pair, &app_cb, &dev_cb), 0);
+	TEST_CHECK_EQ(icap_set_xlat(&pair.dev, &xlat), 0);
+	check_ctrl_block();
+}
+
+/* pair.app -> pair.dev -> proxy -> down.app -> down.dev */
+static void test_proxy_ctrl_block(void)
+{
+	TEST_CHECK_EQ(icap_host_pair_init(&pair, &app_cb, &dev_cb), 0);
+	memset(&down, 0, sizeof(down));
+	TEST_CHECK_EQ(icap_application_init(&down.app, "down_app", &app_cb, NULL), 0);
+	TEST_CHECK_EQ(icap_device_init(&down.dev, "down_dev", &dev_cb, NULL), 0);
+	down.app_ept.addr = DOWN_APP_ADDR;
+	down.app_ept.icap = &down.app;
+	down.dev_ept.addr = DOWN_DEV_ADDR;
+	down.dev_ept.icap = &down.dev;
+	rpmsg_lite_host_register(&down.app_ept);
+	rpmsg_lite_host_register(&down.dev_ept);
+	down.app.transport.rpmsg_instance = &down.rpmsg;
+	down.app.transport.rpmsg_ept = &down.app_ept;
+	down.app.transport.remote_addr = DOWN_DEV_ADDR;
+	down.dev.transport.rpmsg_instance = &down.rpmsg;
+	down.dev.transport.rpmsg_ept = &down.dev_ept;
+
+	/* The proxy translates with the upstream table, the last device has none */
+	TEST_CHECK_EQ(icap_proxy_init(&proxy, &pair.dev, &down.app), 0);
+	TEST_CHECK_EQ(icap_set_xlat(&pair.dev, &xlat), 0);
+	check_ctrl_block();
+	TEST_CHECK_EQ(icap_proxy_deinit(&proxy), 0);
+}
+
+int main(void)
+{
+	test_planar_span();
+	test_ctrl_block();
+	test_proxy_ctrl_block();
+	return TEST_RESULT();
+}